@@ -0,0 +1,284 @@
+/*
+ *  [i] calibracao: erro dos ajustes e das tabelas, custo da conversao
+ *  (build nativo)
+ *
+ *  um NTC "verdadeiro" (Steinhart-Hart de um 10k tipico, nao a equacao
+ *  Beta do config.h) e um LDR "verdadeiro" (r10 e gama afastados dos de
+ *  fabrica) ficam atras dos divisores do config.h e de um ADC ideal de
+ *  12 bits. a ferramenta compara:
+ *
+ *    ajuste    erro contra o sensor verdadeiro dos coeficientes de fabrica
+ *              e dos ajustados (Steinhart-Hart por 0/25/50 C, curva do LDR
+ *              por 1/10/100/1000 lux), com `--ruido-c` e `--ruido-pct` de
+ *              erro nos pontos de referencia, em -20..80 C e 1..10000 lux
+ *
+ *    tabela    GerenciadorCalibracaoBase<AdcIdeal> com os coeficientes
+ *              ajustados (calibrarNTC/calibrarLDR): temperatura() e
+ *              luminosidade() por interpolacao contra a cadeia completa
+ *              com log/pow, em todas as leituras dentro das faixas acima
+ *
+ *    custo     ns por leitura da tabela e da cadeia completa
+ *
+ *  uso: benchmark_calibracao [--ruido-c 0] [--ruido-pct 0] [--leituras 4000000]
+ *                            [--raiz benchmark_calibracao_fs] [--semente 1]
+ *
+ *  sai com 1 se o ajuste sem ruido errar mais de 0.01 C / 0.5%, ou se a
+ *  tabela se afastar da cadeia completa mais de 0.05 C / 1%.
+ */
+
+#include "config.h"
+#include "calibracao.h"
+#include "gerenciador_calibracao.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// SENSORES VERDADEIROS
+
+// 10k NTC tipico (3950 em 25/85 C, curvatura que a Beta nao segue)
+const CoeficientesSteinhartHart NTC_VERDADEIRO = {1.009249522e-3, 2.378405444e-4, 2.019202697e-7};
+const CurvaLDR LDR_VERDADEIRO = {41000.0f, 0.78f};
+
+const double TEMPERATURA_MINIMA = -20.0, TEMPERATURA_MAXIMA = 80.0;
+const double LUX_MINIMO = 1.0, LUX_MAXIMO = 10000.0;
+
+/*
+ * inversa fechada de Steinhart-Hart: resistencia na temperatura
+ */
+static double resistenciaNTC(const CoeficientesSteinhartHart &coef, double temperatura_c)
+{
+    double x = (coef.a - 1.0 / (temperatura_c - ZERO_KELVIN)) / coef.c;
+    double y = sqrt(pow(coef.b / (3.0 * coef.c), 3) + x * x / 4.0);
+    return exp(cbrt(y - x / 2.0) - cbrt(y + x / 2.0));
+}
+
+static double resistenciaLDR(const CurvaLDR &curva, double lux)
+{
+    return curva.r10 * pow(lux / 10.0, -curva.gama);
+}
+
+/*
+ * leitura do ADC ideal para o sensor no lado de baixo do divisor
+ */
+static double leituraDivisor(double resistencia, double resistor_serie)
+{
+    return LEITURA_ADC_MAXIMA * resistencia / (resistencia + resistor_serie);
+}
+
+// ERROS
+
+struct Erro
+{
+    double maximo = 0.0;
+    double soma_quadrados = 0.0;
+    uint32_t pontos = 0;
+
+    void somar(double erro)
+    {
+        maximo = std::max(maximo, fabs(erro));
+        soma_quadrados += erro * erro;
+        pontos++;
+    }
+
+    double rms() const
+    {
+        return pontos ? sqrt(soma_quadrados / pontos) : 0.0;
+    }
+};
+
+/*
+ * erro dos coeficientes contra o NTC verdadeiro, por resistencia exata
+ */
+static Erro erroNTC(const CoeficientesSteinhartHart &coef)
+{
+    Erro erro;
+    for (double t = TEMPERATURA_MINIMA; t <= TEMPERATURA_MAXIMA; t += 0.25)
+        erro.somar(temperaturaSteinhartHart(coef, resistenciaNTC(NTC_VERDADEIRO, t)) - t);
+    return erro;
+}
+
+/*
+ * erro relativo (%) da curva contra o LDR verdadeiro
+ */
+static Erro erroLDR(const CurvaLDR &curva)
+{
+    Erro erro;
+    for (double d = 0.0; d <= 4.0; d += 0.01)
+    {
+        double lux = pow(10.0, d);
+        erro.somar(100.0 * (luminosidadeLDR(curva, resistenciaLDR(LDR_VERDADEIRO, lux)) - lux) / lux);
+    }
+    return erro;
+}
+
+// CUSTO
+
+static double agoraNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Converter>
+static double medirNs(const std::vector<uint16_t> &leituras, Converter converter, float &soma)
+{
+    double inicio = agoraNs();
+    for (uint16_t leitura : leituras)
+        soma += converter(leitura);
+    return (agoraNs() - inicio) / leituras.size();
+}
+
+int main(int argc, char **argv)
+{
+    double ruido_c = 0.0, ruido_pct = 0.0;
+    uint32_t leituras = 4000000;
+    std::string raiz = "benchmark_calibracao_fs";
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--ruido-c")
+            ruido_c = atof(argv[i + 1]);
+        else if (opcao == "--ruido-pct")
+            ruido_pct = atof(argv[i + 1]);
+        else if (opcao == "--leituras")
+            leituras = atol(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (leituras == 0 || ruido_c < 0.0 || ruido_pct < 0.0)
+    {
+        fprintf(stderr, "--leituras precisa ser positivo e os ruidos nao negativos\n");
+        return 2;
+    }
+
+    std::mt19937 aleatorio(semente);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    // pontos de referencia: termometro com ruido_c, fotometro com ruido_pct
+    const double temperaturas[3] = {0.0, 25.0, 50.0};
+    double referencia_t[3], referencia_r[3];
+    for (int i = 0; i < 3; i++)
+    {
+        referencia_t[i] = temperaturas[i] + ruido_c * normal(aleatorio);
+        referencia_r[i] = resistenciaNTC(NTC_VERDADEIRO, temperaturas[i]);
+    }
+    const float luxes[4] = {1.0f, 10.0f, 100.0f, 1000.0f};
+    float referencia_lux[4], referencia_ldr[4];
+    for (int i = 0; i < 4; i++)
+    {
+        referencia_lux[i] = luxes[i] * (1.0 + ruido_pct / 100.0 * normal(aleatorio));
+        referencia_ldr[i] = resistenciaLDR(LDR_VERDADEIRO, luxes[i]);
+    }
+
+    CoeficientesSteinhartHart ntc_ajustado;
+    CurvaLDR ldr_ajustado;
+    if (!ajustarSteinhartHart(referencia_r, referencia_t, ntc_ajustado) ||
+        !ajustarCurvaLDR(referencia_lux, referencia_ldr, 4, ldr_ajustado))
+    {
+        fprintf(stderr, "pontos de referencia degenerados\n");
+        return 2;
+    }
+
+    CoeficientesSteinhartHart ntc_fabrica = steinhartHartDeBeta(BETA_TERMISTOR, RESISTENCIA_NTC_25C);
+    CurvaLDR ldr_fabrica = {RESISTENCIA_LDR * 1000.0f, GAMA_LDR};
+    Erro ntc_antes = erroNTC(ntc_fabrica), ntc_depois = erroNTC(ntc_ajustado);
+    Erro ldr_antes = erroLDR(ldr_fabrica), ldr_depois = erroLDR(ldr_ajustado);
+
+    printf("[benchmark_calibracao] ruido nos pontos de referencia: %.2f C, %.1f%%\n", ruido_c, ruido_pct);
+    printf("ajuste contra o sensor verdadeiro:\n");
+    printf("  %-28s %10s %10s\n", "", "max", "rms");
+    printf("  %-28s %8.3f C %8.3f C\n", "ntc fabrica (Beta)", ntc_antes.maximo, ntc_antes.rms());
+    printf("  %-28s %8.3f C %8.3f C\n", "ntc Steinhart-Hart 3 pontos", ntc_depois.maximo, ntc_depois.rms());
+    printf("  %-28s %8.2f %% %8.2f %%\n", "ldr fabrica", ldr_antes.maximo, ldr_antes.rms());
+    printf("  %-28s %8.2f %% %8.2f %%\n", "ldr curva 4 pontos", ldr_depois.maximo, ldr_depois.rms());
+
+    // tabelas do gerenciador com os coeficientes ajustados
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0)
+        return 2;
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    Serial.silenciar(true);
+
+    GerenciadorCalibracaoBase<AdcIdeal> calibracao;
+    calibracao.iniciar();
+    calibracao.calibrarNTC(referencia_r, referencia_t);
+    calibracao.calibrarLDR(referencia_lux, referencia_ldr, 4);
+    const CoeficientesCalibracao &c = calibracao.atuais();
+
+    auto temperaturaCompleta = [&c](uint16_t leitura) -> float {
+        float r = resistenciaDivisor(AdcIdeal::milivolts(leitura), c.tensao_divisores_mv, c.resistor_serie_ntc);
+        return temperaturaSteinhartHart(c.ntc, r);
+    };
+    auto luminosidadeCompleta = [&c](uint16_t leitura) -> float {
+        float r = resistenciaDivisor(AdcIdeal::milivolts(leitura), c.tensao_divisores_mv, c.resistor_serie_ldr);
+        return luminosidadeLDR(c.ldr, r);
+    };
+
+    // leituras que caem nas faixas de interesse
+    double ntc_inicio = leituraDivisor(resistenciaNTC(NTC_VERDADEIRO, TEMPERATURA_MAXIMA), c.resistor_serie_ntc);
+    double ntc_fim = leituraDivisor(resistenciaNTC(NTC_VERDADEIRO, TEMPERATURA_MINIMA), c.resistor_serie_ntc);
+    double ldr_inicio = leituraDivisor(resistenciaLDR(LDR_VERDADEIRO, LUX_MAXIMO), c.resistor_serie_ldr);
+    double ldr_fim = leituraDivisor(resistenciaLDR(LDR_VERDADEIRO, LUX_MINIMO), c.resistor_serie_ldr);
+
+    Erro tabela_ntc, tabela_ldr;
+    std::vector<uint16_t> faixa_ntc, faixa_ldr;
+    for (uint16_t leitura = 1; leitura < LEITURA_ADC_MAXIMA; leitura++)
+    {
+        if (leitura >= ntc_inicio && leitura <= ntc_fim)
+        {
+            tabela_ntc.somar(calibracao.temperatura(leitura) - temperaturaCompleta(leitura));
+            faixa_ntc.push_back(leitura);
+        }
+        if (leitura >= ldr_inicio && leitura <= ldr_fim)
+        {
+            float completa = luminosidadeCompleta(leitura);
+            tabela_ldr.somar(100.0 * (calibracao.luminosidade(leitura) - completa) / completa);
+            faixa_ldr.push_back(leitura);
+        }
+    }
+
+    printf("tabela (%u pontos) contra a cadeia completa:\n", PONTOS_TABELA_CALIBRACAO);
+    printf("  %-28s %8.4f C %8.4f C  (%zu leituras)\n", "temperatura", tabela_ntc.maximo, tabela_ntc.rms(),
+           faixa_ntc.size());
+    printf("  %-28s %8.3f %% %8.3f %%  (%zu leituras)\n", "luminosidade", tabela_ldr.maximo, tabela_ldr.rms(),
+           faixa_ldr.size());
+
+    // custo por leitura, leituras sorteadas dentro das faixas
+    std::vector<uint16_t> ntc_sorteadas(leituras), ldr_sorteadas(leituras);
+    for (uint32_t i = 0; i < leituras; i++)
+    {
+        ntc_sorteadas[i] = faixa_ntc[aleatorio() % faixa_ntc.size()];
+        ldr_sorteadas[i] = faixa_ldr[aleatorio() % faixa_ldr.size()];
+    }
+    float soma = 0.0f;
+    double ns_tabela_ntc = medirNs(ntc_sorteadas, [&](uint16_t l) { return calibracao.temperatura(l); }, soma);
+    double ns_completa_ntc = medirNs(ntc_sorteadas, temperaturaCompleta, soma);
+    double ns_tabela_ldr = medirNs(ldr_sorteadas, [&](uint16_t l) { return calibracao.luminosidade(l); }, soma);
+    double ns_completa_ldr = medirNs(ldr_sorteadas, luminosidadeCompleta, soma);
+
+    printf("custo por leitura (%u leituras, checksum %.0f):\n", leituras, soma);
+    printf("  %-28s %8.1f ns, cadeia completa %8.1f ns (%.1fx)\n", "temperatura (tabela)", ns_tabela_ntc,
+           ns_completa_ntc, ns_completa_ntc / ns_tabela_ntc);
+    printf("  %-28s %8.1f ns, cadeia completa %8.1f ns (%.1fx)\n", "luminosidade (tabela)", ns_tabela_ldr,
+           ns_completa_ldr, ns_completa_ldr / ns_tabela_ldr);
+
+    bool ajuste_ok = (ruido_c > 0.0 || ntc_depois.maximo <= 0.01) && (ruido_pct > 0.0 || ldr_depois.maximo <= 0.5);
+    bool tabela_ok = tabela_ntc.maximo <= 0.05 && tabela_ldr.maximo <= 1.0;
+    printf("ajuste dentro de 0.01 C / 0.5%% (sem ruido) e tabela dentro de 0.05 C / 1%%: %s\n",
+           ajuste_ok && tabela_ok ? "sim" : "NAO");
+    return ajuste_ok && tabela_ok ? 0 : 1;
+}
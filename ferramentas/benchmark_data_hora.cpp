@@ -0,0 +1,182 @@
+/*
+ *  [i] formatacao de data/hora: civil-from-days x strftime (build nativo)
+ *
+ *  confere o formatarDataHora (formato_tempo.h) contra gmtime_r + strftime
+ *  em todo dia de 1970 a 2100 (meia-noite, 23:59:59 e um segundo sorteado)
+ *  e com o FUSO_HORARIO_S aplicado. depois mede ns por chamada de:
+ *
+ *    formatarDataHora     o atual, so na exibicao/exportacao
+ *    gmtime_r + strftime  a mesma conta pela libc, sem fuso
+ *    localtime + strftime o antigo epochParaString, a cada leitura
+ *                         (TZ do host definido como o fuso do config.h)
+ *
+ *  e os bytes que o texto custava por registro: DadosTempo com o layout
+ *  do ESP32 (long de 32 bits), a coluna data_hora em cada linha do log e
+ *  o total por dia no periodo de amostragem.
+ *
+ *  uso: benchmark_data_hora [--chamadas 2000000] [--periodo-s 300]
+ *                           [--semente 1]
+ *
+ *  sai com 1 se alguma data divergir da libc.
+ */
+
+#include "config.h"
+#include "formato_tempo.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// LAYOUTS NO ESP32 (unsigned long de 32 bits)
+
+struct DadosTempoAnterior
+{
+    uint32_t epoch;
+    uint32_t millis_sincronizado;
+    bool sincronizado;
+    uint32_t incerteza_ms;
+    char data_hora[20];
+};
+
+struct DadosTempoAtual
+{
+    uint32_t epoch;
+    uint32_t millis_sincronizado;
+    bool sincronizado;
+    uint32_t incerteza_ms;
+};
+
+// CONFERENCIA
+
+static bool conferir(uint32_t epoch, int32_t fuso_s, uint32_t &divergencias)
+{
+    char nosso[TAMANHO_DATA_HORA];
+    char libc[32];
+    formatarDataHora(epoch, fuso_s, nosso);
+
+    time_t bruto = (time_t)epoch + fuso_s;
+    struct tm partes;
+    gmtime_r(&bruto, &partes);
+    strftime(libc, sizeof(libc), "%Y-%m-%d %H:%M:%S", &partes);
+
+    if (strcmp(nosso, libc) == 0)
+        return true;
+    if (divergencias++ < 5)
+        printf("  divergencia em %u (fuso %d): %s x %s\n", epoch, fuso_s, nosso, libc);
+    return false;
+}
+
+// MEDIDAS
+
+template <typename Formatar>
+static double medirNs(const std::vector<uint32_t> &epochs, Formatar formatar, uint32_t &soma)
+{
+    char texto[32];
+    auto inicio = std::chrono::steady_clock::now();
+    for (uint32_t epoch : epochs)
+    {
+        formatar(epoch, texto);
+        soma += (uint8_t)texto[18]; // mantem o resultado vivo
+    }
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - inicio).count();
+    return ns / epochs.size();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t chamadas = 2000000;
+    uint32_t periodo_s = TEMPO_AMOSTRAGEM / 1000;
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--chamadas")
+            chamadas = atol(argv[i + 1]);
+        else if (opcao == "--periodo-s")
+            periodo_s = atol(argv[i + 1]);
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (chamadas == 0 || periodo_s == 0)
+    {
+        fprintf(stderr, "--chamadas e --periodo-s precisam ser positivos\n");
+        return 2;
+    }
+
+    std::mt19937 aleatorio(semente);
+
+    // todo dia de 1970 ate 2100 (o epoch de 32 bits sem sinal vai ate 2106)
+    const uint32_t fim = 4102444800u; // 2100-01-01
+    uint32_t conferidas = 0, divergencias = 0;
+    for (uint64_t dia = 0; dia * 86400 < fim; dia++)
+    {
+        uint32_t meia_noite = (uint32_t)(dia * 86400);
+        uint32_t sorteado = meia_noite + aleatorio() % 86400;
+        conferir(meia_noite, 0, divergencias);
+        conferir(meia_noite + 86399, 0, divergencias);
+        conferir(sorteado, 0, divergencias);
+        conferidas += 3;
+        if (sorteado > (uint32_t)-FUSO_HORARIO_S)
+        {
+            conferir(sorteado, FUSO_HORARIO_S, divergencias);
+            conferidas++;
+        }
+    }
+
+    // epochs plausiveis para os registros (2020 a 2040)
+    std::vector<uint32_t> epochs(chamadas);
+    for (uint32_t &epoch : epochs)
+        epoch = 1577836800u + aleatorio() % (20u * 365 * 86400);
+
+    // o antigo usava localtime: fuso do host igual ao do config.h
+    char tz[32];
+    snprintf(tz, sizeof(tz), "<%+03d>%d", FUSO_HORARIO_S / 3600, -FUSO_HORARIO_S / 3600);
+    setenv("TZ", tz, 1);
+    tzset();
+
+    uint32_t soma = 0;
+    double ns_atual = medirNs(epochs, [](uint32_t epoch, char *texto) { formatarDataHora(epoch, FUSO_HORARIO_S, texto); },
+                              soma);
+    double ns_gmtime = medirNs(epochs,
+                               [](uint32_t epoch, char *texto) {
+                                   time_t bruto = (time_t)epoch + FUSO_HORARIO_S;
+                                   struct tm partes;
+                                   gmtime_r(&bruto, &partes);
+                                   strftime(texto, 32, "%Y-%m-%d %H:%M:%S", &partes);
+                               },
+                               soma);
+    double ns_localtime = medirNs(epochs,
+                                  [](uint32_t epoch, char *texto) {
+                                      time_t bruto = epoch;
+                                      strftime(texto, 32, "%Y-%m-%d %H:%M:%S", localtime(&bruto));
+                                  },
+                                  soma);
+
+    // o texto custava 19 bytes + a virgula em cada linha do csv
+    uint32_t coluna_csv = TAMANHO_DATA_HORA - 1 + 1;
+    uint32_t registros_dia = 86400 / periodo_s;
+
+    printf("[benchmark_data_hora] %u datas conferidas (1970-2100), %u chamadas medidas (checksum %u)\n", conferidas,
+           chamadas, soma);
+    printf("  divergencias da libc: %u\n", divergencias);
+    printf("  %-22s %8.1f ns/chamada\n", "formatarDataHora", ns_atual);
+    printf("  %-22s %8.1f ns/chamada (%.1fx)\n", "gmtime_r + strftime", ns_gmtime, ns_gmtime / ns_atual);
+    printf("  %-22s %8.1f ns/chamada (%.1fx)\n", "localtime + strftime", ns_localtime, ns_localtime / ns_atual);
+    printf("bytes por registro (layout do ESP32):\n");
+    printf("  DadosTempo na RAM: %zu -> %zu (-%zu)\n", sizeof(DadosTempoAnterior), sizeof(DadosTempoAtual),
+           sizeof(DadosTempoAnterior) - sizeof(DadosTempoAtual));
+    printf("  linha do log e do upload: -%u bytes (coluna data_hora)\n", coluna_csv);
+    printf("  por dia a cada %u s: -%u bytes na flash e no upload\n", periodo_s, coluna_csv * registros_dia);
+
+    return divergencias == 0 ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+/*
+ *  [i] desgaste da flash: append x lote x segmentos (build nativo)
+ *
+ *  grava `ciclos` leituras do GerenciadorSensores no LittleFS do host
+ *  (stand-in: diretorio do host) por tres esquemas, com o mesmo modelo de
+ *  custo do MonitorFlash (estatisticas_flash.h) contando o que a flash
+ *  programaria e apagaria:
+ *
+ *    append      um open-append-close por ciclo no log unico; o upload
+ *                le o log e o reescreve so com o cabecalho (o atual)
+ *    lote        as linhas esperam na RTC e vao num unico append a cada
+ *                `lote` ciclos ou no upload (ate lote-1 leituras se perdem
+ *                numa queda de energia)
+ *    segmentos   append num arquivo de ate `segmento-bytes`; ao encher abre
+ *                o proximo, e o upload apaga os segmentos enviados em vez
+ *                de reescrever o log
+ *
+ *  o upload acontece a cada `upload-cada` ciclos e confere que todas as
+ *  leituras chegaram. a vida util usa a particao padrao e o periodo dado.
+ *
+ *  uso: benchmark_flash [--ciclos 8640] [--periodo-s 300] [--upload-cada 12]
+ *                       [--lote 12] [--segmento-bytes 4096]
+ *                       [--raiz benchmark_flash_fs]
+ */
+
+#include "config.h"
+#include "estatisticas_flash.h"
+#include "gerenciador_sensores.h"
+#include "codec_registro.h"
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+// GERACAO DAS LINHAS
+
+struct Fonte
+{
+    GerenciadorSensores sensores;
+    String cabecalho;
+    std::vector<std::string> linhas;
+
+    /*
+     * as mesmas leituras para os tres esquemas, formatadas como no
+     * gravarNaFaixa (sem a quebra)
+     */
+    void gerar(uint32_t ciclos, uint32_t periodo_s)
+    {
+        sensores.iniciar();
+        cabecalho = "seq,timestamp,incerteza_ms,mapa,marcas";
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+            cabecalho += "," + String(GerenciadorSensores::canais()[i].nome);
+        cabecalho += ",crc32";
+
+        char linha[tamanhoMaximoLinhaRegistro(NUMERO_CANAIS) + 1];
+        uint32_t epoch = time(NULL) - ciclos * periodo_s;
+        for (uint32_t sequencia = 1; sequencia <= ciclos; sequencia++, epoch += periodo_s)
+        {
+            DadosSensores dados = sensores.lerSensores(epoch);
+            uint32_t crc;
+            formatarLinhaRegistro(sequencia, epoch, INCERTEZA_NTP_MS, dados.canais, GerenciadorSensores::canais(),
+                                  linha, crc);
+            linhas.push_back(linha);
+        }
+    }
+};
+
+/*
+ * linhas de registro de um arquivo (sem o cabecalho)
+ */
+static uint32_t contarRegistros(const char *nome)
+{
+    File arquivo = LittleFS.open(nome, "r");
+    if (!arquivo)
+        return 0;
+    uint32_t linhas = 0;
+    uint8_t bloco[512];
+    size_t lidos;
+    while ((lidos = arquivo.read(bloco, sizeof(bloco))) > 0)
+        for (size_t i = 0; i < lidos; i++)
+            linhas += bloco[i] == '\n';
+    arquivo.close();
+    return linhas > 0 ? linhas - 1 : 0;
+}
+
+// ESQUEMAS
+
+struct Resultado
+{
+    EstatisticasFlash estatisticas;
+    uint32_t enviados = 0;
+    float amplificacao = 0.0f;
+};
+
+/*
+ * open-append-close no log unico, como o gravarNaFaixa sem a particao
+ */
+struct EsquemaAppend
+{
+    MonitorFlash &monitor;
+    const String &cabecalho;
+    const char *arquivo = "/dados_log.csv";
+
+    void gravar(const char *linha)
+    {
+        File log = LittleFS.open(arquivo, "a");
+        uint32_t tamanho_anterior = log.size();
+        uint32_t escritos = 0;
+        if (tamanho_anterior == 0)
+            escritos += log.println(cabecalho);
+        escritos += log.println(linha);
+        log.close();
+        monitor.registrarEscrita(tamanho_anterior, escritos);
+    }
+
+    uint32_t enviar()
+    {
+        uint32_t registros = contarRegistros(arquivo);
+        File log = LittleFS.open(arquivo, "w");
+        uint32_t escritos = log.println(cabecalho);
+        log.close();
+        monitor.registrarReescrita(escritos);
+        return registros;
+    }
+};
+
+/*
+ * linhas acumuladas num buffer (a RTC no dispositivo) e um append por lote
+ */
+struct EsquemaLote
+{
+    EsquemaAppend log;
+    uint32_t lote;
+    std::string pendente = "";
+    uint32_t linhas = 0;
+
+    void descarregar()
+    {
+        if (linhas == 0)
+            return;
+        File arquivo = LittleFS.open(log.arquivo, "a");
+        uint32_t tamanho_anterior = arquivo.size();
+        uint32_t escritos = 0;
+        if (tamanho_anterior == 0)
+            escritos += arquivo.println(log.cabecalho);
+        escritos += arquivo.write((const uint8_t *)pendente.data(), pendente.size());
+        arquivo.close();
+        log.monitor.registrarEscrita(tamanho_anterior, escritos);
+        pendente.clear();
+        linhas = 0;
+    }
+
+    void gravar(const char *linha)
+    {
+        pendente += linha;
+        pendente += "\r\n";
+        if (++linhas >= lote)
+            descarregar();
+    }
+
+    uint32_t enviar()
+    {
+        descarregar();
+        return log.enviar();
+    }
+};
+
+/*
+ * arquivos de ate segmento_bytes; o upload remove os cheios e o atual
+ */
+struct EsquemaSegmentos
+{
+    MonitorFlash &monitor;
+    const String &cabecalho;
+    uint32_t segmento_bytes;
+    uint32_t primeiro = 0; // segmento mais antigo ainda no disco
+    uint32_t atual = 0;
+
+    std::string nome(uint32_t segmento)
+    {
+        char texto[32];
+        snprintf(texto, sizeof(texto), "/segmento_%06u.csv", segmento);
+        return texto;
+    }
+
+    void gravar(const char *linha)
+    {
+        File arquivo = LittleFS.open(nome(atual).c_str(), "a");
+        uint32_t tamanho_anterior = arquivo.size();
+        if (tamanho_anterior > 0 && tamanho_anterior + strlen(linha) + 2 > segmento_bytes)
+        {
+            arquivo.close();
+            arquivo = LittleFS.open(nome(++atual).c_str(), "a");
+            tamanho_anterior = 0;
+        }
+        uint32_t escritos = 0;
+        if (tamanho_anterior == 0)
+            escritos += arquivo.println(cabecalho);
+        escritos += arquivo.println(linha);
+        arquivo.close();
+        monitor.registrarEscrita(tamanho_anterior, escritos);
+    }
+
+    uint32_t enviar()
+    {
+        uint32_t registros = 0;
+        for (uint32_t segmento = primeiro; segmento <= atual; segmento++)
+        {
+            std::string arquivo = nome(segmento);
+            registros += contarRegistros(arquivo.c_str());
+            // remover e so um commit no par de metadados do diretorio
+            if (LittleFS.remove(arquivo.c_str()))
+                monitor.registrarReescrita(0);
+        }
+        primeiro = ++atual;
+        return registros;
+    }
+};
+
+template <typename Esquema>
+static Resultado executar(Esquema &esquema, MonitorFlash &monitor, const Fonte &fonte, uint32_t upload_cada)
+{
+    memset(&estatisticas_flash, 0, sizeof(estatisticas_flash));
+
+    Resultado resultado;
+    uint32_t ciclos = fonte.linhas.size();
+    for (uint32_t ciclo = 1; ciclo <= ciclos; ciclo++)
+    {
+        esquema.gravar(fonte.linhas[ciclo - 1].c_str());
+        if (ciclo % upload_cada == 0 || ciclo == ciclos)
+            resultado.enviados += esquema.enviar();
+    }
+    resultado.estatisticas = estatisticas_flash;
+    resultado.amplificacao = monitor.amplificacaoEscrita();
+    return resultado;
+}
+
+/*
+ * vida pelos blocos apagados por dia, espalhados pela particao padrao
+ * (o vidaUtilDias do monitor divide por escritas, e o lote junta varias)
+ */
+static void imprimir(const char *nome, const Resultado &r, uint32_t ciclos, uint32_t periodo_s)
+{
+    double dias = (double)ciclos * periodo_s / 86400.0;
+    double blocos_dia = r.estatisticas.blocos_apagados / dias;
+    double vida_anos = (double)(TAMANHO_PARTICAO_PADRAO / FLASH_TAMANHO_BLOCO) * RESISTENCIA_CICLOS_FLASH / blocos_dia / 365.0;
+    printf("  %-10s %10u %11u %9u %7.2fx %10.1f %10.1f   %u/%u\n", nome, r.estatisticas.bytes_solicitados,
+           r.estatisticas.bytes_programados, r.estatisticas.blocos_apagados, r.amplificacao, blocos_dia, vida_anos,
+           r.enviados, ciclos);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ciclos = 8640;
+    uint32_t periodo_s = TEMPO_AMOSTRAGEM / 1000;
+    uint32_t upload_cada = 12;
+    uint32_t lote = 12;
+    uint32_t segmento_bytes = FLASH_TAMANHO_BLOCO;
+    std::string raiz = "benchmark_flash_fs";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--ciclos")
+            ciclos = atol(argv[i + 1]);
+        else if (opcao == "--periodo-s")
+            periodo_s = atol(argv[i + 1]);
+        else if (opcao == "--upload-cada")
+            upload_cada = atol(argv[i + 1]);
+        else if (opcao == "--lote")
+            lote = atol(argv[i + 1]);
+        else if (opcao == "--segmento-bytes")
+            segmento_bytes = atol(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (ciclos == 0 || periodo_s == 0 || upload_cada == 0 || lote == 0 || segmento_bytes == 0)
+    {
+        fprintf(stderr, "--ciclos, --periodo-s, --upload-cada, --lote e --segmento-bytes precisam ser positivos\n");
+        return 2;
+    }
+
+    mkdir(raiz.c_str(), 0755);
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    Serial.silenciar(true);
+
+    Fonte fonte;
+    fonte.gerar(ciclos, periodo_s);
+    MonitorFlash monitor;
+
+    EsquemaAppend append = {monitor, fonte.cabecalho};
+    LittleFS.remove(append.arquivo);
+    Resultado r_append = executar(append, monitor, fonte, upload_cada);
+
+    EsquemaLote em_lote = {{monitor, fonte.cabecalho}, lote, "", 0};
+    LittleFS.remove(em_lote.log.arquivo);
+    Resultado r_lote = executar(em_lote, monitor, fonte, upload_cada);
+
+    EsquemaSegmentos segmentos = {monitor, fonte.cabecalho, segmento_bytes};
+    Resultado r_segmentos = executar(segmentos, monitor, fonte, upload_cada);
+
+    printf("[benchmark_flash] %u ciclos de %u s (%.1f dias), upload a cada %u, lote de %u, segmentos de %u bytes\n",
+           ciclos, periodo_s, (double)ciclos * periodo_s / 86400.0, upload_cada, lote, segmento_bytes);
+    printf("  %-10s %10s %11s %9s %8s %10s %10s   %s\n", "esquema", "solicitados", "programados", "apagados",
+           "amplif", "blocos/dia", "vida anos", "enviados");
+    imprimir("append", r_append, ciclos, periodo_s);
+    imprimir("lote", r_lote, ciclos, periodo_s);
+    imprimir("segmentos", r_segmentos, ciclos, periodo_s);
+
+    bool completo = r_append.enviados == ciclos && r_lote.enviados == ciclos && r_segmentos.enviados == ciclos;
+    printf("todos os esquemas enviaram as %u leituras: %s\n", ciclos, completo ? "sim" : "NAO");
+    return completo ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+/*
+ *  [i] gateway (datagramas) x http por despertar (build nativo)
+ *
+ *  a cada despertar o dispositivo grava `registros` leituras novas e as
+ *  envia pelo GerenciadorUpload real, primeiro so pelo gateway
+ *  (enviarPorGateway: stand-in do esp-now -> gateway_local em udp), depois
+ *  so pelo http (associacao + enviarComRetentativas -> servidor_ingestao).
+ *  mede o tempo do radio ate tudo confirmado e os bytes nos dois sentidos.
+ *
+ *  o http paga a associacao + dhcp (--conexao-ms no stand-in do wifi) e
+ *  uma conexao tcp por POST; o esp-now nao associa. bytes de aplicacao
+ *  sao exatos; "no ar" soma uma estimativa por pacote: 43 bytes por quadro
+ *  esp-now (cabecalho 802.11 + action vendor + fcs) e, no http, 8 pacotes
+ *  de controle tcp + os de dados, cada um com 40 de ip/tcp + 34 de 802.11.
+ *
+ *  com --verificar, as linhas que o gateway refez (<dir>/<mac>_faixa<N>.csv)
+ *  sao comparadas com as que estavam na flash: o lote binario e sem perdas.
+ *
+ *  uso: benchmark_gateway [--despertares 20] [--registros 10] [--conexao-ms 0]
+ *                         [--url http://127.0.0.1:8080/api] [--gateway 127.0.0.1:8090]
+ *                         [--raiz benchmark_gateway_fs] [--verificar gateway_dados]
+ *
+ *  precisa do gateway_local e do servidor_ingestao rodando.
+ */
+
+#include "config.h"
+#include "gerenciador_upload.h"
+#include "modelo_energia.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <vector>
+
+const uint32_t BYTES_QUADRO_ESP_NOW = 43;
+const uint32_t BYTES_PACOTE_TCP = 40 + 34;
+const uint32_t PACOTES_CONTROLE_TCP = 8; // syn, syn-ack, ack, fin/ack nos dois sentidos, acks
+const uint32_t MSS_TCP = 1460;
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+struct ResultadoCaminho
+{
+    std::vector<uint32_t> radio_us;
+    uint64_t bytes_enviados = 0;
+    uint64_t bytes_recebidos = 0;
+    uint64_t bytes_no_ar = 0;
+    uint32_t pacotes = 0; // datagramas ou POSTs
+    uint32_t falhas = 0;
+};
+
+/*
+ * `quantidade` leituras novas a partir de epoch, com as regras de faixa
+ */
+static void gravarLeituras(GerenciadorArmazenamento &armazenamento, GerenciadorSensores &sensores, uint32_t &epoch,
+                           uint32_t quantidade, uint32_t periodo_s)
+{
+    for (uint32_t i = 0; i < quantidade; i++, epoch += periodo_s)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores dados = sensores.lerSensores(epoch);
+        armazenamento.salvarRegistro(tempo, dados);
+    }
+}
+
+/*
+ * associacao sondada a cada 1 ms: conta o tempo simulado do radio, nao o
+ * intervalo de sondagem do GerenciadorWiFi (1 s no fisico)
+ */
+static bool associar(unsigned long limite_ms)
+{
+    unsigned long inicio = millis();
+    WiFi.begin(WIFI_SSID, WIFI_SENHA);
+    while (WiFi.status() != WL_CONNECTED)
+    {
+        if (millis() - inicio > limite_ms)
+            return false;
+        delay(1);
+    }
+    return true;
+}
+
+/*
+ * linhas pendentes de todas as faixas (o que o gateway deve refazer)
+ */
+static void lerPendentes(GerenciadorArmazenamento &armazenamento, std::set<std::string> &linhas)
+{
+    for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+    {
+        File log = armazenamento.abrirLeitura(faixas()[f].arquivo);
+        if (!log)
+            continue;
+        log.readStringUntil('\n');
+        while (log.available())
+        {
+            String linha = log.readStringUntil('\n');
+            linha.trim();
+            if (linha.length() > 0)
+                linhas.insert(linha.c_str());
+        }
+        log.close();
+    }
+}
+
+/*
+ * arquivo em que o gateway_local acumula as linhas da faixa
+ */
+static std::string arquivoGateway(const std::string &diretorio, uint8_t faixa)
+{
+    uint8_t mac[TAMANHO_MAC_GATEWAY];
+    WiFi.macAddress(mac);
+    char dispositivo[2 * TAMANHO_MAC_GATEWAY + 1];
+    for (size_t i = 0; i < TAMANHO_MAC_GATEWAY; i++)
+        snprintf(dispositivo + 2 * i, 3, "%02x", mac[i]);
+    return diretorio + "/" + dispositivo + "_faixa" + std::to_string(faixa) + ".csv";
+}
+
+static void imprimirCaminho(const char *nome, const ResultadoCaminho &r, uint32_t registros,
+                            const TabelaCorrente &correntes)
+{
+    size_t n = r.radio_us.size();
+    printf("  %-8s %zu despertares (%u falhas)\n", nome, n, r.falhas);
+    if (n == 0)
+        return;
+    uint32_t p50 = percentil(r.radio_us, 0.50);
+    printf("           radio ate confirmar: p50 %.2f ms, p99 %.2f ms\n", p50 / 1000.0, percentil(r.radio_us, 0.99) / 1000.0);
+    printf("           por despertar: %.1f pacotes, %.0f bytes enviados + %.0f recebidos (%.1f bytes/registro)\n",
+           (double)r.pacotes / n, (double)r.bytes_enviados / n, (double)r.bytes_recebidos / n,
+           (double)r.bytes_enviados / n / registros);
+    printf("           no ar (estimado): %.0f bytes por despertar\n", (double)r.bytes_no_ar / n);
+    float uah = energiaEstadoUAh(correntes.corrente_ma[ENERGIA_CPU] + correntes.corrente_ma[ENERGIA_RADIO], p50) / 1000;
+    printf("           carga do radio por despertar: %.3f uAh\n", uah);
+}
+
+int main(int argc, char **argv)
+{
+    int despertares = 20;
+    int registros = 10;
+    unsigned long conexao_ms = 0;
+    std::string url = SERVIDOR_URL;
+    std::string gateway = "127.0.0.1:8090";
+    std::string raiz = "benchmark_gateway_fs";
+    std::string verificar;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--despertares")
+            despertares = atoi(argv[i + 1]);
+        else if (opcao == "--registros")
+            registros = atoi(argv[i + 1]);
+        else if (opcao == "--conexao-ms")
+            conexao_ms = atol(argv[i + 1]);
+        else if (opcao == "--url")
+            url = argv[i + 1];
+        else if (opcao == "--gateway")
+            gateway = argv[i + 1];
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--verificar")
+            verificar = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    size_t dois_pontos = gateway.find(':');
+    if (despertares <= 0 || registros <= 0 || dois_pontos == std::string::npos)
+    {
+        fprintf(stderr, "--despertares e --registros precisam ser positivos, --gateway host:porta\n");
+        return 2;
+    }
+    esp_now_nativo.definirGateway(gateway.substr(0, dois_pontos).c_str(), atoi(gateway.c_str() + dois_pontos + 1));
+
+    // dispositivo novo: logs e seqs das faixas zerados
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    Preferences nvs;
+    nvs.begin(ESPACO_NVS_CONFIG, false);
+    for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+    {
+        LittleFS.remove(faixas()[f].arquivo);
+        nvs.remove(faixas()[f].chave_nvs);
+        if (!verificar.empty())
+            remove(arquivoGateway(verificar, f).c_str()); // o gateway acrescenta; comeca vazio
+    }
+    nvs.end();
+
+    Serial.silenciar(true);
+    GerenciadorArmazenamento armazenamento;
+    GerenciadorSensores sensores;
+    GerenciadorUpload upload(url.c_str());
+    armazenamento.iniciar();
+    sensores.iniciar();
+    upload.setGatewayHabilitado(true);
+    WiFi.definirLatenciaConexao(conexao_ms);
+    TabelaCorrente correntes = {CORRENTES_ENERGIA};
+
+    uint32_t periodo_s = TEMPO_DEEP_SLEEP_COMPLETO / 1000;
+    uint32_t epoch = time(NULL) - 2 * despertares * registros * periodo_s;
+    std::set<std::string> enviadas;
+
+    // gateway: o radio nao associa
+    ResultadoCaminho via_gateway;
+    for (int i = 0; i < despertares; i++)
+    {
+        gravarLeituras(armazenamento, sensores, epoch, registros, periodo_s);
+        if (!verificar.empty())
+            lerPendentes(armazenamento, enviadas);
+
+        WiFi.disconnect();
+        uint32_t datagramas_antes = contadores_esp_now.enviados + contadores_esp_now.recebidos;
+        uint64_t enviados_antes = contadores_esp_now.bytes_enviados;
+        uint64_t recebidos_antes = contadores_esp_now.bytes_recebidos;
+        unsigned long inicio = micros();
+        bool ok = upload.enviarPorGateway(armazenamento);
+        unsigned long radio_us = micros() - inicio;
+
+        if (!ok)
+        {
+            via_gateway.falhas++;
+            continue;
+        }
+        uint32_t quadros = contadores_esp_now.enviados + contadores_esp_now.recebidos - datagramas_antes;
+        uint64_t enviados = contadores_esp_now.bytes_enviados - enviados_antes;
+        uint64_t recebidos = contadores_esp_now.bytes_recebidos - recebidos_antes;
+        via_gateway.radio_us.push_back(radio_us);
+        via_gateway.pacotes += quadros;
+        via_gateway.bytes_enviados += enviados;
+        via_gateway.bytes_recebidos += recebidos;
+        via_gateway.bytes_no_ar += enviados + recebidos + quadros * BYTES_QUADRO_ESP_NOW;
+    }
+
+    // http: associacao + tcp + POST a cada despertar
+    upload.setGatewayHabilitado(false);
+    ResultadoCaminho via_http;
+    for (int i = 0; i < despertares; i++)
+    {
+        gravarLeituras(armazenamento, sensores, epoch, registros, periodo_s);
+
+        WiFi.disconnect();
+        uint32_t posts_antes = contadores_http.requisicoes;
+        uint64_t enviados_antes = contadores_http.bytes_enviados;
+        uint64_t recebidos_antes = contadores_http.bytes_recebidos;
+        unsigned long inicio = micros();
+        bool ok = associar(conexao_ms + 1000) && upload.enviarComRetentativas(armazenamento);
+        unsigned long radio_us = micros() - inicio;
+
+        if (!ok)
+        {
+            via_http.falhas++;
+            continue;
+        }
+        uint32_t posts = contadores_http.requisicoes - posts_antes;
+        uint64_t enviados = contadores_http.bytes_enviados - enviados_antes;
+        uint64_t recebidos = contadores_http.bytes_recebidos - recebidos_antes;
+        uint32_t pacotes = posts * PACOTES_CONTROLE_TCP + (uint32_t)((enviados + MSS_TCP - 1) / MSS_TCP) +
+                           (uint32_t)((recebidos + MSS_TCP - 1) / MSS_TCP);
+        via_http.radio_us.push_back(radio_us);
+        via_http.pacotes += posts;
+        via_http.bytes_enviados += enviados;
+        via_http.bytes_recebidos += recebidos;
+        via_http.bytes_no_ar += enviados + recebidos + pacotes * BYTES_PACOTE_TCP;
+    }
+
+    printf("[gateway] %d despertares por caminho, %d registros cada (conexao wifi simulada %lu ms)\n", despertares,
+           registros, conexao_ms);
+    imprimirCaminho("gateway", via_gateway, registros, correntes);
+    imprimirCaminho("http", via_http, registros, correntes);
+    if (!via_gateway.radio_us.empty() && !via_http.radio_us.empty())
+    {
+        printf("  gateway: %.1fx menos bytes no ar, %.1fx menos tempo de radio\n",
+               (double)via_http.bytes_no_ar / via_gateway.bytes_no_ar,
+               (double)percentil(via_http.radio_us, 0.50) / percentil(via_gateway.radio_us, 0.50));
+    }
+
+    bool integro = true;
+    if (!verificar.empty())
+    {
+        std::set<std::string> refeitas;
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            std::ifstream arquivo(arquivoGateway(verificar, f));
+            std::string linha;
+            while (std::getline(arquivo, linha))
+                refeitas.insert(linha);
+        }
+        size_t faltando = 0;
+        for (const std::string &linha : enviadas)
+            faltando += refeitas.count(linha) == 0;
+        integro = faltando == 0;
+        printf("  verificacao: %zu linhas na flash, %zu refeitas pelo gateway, %zu faltando -> %s\n", enviadas.size(),
+               refeitas.size(), faltando, integro ? "identicas" : "DIFERENTES");
+    }
+
+    return via_gateway.falhas == 0 && via_http.falhas == 0 && integro ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+/*
+ *  [i] leitura do log: particao mapeada x LittleFS (build nativo)
+ *
+ *  grava `registros` leituras pelo GerenciadorArmazenamento real duas vezes:
+ *  com os logs no LittleFS (stand-in: diretorio do host) e com a particao
+ *  "registros" declarada no stand-in do esp_partition (arquivo do host
+ *  mapeado com mmap). na faixa bruta, mede:
+ *
+ *    leitura + crc   o log inteiro, com o crc de cada linha verificado
+ *    lotes gateway   lotes de TAMANHO_MAXIMO_LOTE decodificados e codificados
+ *                    em datagramas, como no enviarLoteGateway (sem radio)
+ *
+ *  e o caminho de antes no mesmo LittleFS: readStringUntil('\n') e uma
+ *  String por linha, lote montado numa String e separado de novo no ';'.
+ *  ciclos pelo contador de tempo do processador (x86), alocacoes pelo
+ *  operator new do processo. mediana das repeticoes.
+ *
+ *  no esp32 o readStringUntil le um byte por chamada ao VFS
+ *  (Stream::timedRead); aqui o FILE* tem buffer, entao a diferenca medida
+ *  no host e um limite inferior da do dispositivo.
+ *
+ *  uso: benchmark_leitura [--registros 50000] [--repeticoes 5]
+ *                         [--raiz benchmark_leitura_fs]
+ */
+
+#include "config.h"
+#include "gerenciador_armazenamento.h"
+#include "protocolo_gateway.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <sys/stat.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t ciclos()
+{
+    return __rdtsc();
+}
+#else
+static uint64_t ciclos()
+{
+    return 0; // sem contador acessivel: so o tempo
+}
+#endif
+
+// ALOCACOES
+
+static uint64_t alocacoes = 0;
+
+void *operator new(size_t tamanho)
+{
+    alocacoes++;
+    void *p = malloc(tamanho ? tamanho : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// MEDIDAS
+
+struct Medida
+{
+    uint32_t registros = 0;
+    uint32_t integros = 0;
+    uint64_t bytes = 0;
+    uint32_t datagramas = 0;
+    uint64_t ns = 0;
+    uint64_t ciclos = 0;
+    uint64_t alocacoes = 0;
+};
+
+template <typename Caminho>
+static Medida medir(int repeticoes, Caminho caminho)
+{
+    std::vector<Medida> medidas;
+    for (int r = 0; r < repeticoes; r++)
+    {
+        Medida m;
+        uint64_t alocacoes_antes = alocacoes;
+        auto inicio = std::chrono::steady_clock::now();
+        uint64_t ciclos_antes = ciclos();
+        caminho(m);
+        m.ciclos = ciclos() - ciclos_antes;
+        m.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - inicio).count();
+        m.alocacoes = alocacoes - alocacoes_antes;
+        medidas.push_back(m);
+    }
+    std::sort(medidas.begin(), medidas.end(), [](const Medida &a, const Medida &b) { return a.ns < b.ns; });
+    return medidas[medidas.size() / 2];
+}
+
+static void imprimir(const char *nome, const Medida &m)
+{
+    double registros = m.registros ? m.registros : 1;
+    printf("  %-26s %8.1f MB/s %8.0f ns/reg %8.0f ciclos/reg %6.2f aloc/reg  (%u registros, %u com crc ok",
+           nome, m.bytes / (m.ns / 1e9) / 1e6, m.ns / registros, m.ciclos / registros, m.alocacoes / registros,
+           m.registros, m.integros);
+    if (m.datagramas > 0)
+        printf(", %u datagramas", m.datagramas);
+    printf(")\n");
+}
+
+// CODIFICACAO DOS LOTES
+
+/*
+ * datagramas de um lote, como numa rodada do enviarLoteGateway
+ */
+struct CodificacaoLote
+{
+    CodificadorLoteGateway codificador;
+    const FormatoLog &formato;
+    bool aberto = false;
+
+    CodificacaoLote(const FormatoLog &f) : formato(f) {}
+
+    void acrescentar(const LinhaDecodificada &registro, Medida &m)
+    {
+        if (aberto && codificador.acrescentar(registro))
+            return;
+        uint32_t base = registro.sequencia - 1;
+        if (aberto)
+        {
+            codificador.fechar();
+            m.datagramas++;
+            base = codificador.ultima();
+        }
+        static const uint8_t mac[TAMANHO_MAC_GATEWAY] = {0x02, 0, 0, 0, 0, 0x01};
+        codificador.iniciar(mac, FAIXA_BRUTA, base, !aberto, formato.canais, registro.epoch);
+        aberto = true;
+        codificador.acrescentar(registro);
+    }
+
+    void fechar(Medida &m)
+    {
+        if (!aberto)
+            return;
+        codificador.fechar();
+        m.datagramas++;
+    }
+};
+
+static void verificarLinha(const char *linha, size_t tamanho, const FormatoLog &formato, Medida &m,
+                           CodificacaoLote *lote = NULL)
+{
+    LinhaDecodificada registro;
+    m.registros++;
+    m.bytes += tamanho + 1;
+    if (decodificarLinhaRegistro(linha, tamanho, formato, registro) != LINHA_INTEGRA)
+        return;
+    m.integros++;
+    if (lote)
+        lote->acrescentar(registro, m);
+}
+
+// CAMINHO ANTERIOR (readStringUntil)
+
+static void lerAnterior(const FormatoLog &formato, Medida &m)
+{
+    File arquivo = LittleFS.open(faixas()[FAIXA_BRUTA].arquivo, "r");
+    arquivo.readStringUntil('\n');
+    while (arquivo.available())
+    {
+        String linha = arquivo.readStringUntil('\n');
+        linha.trim();
+        if (linha.length() > 0)
+            verificarLinha(linha.c_str(), linha.length(), formato, m);
+    }
+    arquivo.close();
+}
+
+/*
+ * lotes como o lerDadosParaUpload anterior montava e o enviarRodadaGateway
+ * anterior separava
+ */
+static void lotesAnterior(const FormatoLog &formato, Medida &m)
+{
+    File arquivo = LittleFS.open(faixas()[FAIXA_BRUTA].arquivo, "r");
+    arquivo.readStringUntil('\n');
+    String pendente = "";
+    while (arquivo.available() || pendente.length() > 0)
+    {
+        String dados = pendente;
+        pendente = "";
+        while (arquivo.available())
+        {
+            String linha = arquivo.readStringUntil('\n');
+            linha.trim();
+            if (linha.length() == 0)
+                continue;
+            if (dados.length() > 0 && dados.length() + 1 + linha.length() > TAMANHO_MAXIMO_LOTE)
+            {
+                pendente = linha;
+                break;
+            }
+            if (dados.length() > 0)
+                dados += ";";
+            dados += linha;
+        }
+
+        CodificacaoLote lote(formato);
+        const char *linha = dados.c_str();
+        const char *fim = linha + dados.length();
+        while (linha < fim)
+        {
+            const char *separador = (const char *)memchr(linha, ';', fim - linha);
+            size_t tamanho = (separador ? separador : fim) - linha;
+            verificarLinha(linha, tamanho, formato, m, &lote);
+            linha += tamanho + 1;
+        }
+        lote.fechar(m);
+    }
+    arquivo.close();
+}
+
+// CAMINHO ATUAL (percorrerFaixa / lerLote)
+
+static void lerAtual(GerenciadorArmazenamento &armazenamento, const FormatoLog &formato, Medida &m)
+{
+    armazenamento.percorrerFaixa(FAIXA_BRUTA, 0, [&](const char *linha, size_t tamanho, uint32_t, uint32_t) -> bool {
+        if (tamanho > 0)
+            verificarLinha(linha, tamanho, formato, m);
+        return true;
+    });
+}
+
+/*
+ * lotes pelo lerLote de um gerenciador recem-iniciado (progresso zerado)
+ * o ultimo lote nao e marcado: marcar tudo esvaziaria o log
+ */
+static void lotesAtual(GerenciadorArmazenamento &armazenamento, uint32_t registros, const FormatoLog &formato,
+                       Medida &m)
+{
+    while (true)
+    {
+        CodificacaoLote lote(formato);
+        uint32_t primeira, ultima;
+        armazenamento.lerLote(FAIXA_BRUTA, primeira, ultima, [&](const char *linha, size_t tamanho) {
+            verificarLinha(linha, tamanho, formato, m, &lote);
+        });
+        lote.fechar(m);
+        if (ultima == 0 || ultima >= registros)
+            break;
+        armazenamento.marcarComoEnviado(FAIXA_BRUTA, ultima);
+    }
+}
+
+/*
+ * um gerenciador iniciado por repeticao, fora da medida
+ */
+static Medida medirLotes(int repeticoes, uint32_t registros, const FormatoLog &formato)
+{
+    std::vector<std::unique_ptr<GerenciadorArmazenamento>> gerenciadores;
+    for (int r = 0; r < repeticoes; r++)
+    {
+        gerenciadores.emplace_back(new GerenciadorArmazenamento());
+        gerenciadores.back()->iniciar();
+    }
+    int usado = 0;
+    return medir(repeticoes, [&](Medida &m) { lotesAtual(*gerenciadores[usado++], registros, formato, m); });
+}
+
+// GRAVACAO DO LOG
+
+static void prepararRaiz(const std::string &raiz)
+{
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    Preferences nvs;
+    nvs.begin(ESPACO_NVS_CONFIG, false);
+    for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+    {
+        LittleFS.remove(faixas()[f].arquivo);
+        nvs.remove(faixas()[f].chave_nvs);
+        nvs.remove(faixas()[f].chave_confirmada);
+    }
+    nvs.end();
+}
+
+static void gravarLog(GerenciadorSensores &sensores, uint32_t registros)
+{
+    GerenciadorArmazenamento armazenamento;
+    armazenamento.iniciar();
+    uint32_t periodo_s = TEMPO_DEEP_SLEEP_COMPLETO / 1000;
+    uint32_t epoch = time(NULL) - registros * periodo_s;
+    for (uint32_t i = 0; i < registros; i++, epoch += periodo_s)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores dados = sensores.lerSensores(epoch);
+        armazenamento.salvarRegistro(tempo, dados);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t registros = 50000;
+    int repeticoes = 5;
+    std::string raiz = "benchmark_leitura_fs";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--registros")
+            registros = atol(argv[i + 1]);
+        else if (opcao == "--repeticoes")
+            repeticoes = atoi(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (registros == 0 || repeticoes <= 0)
+    {
+        fprintf(stderr, "--registros e --repeticoes precisam ser positivos\n");
+        return 2;
+    }
+    mkdir(raiz.c_str(), 0755);
+
+    Serial.silenciar(true);
+    GerenciadorSensores sensores;
+    sensores.iniciar();
+
+    // LittleFS: caminho anterior e leitor em blocos sobre o mesmo arquivo
+    prepararRaiz(raiz + "/littlefs");
+    gravarLog(sensores, registros);
+    GerenciadorArmazenamento littlefs;
+    littlefs.iniciar();
+    const String &cabecalho = littlefs.cabecalhoCSV();
+    FormatoLog formato = formatoDoCabecalho(cabecalho.c_str(), cabecalho.length());
+
+    Medida leitura_anterior = medir(repeticoes, [&](Medida &m) { lerAnterior(formato, m); });
+    Medida leitura_blocos = medir(repeticoes, [&](Medida &m) { lerAtual(littlefs, formato, m); });
+    Medida lotes_anterior = medir(repeticoes, [&](Medida &m) { lotesAnterior(formato, m); });
+    Medida lotes_blocos = medirLotes(repeticoes, registros, formato);
+
+    // particao: a faixa bruta precisa caber na sua regiao do anel
+    prepararRaiz(raiz + "/particao");
+    uint32_t setores = (uint64_t)registros * (tamanhoMaximoLinhaRegistro(NUMERO_CANAIS) + 1) /
+                           (TAMANHO_SETOR_DIARIO - 2 * cabecalho.length()) + 4;
+    std::string arquivo_particao = raiz + "/particao/" + ROTULO_PARTICAO_REGISTROS + ".bin";
+    remove(arquivo_particao.c_str());
+    if (!particoes_nativo.declarar(ROTULO_PARTICAO_REGISTROS, SUBTIPO_PARTICAO_REGISTROS,
+                                   NUMERO_FAIXAS * setores * TAMANHO_SETOR_DIARIO, arquivo_particao))
+    {
+        fprintf(stderr, "nao foi possivel criar %s\n", arquivo_particao.c_str());
+        return 1;
+    }
+    gravarLog(sensores, registros);
+    GerenciadorArmazenamento particao;
+    particao.iniciar();
+
+    Medida leitura_mapa = medir(repeticoes, [&](Medida &m) { lerAtual(particao, formato, m); });
+    Medida lotes_mapa = medirLotes(repeticoes, registros, formato);
+
+    printf("[benchmark_leitura] %u registros na faixa bruta, %d repeticoes (mediana)\n", registros, repeticoes);
+    printf("leitura + crc:\n");
+    imprimir("littlefs readStringUntil", leitura_anterior);
+    imprimir("littlefs em blocos", leitura_blocos);
+    imprimir("particao mapeada", leitura_mapa);
+    printf("lotes gateway (%u bytes):\n", TAMANHO_MAXIMO_LOTE);
+    imprimir("littlefs readStringUntil", lotes_anterior);
+    imprimir("littlefs em blocos", lotes_blocos);
+    imprimir("particao mapeada", lotes_mapa);
+
+    bool consistente = leitura_anterior.integros == registros && leitura_blocos.integros == registros &&
+                       leitura_mapa.integros == registros && lotes_anterior.integros == registros &&
+                       lotes_blocos.integros == registros && lotes_mapa.integros == registros;
+    printf("todos os caminhos com os %u registros integros: %s\n", registros, consistente ? "sim" : "NAO");
+    return consistente ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+/*
+ *  [i] gerador de carga sintetica: vazao e reprodutibilidade (build nativo)
+ *
+ *  gera `amostras` leituras por perfil do CanalMock (gerador_carga.h) em
+ *  lotes de `lote` com o gerarLote, como os benchmarks do host fazem, e
+ *  mede amostras/s. para cada perfil tambem confere:
+ *
+ *    reproducao  a mesma semente, depois de reiniciar, gera a mesma serie
+ *                (hash FNV-1a dos valores) e outra semente gera outra
+ *    dropouts    a fracao de amostras invalidas fica perto de prob_falha
+ *
+ *  o replay le o canal `canal` de um trace CSV (`--trace dados_log.csv`)
+ *  pelo lerTraceCSV; sem trace, usa um CSV esparso gerado pelo codec do
+ *  log (temperatura ausente em 1 de cada 7 registros, luminosidade em 1
+ *  de cada 2) e confere que o replay devolve so as temperaturas gravadas.
+ *
+ *  uso: benchmark_mock [--amostras 10000000] [--lote 4096]
+ *                      [--trace arquivo.csv] [--canal temperatura]
+ */
+
+#include "config.h"
+#include "gerador_carga.h"
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// SERIES
+
+struct Serie
+{
+    uint64_t hash = 1469598103934665603ULL;
+    uint64_t validas = 0;
+    uint64_t total = 0;
+    double soma = 0.0;
+    float minimo = INFINITY;
+    float maximo = -INFINITY;
+
+    void acrescentar(const float *valores, const bool *validos, size_t quantidade)
+    {
+        for (size_t i = 0; i < quantidade; i++)
+        {
+            uint32_t bits;
+            memcpy(&bits, &valores[i], sizeof(bits));
+            hash = (hash ^ (validos[i] ? bits : 0xFFFFFFFF)) * 1099511628211ULL;
+            if (!validos[i])
+                continue;
+            validas++;
+            soma += valores[i];
+            minimo = valores[i] < minimo ? valores[i] : minimo;
+            maximo = valores[i] > maximo ? valores[i] : maximo;
+        }
+        total += quantidade;
+    }
+};
+
+/*
+ * uma serie completa em lotes, a partir do inicio da sequencia do canal
+ */
+static Serie gerarSerie(CanalMock &canal, uint64_t amostras, size_t lote, uint32_t passo_s, double *ns = NULL)
+{
+    std::vector<float> valores(lote);
+    std::unique_ptr<bool[]> validos(new bool[lote]);
+    Serie serie;
+    canal.reiniciar();
+
+    auto inicio = std::chrono::steady_clock::now();
+    uint32_t tempo_s = 0;
+    for (uint64_t gerado = 0; gerado < amostras; gerado += lote)
+    {
+        size_t quantidade = amostras - gerado < lote ? (size_t)(amostras - gerado) : lote;
+        canal.gerarLote(tempo_s, passo_s, quantidade, valores.data(), validos.get());
+        serie.acrescentar(valores.data(), validos.get(), quantidade);
+        tempo_s += quantidade * passo_s;
+    }
+    if (ns)
+        *ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - inicio).count();
+    return serie;
+}
+
+struct DescritorTrace
+{
+    const char *nome;
+    uint8_t casas;
+};
+
+struct Caso
+{
+    const char *nome;
+    ConfigCanalMock config;
+};
+
+int main(int argc, char **argv)
+{
+    uint64_t amostras = 10000000;
+    size_t lote = 4096;
+    std::string arquivo_trace;
+    std::string canal_trace = "temperatura";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--amostras")
+            amostras = strtoull(argv[i + 1], NULL, 10);
+        else if (opcao == "--lote")
+            lote = atol(argv[i + 1]);
+        else if (opcao == "--trace")
+            arquivo_trace = argv[i + 1];
+        else if (opcao == "--canal")
+            canal_trace = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (amostras == 0 || lote == 0)
+    {
+        fprintf(stderr, "--amostras e --lote precisam ser positivos\n");
+        return 2;
+    }
+
+    // trace do replay: arquivo informado ou um csv no formato do log
+    const ConfigCanalMock temperatura = MOCK_TEMPERATURA;
+    std::string texto_trace;
+    std::vector<float> gravadas; // temperaturas escritas no csv gerado
+    if (!arquivo_trace.empty())
+    {
+        FILE *arquivo = fopen(arquivo_trace.c_str(), "rb");
+        if (!arquivo)
+        {
+            fprintf(stderr, "nao foi possivel abrir %s\n", arquivo_trace.c_str());
+            return 2;
+        }
+        char bloco[65536];
+        size_t lidos;
+        while ((lidos = fread(bloco, 1, sizeof(bloco), arquivo)) > 0)
+            texto_trace.append(bloco, lidos);
+        fclose(arquivo);
+    }
+    else
+    {
+        const DescritorTrace canais[2] = {{"temperatura", 2}, {"luminosidade", 2}};
+        CanalMock origem, luz;
+        origem.configurar(temperatura);
+        luz.configurar(MOCK_LUMINOSIDADE);
+        texto_trace = "seq,timestamp,incerteza_ms,mapa,marcas,temperatura,luminosidade,crc32\n";
+        for (uint32_t i = 0; i < 2016; i++)
+        {
+            float valor, lux;
+            origem.gerar(i * 300, valor);
+            luz.gerar(i * 300, lux);
+
+            RegistroCanais<2> registro;
+            registro.limpar();
+            if (i % 7 != 3)
+            {
+                registro.definir(0, escalarValor(valor, canais[0].casas));
+                gravadas.push_back(valorReal(registro.valor(0), canais[0].casas));
+            }
+            if (i % 2 == 0)
+                registro.definir(1, escalarValor(lux, canais[1].casas));
+
+            char linha[tamanhoMaximoLinhaRegistro(2) + 1];
+            uint32_t crc;
+            formatarLinhaRegistro(i + 1, 1700000000 + i * 300, 50, registro, canais, linha, crc);
+            texto_trace += linha;
+            texto_trace += '\n';
+        }
+        canal_trace = "temperatura";
+    }
+    std::vector<float> trace(texto_trace.size() / 2 + 1);
+    trace.resize(lerTraceCSV(texto_trace.c_str(), canal_trace.c_str(), trace.data(), trace.size()));
+    if (trace.empty())
+    {
+        fprintf(stderr, "trace sem amostras do canal %s\n", canal_trace.c_str());
+        return 2;
+    }
+
+    Caso casos[] = {
+        {"temperatura", MOCK_TEMPERATURA},
+        {"luminosidade", MOCK_LUMINOSIDADE},
+        {"degrau", {PERFIL_DEGRAU, 20.0f, 5.0f, 7200, 0, 0.1f, 0.0f, 0x51A7}},
+        {"com dropouts", {PERFIL_SENOIDE, 22.5f, 2.5f, 86400, 0, 0.05f, 0.02f, 0xD0D0}},
+        {"replay", {PERFIL_REPLAY, 0.0f, 0.0f, 1, 0, 0.0f, 0.0f, 1}},
+    };
+
+    printf("[benchmark_mock] %llu amostras por perfil, lotes de %zu, trace de %zu amostras\n",
+           (unsigned long long)amostras, lote, trace.size());
+    printf("  %-13s %11s %9s %9s %9s %9s %11s\n", "perfil", "M amostra/s", "validas", "media", "min", "max",
+           "reproduz");
+
+    bool ok = true;
+    for (const Caso &caso : casos)
+    {
+        CanalMock canal;
+        canal.configurar(caso.config);
+        if (caso.config.perfil == PERFIL_REPLAY)
+            canal.configurarReplay(trace.data(), trace.size());
+
+        double ns = 0.0;
+        Serie serie = gerarSerie(canal, amostras, lote, 300, &ns);
+        Serie repetida = gerarSerie(canal, amostras, lote, 300);
+
+        // outra semente muda o ruido (perfis sem ruido nao dependem dela)
+        bool semente_importa = caso.config.ruido > 0.0f || caso.config.prob_falha > 0.0f;
+        bool outra_diferente = true;
+        if (semente_importa)
+        {
+            ConfigCanalMock outra = caso.config;
+            outra.semente ^= 0x5EED;
+            CanalMock canal_outro;
+            canal_outro.configurar(outra);
+            outra_diferente = gerarSerie(canal_outro, amostras, lote, 300).hash != serie.hash;
+        }
+
+        double fracao_falhas = 1.0 - (double)serie.validas / serie.total;
+        bool falhas_ok = fabs(fracao_falhas - caso.config.prob_falha) <= 0.002 + 0.1 * caso.config.prob_falha;
+        bool reproduz = repetida.hash == serie.hash && outra_diferente;
+        ok = ok && reproduz && falhas_ok;
+
+        printf("  %-13s %11.1f %8.2f%% %9.2f %9.2f %9.2f %11s%s\n", caso.nome, serie.total / (ns / 1e3),
+               100.0 * serie.validas / serie.total, serie.validas ? serie.soma / serie.validas : 0.0,
+               serie.minimo, serie.maximo, reproduz ? "sim" : "NAO", falhas_ok ? "" : "  (dropouts fora do esperado)");
+    }
+
+    // replay do csv gerado: so as temperaturas presentes, como foram escritas
+    if (arquivo_trace.empty())
+    {
+        CanalMock replay;
+        replay.configurarReplay(trace.data(), trace.size());
+        float maior_erro = trace.size() == gravadas.size() ? 0.0f : INFINITY;
+        for (uint32_t i = 0; i < trace.size() && i < gravadas.size(); i++)
+        {
+            float obtido;
+            replay.gerar(i * 300, obtido);
+            maior_erro = fmaxf(maior_erro, fabsf(gravadas[i] - obtido));
+        }
+        bool replay_ok = maior_erro == 0.0f;
+        ok = ok && replay_ok;
+        printf("replay do trace gerado: %zu de %zu temperaturas, maior erro %.4f (%s)\n", trace.size(),
+               gravadas.size(), maior_erro, replay_ok ? "ok" : "FALHOU");
+    }
+
+    printf("todos os perfis reproduziveis e com dropouts no esperado: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/*
+ *  [i] rajada: vazao da captura e bytes por bloco (build nativo)
+ *
+ *  codec: codifica e decodifica rajadas de FREQUENCIA_RAJADA_HZ x
+ *  DURACAO_RAJADA_MS amostras por canal (compressao_rajada.h) para quatro
+ *  sinais do ADC de 12 bits:
+ *
+ *    estavel          nivel fixo com +-2 LSB de ruido
+ *    cintilacao       lampada em 50 Hz retificada (100 Hz) sobre o LDR
+ *    degrau termico   termistor subindo com constante de 100 ms
+ *    ruido 12 bits    uniforme em 0..4095 (pior caso do delta)
+ *
+ *  e relata bytes por canal, a razao contra as amostras cruas de 16 bits
+ *  e M amostras/s de codificacao, decodificacao e fletcher-16.
+ *
+ *  captura: o GerenciadorRajada real roda `--rajadas` capturas no host,
+ *  com o analogRead do stand-in trocado pelo sinal (definirLeituraAnalogica)
+ *  e a gravacao no LittleFS do host. cada bloco e lido de volta de
+ *  ARQUIVO_RAJADAS, conferido (assinatura, fletcher-16, amostras iguais as
+ *  lidas) e relatado: amostras/s sustentadas nos dois canais, tempo de
+ *  captura e de gravacao e bytes gravados por rajada.
+ *
+ *  uso: benchmark_rajada [--repeticoes 2000] [--rajadas 3]
+ *                        [--raiz benchmark_rajada_fs] [--semente 1]
+ *
+ *  sai com 1 se alguma rajada nao voltar igual ou se a captura ficar
+ *  abaixo de 95% de FREQUENCIA_RAJADA_HZ.
+ */
+
+#include "config.h"
+#include "gerenciador_armazenamento.h"
+#include "gerenciador_rajada.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// SINAIS
+
+enum Sinal
+{
+    SINAL_ESTAVEL,
+    SINAL_CINTILACAO,
+    SINAL_DEGRAU,
+    SINAL_RUIDO,
+    TOTAL_SINAIS
+};
+
+static const char *const NOMES_SINAIS[TOTAL_SINAIS] = {"estavel", "cintilacao", "degrau termico", "ruido 12 bits"};
+
+static std::mt19937 aleatorio;
+
+/*
+ * leitura do ADC no instante t_s do sinal; canal 1 (LDR) fica um pouco
+ * acima do canal 0 para os dois nao serem iguais
+ */
+static uint16_t amostra(Sinal sinal, double t_s, uint8_t canal)
+{
+    std::normal_distribution<double> ruido(0.0, 1.0);
+    double base = 1800.0 + 200.0 * canal;
+    double valor = base;
+    switch (sinal)
+    {
+    case SINAL_ESTAVEL:
+        valor = base + ruido(aleatorio);
+        break;
+    case SINAL_CINTILACAO:
+        valor = base + 400.0 * fabs(sin(2 * M_PI * 50.0 * t_s)) + 3.0 * ruido(aleatorio);
+        break;
+    case SINAL_DEGRAU:
+        valor = base + 800.0 * (1.0 - exp(-t_s / 0.1)) + 2.0 * ruido(aleatorio);
+        break;
+    default:
+        return aleatorio() % 4096;
+    }
+    return (uint16_t)std::min(4095.0, std::max(0.0, round(valor)));
+}
+
+// CODEC
+
+struct ResultadoCodec
+{
+    size_t bytes;
+    double ns_codificar;
+    double ns_decodificar;
+    double ns_verificar;
+    bool identico;
+};
+
+static double agoraNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static ResultadoCodec medirCodec(const std::vector<uint16_t> &amostras, int repeticoes)
+{
+    size_t n = amostras.size();
+    std::vector<uint8_t> compactado(tamanhoMaximoCompactado(n));
+    std::vector<uint16_t> decodificado(n);
+    ResultadoCodec r = {0, 0.0, 0.0, 0.0, true};
+    uint32_t soma = 0; // mantem os resultados vivos
+
+    double inicio = agoraNs();
+    for (int i = 0; i < repeticoes; i++)
+        r.bytes = codificarDeltaVarint(amostras.data(), n, compactado.data());
+    r.ns_codificar = (agoraNs() - inicio) / repeticoes;
+
+    inicio = agoraNs();
+    for (int i = 0; i < repeticoes; i++)
+        r.identico = decodificarDeltaVarint(compactado.data(), r.bytes, decodificado.data(), n) == r.bytes && r.identico;
+    r.ns_decodificar = (agoraNs() - inicio) / repeticoes;
+
+    inicio = agoraNs();
+    for (int i = 0; i < repeticoes; i++)
+        soma += fletcher16(compactado.data(), r.bytes);
+    r.ns_verificar = (agoraNs() - inicio) / repeticoes;
+
+    r.identico = r.identico && decodificado == amostras && soma != 0xFFFFFFFF;
+    return r;
+}
+
+// CAPTURA
+
+static Sinal sinal_captura = SINAL_CINTILACAO;
+static std::vector<uint16_t> lidas[CANAIS_RAJADA]; // o que o "ADC" devolveu, por canal
+
+static uint16_t lerAdc(uint8_t pino)
+{
+    uint8_t canal = pino == PINO_TERMISTOR ? 0 : 1;
+    uint16_t valor = amostra(sinal_captura, micros() / 1e6, canal);
+    lidas[canal].push_back(valor);
+    return valor;
+}
+
+struct ResultadoCaptura
+{
+    CabecalhoRajada cabecalho;
+    size_t bytes_bloco;
+    uint32_t captura_us;
+    uint32_t gravacao_us;
+    bool identico;
+};
+
+/*
+ * confere o bloco gravado a partir de posicao contra as amostras lidas
+ */
+static bool conferirBloco(size_t posicao, ResultadoCaptura &r)
+{
+    File arquivo = LittleFS.open(ARQUIVO_RAJADAS, "r");
+    if (!arquivo || !arquivo.seek(posicao))
+        return false;
+    std::vector<uint8_t> bloco(arquivo.size() - posicao);
+    bool lido = arquivo.read(bloco.data(), bloco.size()) == bloco.size();
+    arquivo.close();
+    if (!lido || bloco.size() < sizeof(CabecalhoRajada))
+        return false;
+
+    memcpy(&r.cabecalho, bloco.data(), sizeof(CabecalhoRajada));
+    r.bytes_bloco = bloco.size();
+    const uint8_t *dados = bloco.data() + sizeof(CabecalhoRajada);
+    size_t tamanho = r.cabecalho.tamanho_dados;
+    if (r.cabecalho.assinatura != ASSINATURA_RAJADA || sizeof(CabecalhoRajada) + tamanho != bloco.size() ||
+        fletcher16(dados, tamanho) != r.cabecalho.verificacao)
+        return false;
+
+    std::vector<uint16_t> canal(r.cabecalho.amostras);
+    for (uint8_t c = 0; c < CANAIS_RAJADA; c++)
+    {
+        size_t consumidos = decodificarDeltaVarint(dados, tamanho, canal.data(), canal.size());
+        if (consumidos == 0 || canal != lidas[c])
+            return false;
+        dados += consumidos;
+        tamanho -= consumidos;
+    }
+    return tamanho == 0;
+}
+
+static ResultadoCaptura capturar(GerenciadorRajada &rajada, GerenciadorArmazenamento &armazenamento)
+{
+    ResultadoCaptura r;
+    memset(&r, 0, sizeof(r));
+    for (uint8_t c = 0; c < CANAIS_RAJADA; c++)
+    {
+        lidas[c].clear();
+        lidas[c].reserve(MAXIMO_AMOSTRAS_RAJADA);
+    }
+
+    size_t posicao = 0;
+    if (LittleFS.exists(ARQUIVO_RAJADAS))
+    {
+        File arquivo = LittleFS.open(ARQUIVO_RAJADAS, "r");
+        posicao = arquivo.size();
+        arquivo.close();
+    }
+
+    uint32_t inicio = micros();
+    bool capturada = rajada.capturar(GATILHO_BOTAO, 1700000000);
+    r.captura_us = micros() - inicio;
+    inicio = micros();
+    bool gravada = capturada && rajada.salvar(armazenamento);
+    r.gravacao_us = micros() - inicio;
+
+    r.identico = gravada && conferirBloco(posicao, r);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    int repeticoes = 2000;
+    int rajadas = 3;
+    std::string raiz = "benchmark_rajada_fs";
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--repeticoes")
+            repeticoes = atoi(argv[i + 1]);
+        else if (opcao == "--rajadas")
+            rajadas = atoi(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (repeticoes <= 0 || rajadas <= 0)
+    {
+        fprintf(stderr, "--repeticoes e --rajadas precisam ser positivos\n");
+        return 2;
+    }
+    aleatorio.seed(semente);
+
+    uint32_t total = (uint32_t)FREQUENCIA_RAJADA_HZ * DURACAO_RAJADA_MS / 1000;
+    if (total > MAXIMO_AMOSTRAS_RAJADA)
+        total = MAXIMO_AMOSTRAS_RAJADA;
+
+    printf("[benchmark_rajada] %u amostras por canal (%u Hz x %u ms), %d repeticoes\n", total, FREQUENCIA_RAJADA_HZ,
+           DURACAO_RAJADA_MS, repeticoes);
+    printf("  %-15s %11s %7s %13s %14s %13s\n", "sinal", "bytes/canal", "razao", "codifica M/s", "decodifica M/s",
+           "fletcher M/s");
+
+    bool ok = true;
+    for (int s = 0; s < TOTAL_SINAIS; s++)
+    {
+        std::vector<uint16_t> amostras(total);
+        for (uint32_t i = 0; i < total; i++)
+            amostras[i] = amostra((Sinal)s, (double)i / FREQUENCIA_RAJADA_HZ, 1);
+
+        ResultadoCodec r = medirCodec(amostras, repeticoes);
+        ok = ok && r.identico;
+        printf("  %-15s %11zu %6.1f%% %13.1f %14.1f %13.1f%s\n", NOMES_SINAIS[s], r.bytes,
+               100.0 * r.bytes / (total * sizeof(uint16_t)), total / r.ns_codificar * 1e3,
+               total / r.ns_decodificar * 1e3, total / r.ns_verificar * 1e3, r.identico ? "" : "  <- NAO reproduz");
+    }
+
+    // captura real no host: GerenciadorRajada + LittleFS
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0)
+        return 2;
+    LittleFS.definirRaizPadrao(raiz);
+    LittleFS.begin(true);
+    Serial.silenciar(true);
+    definirLeituraAnalogica(lerAdc);
+
+    GerenciadorArmazenamento armazenamento;
+    armazenamento.iniciar();
+    GerenciadorRajada rajada;
+
+    printf("captura (GerenciadorRajada, %d rajadas por sinal):\n", rajadas);
+    printf("  %-15s %9s %12s %10s %11s %12s %9s\n", "sinal", "hz/canal", "amostras/s", "captura ms", "gravacao ms",
+           "bytes/bloco", "confere");
+    for (int s = 0; s < TOTAL_SINAIS; s++)
+    {
+        sinal_captura = (Sinal)s;
+        for (int i = 0; i < rajadas; i++)
+        {
+            ResultadoCaptura r = capturar(rajada, armazenamento);
+            bool na_taxa = r.cabecalho.frequencia_hz >= FREQUENCIA_RAJADA_HZ * 0.95;
+            ok = ok && r.identico && na_taxa;
+            printf("  %-15s %9u %12u %10.1f %11.2f %12zu %9s%s\n", i == 0 ? NOMES_SINAIS[s] : "",
+                   r.cabecalho.frequencia_hz, r.cabecalho.frequencia_hz * CANAIS_RAJADA, r.captura_us / 1e3,
+                   r.gravacao_us / 1e3, r.bytes_bloco, r.identico ? "sim" : "NAO", na_taxa ? "" : "  <- abaixo da taxa");
+        }
+    }
+    printf("  cru: %zu bytes por bloco (%u amostras x %u canais x 2 + cabecalho)\n",
+           sizeof(CabecalhoRajada) + total * CANAIS_RAJADA * sizeof(uint16_t), total, CANAIS_RAJADA);
+
+    printf("todas as rajadas voltaram iguais e na taxa: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
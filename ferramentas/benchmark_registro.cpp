@@ -0,0 +1,223 @@
+/*
+ *  [i] registro de canais: tamanho e custo com 2, 8 e 32 canais (build nativo)
+ *
+ *  tabelas de 2, 8 e 32 canais (nomes c0, c1, ..., casas alternando 1 e 2)
+ *  e tres densidades de presenca: cheio (todos os canais lidos), metade
+ *  e esparso (cada canal com 1/8 de chance, ao menos um). para cada caso,
+ *  `--registros` registros com valores sorteados passam por:
+ *
+ *    montar      RegistroCanais<N>::definir em ordem de canal
+ *    codificar   formatarLinhaRegistro (linha do /dados_log.csv com crc32)
+ *    decodificar decodificarLinhaRegistro com o formato do cabecalho
+ *
+ *  relata ns por registro de cada etapa, bytes medios por linha e os
+ *  mesmos bytes num CSV denso de colunas fixas (campo vazio para canal
+ *  ausente, sem mapa), alem do sizeof do registro na memoria RTC. toda
+ *  linha decodificada e conferida contra o registro de origem.
+ *
+ *  uso: benchmark_registro [--registros 200000] [--semente 1]
+ *
+ *  sai com 1 se alguma linha nao voltar integra e igual ao registro.
+ */
+
+#include "codec_registro.h"
+#include "registro_canais.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct Descritor
+{
+    const char *nome;
+    uint8_t casas;
+};
+
+struct Densidade
+{
+    const char *nome;
+    uint32_t chance_em_8; // chance de cada canal estar presente, em oitavos
+};
+
+const Densidade DENSIDADES[] = {{"cheio", 8}, {"metade", 4}, {"esparso", 1}};
+
+struct Resultado
+{
+    double ns_montar = 0.0;
+    double ns_codificar = 0.0;
+    double ns_decodificar = 0.0;
+    double bytes_linha = 0.0;
+    double bytes_denso = 0.0;
+    double presentes = 0.0;
+    uint32_t divergentes = 0;
+};
+
+static double agoraNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * linha equivalente com uma coluna fixa por canal (vazia quando ausente)
+ */
+template <uint8_t N>
+static size_t tamanhoDenso(const RegistroCanais<N> &registro, const Descritor *canais, size_t prefixo)
+{
+    char texto[TAMANHO_TEXTO_VALOR];
+    size_t tamanho = prefixo + 1 + TAMANHO_CRC_TEXTO;
+    for (uint8_t canal = 0; canal < N; canal++)
+    {
+        tamanho++; // virgula
+        if (registro.tem(canal))
+            tamanho += formatarPontoFixo(registro.valor(canal), canais[canal].casas, texto);
+    }
+    return tamanho;
+}
+
+template <uint8_t N>
+static Resultado medir(const Densidade &densidade, uint32_t registros, std::mt19937 &aleatorio)
+{
+    static char nomes[N][4];
+    Descritor canais[N];
+    std::string cabecalho = "seq,timestamp,incerteza_ms,mapa,marcas";
+    for (uint8_t i = 0; i < N; i++)
+    {
+        snprintf(nomes[i], sizeof(nomes[i]), "c%u", i);
+        canais[i] = {nomes[i], (uint8_t)(1 + i % 2)};
+        cabecalho += std::string(",") + nomes[i];
+    }
+    cabecalho += ",crc32";
+    FormatoLog formato = formatoDoCabecalho(cabecalho.c_str(), cabecalho.size());
+
+    // mapas e valores sorteados antes de medir
+    std::normal_distribution<float> normal(22.5f, 15.0f);
+    std::vector<uint32_t> mapas(registros);
+    std::vector<int32_t> valores((size_t)registros * N);
+    for (uint32_t r = 0; r < registros; r++)
+    {
+        uint32_t mapa = 0;
+        for (uint8_t canal = 0; canal < N; canal++)
+        {
+            if (aleatorio() % 8 < densidade.chance_em_8)
+                mapa |= 1u << canal;
+            valores[(size_t)r * N + canal] = escalarValor(normal(aleatorio), canais[canal].casas);
+        }
+        mapas[r] = mapa ? mapa : 1u << (aleatorio() % N);
+    }
+
+    Resultado resultado;
+    std::vector<RegistroCanais<N>> montados(registros);
+    double inicio = agoraNs();
+    for (uint32_t r = 0; r < registros; r++)
+    {
+        RegistroCanais<N> &registro = montados[r];
+        registro.limpar();
+        uint32_t restantes = mapas[r];
+        while (restantes)
+        {
+            uint8_t canal = __builtin_ctz(restantes);
+            restantes &= restantes - 1;
+            registro.definir(canal, valores[(size_t)r * N + canal]);
+        }
+    }
+    resultado.ns_montar = (agoraNs() - inicio) / registros;
+
+    const size_t largura = tamanhoMaximoLinhaRegistro(N) + 1;
+    std::vector<char> linhas((size_t)registros * largura);
+    std::vector<uint16_t> tamanhos(registros);
+    inicio = agoraNs();
+    for (uint32_t r = 0; r < registros; r++)
+    {
+        uint32_t crc;
+        tamanhos[r] = formatarLinhaRegistro(r + 1, 1700000000 + r * 300, 250, montados[r], canais,
+                                            &linhas[(size_t)r * largura], crc);
+    }
+    resultado.ns_codificar = (agoraNs() - inicio) / registros;
+
+    std::vector<LinhaDecodificada> decodificadas(registros);
+    uint32_t integras = 0;
+    inicio = agoraNs();
+    for (uint32_t r = 0; r < registros; r++)
+        integras += decodificarLinhaRegistro(&linhas[(size_t)r * largura], tamanhos[r], formato, decodificadas[r]) ==
+                    LINHA_INTEGRA;
+    resultado.ns_decodificar = (agoraNs() - inicio) / registros;
+    resultado.divergentes = registros - integras;
+
+    for (uint32_t r = 0; r < registros; r++)
+    {
+        const RegistroCanais<N> &registro = montados[r];
+        const LinhaDecodificada &linha = decodificadas[r];
+        bool igual = linha.sequencia == r + 1 && linha.mapa == registro.mapa && linha.simulados == 0 &&
+                     linha.atipicos == 0;
+        for (uint8_t i = 0; igual && i < registro.quantidade(); i++)
+            igual = linha.valores[i] == registro.valores[i];
+        resultado.divergentes += !igual;
+
+        // seq,epoch,incerteza vem antes das colunas dos canais nas duas formas
+        char texto[12];
+        size_t prefixo = formatarNatural(r + 1, texto) + 1 + formatarNatural(1700000000 + r * 300, texto) + 1 +
+                  formatarNatural(250, texto);
+        resultado.bytes_linha += tamanhos[r];
+        resultado.bytes_denso += tamanhoDenso(registro, canais, prefixo);
+        resultado.presentes += registro.quantidade();
+    }
+    resultado.bytes_linha /= registros;
+    resultado.bytes_denso /= registros;
+    resultado.presentes /= registros;
+    return resultado;
+}
+
+template <uint8_t N>
+static bool relatar(uint32_t registros, std::mt19937 &aleatorio)
+{
+    bool ok = true;
+    for (const Densidade &densidade : DENSIDADES)
+    {
+        Resultado r = medir<N>(densidade, registros, aleatorio);
+        printf("  %3u %-8s %9.1f %8.1f %8.1f %8.1f %9.1f %9.1f %7zu %s\n", N, densidade.nome, r.presentes, r.ns_montar,
+               r.ns_codificar, r.ns_decodificar, r.bytes_linha, r.bytes_denso, sizeof(RegistroCanais<N>),
+               r.divergentes ? "DIVERGIU" : "ok");
+        ok = ok && r.divergentes == 0;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t registros = 200000;
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--registros")
+            registros = atol(argv[i + 1]);
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (registros == 0)
+    {
+        fprintf(stderr, "--registros precisa ser positivo\n");
+        return 2;
+    }
+
+    std::mt19937 aleatorio(semente);
+    printf("[benchmark_registro] %u registros por caso, ns por registro, bytes por linha\n", registros);
+    printf("  %3s %-8s %9s %8s %8s %8s %9s %9s %7s\n", "N", "presenca", "presentes", "montar", "codif.", "decodif.",
+           "bytes", "denso", "sizeof");
+
+    bool ok = relatar<2>(registros, aleatorio);
+    ok = relatar<8>(registros, aleatorio) && ok;
+    ok = relatar<32>(registros, aleatorio) && ok;
+
+    printf("todas as linhas voltaram integras e iguais ao registro: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/*
+ *  [i] benchmark do handshake tls: completo x retomado (build nativo)
+ *
+ *  cada envio e um despertar: conexao nova pelo GerenciadorUpload real
+ *  (TransporteHTTP -> ClienteTLS), com a sessao na "memoria RTC" (no host,
+ *  uma global que sobrevive entre envios). no modo completo a sessao e
+ *  apagada antes de cada envio, como no firmware sem retomada; no modo
+ *  retomado so o primeiro envio paga o handshake completo.
+ *
+ *  relata o tempo do handshake (p50/p99), os bytes no socket, o tempo do
+ *  POST inteiro e a carga por despertar com as correntes do
+ *  CORRENTES_ENERGIA (cpu + radio durante o handshake), e confere os
+ *  orcamentos ORCAMENTO_HANDSHAKE_* do config.h.
+ *
+ *  no host a cpu do handshake e desprezivel: o tempo medido e o das idas e
+ *  voltas (--rtt-ms do servidor_tls). bytes e idas e voltas sao os do
+ *  dispositivo, porque o handshake e o mesmo TLS 1.2.
+ *
+ *  uso: benchmark_tls [--url https://localhost:8443/api] [--ca tls_servidor/ca.pem]
+ *                     [--chave-sha256 hexa] [--envios 50]
+ *
+ *  precisa do servidor_tls na frente do servidor_ingestao.
+ */
+
+#include "config.h"
+#include "gerenciador_upload.h"
+#include "modelo_energia.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+struct ResultadoModo
+{
+    std::vector<uint32_t> handshake_ms;
+    std::vector<uint32_t> post_us;
+    uint64_t bytes_enviados = 0;
+    uint64_t bytes_recebidos = 0;
+    uint32_t retomados = 0;
+    uint32_t falhas = 0;
+};
+
+/*
+ * um despertar por envio; retomar = manter a sessao da RTC
+ */
+static ResultadoModo medir(GerenciadorUpload &upload, int envios, bool retomar)
+{
+    ResultadoModo resultado;
+    esquecerSessaoTLS();
+    for (int i = 0; i < envios; i++)
+    {
+        if (!retomar)
+            esquecerSessaoTLS();
+
+        uint32_t falhas_antes = estatisticas_tls.falhas;
+        String csv = String(i) + ",1700000000,50,3,,2250,1000,00000000";
+        unsigned long inicio = micros();
+        bool ok = upload.enviarDados(csv);
+        unsigned long post_us = micros() - inicio;
+
+        if (!ok || estatisticas_tls.falhas != falhas_antes)
+        {
+            resultado.falhas++;
+            continue;
+        }
+        // o primeiro envio do modo retomado cria a sessao: fica fora da media
+        if (retomar && i == 0)
+            continue;
+
+        const CustoHandshake &custo = estatisticas_tls.ultimo;
+        resultado.handshake_ms.push_back(custo.duracao_ms);
+        resultado.post_us.push_back(post_us);
+        resultado.bytes_enviados += custo.bytes_enviados;
+        resultado.bytes_recebidos += custo.bytes_recebidos;
+        resultado.retomados += custo.retomado;
+    }
+    return resultado;
+}
+
+static void imprimirModo(const char *nome, const ResultadoModo &r, const TabelaCorrente &correntes)
+{
+    size_t n = r.handshake_ms.size();
+    uint32_t p50 = percentil(r.handshake_ms, 0.50);
+    printf("  %-9s %3zu envios (%u retomados, %u falhas)\n", nome, n, r.retomados, r.falhas);
+    if (n == 0)
+        return;
+    printf("            handshake p50 %u ms, p99 %u ms; POST inteiro p50 %.1f ms\n", p50,
+           percentil(r.handshake_ms, 0.99), percentil(r.post_us, 0.50) / 1000.0);
+    printf("            bytes no handshake: %.0f enviados + %.0f recebidos\n", (double)r.bytes_enviados / n,
+           (double)r.bytes_recebidos / n);
+    float uah = energiaEstadoUAh(correntes.corrente_ma[ENERGIA_CPU] + correntes.corrente_ma[ENERGIA_RADIO], p50);
+    printf("            carga do handshake por despertar: %.3f uAh\n", uah);
+}
+
+int main(int argc, char **argv)
+{
+    std::string url = "https://localhost:8443/api";
+    std::string arquivo_ca = "tls_servidor/ca.pem";
+    std::string chave_sha256;
+    int envios = 50;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--url")
+            url = argv[i + 1];
+        else if (opcao == "--ca")
+            arquivo_ca = argv[i + 1];
+        else if (opcao == "--chave-sha256")
+            chave_sha256 = argv[i + 1];
+        else if (opcao == "--envios")
+            envios = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (envios < 2 || url.compare(0, 8, "https://") != 0)
+    {
+        fprintf(stderr, "--envios precisa ser >= 2 e --url https://\n");
+        return 2;
+    }
+
+    // ancoras do servidor local no lugar das do config_privado.h
+    std::string ca_pem;
+    if (!arquivo_ca.empty())
+    {
+        std::ifstream entrada(arquivo_ca);
+        std::stringstream conteudo;
+        conteudo << entrada.rdbuf();
+        ca_pem = conteudo.str();
+        if (ca_pem.empty())
+        {
+            fprintf(stderr, "nao foi possivel ler %s (gerado pelo servidor_tls)\n", arquivo_ca.c_str());
+            return 2;
+        }
+    }
+    confiancaTLS().ca_pem = ca_pem.c_str();
+    confiancaTLS().chave_sha256 = chave_sha256.c_str();
+
+    Serial.silenciar(true);
+    WiFi.begin(WIFI_SSID, WIFI_SENHA);
+    GerenciadorUpload upload(url.c_str());
+    TabelaCorrente correntes = {CORRENTES_ENERGIA};
+
+    ResultadoModo completo = medir(upload, envios, false);
+    ResultadoModo retomado = medir(upload, envios, true);
+
+    printf("[tls] %d despertares por modo contra %s (%s%s)\n", envios, url.c_str(),
+           ca_pem.empty() ? "" : "CA", chave_sha256.empty() ? "" : (ca_pem.empty() ? "chave fixada" : " + chave fixada"));
+    imprimirModo("completo", completo, correntes);
+    imprimirModo("retomado", retomado, correntes);
+    printf("  sessao na RTC: %u de %u bytes\n", sessao_tls.tamanho, (unsigned)sizeof(sessao_tls.dados));
+
+    uint32_t p50_completo = percentil(completo.handshake_ms, 0.50);
+    uint32_t p50_retomado = percentil(retomado.handshake_ms, 0.50);
+    double bytes_completo = completo.handshake_ms.empty()
+                                ? 0
+                                : (double)(completo.bytes_enviados + completo.bytes_recebidos) / completo.handshake_ms.size();
+    double bytes_retomado = retomado.handshake_ms.empty()
+                                ? 0
+                                : (double)(retomado.bytes_enviados + retomado.bytes_recebidos) / retomado.handshake_ms.size();
+    if (bytes_retomado > 0)
+        printf("  retomado: %.1fx menos bytes, %u ms a menos por despertar\n", bytes_completo / bytes_retomado,
+               p50_completo > p50_retomado ? p50_completo - p50_retomado : 0);
+
+    bool dentro = p50_completo <= ORCAMENTO_HANDSHAKE_COMPLETO_MS && p50_retomado <= ORCAMENTO_HANDSHAKE_RETOMADO_MS;
+    bool todos_retomados = !retomado.handshake_ms.empty() && retomado.retomados == retomado.handshake_ms.size();
+    printf("  orcamento: completo %u ms, retomado %u ms -> %s\n", ORCAMENTO_HANDSHAKE_COMPLETO_MS,
+           ORCAMENTO_HANDSHAKE_RETOMADO_MS, dentro ? "dentro" : "ESTOURADO");
+    if (!todos_retomados)
+        printf("  [!] servidor nao retomou todas as sessoes (--retomada nenhuma?)\n");
+
+    return completo.falhas == 0 && retomado.falhas == 0 && dentro && todos_retomados ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/*
+ *  [i] calculadora de energia (build nativo)
+ *
+ *  roda o mesmo modelo do GerenciadorEnergia (modelo_energia.h) sobre um
+ *  calendario simulado de ciclos, para comparar periodos de amostragem,
+ *  frequencia de upload e rajadas antes de levar ao campo.
+ *
+ *  uso: calculadora_energia [--periodo-s 300] [--acordado-ms 3000]
+ *                           [--flash-ms 20] [--upload-cada 1]
+ *                           [--rajada-cada 0] [--dias 30]
+ *                           [--correntes 0.010,45,85,20] [--bateria-mah 2000]
+ *
+ *  --upload-cada N: o radio liga em 1 de cada N ciclos (1 = todo ciclo)
+ *  --rajada-cada N: uma rajada a cada N ciclos (0 = nunca)
+ *
+ *  os tempos por ciclo podem vir do "tempos do ciclo" impresso no serial.
+ */
+
+#include "config.h"
+#include "modelo_energia.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static const char *NOMES_ESTADOS[TOTAL_ESTADOS_ENERGIA] = {"sono", "cpu", "radio", "flash"};
+
+/*
+ * le "a,b,c,d" na tabela de correntes
+ */
+static bool lerCorrentes(const char *texto, TabelaCorrente &tabela)
+{
+    char *fim = NULL;
+    for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+    {
+        tabela.corrente_ma[i] = strtof(texto, &fim);
+        if (fim == texto || tabela.corrente_ma[i] < 0.0f)
+            return false;
+        if (i + 1 < TOTAL_ESTADOS_ENERGIA)
+        {
+            if (*fim != ',')
+                return false;
+            texto = fim + 1;
+        }
+    }
+    return *fim == '\0';
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t periodo_s = TEMPO_AMOSTRAGEM / 1000;
+    uint32_t acordado_ms = 3000;
+    uint32_t flash_ms = 20;
+    uint32_t upload_cada = 1;
+    uint32_t rajada_cada = 0;
+    uint32_t dias = 30;
+    float bateria_mah = CAPACIDADE_BATERIA_MAH;
+    TabelaCorrente tabela = {CORRENTES_ENERGIA};
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--periodo-s")
+            periodo_s = atoi(argv[i + 1]);
+        else if (opcao == "--acordado-ms")
+            acordado_ms = atoi(argv[i + 1]);
+        else if (opcao == "--flash-ms")
+            flash_ms = atoi(argv[i + 1]);
+        else if (opcao == "--upload-cada")
+            upload_cada = atoi(argv[i + 1]);
+        else if (opcao == "--rajada-cada")
+            rajada_cada = atoi(argv[i + 1]);
+        else if (opcao == "--dias")
+            dias = atoi(argv[i + 1]);
+        else if (opcao == "--bateria-mah")
+            bateria_mah = atof(argv[i + 1]);
+        else if (opcao == "--correntes")
+        {
+            if (!lerCorrentes(argv[i + 1], tabela))
+            {
+                fprintf(stderr, "correntes invalidas: %s (esperado sono,cpu,radio,flash em mA)\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 1;
+        }
+    }
+
+    if (periodo_s == 0 || upload_cada == 0 || dias == 0 || acordado_ms >= periodo_s * 1000)
+    {
+        fprintf(stderr, "parametros invalidos: periodo deve ser maior que o tempo acordado\n");
+        return 1;
+    }
+
+    // rajada: CPU amostrando por DURACAO_RAJADA_MS e mais uma escrita de bloco na flash
+    const uint32_t rajada_cpu_ms = DURACAO_RAJADA_MS;
+    const uint32_t rajada_flash_ms = flash_ms;
+
+    uint64_t ciclos = (uint64_t)dias * 86400 / periodo_s;
+    float uah_estado[TOTAL_ESTADOS_ENERGIA] = {0};
+    float uah_total = 0.0f;
+    float uah_maximo_ciclo = 0.0f;
+    uint64_t ms_total = 0;
+
+    for (uint64_t ciclo = 0; ciclo < ciclos; ciclo++)
+    {
+        TemposEnergia tempos = {{0, 0, 0, 0}};
+        tempos.ms[ENERGIA_CPU] = acordado_ms;
+        tempos.ms[ENERGIA_FLASH] = flash_ms;
+
+        if (ciclo % upload_cada == 0)
+            tempos.ms[ENERGIA_RADIO] = acordado_ms;
+
+        if (rajada_cada > 0 && ciclo % rajada_cada == 0)
+        {
+            tempos.ms[ENERGIA_CPU] += rajada_cpu_ms;
+            tempos.ms[ENERGIA_FLASH] += rajada_flash_ms;
+        }
+
+        uint32_t periodo_ms = periodo_s * 1000;
+        tempos.ms[ENERGIA_SONO] = periodo_ms > tempos.ms[ENERGIA_CPU] ? periodo_ms - tempos.ms[ENERGIA_CPU] : 0;
+
+        float uah_ciclo = energiaUAh(tempos, tabela);
+        for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+            uah_estado[i] += energiaEstadoUAh(tabela.corrente_ma[i], tempos.ms[i]);
+
+        uah_total += uah_ciclo;
+        if (uah_ciclo > uah_maximo_ciclo)
+            uah_maximo_ciclo = uah_ciclo;
+        ms_total += tempos.ms[ENERGIA_SONO] + tempos.ms[ENERGIA_CPU];
+    }
+
+    float uah_medio = uah_total / ciclos;
+    float mah_dia = consumoDiarioMAh(uah_medio, (float)ms_total / ciclos);
+
+    printf("[energia] %llu ciclos em %u dias (periodo %u s, acordado %u ms)\n",
+           (unsigned long long)ciclos, dias, periodo_s, acordado_ms);
+    printf("  correntes (mA): sono %.3f, cpu %.1f, radio %.1f, flash %.1f\n", tabela.corrente_ma[ENERGIA_SONO],
+           tabela.corrente_ma[ENERGIA_CPU], tabela.corrente_ma[ENERGIA_RADIO], tabela.corrente_ma[ENERGIA_FLASH]);
+
+    printf("\n[energia] consumo por estado\n");
+    for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+    {
+        printf("  %-6s %10.1f mAh (%5.1f%%)\n", NOMES_ESTADOS[i], uah_estado[i] / 1000.0f,
+               uah_total > 0.0f ? 100.0f * uah_estado[i] / uah_total : 0.0f);
+    }
+
+    printf("\n[energia] resumo\n");
+    printf("  por amostra: %.1f uAh (pior ciclo %.1f uAh)\n", uah_medio, uah_maximo_ciclo);
+    printf("  consumo: %.2f mAh/dia (corrente media %.3f mA)\n", mah_dia, mah_dia / 24.0f);
+    printf("  autonomia: %.0f dias com %.0f mAh\n", autonomiaDias(bateria_mah, mah_dia), bateria_mah);
+    return 0;
+}
@@ -0,0 +1,422 @@
+/*
+ *  [i] cliente do console serial (build nativo)
+ *
+ *  fala com o GerenciadorConsole pela porta serial (cabo usb) ou pelo pty
+ *  do dispositivo_console: comandos de texto ou exportacao binaria de um
+ *  arquivo do LittleFS, com o mesmo protocolo de quadros do firmware
+ *  (protocolo_console.h).
+ *
+ *  uso: cliente_console --porta /dev/ttyUSB0 [--comando "consulta 1700000000 1700086400"]
+ *       cliente_console --porta /dev/ttyUSB0 --exportar dados.csv
+ *                       [--arquivo /dados_log.csv] [--baud 921600] [--espera-s 15]
+ *
+ *  a exportacao so grava o arquivo de saida se o crc32 do arquivo inteiro
+ *  conferir com o do quadro FIM. relata vazao, quadros descartados e NAKs.
+ */
+
+#include "protocolo_console.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+
+const uint32_t VELOCIDADE_TEXTO = 115200;  // VELOCIDADE_CONSOLE do firmware
+const int INATIVIDADE_EXPORTACAO_MS = 5000;
+const int INATIVIDADE_RESPOSTA_MS = 10000;
+
+static double agoraS()
+{
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// PORTA SERIAL
+
+struct PortaSerial
+{
+    int fd = -1;
+    uint8_t buffer[4096];
+    size_t inicio = 0;
+    size_t fim = 0;
+
+    static bool velocidade(uint32_t baud, speed_t &codigo)
+    {
+        static const struct
+        {
+            uint32_t baud;
+            speed_t codigo;
+        } tabela[] = {{115200, B115200},   {230400, B230400},   {460800, B460800},   {500000, B500000},
+                      {576000, B576000},   {921600, B921600},   {1000000, B1000000}, {1152000, B1152000},
+                      {1500000, B1500000}, {2000000, B2000000}};
+        for (const auto &linha : tabela)
+            if (linha.baud == baud)
+            {
+                codigo = linha.codigo;
+                return true;
+            }
+        return false;
+    }
+
+    bool abrir(const char *caminho)
+    {
+        fd = open(caminho, O_RDWR | O_NOCTTY);
+        if (fd < 0)
+            return false;
+        struct termios modo;
+        if (tcgetattr(fd, &modo) != 0)
+            return false;
+        cfmakeraw(&modo);
+        modo.c_cflag |= CLOCAL | CREAD;
+        modo.c_cc[VMIN] = 0;
+        modo.c_cc[VTIME] = 0;
+        if (tcsetattr(fd, TCSANOW, &modo) != 0 || !definirVelocidade(VELOCIDADE_TEXTO))
+            return false;
+        tcflush(fd, TCIOFLUSH);
+        return true;
+    }
+
+    bool definirVelocidade(uint32_t baud)
+    {
+        speed_t codigo;
+        struct termios modo;
+        if (!velocidade(baud, codigo) || tcgetattr(fd, &modo) != 0)
+            return false;
+        cfsetispeed(&modo, codigo);
+        cfsetospeed(&modo, codigo);
+        return tcsetattr(fd, TCSADRAIN, &modo) == 0;
+    }
+
+    bool escrever(const void *dados, size_t tamanho)
+    {
+        const uint8_t *p = (const uint8_t *)dados;
+        while (tamanho > 0)
+        {
+            ssize_t n = write(fd, p, tamanho);
+            if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return false;
+            if (n > 0)
+            {
+                p += n;
+                tamanho -= n;
+            }
+        }
+        return true;
+    }
+
+    bool escrever(const std::string &texto) { return escrever(texto.data(), texto.size()); }
+
+    /*
+     * proximo byte, ou -1 apos timeout_ms sem nada chegar
+     */
+    int lerByte(int timeout_ms)
+    {
+        if (inicio == fim)
+        {
+            struct pollfd espera = {fd, POLLIN, 0};
+            if (poll(&espera, 1, timeout_ms) <= 0)
+                return -1;
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n <= 0)
+                return -1;
+            inicio = 0;
+            fim = n;
+        }
+        return buffer[inicio++];
+    }
+
+    bool lerLinha(std::string &linha, int timeout_ms)
+    {
+        linha.clear();
+        int c;
+        while ((c = lerByte(timeout_ms)) >= 0)
+        {
+            if (c == '\n')
+            {
+                while (!linha.empty() && linha.back() == '\r')
+                    linha.pop_back();
+                return true;
+            }
+            linha += (char)c;
+        }
+        return false;
+    }
+
+    void descartarEntrada(int silencio_ms)
+    {
+        while (lerByte(silencio_ms) >= 0)
+        {
+        }
+    }
+};
+
+static bool prefixo(const std::string &texto, const char *inicio)
+{
+    return texto.compare(0, strlen(inicio), inicio) == 0;
+}
+
+// COMANDOS DE TEXTO
+
+/*
+ * linha vazia ate o console responder "pronto" (a placa pode estar no
+ * meio de um ciclo ou reiniciando por causa da abertura da porta)
+ */
+static bool sincronizar(PortaSerial &porta, int espera_s)
+{
+    double limite = agoraS() + espera_s;
+    std::string linha;
+    while (agoraS() < limite)
+    {
+        porta.escrever("\n");
+        double proxima = agoraS() + 0.5;
+        while (agoraS() < proxima)
+        {
+            if (porta.lerLinha(linha, 100) && linha == "pronto")
+            {
+                porta.descartarEntrada(200);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * envia o comando e repassa a resposta (apos o eco) ate a linha final
+ */
+static bool executarComando(PortaSerial &porta, const std::string &comando, std::string &final, FILE *saida)
+{
+    porta.escrever(comando + "\n");
+
+    std::string linha;
+    do
+    {
+        if (!porta.lerLinha(linha, INATIVIDADE_RESPOSTA_MS))
+            return false;
+    } while (linha != "> " + comando);
+
+    while (porta.lerLinha(linha, INATIVIDADE_RESPOSTA_MS))
+    {
+        if (prefixo(linha, "ok") || prefixo(linha, "erro"))
+        {
+            final = linha;
+            return true;
+        }
+        if (saida)
+            fprintf(saida, "%s\n", linha.c_str());
+    }
+    return false;
+}
+
+// EXPORTACAO BINARIA
+
+static void enviarControle(PortaSerial &porta, uint8_t tipo, uint32_t sequencia)
+{
+    uint8_t quadro[tamanhoQuadro(0)];
+    porta.escrever(quadro, montarQuadro(tipo, sequencia, NULL, 0, quadro));
+}
+
+struct ResultadoExportacao
+{
+    bool sucesso;
+    uint32_t tamanho;  // anunciado no INICIO
+    uint32_t recebidos;
+    uint32_t quadros;
+    uint32_t naks;
+    uint32_t descartados;
+    double segundos;
+};
+
+/*
+ * recebe INICIO, DADOS... e FIM em ordem; fora de ordem gera um NAK por lacuna
+ */
+static ResultadoExportacao receberArquivo(PortaSerial &porta, FILE *destino)
+{
+    ResultadoExportacao r = {false, 0, 0, 0, 0, 0, 0};
+    DecodificadorQuadros<CARGA_MAXIMA_QUADRO> decodificador;
+    uint32_t esperado = 0;
+    uint32_t crc = 0;
+    bool nak_pendente = false;
+    uint32_t nak_em = 0; // quadro que gerou o ultimo NAK
+    double inicio = agoraS();
+
+    int c;
+    while ((c = porta.lerByte(INATIVIDADE_EXPORTACAO_MS)) >= 0)
+    {
+        if (!decodificador.alimentar(c))
+            continue;
+
+        uint32_t sequencia = decodificador.sequencia();
+        uint8_t tipo = decodificador.tipo();
+        if (tipo == QUADRO_CANCELA)
+            break;
+
+        if (sequencia != esperado)
+        {
+            // repetido: reconfirma (o ACK pode ter se perdido); adiantado: faltou
+            // algo. um NAK por rodada: so repete quando o dispositivo recomeca
+            if (sequencia < esperado)
+                enviarControle(porta, QUADRO_ACK, esperado);
+            else if (!nak_pendente || sequencia <= nak_em)
+            {
+                enviarControle(porta, QUADRO_NAK, esperado);
+                nak_pendente = true;
+                nak_em = sequencia;
+                r.naks++;
+            }
+            continue;
+        }
+
+        if (tipo == QUADRO_INICIO && sequencia == 0 && decodificador.tamanho() >= 7)
+        {
+            r.tamanho = lerU32(decodificador.carga());
+        }
+        else if (tipo == QUADRO_DADOS && sequencia > 0)
+        {
+            fwrite(decodificador.carga(), 1, decodificador.tamanho(), destino);
+            crc = crc32(decodificador.carga(), decodificador.tamanho(), crc);
+            r.recebidos += decodificador.tamanho();
+        }
+        else if (tipo == QUADRO_FIM && decodificador.tamanho() == 4)
+        {
+            enviarControle(porta, QUADRO_ACK, esperado + 1);
+            r.sucesso = r.recebidos == r.tamanho && crc == lerU32(decodificador.carga());
+            r.quadros = esperado + 1;
+            break;
+        }
+        else
+        {
+            continue;
+        }
+
+        esperado++;
+        nak_pendente = false;
+        enviarControle(porta, QUADRO_ACK, esperado);
+    }
+
+    if (!r.sucesso && r.quadros == 0)
+        enviarControle(porta, QUADRO_CANCELA, esperado);
+    r.descartados = decodificador.descartados;
+    r.segundos = agoraS() - inicio;
+    return r;
+}
+
+static int exportar(PortaSerial &porta, const std::string &arquivo, uint32_t baud, const std::string &saida)
+{
+    std::string parcial = saida + ".parcial";
+    FILE *destino = fopen(parcial.c_str(), "wb");
+    if (!destino)
+    {
+        perror(parcial.c_str());
+        return 1;
+    }
+
+    std::string final;
+    std::string comando = "exportar " + arquivo + " " + std::to_string(baud);
+    if (!executarComando(porta, comando, final, stderr) || !prefixo(final, "ok exportando"))
+    {
+        fprintf(stderr, "[cliente] %s\n", final.empty() ? "sem resposta" : final.c_str());
+        fclose(destino);
+        remove(parcial.c_str());
+        return 1;
+    }
+    fprintf(stderr, "[cliente] %s\n", final.c_str());
+
+    porta.definirVelocidade(baud);
+    ResultadoExportacao r = receberArquivo(porta, destino);
+    fclose(destino);
+    tcdrain(porta.fd);
+    porta.definirVelocidade(VELOCIDADE_TEXTO);
+
+    std::string linha;
+    while (porta.lerLinha(linha, 2000) && !prefixo(linha, "ok") && !prefixo(linha, "erro"))
+    {
+    }
+    if (!linha.empty())
+        fprintf(stderr, "[dispositivo] %s\n", linha.c_str());
+
+    if (!r.sucesso)
+    {
+        fprintf(stderr, "[cliente] exportacao falhou (%u de %u bytes recebidos%s)\n", r.recebidos, r.tamanho,
+                r.quadros ? ", crc32 do arquivo nao confere" : "");
+        remove(parcial.c_str());
+        return 1;
+    }
+    rename(parcial.c_str(), saida.c_str());
+
+    printf("[cliente] %s -> %s: %u bytes em %.2f s (%.1f KiB/s), %u quadros, %u NAKs, %u bytes descartados, crc32 ok\n",
+           arquivo.c_str(), saida.c_str(), r.tamanho, r.segundos, r.tamanho / 1024.0 / r.segundos, r.quadros, r.naks,
+           r.descartados);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string caminho_porta;
+    std::string comando;
+    std::string saida;
+    std::string arquivo = "/dados_log.csv";
+    uint32_t baud = 921600; // VELOCIDADE_EXPORTACAO_PADRAO
+    int espera_s = 15;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--porta")
+            caminho_porta = argv[i + 1];
+        else if (opcao == "--comando")
+            comando = argv[i + 1];
+        else if (opcao == "--exportar")
+            saida = argv[i + 1];
+        else if (opcao == "--arquivo")
+            arquivo = argv[i + 1];
+        else if (opcao == "--baud")
+            baud = atoi(argv[i + 1]);
+        else if (opcao == "--espera-s")
+            espera_s = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+
+    speed_t codigo;
+    if (caminho_porta.empty() || (comando.empty() == saida.empty()) || !PortaSerial::velocidade(baud, codigo))
+    {
+        fprintf(stderr, "uso: %s --porta <dispositivo> (--comando \"...\" | --exportar <saida> [--arquivo /dados_log.csv] "
+                        "[--baud 921600]) [--espera-s 15]\n",
+                argv[0]);
+        return 2;
+    }
+
+    PortaSerial porta;
+    if (!porta.abrir(caminho_porta.c_str()))
+    {
+        perror(caminho_porta.c_str());
+        return 1;
+    }
+
+    if (!sincronizar(porta, espera_s))
+    {
+        fprintf(stderr, "[cliente] console nao respondeu em %d s (energize a placa ou aperte o botao)\n", espera_s);
+        return 1;
+    }
+
+    if (!saida.empty())
+        return exportar(porta, arquivo, baud, saida);
+
+    std::string final;
+    double inicio = agoraS();
+    if (!executarComando(porta, comando, final, stdout))
+    {
+        fprintf(stderr, "[cliente] resposta incompleta\n");
+        return 1;
+    }
+    fprintf(stderr, "[cliente] %s (%.2f s)\n", final.c_str(), agoraS() - inicio);
+    return prefixo(final, "ok") ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/*
+ *  [i] backends por template x por interface virtual (build nativo)
+ *
+ *  os gerenciadores sao templates sobre backends estaticos (plataforma.h).
+ *  esta ferramenta compara o desenho com o alternativo de interface
+ *  virtual, o backend escolhido em tempo de execucao (`--backend`), sobre
+ *  o mesmo codigo dos gerenciadores:
+ *
+ *    tamanho   sizeof de cada gerenciador com os backends do esp32 e com
+ *              os do wokwi (backends sem estado: devem ser iguais) e o
+ *              que a versao virtual somaria (um ponteiro de interface por
+ *              backend no objeto, mais a vtable de cada backend)
+ *
+ *    ciclos    ns por chamada, mediana de `--repeticoes`:
+ *                Adc::milivolts         a chamada pura, sobre todas as leituras do ADC
+ *                tabelas de calibracao  GerenciadorCalibracaoBase::restaurarFabrica
+ *                                       (NVS + 2 tabelas de PONTOS_TABELA_CALIBRACAO)
+ *                salvarRegistro         GerenciadorArmazenamentoBase no LittleFS do
+ *                                       host, `--registros` por rodada
+ *
+ *  a saida de cada par e conferida: as tabelas convertem igual e os dois
+ *  logs terminam com o mesmo tamanho. o tamanho da imagem na flash so sai
+ *  do build do esp32 (pio run -e esp32doit-devkit-v1 -t size).
+ *
+ *  uso: comparacao_plataforma [--repeticoes 5] [--registros 500]
+ *                             [--backend ideal|efuse] [--raiz comparacao_fs]
+ *
+ *  sai com 1 se os tamanhos diferirem entre as plataformas ou se as duas
+ *  versoes produzirem resultados diferentes.
+ */
+
+#include "config.h"
+#include "gerenciador_armazenamento.h"
+#include "gerenciador_calibracao.h"
+#include "gerenciador_sensores.h"
+#include "gerenciador_sleep.h"
+#include "gerenciador_time.h"
+#include "gerenciador_upload.h"
+#include "gerenciador_wifi.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// O DESENHO ALTERNATIVO: INTERFACES VIRTUAIS
+
+struct InterfaceAdc
+{
+    virtual ~InterfaceAdc() {}
+    virtual const char *iniciar() = 0;
+    virtual float milivolts(uint16_t leitura) = 0;
+};
+
+struct AdcIdealVirtual : InterfaceAdc
+{
+    const char *iniciar() override { return AdcIdeal::iniciar(); }
+    float milivolts(uint16_t leitura) override { return AdcIdeal::milivolts(leitura); }
+};
+
+struct AdcEfuseVirtual : InterfaceAdc
+{
+    const char *iniciar() override { return AdcEfuse::iniciar(); }
+    float milivolts(uint16_t leitura) override { return AdcEfuse::milivolts(leitura); }
+};
+
+struct InterfaceArquivos
+{
+    virtual ~InterfaceArquivos() {}
+    virtual bool montar() = 0;
+    virtual File abrir(const char *caminho, const char *modo) = 0;
+    virtual bool existe(const char *caminho) = 0;
+    virtual bool renomear(const char *de, const char *para) = 0;
+    virtual uint32_t capacidade() = 0;
+};
+
+struct ArquivosLittleFSVirtual : InterfaceArquivos
+{
+    bool montar() override { return ArquivosLittleFS::montar(); }
+    File abrir(const char *caminho, const char *modo) override { return ArquivosLittleFS::abrir(caminho, modo); }
+    bool existe(const char *caminho) override { return ArquivosLittleFS::existe(caminho); }
+    bool renomear(const char *de, const char *para) override { return ArquivosLittleFS::renomear(de, para); }
+    uint32_t capacidade() override { return ArquivosLittleFS::capacidade(); }
+};
+
+// escolhidos em main, como um firmware que decide a plataforma ao rodar
+static InterfaceAdc *adc_virtual = NULL;
+static InterfaceArquivos *arquivos_virtuais = NULL;
+
+// backends estaticos que so repassam a interface: o gerenciador nao muda
+struct AdcPorInterface
+{
+    static const char *iniciar() { return adc_virtual->iniciar(); }
+    static float milivolts(uint16_t leitura) { return adc_virtual->milivolts(leitura); }
+};
+
+struct ArquivosPorInterface
+{
+    static bool montar() { return arquivos_virtuais->montar(); }
+    static File abrir(const char *caminho, const char *modo) { return arquivos_virtuais->abrir(caminho, modo); }
+    static bool existe(const char *caminho) { return arquivos_virtuais->existe(caminho); }
+    static bool renomear(const char *de, const char *para) { return arquivos_virtuais->renomear(de, para); }
+    static uint32_t capacidade() { return arquivos_virtuais->capacidade(); }
+};
+
+// TAMANHO
+
+struct Tamanho
+{
+    const char *nome;
+    size_t esp32;
+    size_t wokwi;
+    uint8_t backends;
+};
+
+// CICLOS
+
+static double agoraNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double mediana(std::vector<double> valores)
+{
+    std::sort(valores.begin(), valores.end());
+    return valores[valores.size() / 2];
+}
+
+/*
+ * converte todas as leituras do ADC, como a construcao das tabelas faz
+ */
+template <typename Adc>
+static double medirMilivolts(int repeticoes, std::vector<float> &milivolts)
+{
+    std::vector<double> ns;
+    milivolts.assign(LEITURA_ADC_MAXIMA + 1, 0.0f);
+    for (int r = 0; r < repeticoes; r++)
+    {
+        double inicio = agoraNs();
+        for (int volta = 0; volta < 256; volta++)
+        {
+            for (uint16_t leitura = 0; leitura <= LEITURA_ADC_MAXIMA; leitura++)
+                milivolts[leitura] = Adc::milivolts(leitura);
+            __asm__ __volatile__("" : : "r"(milivolts.data()) : "memory"); // cada volta conta
+        }
+        ns.push_back((agoraNs() - inicio) / (256.0 * (LEITURA_ADC_MAXIMA + 1)));
+    }
+    return mediana(ns);
+}
+
+template <typename Adc>
+static double medirTabelas(int repeticoes, GerenciadorCalibracaoBase<Adc> &calibracao)
+{
+    std::vector<double> ns;
+    calibracao.iniciar();
+    for (int r = 0; r < repeticoes; r++)
+    {
+        double inicio = agoraNs();
+        calibracao.restaurarFabrica();
+        ns.push_back(agoraNs() - inicio);
+    }
+    return mediana(ns);
+}
+
+template <typename Arquivos>
+static double medirRegistros(int repeticoes, uint32_t registros, const std::string &raiz, size_t &tamanho_log)
+{
+    std::vector<double> ns;
+    for (int r = 0; r < repeticoes; r++)
+    {
+        std::string limpar = "rm -rf '" + raiz + "'";
+        if (system(limpar.c_str()) != 0)
+            exit(2);
+        LittleFS.definirRaiz(raiz);
+
+        GerenciadorArmazenamentoBase<Arquivos> armazenamento;
+        armazenamento.iniciar();
+
+        DadosTempo tempo = {1700000000, 0, true, 50};
+        DadosSensores sensores;
+        sensores.canais.limpar();
+        sensores.timestamp_leitura = 0;
+        sensores.faixas = 0;
+
+        double inicio = agoraNs();
+        for (uint32_t i = 0; i < registros; i++)
+        {
+            tempo.epoch += 300;
+            sensores.canais.definir(CANAL_TEMPERATURA, 2250 + (int32_t)(i % 50));
+            sensores.canais.definir(CANAL_LUMINOSIDADE, 40000 + (int32_t)(i % 300));
+            armazenamento.salvarRegistro(tempo, sensores);
+        }
+        ns.push_back((agoraNs() - inicio) / registros);
+
+        File log = LittleFS.open(armazenamento.arquivoLog(), "r");
+        tamanho_log = log ? log.size() : 0;
+        log.close();
+    }
+    return mediana(ns);
+}
+
+static void imprimirCiclos(const char *nome, double estatico, double virtual_, const char *unidade, double escala)
+{
+    printf("  %-23s %12.2f %12.2f %+9.1f%%  %s\n", nome, estatico / escala, virtual_ / escala,
+           100.0 * (virtual_ - estatico) / estatico, unidade);
+}
+
+int main(int argc, char **argv)
+{
+    int repeticoes = 5;
+    uint32_t registros = 500;
+    std::string backend = "ideal";
+    std::string raiz = "comparacao_fs";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--repeticoes")
+            repeticoes = atoi(argv[i + 1]);
+        else if (opcao == "--registros")
+            registros = atol(argv[i + 1]);
+        else if (opcao == "--backend")
+            backend = argv[i + 1];
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (repeticoes <= 0 || registros == 0 || (backend != "ideal" && backend != "efuse"))
+    {
+        fprintf(stderr, "--repeticoes e --registros precisam ser positivos e --backend ser ideal ou efuse\n");
+        return 2;
+    }
+
+    AdcIdealVirtual adc_ideal;
+    AdcEfuseVirtual adc_efuse;
+    ArquivosLittleFSVirtual arquivos_littlefs;
+    adc_virtual = backend == "ideal" ? (InterfaceAdc *)&adc_ideal : (InterfaceAdc *)&adc_efuse;
+    arquivos_virtuais = &arquivos_littlefs;
+    Serial.silenciar(true);
+
+    // tamanho dos objetos: backends sao tipos, nao membros
+    const Tamanho tamanhos[] = {
+        {"armazenamento", sizeof(GerenciadorArmazenamentoBase<PlataformaESP32::Arquivos>),
+         sizeof(GerenciadorArmazenamentoBase<PlataformaWokwi::Arquivos>), 1},
+        {"upload", sizeof(GerenciadorUploadBase<PlataformaESP32::Transporte, PlataformaESP32::Enlace>),
+         sizeof(GerenciadorUploadBase<PlataformaWokwi::Transporte, PlataformaWokwi::Enlace>), 2},
+        {"tempo", sizeof(GerenciadorTempoBase<PlataformaESP32::Relogio>),
+         sizeof(GerenciadorTempoBase<PlataformaWokwi::Relogio>), 1},
+        {"wifi", sizeof(GerenciadorWiFiBase<PlataformaESP32::Rede>), sizeof(GerenciadorWiFiBase<PlataformaWokwi::Rede>),
+         1},
+        {"sono", sizeof(GerenciadorSleepBase<PlataformaESP32::Sono>), sizeof(GerenciadorSleepBase<PlataformaWokwi::Sono>),
+         1},
+        {"calibracao", sizeof(GerenciadorCalibracaoBase<PlataformaESP32::Adc>),
+         sizeof(GerenciadorCalibracaoBase<PlataformaWokwi::Adc>), 1},
+    };
+
+    // no esp32 ponteiro e vptr tem 4 bytes
+    const size_t PONTEIRO_ESP32 = 4;
+
+    bool ok = true;
+    printf("[comparacao_plataforma] backend virtual: %s, %d repeticoes\n", backend.c_str(), repeticoes);
+    printf("tamanho dos gerenciadores no host (bytes):\n");
+    printf("  %-15s %8s %8s %22s\n", "gerenciador", "esp32", "wokwi", "virtual (ptr no esp32)");
+    for (const Tamanho &t : tamanhos)
+    {
+        bool iguais = t.esp32 == t.wokwi;
+        ok = ok && iguais;
+        printf("  %-15s %8zu %8zu %13zu (+%u)%s\n", t.nome, t.esp32, t.wokwi, t.esp32 + t.backends * sizeof(void *),
+               (unsigned)(t.backends * PONTEIRO_ESP32), iguais ? "" : "  <- difere entre plataformas");
+    }
+    printf("  vtables na flash (esp32): %u bytes por backend de 5 metodos (arquivos), %u do adc\n",
+           (unsigned)((2 + 2 + 5) * PONTEIRO_ESP32), (unsigned)((2 + 2 + 2) * PONTEIRO_ESP32));
+
+    // ciclos
+    printf("ciclos (mediana):         %12s %12s %10s\n", "template", "virtual", "diferenca");
+    std::vector<float> mv_estatico, mv_virtual;
+    double ns_estatico = backend == "ideal" ? medirMilivolts<AdcIdeal>(repeticoes, mv_estatico)
+                                            : medirMilivolts<AdcEfuse>(repeticoes, mv_estatico);
+    double ns_virtual = medirMilivolts<AdcPorInterface>(repeticoes, mv_virtual);
+    imprimirCiclos("Adc::milivolts", ns_estatico, ns_virtual, "ns/chamada", 1.0);
+    ok = ok && mv_estatico == mv_virtual;
+
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0)
+        return 2;
+    LittleFS.definirRaiz(raiz);
+    GerenciadorCalibracaoBase<AdcIdeal> calibracao_ideal;
+    GerenciadorCalibracaoBase<AdcEfuse> calibracao_efuse;
+    GerenciadorCalibracaoBase<AdcPorInterface> calibracao_virtual;
+    double tabelas_estatico = backend == "ideal" ? medirTabelas(repeticoes, calibracao_ideal)
+                                                 : medirTabelas(repeticoes, calibracao_efuse);
+    double tabelas_virtual = medirTabelas(repeticoes, calibracao_virtual);
+    imprimirCiclos("tabelas de calibracao", tabelas_estatico, tabelas_virtual, "us/compilacao", 1e3);
+    for (uint16_t leitura = 0; leitura <= LEITURA_ADC_MAXIMA; leitura++)
+    {
+        float estatico = backend == "ideal" ? calibracao_ideal.temperatura(leitura) : calibracao_efuse.temperatura(leitura);
+        ok = ok && estatico == calibracao_virtual.temperatura(leitura);
+    }
+
+    size_t log_estatico = 0, log_virtual = 0;
+    double registro_estatico = medirRegistros<ArquivosLittleFS>(repeticoes, registros, raiz, log_estatico);
+    double registro_virtual = medirRegistros<ArquivosPorInterface>(repeticoes, registros, raiz, log_virtual);
+    imprimirCiclos("salvarRegistro", registro_estatico, registro_virtual, "us/registro", 1e3);
+    ok = ok && log_estatico == log_virtual && log_estatico > 0;
+    printf("  logs: %zu x %zu bytes, milivolts e tabelas %s\n", log_estatico, log_virtual,
+           ok ? "iguais" : "DIFERENTES");
+
+    printf("mesmo tamanho nas plataformas e mesmo resultado nas duas versoes: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
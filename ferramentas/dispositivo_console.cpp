@@ -0,0 +1,113 @@
+/*
+ *  [i] dispositivo simulado para o console serial (build nativo)
+ *
+ *  roda o GerenciadorConsole real sobre um pseudo-terminal: grava um
+ *  backlog sintetico no LittleFS simulado (sem wifi, os registros se
+ *  acumulam) e atende comandos ate ser interrompido. o caminho do pty e
+ *  impresso na saida; o cliente_console, ou qualquer terminal serial,
+ *  abre esse caminho no lugar do cabo usb.
+ *
+ *  uso: dispositivo_console [--dias 30] [--periodo-s 300] [--raiz console_fs]
+ */
+
+#include "config.h"
+#include "console_serial.h"
+
+/*
+ * backlog de `dias` com um registro a cada periodo_s, terminando agora
+ */
+static uint32_t gerarBacklog(GerenciadorArmazenamento &armazenamento, int dias, uint32_t periodo_s)
+{
+    CanalMock geradores[NUMERO_CANAIS];
+    for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+        geradores[c].configurar(GerenciadorSensores::canais()[c].mock);
+
+    uint32_t registros = (uint32_t)dias * 86400 / periodo_s;
+    uint32_t epoch = time(NULL) - registros * periodo_s;
+    for (uint32_t i = 0; i < registros; i++, epoch += periodo_s)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores sensores;
+        sensores.canais.limpar();
+        sensores.faixas = 0;
+        for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+        {
+            float valor;
+            if (geradores[c].gerar(epoch, valor))
+                sensores.canais.definir(c, escalarValor(valor, GerenciadorSensores::canais()[c].casas));
+        }
+        sensores.timestamp_leitura = i;
+        armazenamento.salvarRegistro(tempo, sensores);
+    }
+    return registros;
+}
+
+int main(int argc, char **argv)
+{
+    int dias = 30;
+    uint32_t periodo_s = TEMPO_DEEP_SLEEP_COMPLETO / 1000;
+    std::string raiz = "console_fs";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--dias")
+            dias = atoi(argv[i + 1]);
+        else if (opcao == "--periodo-s")
+            periodo_s = atoi(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (dias < 0 || periodo_s == 0)
+    {
+        fprintf(stderr, "--dias e --periodo-s precisam ser positivos\n");
+        return 2;
+    }
+
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    LittleFS.remove("/dados_log.csv");
+
+    GerenciadorArmazenamento armazenamento;
+    GerenciadorConfig config;
+    GerenciadorSensores sensores;
+    GerenciadorEnergia energia;
+    GerenciadorTelemetria telemetria;
+    GerenciadorTempo tempo;
+    GerenciadorConsole console(armazenamento, config, sensores, energia, telemetria, tempo);
+
+    Serial.silenciar(true);
+    armazenamento.iniciar();
+    config.carregar();
+    sensores.iniciar();
+    energia.iniciar();
+    telemetria.iniciar();
+    tempo.iniciar();
+
+    uint32_t registros = gerarBacklog(armazenamento, dias, periodo_s);
+    File log = armazenamento.abrirLeitura(armazenamento.arquivoLog());
+    printf("[dispositivo] %u registros (%d dias) em %s%s, %u bytes\n", registros, dias, raiz.c_str(),
+           armazenamento.arquivoLog(), log ? (unsigned)log.size() : 0u);
+    log.close();
+
+    const char *porta = Serial.abrirPty();
+    if (porta == NULL)
+    {
+        perror("pty");
+        return 1;
+    }
+    printf("[dispositivo] console em %s (ctrl+c encerra)\n", porta);
+    fflush(stdout);
+
+    // sem ciclos nem sono: o console fica sempre escutando
+    while (true)
+    {
+        console.atender();
+        delay(2);
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ *  [i] fila SPSC: estresse e vazao contra mutex + deque (build nativo)
+ *
+ *  estresse: um produtor e um consumidor em threads separadas passam
+ *  `registros` RegistroDados pela FilaSPSC (fila_spsc.h) com capacidade
+ *  2, CAPACIDADE_FILA_REGISTROS e 1024. cada registro leva o seu numero
+ *  e um checksum dos campos; o consumidor confere ordem, conteudo e
+ *  total. pausas sorteadas nos dois lados exercitam fila cheia, fila
+ *  vazia e a releitura dos indices em cache. rode tambem pelo ambiente
+ *  estresse_fila_tsan (ThreadSanitizer): qualquer corrida aparece como
+ *  relatorio do tsan e o processo sai com erro.
+ *
+ *  vazao: registros/s da FilaSPSC contra um std::deque protegido por
+ *  std::mutex, com a mesma capacidade e a mesma espera (yield) quando
+ *  cheia ou vazia. mediana de `repeticoes`.
+ *
+ *  uso: estresse_fila [--registros 2000000] [--repeticoes 5] [--semente 1]
+ *
+ *  sai com 1 se algum registro chegar fora de ordem, corrompido ou faltar.
+ */
+
+#include "config.h"
+#include "fila_spsc.h"
+#include "gerenciador_armazenamento.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// REGISTROS
+
+static uint32_t assinatura(const RegistroDados &registro)
+{
+    return registro.sequencia * 2654435761u ^ registro.tempo.epoch ^ registro.tempo.incerteza_ms;
+}
+
+static RegistroDados registroNumero(uint32_t numero)
+{
+    RegistroDados registro;
+    memset(&registro, 0, sizeof(registro));
+    registro.sequencia = numero;
+    registro.tempo.epoch = 1700000000 + numero * 300;
+    registro.tempo.incerteza_ms = numero % 1000;
+    registro.checksum = assinatura(registro);
+    return registro;
+}
+
+// BASE DE COMPARACAO
+
+template <uint32_t CAPACIDADE>
+class FilaMutex
+{
+private:
+    std::mutex trava;
+    std::deque<RegistroDados> itens;
+
+public:
+    bool inserir(const RegistroDados &item)
+    {
+        std::lock_guard<std::mutex> guarda(trava);
+        if (itens.size() == CAPACIDADE)
+            return false;
+        itens.push_back(item);
+        return true;
+    }
+
+    bool remover(RegistroDados &item)
+    {
+        std::lock_guard<std::mutex> guarda(trava);
+        if (itens.empty())
+            return false;
+        item = itens.front();
+        itens.pop_front();
+        return true;
+    }
+};
+
+// EXECUCAO
+
+struct Resultado
+{
+    uint32_t recebidos = 0;
+    uint32_t fora_de_ordem = 0;
+    uint32_t corrompidos = 0;
+    double segundos = 0.0;
+};
+
+/*
+ * produtor nesta thread, consumidor em outra; pausa_cada > 0 sorteia
+ * esperas curtas em 1 de cada pausa_cada operacoes de cada lado
+ */
+template <typename Fila>
+static Resultado transferir(Fila &fila, uint32_t registros, uint32_t pausa_cada, uint32_t semente)
+{
+    Resultado r;
+    auto inicio = std::chrono::steady_clock::now();
+
+    std::thread consumidor([&]() {
+        std::mt19937 aleatorio(semente ^ 0xC0FFEE);
+        RegistroDados registro;
+        uint32_t esperado = 0;
+        while (esperado < registros)
+        {
+            if (!fila.remover(registro))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (registro.sequencia != esperado)
+                r.fora_de_ordem++;
+            if (registro.checksum != assinatura(registro))
+                r.corrompidos++;
+            esperado = registro.sequencia + 1;
+            r.recebidos++;
+            if (pausa_cada && aleatorio() % pausa_cada == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(aleatorio() % 50));
+        }
+    });
+
+    std::mt19937 aleatorio(semente);
+    for (uint32_t i = 0; i < registros; i++)
+    {
+        RegistroDados registro = registroNumero(i);
+        while (!fila.inserir(registro))
+            std::this_thread::yield();
+        if (pausa_cada && aleatorio() % pausa_cada == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(aleatorio() % 50));
+    }
+    consumidor.join();
+
+    r.segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    return r;
+}
+
+template <uint32_t CAPACIDADE>
+static bool estressar(uint32_t registros, uint32_t semente)
+{
+    std::unique_ptr<FilaSPSC<RegistroDados, CAPACIDADE>> fila(new FilaSPSC<RegistroDados, CAPACIDADE>());
+    Resultado r = transferir(*fila, registros, 64, semente);
+    bool ok = r.recebidos == registros && r.fora_de_ordem == 0 && r.corrompidos == 0 && fila->vazia();
+    printf("  capacidade %-5u %9u recebidos %6u fora de ordem %6u corrompidos  %s\n", CAPACIDADE, r.recebidos,
+           r.fora_de_ordem, r.corrompidos, ok ? "ok" : "FALHOU");
+    return ok;
+}
+
+template <uint32_t CAPACIDADE>
+static bool medirVazao(uint32_t registros, int repeticoes, uint32_t semente)
+{
+    std::vector<double> spsc, mutex;
+    bool ok = true;
+    for (int i = 0; i < repeticoes; i++)
+    {
+        std::unique_ptr<FilaSPSC<RegistroDados, CAPACIDADE>> fila(new FilaSPSC<RegistroDados, CAPACIDADE>());
+        Resultado r = transferir(*fila, registros, 0, semente);
+        ok = ok && r.recebidos == registros && r.fora_de_ordem == 0 && r.corrompidos == 0;
+        spsc.push_back(registros / r.segundos);
+
+        FilaMutex<CAPACIDADE> base;
+        r = transferir(base, registros, 0, semente);
+        ok = ok && r.recebidos == registros && r.fora_de_ordem == 0 && r.corrompidos == 0;
+        mutex.push_back(registros / r.segundos);
+    }
+    std::sort(spsc.begin(), spsc.end());
+    std::sort(mutex.begin(), mutex.end());
+    double m_spsc = spsc[spsc.size() / 2], m_mutex = mutex[mutex.size() / 2];
+    printf("  capacidade %-5u %10.2f M reg/s %14.2f M reg/s %8.1fx\n", CAPACIDADE, m_spsc / 1e6, m_mutex / 1e6,
+           m_spsc / m_mutex);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t registros = 2000000;
+    int repeticoes = 5;
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--registros")
+            registros = atol(argv[i + 1]);
+        else if (opcao == "--repeticoes")
+            repeticoes = atoi(argv[i + 1]);
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (registros == 0 || repeticoes <= 0)
+    {
+        fprintf(stderr, "--registros e --repeticoes precisam ser positivos\n");
+        return 2;
+    }
+
+    printf("[estresse_fila] %u registros de %zu bytes, %u threads de hardware\n", registros, sizeof(RegistroDados),
+           std::thread::hardware_concurrency());
+
+    printf("estresse (pausas sorteadas nos dois lados):\n");
+    bool ok = estressar<2>(registros / 20, semente);
+    ok = estressar<CAPACIDADE_FILA_REGISTROS>(registros / 20, semente) && ok;
+    ok = estressar<1024>(registros / 20, semente) && ok;
+
+    printf("vazao (mediana de %d):\n  %-17s %15s %20s %9s\n", repeticoes, "", "FilaSPSC", "mutex + deque", "ganho");
+    ok = medirVazao<CAPACIDADE_FILA_REGISTROS>(registros, repeticoes, semente) && ok;
+    ok = medirVazao<1024>(registros, repeticoes, semente) && ok;
+
+    printf("todos os registros chegaram em ordem e integros: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1028 @@
+/*
+ *  [i] exportador de logs offline (build nativo)
+ *
+ *  le os dumps dos dispositivos recolhidos em campo: diretorios com o
+ *  conteudo do LittleFS (raiz do stand-in nativo ou imagem extraida com
+ *  "mklittlefs -u"), arquivos dados_log*.csv soltos e copias da particao
+ *  "registros" (registros*.bin: os aneis de setores do diario_particao.h,
+ *  lidos em ordem de geracao; so a faixa bruta, sem os setores ja
+ *  liberados, salvo com --liberados). cada linha passa
+ *  pelo codec do firmware (codec_registro.h): crc32 conferido em paralelo,
+ *  lacunas e duplicatas de epoch por dispositivo, rajadas verificadas e
+ *  exportacao para CSV ou formato colunar.
+ *
+ *  uso: exportador_logs [--threads N] [--periodo-s 0] [--csv saida.csv]
+ *                       [--colunar diretorio] [--liberados] <dump|arquivo>...
+ *       exportador_logs --benchmark [--mb 256] [--threads N]
+ *
+ *  --periodo-s 0 usa a mediana dos intervalos de cada dispositivo.
+ *
+ *  formato colunar: um arquivo little-endian por coluna - dispositivo.u16,
+ *  epoch.u32, incerteza_ms.u32, simulados.u32, atipicos.u32 e <canal>.f64
+ *  (NaN = canal ausente) - e esquema.json com tipos, canais e dispositivos;
+ *  legivel com numpy.fromfile. linhas corrompidas ficam fora da exportacao.
+ */
+
+#include "config.h"
+#include "codec_registro.h"
+#include "compressao_rajada.h"
+#include "diario_particao.h"
+#include "formato_tempo.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+const size_t TAMANHO_TAREFA = 4 << 20; // bytes de log por tarefa
+const size_t JANELA_TAREFAS = 64;      // tarefas decodificadas a frente da escrita
+const size_t OCORRENCIAS_LISTADAS = 5;
+const uint8_t CANAIS_POR_RAJADA = 2;   // CANAIS_RAJADA do gerenciador_rajada.h
+
+// ENTRADAS
+
+struct ArquivoMapeado
+{
+    const char *dados = NULL;
+    size_t tamanho = 0;
+
+    bool abrir(const std::string &caminho)
+    {
+        int fd = open(caminho.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        fstat(fd, &info);
+        tamanho = info.st_size;
+        if (tamanho > 0)
+        {
+            void *mapa = mmap(NULL, tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+            dados = mapa == MAP_FAILED ? NULL : (const char *)mapa;
+            if (dados)
+                madvise(mapa, tamanho, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        return tamanho == 0 || dados != NULL;
+    }
+
+    void fechar()
+    {
+        if (dados)
+            munmap((void *)dados, tamanho);
+        dados = NULL;
+        tamanho = 0;
+    }
+};
+
+struct ArquivoLog
+{
+    std::string caminho;
+    uint16_t dispositivo;
+    ArquivoMapeado mapa;
+    bool da_particao = false;           // setores de uma copia da particao, em texto
+    std::string texto;                  // cabecalho do csv + linhas dos setores, em ordem
+    FormatoLog formato;
+    size_t inicio_registros;            // depois do cabecalho
+    uint8_t coluna[MAXIMO_CANAIS];      // canal do arquivo -> coluna global
+    std::vector<uint32_t> epochs;       // em ordem de gravacao
+
+    bool abrir()
+    {
+        if (!da_particao)
+            return mapa.abrir(caminho);
+        mapa.dados = texto.data();
+        mapa.tamanho = texto.size();
+        return true;
+    }
+
+    void fechar()
+    {
+        if (!da_particao)
+            mapa.fechar();
+        mapa.dados = NULL;
+        mapa.tamanho = 0;
+    }
+};
+
+struct Dispositivo
+{
+    std::string nome;
+    std::string diretorio;
+    std::vector<uint32_t> epochs;
+    uint64_t fora_de_ordem = 0;
+};
+
+struct Contadores
+{
+    uint64_t linhas[4] = {0, 0, 0, 0}; // por ResultadoLinha
+    uint64_t bytes = 0;
+
+    void somar(const Contadores &outro)
+    {
+        for (int i = 0; i < 4; i++)
+            linhas[i] += outro.linhas[i];
+        bytes += outro.bytes;
+    }
+};
+
+struct ConfigExportacao
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t periodo_s = 0;
+    std::string csv;
+    std::string colunar;
+    bool liberados = false;  // copias da particao: inclui setores ja confirmados
+    bool silencioso = false; // benchmark: sem relatorio por dispositivo
+};
+
+// DESCOBERTA DOS DUMPS
+
+static bool nomeDeLog(const char *nome)
+{
+    size_t n = strlen(nome);
+    return strncmp(nome, "dados_log", 9) == 0 && n > 4 && strcmp(nome + n - 4, ".csv") == 0;
+}
+
+static bool nomeDeCopiaParticao(const char *nome)
+{
+    size_t n = strlen(nome);
+    return strncmp(nome, ROTULO_PARTICAO_REGISTROS, strlen(ROTULO_PARTICAO_REGISTROS)) == 0 && n > 4 &&
+           strcmp(nome + n - 4, ".bin") == 0;
+}
+
+static uint16_t dispositivoDe(std::vector<Dispositivo> &dispositivos, const std::string &nome, const std::string &diretorio)
+{
+    for (size_t i = 0; i < dispositivos.size(); i++)
+        if (dispositivos[i].diretorio == diretorio)
+            return i;
+    Dispositivo novo;
+    novo.nome = nome.empty() ? diretorio : nome;
+    novo.diretorio = diretorio;
+    dispositivos.push_back(novo);
+    return dispositivos.size() - 1;
+}
+
+/*
+ * le a copia da particao "registros" (esp_partition_read / esptool
+ * read_flash, ou o arquivo do stand-in nativo): o anel da faixa bruta em
+ * ordem de geracao vira um log por trecho de setores com o mesmo cabecalho
+ * do csv. setores liberados ja foram confirmados pelo servidor (e os de
+ * formato antigo copiados para dados_log_anterior.csv) e ficam de fora,
+ * salvo com liberados. a linha interrompida no fim da cabeca ganha a
+ * quebra e aparece como corrompida, como no firmware
+ */
+static void lerCopiaParticao(const std::string &caminho, uint16_t dispositivo, bool liberados,
+                             std::vector<ArquivoLog *> &arquivos)
+{
+    ArquivoMapeado copia;
+    if (!copia.abrir(caminho) || copia.tamanho < TAMANHO_SETOR_DIARIO * NUMERO_FAIXAS)
+    {
+        fprintf(stderr, "%s: copia da particao vazia ou ilegivel\n", caminho.c_str());
+        copia.fechar();
+        return;
+    }
+
+    ArquivoLog *atual = NULL;
+    uint32_t ativos = 0, ignorados = 0;
+    percorrerCopiaDiario((const uint8_t *)copia.dados, copia.tamanho,
+                         [&](uint8_t faixa, uint32_t geracao, bool liberado, const char *texto, size_t tamanho) {
+        if (faixa != FAIXA_BRUTA)
+            return;
+        if (liberado && !liberados)
+        {
+            ignorados++;
+            atual = NULL; // o trecho seguinte nao e continuo com o anterior
+            return;
+        }
+        ativos += !liberado;
+
+        const char *quebra = (const char *)memchr(texto, '\n', tamanho);
+        size_t cabecalho = quebra ? quebra - texto + 1 : tamanho;
+        if (!atual || atual->texto.compare(0, cabecalho, texto, cabecalho) != 0)
+        {
+            atual = new ArquivoLog();
+            atual->caminho = caminho + ":" + faixas()[faixa].nome + "@" + std::to_string(geracao);
+            atual->dispositivo = dispositivo;
+            atual->da_particao = true;
+            atual->texto.assign(texto, cabecalho);
+            arquivos.push_back(atual);
+        }
+        atual->texto.append(texto + cabecalho, tamanho - cabecalho);
+        if (!atual->texto.empty() && atual->texto.back() != '\n')
+            atual->texto += '\n';
+    });
+    copia.fechar();
+    printf("[exportador] %s: %u setores ativos da faixa %s%s", caminho.c_str(), ativos, faixas()[FAIXA_BRUTA].nome,
+           liberados ? " (com os liberados)" : "");
+    if (ignorados)
+        printf(", %u liberados ignorados", ignorados);
+    printf("\n");
+}
+
+/*
+ * percorre o dump: todo diretorio com dados_log*.csv ou registros*.bin
+ * (copia da particao) e um dispositivo
+ */
+static void descobrir(const std::string &raiz, const std::string &relativo, std::vector<Dispositivo> &dispositivos,
+                      std::vector<ArquivoLog *> &arquivos, bool liberados = false)
+{
+    std::string diretorio = relativo.empty() ? raiz : raiz + "/" + relativo;
+    DIR *d = opendir(diretorio.c_str());
+    if (!d)
+        return;
+
+    std::vector<std::string> logs, copias, subdiretorios;
+    while (struct dirent *entrada = readdir(d))
+    {
+        if (entrada->d_name[0] == '.')
+            continue;
+        std::string caminho = diretorio + "/" + entrada->d_name;
+        struct stat info;
+        if (stat(caminho.c_str(), &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            subdiretorios.push_back(relativo.empty() ? entrada->d_name : relativo + "/" + entrada->d_name);
+        else if (nomeDeLog(entrada->d_name))
+            logs.push_back(caminho);
+        else if (nomeDeCopiaParticao(entrada->d_name))
+            copias.push_back(caminho);
+    }
+    closedir(d);
+
+    // o log anterior (formato antigo) vem antes do atual
+    std::sort(logs.begin(), logs.end(), [](const std::string &a, const std::string &b) {
+        bool anterior_a = a.find("anterior") != std::string::npos;
+        bool anterior_b = b.find("anterior") != std::string::npos;
+        return anterior_a != anterior_b ? anterior_a : a < b;
+    });
+    for (const std::string &caminho : logs)
+    {
+        ArquivoLog *arquivo = new ArquivoLog();
+        arquivo->caminho = caminho;
+        arquivo->dispositivo = dispositivoDe(dispositivos, relativo, diretorio);
+        arquivos.push_back(arquivo);
+    }
+
+    // a particao recebe os registros depois que passa a existir: vem por ultimo
+    std::sort(copias.begin(), copias.end());
+    for (const std::string &caminho : copias)
+        lerCopiaParticao(caminho, dispositivoDe(dispositivos, relativo, diretorio), liberados, arquivos);
+
+    std::sort(subdiretorios.begin(), subdiretorios.end());
+    for (const std::string &sub : subdiretorios)
+        descobrir(raiz, sub, dispositivos, arquivos, liberados);
+}
+
+// TAREFAS EM PARALELO
+
+struct Tarefa
+{
+    ArquivoLog *arquivo;
+    size_t inicio;
+    size_t fim;
+};
+
+/*
+ * saida de uma tarefa, escrita em ordem pelo laco principal
+ */
+struct ResultadoTarefa
+{
+    Contadores contadores;
+    std::vector<uint32_t> epochs;
+    std::vector<size_t> corrompidas; // deslocamento da linha no arquivo
+    std::string csv;
+    std::vector<uint32_t> epoch, incerteza, simulados, atipicos;
+    std::vector<std::vector<double>> canais;
+};
+
+struct Exportacao
+{
+    const ConfigExportacao &config;
+    std::vector<std::string> colunas; // canais globais (uniao dos cabecalhos)
+    std::vector<Dispositivo> &dispositivos;
+
+    FILE *csv = NULL;
+    FILE *colunas_bin[5] = {NULL, NULL, NULL, NULL, NULL}; // dispositivo, epoch, incerteza, simulados, atipicos
+    std::vector<FILE *> canais_bin;
+    uint64_t linhas_exportadas = 0;
+
+    Exportacao(const ConfigExportacao &c, std::vector<Dispositivo> &d) : config(c), dispositivos(d) {}
+};
+
+static uint32_t remapear(uint32_t bits, const uint8_t *coluna)
+{
+    uint32_t global = 0;
+    while (bits)
+    {
+        uint8_t canal = __builtin_ctz(bits);
+        bits &= bits - 1;
+        if (coluna[canal] < MAXIMO_CANAIS)
+            global |= 1u << coluna[canal];
+    }
+    return global;
+}
+
+static void decodificarTarefa(const Tarefa &tarefa, const Exportacao &exportacao, ResultadoTarefa &resultado)
+{
+    const ArquivoLog &arquivo = *tarefa.arquivo;
+    const char *base = arquivo.mapa.dados;
+    const char *p = base + tarefa.inicio;
+    const char *fim = base + tarefa.fim;
+    size_t total_colunas = exportacao.colunas.size();
+    bool exportar_csv = exportacao.csv != NULL;
+    bool exportar_colunar = exportacao.colunas_bin[0] != NULL;
+    const char *nome_dispositivo = exportacao.dispositivos[arquivo.dispositivo].nome.c_str();
+
+    if (exportar_colunar)
+        resultado.canais.assign(total_colunas, std::vector<double>());
+
+    LinhaDecodificada linha;
+    char texto[32];
+    std::vector<int8_t> posicao(total_colunas);
+
+    resultado.contadores.bytes = tarefa.fim - tarefa.inicio;
+    while (p < fim)
+    {
+        const char *quebra = (const char *)memchr(p, '\n', fim - p);
+        const char *fim_linha = quebra ? quebra : fim;
+        if (fim_linha == p || (fim_linha - p == 1 && *p == '\r'))
+        {
+            p = fim_linha + 1;
+            continue;
+        }
+
+        ResultadoLinha estado = decodificarLinhaRegistro(p, fim_linha - p, arquivo.formato, linha);
+        resultado.contadores.linhas[estado]++;
+
+        if (estado == LINHA_CORROMPIDA)
+            resultado.corrompidas.push_back(p - base);
+
+        if (estado == LINHA_INTEGRA || estado == LINHA_NAO_VERIFICADA)
+        {
+            resultado.epochs.push_back(linha.epoch);
+
+            // posicao de cada coluna global entre os valores presentes
+            std::fill(posicao.begin(), posicao.end(), -1);
+            uint32_t restantes = linha.mapa;
+            for (int8_t i = 0; restantes; i++)
+            {
+                uint8_t canal = __builtin_ctz(restantes);
+                restantes &= restantes - 1;
+                posicao[arquivo.coluna[canal]] = i;
+            }
+            uint32_t simulados = remapear(linha.simulados, arquivo.coluna);
+            uint32_t atipicos = remapear(linha.atipicos, arquivo.coluna);
+
+            if (exportar_csv)
+            {
+                std::string &s = resultado.csv;
+                s += nome_dispositivo;
+                s += ',';
+                s.append(texto, formatarNatural(linha.epoch, texto));
+                s += ',';
+                formatarDataHora(linha.epoch, FUSO_HORARIO_S, texto);
+                s += texto;
+                s += ',';
+                s.append(texto, formatarNatural(linha.incerteza_ms, texto));
+                for (size_t c = 0; c < total_colunas; c++)
+                {
+                    s += ',';
+                    if (posicao[c] >= 0)
+                        s.append(texto, formatarPontoFixo(linha.valores[posicao[c]], linha.casas[posicao[c]], texto));
+                }
+                s += ',';
+                s.append(texto, formatarMapa(simulados, texto));
+                s += ',';
+                s.append(texto, formatarMapa(atipicos, texto));
+                s += estado == LINHA_INTEGRA ? ",integra\n" : ",nao_verificada\n";
+            }
+
+            if (exportar_colunar)
+            {
+                resultado.epoch.push_back(linha.epoch);
+                resultado.incerteza.push_back(linha.incerteza_ms);
+                resultado.simulados.push_back(simulados);
+                resultado.atipicos.push_back(atipicos);
+                for (size_t c = 0; c < total_colunas; c++)
+                {
+                    resultado.canais[c].push_back(posicao[c] >= 0
+                                                      ? (double)linha.valores[posicao[c]] / potenciaDez(linha.casas[posicao[c]])
+                                                      : NAN);
+                }
+            }
+        }
+
+        p = fim_linha + 1;
+    }
+}
+
+/*
+ * grava a saida de uma tarefa e acumula os epochs do arquivo
+ */
+static void escreverResultado(const Tarefa &tarefa, Exportacao &exportacao, ResultadoTarefa &resultado)
+{
+    ArquivoLog &arquivo = *tarefa.arquivo;
+    arquivo.epochs.insert(arquivo.epochs.end(), resultado.epochs.begin(), resultado.epochs.end());
+
+    if (exportacao.csv && !resultado.csv.empty())
+        fwrite(resultado.csv.data(), 1, resultado.csv.size(), exportacao.csv);
+
+    if (exportacao.colunas_bin[0] && !resultado.epoch.empty())
+    {
+        size_t n = resultado.epoch.size();
+        std::vector<uint16_t> dispositivo(n, arquivo.dispositivo);
+        fwrite(dispositivo.data(), sizeof(uint16_t), n, exportacao.colunas_bin[0]);
+        fwrite(resultado.epoch.data(), sizeof(uint32_t), n, exportacao.colunas_bin[1]);
+        fwrite(resultado.incerteza.data(), sizeof(uint32_t), n, exportacao.colunas_bin[2]);
+        fwrite(resultado.simulados.data(), sizeof(uint32_t), n, exportacao.colunas_bin[3]);
+        fwrite(resultado.atipicos.data(), sizeof(uint32_t), n, exportacao.colunas_bin[4]);
+        for (size_t c = 0; c < exportacao.canais_bin.size(); c++)
+            fwrite(resultado.canais[c].data(), sizeof(double), n, exportacao.canais_bin[c]);
+    }
+    exportacao.linhas_exportadas += resultado.epochs.size();
+}
+
+/*
+ * decodifica todas as tarefas em paralelo; a escrita segue a ordem dos
+ * arquivos com no maximo JANELA_TAREFAS resultados em memoria
+ */
+static Contadores processarTarefas(const std::vector<Tarefa> &tarefas, Exportacao &exportacao,
+                                   std::vector<std::pair<std::string, size_t>> &corrompidas)
+{
+    std::vector<ResultadoTarefa> resultados(tarefas.size());
+    std::vector<uint8_t> prontas(tarefas.size(), 0);
+    std::mutex trava;
+    std::condition_variable mudou;
+    size_t proxima = 0, escritas = 0;
+
+    auto trabalhador = [&]() {
+        for (;;)
+        {
+            size_t indice;
+            {
+                std::unique_lock<std::mutex> bloqueio(trava);
+                mudou.wait(bloqueio, [&] { return proxima >= tarefas.size() || proxima < escritas + JANELA_TAREFAS; });
+                if (proxima >= tarefas.size())
+                    return;
+                indice = proxima++;
+            }
+            decodificarTarefa(tarefas[indice], exportacao, resultados[indice]);
+            {
+                std::lock_guard<std::mutex> bloqueio(trava);
+                prontas[indice] = 1;
+            }
+            mudou.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < exportacao.config.threads; i++)
+        threads.emplace_back(trabalhador);
+
+    Contadores total;
+    for (size_t i = 0; i < tarefas.size(); i++)
+    {
+        {
+            std::unique_lock<std::mutex> bloqueio(trava);
+            mudou.wait(bloqueio, [&] { return prontas[i] != 0; });
+        }
+        ResultadoTarefa &resultado = resultados[i];
+        escreverResultado(tarefas[i], exportacao, resultado);
+        total.somar(resultado.contadores);
+        for (size_t deslocamento : resultado.corrompidas)
+            corrompidas.push_back(std::make_pair(tarefas[i].arquivo->caminho, deslocamento));
+        resultado = ResultadoTarefa();
+        {
+            std::lock_guard<std::mutex> bloqueio(trava);
+            escritas = i + 1;
+        }
+        mudou.notify_all();
+    }
+
+    for (std::thread &t : threads)
+        t.join();
+    return total;
+}
+
+// RELATORIOS
+
+/*
+ * lacunas e duplicatas de epoch de um dispositivo
+ */
+static void analisarEpochs(Dispositivo &dispositivo, uint32_t periodo_configurado, bool detalhar)
+{
+    std::vector<uint32_t> epochs;
+    for (uint32_t epoch : dispositivo.epochs)
+        if (epoch != 0)
+            epochs.push_back(epoch);
+    std::sort(epochs.begin(), epochs.end());
+
+    uint64_t duplicatas = 0;
+    std::vector<uint32_t> intervalos;
+    for (size_t i = 1; i < epochs.size(); i++)
+    {
+        if (epochs[i] == epochs[i - 1])
+            duplicatas++;
+        else
+            intervalos.push_back(epochs[i] - epochs[i - 1]);
+    }
+
+    uint32_t periodo = periodo_configurado;
+    if (periodo == 0 && !intervalos.empty())
+    {
+        std::vector<uint32_t> copia = intervalos;
+        std::nth_element(copia.begin(), copia.begin() + copia.size() / 2, copia.end());
+        periodo = copia[copia.size() / 2];
+    }
+
+    // lacuna: intervalo maior que 1,5 periodo
+    std::vector<std::pair<uint32_t, uint32_t>> lacunas; // (duracao, inicio)
+    uint64_t perdidos = 0;
+    uint32_t anterior = 0;
+    for (size_t i = 0; i < epochs.size(); i++)
+    {
+        if (i > 0 && epochs[i] != anterior && periodo > 0 && (uint64_t)(epochs[i] - anterior) * 2 > periodo * 3ull)
+        {
+            lacunas.push_back(std::make_pair(epochs[i] - anterior, anterior));
+            perdidos += (epochs[i] - anterior + periodo / 2) / periodo - 1;
+        }
+        anterior = epochs[i];
+    }
+
+    if (!detalhar)
+        return;
+
+    char inicio[TAMANHO_DATA_HORA], fim[TAMANHO_DATA_HORA];
+    printf("  %s: %zu registros", dispositivo.nome.c_str(), dispositivo.epochs.size());
+    if (!epochs.empty())
+    {
+        formatarDataHora(epochs.front(), FUSO_HORARIO_S, inicio);
+        formatarDataHora(epochs.back(), FUSO_HORARIO_S, fim);
+        printf(" de %s a %s", inicio, fim);
+    }
+    printf(", periodo %u s\n", periodo);
+    printf("    lacunas: %zu (~%llu registros faltando), duplicatas: %llu, fora de ordem: %llu\n", lacunas.size(),
+           (unsigned long long)perdidos, (unsigned long long)duplicatas, (unsigned long long)dispositivo.fora_de_ordem);
+
+    std::sort(lacunas.rbegin(), lacunas.rend());
+    for (size_t i = 0; i < lacunas.size() && i < OCORRENCIAS_LISTADAS; i++)
+    {
+        formatarDataHora(lacunas[i].second, FUSO_HORARIO_S, inicio);
+        printf("      lacuna de %u s apos %s\n", lacunas[i].first, inicio);
+    }
+}
+
+/*
+ * confere os blocos de /rajadas.bin (cabecalho, fletcher-16 e decodificacao)
+ */
+static void verificarRajadas(const Dispositivo &dispositivo)
+{
+    std::string caminho = dispositivo.diretorio + "/rajadas.bin";
+    ArquivoMapeado mapa;
+    if (!mapa.abrir(caminho) || mapa.tamanho == 0)
+        return;
+
+    const uint8_t *dados = (const uint8_t *)mapa.dados;
+    size_t posicao = 0, integras = 0, corrompidas = 0;
+    uint64_t amostras = 0;
+    std::vector<uint16_t> saida;
+
+    while (posicao + sizeof(CabecalhoRajada) <= mapa.tamanho)
+    {
+        CabecalhoRajada cabecalho;
+        memcpy(&cabecalho, dados + posicao, sizeof(cabecalho));
+        if (cabecalho.assinatura != ASSINATURA_RAJADA || cabecalho.versao != VERSAO_RAJADA ||
+            posicao + sizeof(cabecalho) + cabecalho.tamanho_dados > mapa.tamanho)
+        {
+            corrompidas++;
+            break; // sem assinatura valida nao ha como achar o proximo bloco
+        }
+
+        const uint8_t *bloco = dados + posicao + sizeof(cabecalho);
+        bool integra = fletcher16(bloco, cabecalho.tamanho_dados) == cabecalho.verificacao;
+
+        // os canais vem em sequencia: cada um consome sua parte do bloco
+        saida.resize(cabecalho.amostras);
+        size_t consumido = 0;
+        for (uint8_t canal = 0; integra && canal < CANAIS_POR_RAJADA; canal++)
+        {
+            size_t n = decodificarDeltaVarint(bloco + consumido, cabecalho.tamanho_dados - consumido, saida.data(),
+                                              cabecalho.amostras);
+            integra = n > 0 || cabecalho.amostras == 0;
+            consumido += n;
+        }
+        integra = integra && consumido == cabecalho.tamanho_dados;
+
+        if (integra)
+        {
+            integras++;
+            amostras += cabecalho.amostras;
+        }
+        else
+        {
+            corrompidas++;
+        }
+        posicao += sizeof(cabecalho) + cabecalho.tamanho_dados;
+    }
+
+    printf("    rajadas: %zu integras (%llu amostras por canal), %zu corrompidas\n", integras,
+           (unsigned long long)amostras, corrompidas);
+    mapa.fechar();
+}
+
+// EXECUCAO
+
+static bool abrirSaidas(Exportacao &exportacao)
+{
+    const ConfigExportacao &config = exportacao.config;
+    if (!config.csv.empty())
+    {
+        exportacao.csv = fopen(config.csv.c_str(), "wb");
+        if (!exportacao.csv)
+            return false;
+        std::string cabecalho = "dispositivo,epoch,data_hora,incerteza_ms";
+        for (const std::string &coluna : exportacao.colunas)
+            cabecalho += "," + coluna;
+        cabecalho += ",simulados,atipicos,integridade\n";
+        fputs(cabecalho.c_str(), exportacao.csv);
+    }
+
+    if (!config.colunar.empty())
+    {
+        mkdir(config.colunar.c_str(), 0755);
+        const char *nomes[5] = {"dispositivo.u16", "epoch.u32", "incerteza_ms.u32", "simulados.u32", "atipicos.u32"};
+        for (int i = 0; i < 5; i++)
+            if (!(exportacao.colunas_bin[i] = fopen((config.colunar + "/" + nomes[i]).c_str(), "wb")))
+                return false;
+        for (const std::string &coluna : exportacao.colunas)
+        {
+            FILE *arquivo = fopen((config.colunar + "/" + coluna + ".f64").c_str(), "wb");
+            if (!arquivo)
+                return false;
+            exportacao.canais_bin.push_back(arquivo);
+        }
+    }
+    return true;
+}
+
+static void fecharSaidas(Exportacao &exportacao)
+{
+    const ConfigExportacao &config = exportacao.config;
+    if (exportacao.csv)
+        fclose(exportacao.csv);
+    if (!exportacao.colunas_bin[0])
+        return;
+
+    for (FILE *arquivo : exportacao.colunas_bin)
+        fclose(arquivo);
+    for (FILE *arquivo : exportacao.canais_bin)
+        fclose(arquivo);
+
+    FILE *esquema = fopen((config.colunar + "/esquema.json").c_str(), "w");
+    fprintf(esquema, "{\"linhas\": %llu, \"colunas\": [", (unsigned long long)exportacao.linhas_exportadas);
+    fprintf(esquema, "{\"nome\": \"dispositivo\", \"tipo\": \"u16\"}, {\"nome\": \"epoch\", \"tipo\": \"u32\"}, "
+                     "{\"nome\": \"incerteza_ms\", \"tipo\": \"u32\"}, {\"nome\": \"simulados\", \"tipo\": \"u32\"}, "
+                     "{\"nome\": \"atipicos\", \"tipo\": \"u32\"}");
+    for (const std::string &coluna : exportacao.colunas)
+        fprintf(esquema, ", {\"nome\": \"%s\", \"tipo\": \"f64\", \"canal\": true}", coluna.c_str());
+    fprintf(esquema, "], \"dispositivos\": [");
+    for (size_t i = 0; i < exportacao.dispositivos.size(); i++)
+        fprintf(esquema, "%s\"%s\"", i ? ", " : "", exportacao.dispositivos[i].nome.c_str());
+    fprintf(esquema, "]}\n");
+    fclose(esquema);
+}
+
+/*
+ * verifica e exporta os arquivos; retorna os contadores e preenche os segundos
+ */
+static Contadores exportar(std::vector<ArquivoLog *> &arquivos, std::vector<Dispositivo> &dispositivos,
+                           const ConfigExportacao &config, double &segundos)
+{
+    Exportacao exportacao(config, dispositivos);
+    std::vector<Tarefa> tarefas;
+    auto inicio = std::chrono::steady_clock::now();
+
+    // cabecalhos: formato de cada arquivo e uniao das colunas de canais
+    for (ArquivoLog *arquivo : arquivos)
+    {
+        if (!arquivo->abrir())
+        {
+            fprintf(stderr, "nao foi possivel ler %s\n", arquivo->caminho.c_str());
+            continue;
+        }
+        const char *dados = arquivo->mapa.dados;
+        size_t tamanho = arquivo->mapa.tamanho;
+        const char *quebra = dados ? (const char *)memchr(dados, '\n', tamanho) : NULL;
+        arquivo->formato = formatoDoCabecalho(dados, quebra ? quebra - dados : tamanho);
+        if (!arquivo->formato.valido)
+        {
+            fprintf(stderr, "%s: cabecalho nao reconhecido\n", arquivo->caminho.c_str());
+            continue;
+        }
+        arquivo->inicio_registros = quebra ? quebra - dados + 1 : tamanho;
+
+        for (uint8_t i = 0; i < arquivo->formato.canais; i++)
+        {
+            std::string nome(arquivo->formato.nomes[i], arquivo->formato.tamanhos_nomes[i]);
+            size_t c = std::find(exportacao.colunas.begin(), exportacao.colunas.end(), nome) - exportacao.colunas.begin();
+            if (c == exportacao.colunas.size())
+                exportacao.colunas.push_back(nome);
+            arquivo->coluna[i] = c;
+        }
+
+        // tarefas de ~TAMANHO_TAREFA cortadas em quebras de linha
+        size_t posicao = arquivo->inicio_registros;
+        while (posicao < tamanho)
+        {
+            size_t fim = std::min(tamanho, posicao + TAMANHO_TAREFA);
+            if (fim < tamanho)
+            {
+                const char *proxima = (const char *)memchr(dados + fim, '\n', tamanho - fim);
+                fim = proxima ? proxima - dados + 1 : tamanho;
+            }
+            tarefas.push_back({arquivo, posicao, fim});
+            posicao = fim;
+        }
+    }
+
+    std::vector<std::pair<std::string, size_t>> corrompidas;
+    Contadores total;
+    if (!abrirSaidas(exportacao))
+        fprintf(stderr, "nao foi possivel criar as saidas\n");
+    else
+        total = processarTarefas(tarefas, exportacao, corrompidas);
+    fecharSaidas(exportacao);
+
+    for (ArquivoLog *arquivo : arquivos)
+    {
+        Dispositivo &dispositivo = dispositivos[arquivo->dispositivo];
+        for (size_t i = 1; i < arquivo->epochs.size(); i++)
+            dispositivo.fora_de_ordem += arquivo->epochs[i] < arquivo->epochs[i - 1];
+        dispositivo.epochs.insert(dispositivo.epochs.end(), arquivo->epochs.begin(), arquivo->epochs.end());
+        arquivo->epochs = std::vector<uint32_t>();
+        arquivo->fechar();
+    }
+    segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    if (!config.silencioso)
+    {
+        for (size_t i = 0; i < corrompidas.size() && i < OCORRENCIAS_LISTADAS; i++)
+            printf("  [!] crc invalido em %s, byte %zu\n", corrompidas[i].first.c_str(), corrompidas[i].second);
+        if (corrompidas.size() > OCORRENCIAS_LISTADAS)
+            printf("  [!] ... mais %zu linhas corrompidas\n", corrompidas.size() - OCORRENCIAS_LISTADAS);
+    }
+    return total;
+}
+
+static void imprimirTotais(const Contadores &total, double segundos, unsigned threads)
+{
+    uint64_t registros = total.linhas[LINHA_INTEGRA] + total.linhas[LINHA_NAO_VERIFICADA] +
+                         total.linhas[LINHA_CORROMPIDA] + total.linhas[LINHA_MALFORMADA];
+    printf("  linhas: %llu integras, %llu sem crc (formato antigo), %llu corrompidas, %llu malformadas\n",
+           (unsigned long long)total.linhas[LINHA_INTEGRA], (unsigned long long)total.linhas[LINHA_NAO_VERIFICADA],
+           (unsigned long long)total.linhas[LINHA_CORROMPIDA], (unsigned long long)total.linhas[LINHA_MALFORMADA]);
+    printf("  %.1f MB em %.3f s com %u threads: %.0f MB/s, %.1f M registros/s\n", total.bytes / 1e6, segundos,
+           threads, segundos > 0 ? total.bytes / 1e6 / segundos : 0.0, segundos > 0 ? registros / 1e6 / segundos : 0.0);
+}
+
+// BENCHMARK
+
+struct DescritorBenchmark
+{
+    const char *nome;
+    uint8_t casas;
+};
+
+/*
+ * gera dumps sinteticos com o codec do firmware: passeio aleatorio em
+ * 4 canais, 0,1% de linhas com um digito trocado, lacunas e duplicatas
+ */
+static void gerarDumpsBenchmark(const std::string &raiz, size_t bytes_alvo, unsigned dispositivos)
+{
+    static const DescritorBenchmark canais[] = {{"temperatura", 2}, {"luminosidade", 2}, {"umidade", 1}, {"bateria_mv", 0}};
+    const uint8_t total_canais = sizeof(canais) / sizeof(canais[0]);
+    mkdir(raiz.c_str(), 0755);
+
+    std::string cabecalho = "seq,timestamp,incerteza_ms,mapa,marcas";
+    for (const DescritorBenchmark &canal : canais)
+        cabecalho += std::string(",") + canal.nome;
+    cabecalho += ",crc32\n";
+
+    std::mt19937 aleatorio(42);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+    char linha[tamanhoMaximoLinhaRegistro(total_canais) + 2];
+
+    for (unsigned d = 0; d < dispositivos; d++)
+    {
+        std::string diretorio = raiz + "/disp_" + std::to_string(d);
+        mkdir(diretorio.c_str(), 0755);
+        FILE *arquivo = fopen((diretorio + "/dados_log.csv").c_str(), "wb");
+        fputs(cabecalho.c_str(), arquivo);
+
+        uint32_t sequencia = 1;
+        uint32_t epoch = 1700000000;
+        double valores[total_canais] = {22.5, 300.0, 55.0, 3700.0};
+        size_t escritos = cabecalho.size();
+        while (escritos < bytes_alvo / dispositivos)
+        {
+            RegistroCanais<total_canais> registro;
+            registro.limpar();
+            for (uint8_t c = 0; c < total_canais; c++)
+            {
+                valores[c] += (uniforme(aleatorio) - 0.5) * valores[c] * 0.01;
+                if (c < 2 || uniforme(aleatorio) < 0.25)
+                    registro.definir(c, escalarValor(valores[c], canais[c].casas));
+            }
+            if (uniforme(aleatorio) < 0.01)
+                registro.simulados |= 1;
+
+            uint32_t crc;
+            size_t tamanho = formatarLinhaRegistro(sequencia++, epoch, 50, registro, canais, linha, crc);
+            if (uniforme(aleatorio) < 0.001)
+                linha[tamanho / 2] = linha[tamanho / 2] == '0' ? '1' : '0';
+            linha[tamanho++] = '\n';
+            fwrite(linha, 1, tamanho, arquivo);
+            escritos += tamanho;
+
+            double sorteio = uniforme(aleatorio);
+            epoch += sorteio < 0.0005 ? 3600 : (sorteio < 0.001 ? 0 : 300);
+        }
+        fclose(arquivo);
+    }
+}
+
+static int executarBenchmark(size_t megabytes, unsigned threads_max)
+{
+    const std::string raiz = "exportador_bench";
+    const unsigned dispositivos = 64;
+    printf("[exportador] gerando %zu MB em %u dispositivos sinteticos (%s/)\n", megabytes, dispositivos, raiz.c_str());
+    gerarDumpsBenchmark(raiz, megabytes << 20, dispositivos);
+
+    // leitura crua dos mesmos arquivos: referencia de "velocidade de disco"
+    {
+        std::vector<Dispositivo> dispositivos_lidos;
+        std::vector<ArquivoLog *> arquivos;
+        descobrir(raiz, "", dispositivos_lidos, arquivos);
+        auto inicio = std::chrono::steady_clock::now();
+        uint64_t bytes = 0, soma = 0;
+        for (ArquivoLog *arquivo : arquivos)
+        {
+            arquivo->mapa.abrir(arquivo->caminho);
+            const char *p = arquivo->mapa.dados;
+            for (size_t i = 0; i < arquivo->mapa.tamanho; i += 64)
+                soma += p[i];
+            bytes += arquivo->mapa.tamanho;
+            arquivo->mapa.fechar();
+            delete arquivo;
+        }
+        double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+        printf("\n[exportador] leitura crua (page cache, 1 thread): %.0f MB/s (%llu)\n", bytes / 1e6 / segundos,
+               (unsigned long long)(soma & 1));
+    }
+
+    struct Cenario
+    {
+        const char *nome;
+        bool csv;
+        bool colunar;
+    };
+    const Cenario cenarios[] = {{"verificacao", false, false}, {"verificacao + csv", true, false},
+                                {"verificacao + colunar", false, true}};
+
+    std::vector<unsigned> contagens;
+    for (unsigned threads = 1; threads < threads_max; threads *= 2)
+        contagens.push_back(threads);
+    contagens.push_back(threads_max);
+
+    for (const Cenario &cenario : cenarios)
+    {
+        printf("\n[exportador] %s\n", cenario.nome);
+        for (unsigned threads : contagens)
+        {
+            ConfigExportacao config;
+            config.threads = threads;
+            config.silencioso = true;
+            if (cenario.csv)
+                config.csv = "/dev/null";
+            if (cenario.colunar)
+                config.colunar = raiz + "_colunar";
+
+            std::vector<Dispositivo> dispositivos_lidos;
+            std::vector<ArquivoLog *> arquivos;
+            descobrir(raiz, "", dispositivos_lidos, arquivos);
+            double segundos;
+            Contadores total = exportar(arquivos, dispositivos_lidos, config, segundos);
+            for (Dispositivo &dispositivo : dispositivos_lidos)
+                analisarEpochs(dispositivo, 0, false);
+            imprimirTotais(total, segundos, threads);
+            for (ArquivoLog *arquivo : arquivos)
+                delete arquivo;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    ConfigExportacao config;
+    std::vector<std::string> entradas;
+    bool benchmark = false;
+    size_t megabytes = 256;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string opcao = argv[i];
+        bool tem_valor = i + 1 < argc;
+        if (opcao == "--benchmark")
+            benchmark = true;
+        else if (opcao == "--liberados")
+            config.liberados = true;
+        else if (opcao == "--threads" && tem_valor)
+            config.threads = std::max(1, atoi(argv[++i]));
+        else if (opcao == "--periodo-s" && tem_valor)
+            config.periodo_s = atoi(argv[++i]);
+        else if (opcao == "--csv" && tem_valor)
+            config.csv = argv[++i];
+        else if (opcao == "--colunar" && tem_valor)
+            config.colunar = argv[++i];
+        else if (opcao == "--mb" && tem_valor)
+            megabytes = atoi(argv[++i]);
+        else if (opcao.compare(0, 2, "--") == 0)
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+        else
+            entradas.push_back(opcao);
+    }
+
+    if (benchmark)
+        return executarBenchmark(megabytes, config.threads);
+
+    if (entradas.empty())
+    {
+        fprintf(stderr, "uso: exportador_logs [--threads N] [--periodo-s 0] [--csv saida.csv] "
+                        "[--colunar diretorio] [--liberados] <dump|arquivo>...\n");
+        return 2;
+    }
+
+    std::vector<Dispositivo> dispositivos;
+    std::vector<ArquivoLog *> arquivos;
+    for (const std::string &entrada : entradas)
+    {
+        struct stat info;
+        if (stat(entrada.c_str(), &info) != 0)
+        {
+            fprintf(stderr, "nao encontrado: %s\n", entrada.c_str());
+            return 2;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            descobrir(entrada, "", dispositivos, arquivos, config.liberados);
+        }
+        else
+        {
+            size_t barra = entrada.find_last_of('/');
+            std::string diretorio = barra == std::string::npos ? "." : entrada.substr(0, barra);
+            if (entrada.size() > 4 && entrada.compare(entrada.size() - 4, 4, ".bin") == 0)
+            {
+                lerCopiaParticao(entrada, dispositivoDe(dispositivos, diretorio, diretorio), config.liberados, arquivos);
+                continue;
+            }
+            ArquivoLog *arquivo = new ArquivoLog();
+            arquivo->caminho = entrada;
+            arquivo->dispositivo = dispositivoDe(dispositivos, diretorio, diretorio);
+            arquivos.push_back(arquivo);
+        }
+    }
+
+    printf("[exportador] %zu arquivos de log em %zu dispositivos\n", arquivos.size(), dispositivos.size());
+    double segundos;
+    Contadores total = exportar(arquivos, dispositivos, config, segundos);
+
+    printf("\n[exportador] dispositivos\n");
+    for (Dispositivo &dispositivo : dispositivos)
+    {
+        analisarEpochs(dispositivo, config.periodo_s, true);
+        verificarRajadas(dispositivo);
+    }
+
+    printf("\n[exportador] total\n");
+    imprimirTotais(total, segundos, config.threads);
+    if (!config.csv.empty())
+        printf("  csv: %s\n", config.csv.c_str());
+    if (!config.colunar.empty())
+        printf("  colunar: %s/ (esquema.json)\n", config.colunar.c_str());
+
+    for (ArquivoLog *arquivo : arquivos)
+        delete arquivo;
+
+    bool falhas = total.linhas[LINHA_CORROMPIDA] + total.linhas[LINHA_MALFORMADA] > 0;
+    return falhas ? 1 : 0;
+}
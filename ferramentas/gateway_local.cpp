@@ -0,0 +1,216 @@
+/*
+ *  [i] gateway local de referencia (host): lotes em datagramas udp
+ *
+ *  faz o papel do gateway esp-now no build nativo: o stand-in do esp_now
+ *  manda cada quadro para esta porta. cada LOTE e verificado (crc32),
+ *  decodificado e refeito nas linhas do log identicas as da flash (mesmo
+ *  crc32 de linha), acrescentadas em <dir>/<mac>_faixa<N>.csv. cada LOTE
+ *  recebe um ACK com a sua faixa de seq e o maior seq sem buracos do
+ *  dispositivo e da faixa (ver protocolo_gateway.h).
+ *
+ *  LOTE cujo base ainda nao foi confirmado e descartado (go-back-N);
+ *  registros ja gravados sao contados como duplicados e nao se repetem
+ *  no arquivo. o estado fica em memoria: gateway reiniciado aceita de novo
+ *  a partir da base que o dispositivo afirma entregue.
+ *
+ *  uso: gateway_local [--porta 8090] [--dir gateway_dados] [--perda 0.0]
+ *                     [--duracao-s 0]
+ *
+ *  --perda p descarta a fracao p dos datagramas nos dois sentidos, para
+ *  exercitar as retransmissoes do dispositivo.
+ */
+
+#include "protocolo_gateway.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <random>
+#include <string>
+
+static volatile sig_atomic_t encerrar = 0;
+
+static void aoSinal(int)
+{
+    encerrar = 1;
+}
+
+struct EstatisticasGateway
+{
+    uint64_t datagramas = 0;
+    uint64_t bytes = 0;
+    uint64_t invalidos = 0;      // crc ou formato
+    uint64_t fora_de_ordem = 0;  // base ainda nao confirmada
+    uint64_t registros = 0;      // linhas novas gravadas
+    uint64_t duplicados = 0;     // seq ja gravado
+    uint64_t acks = 0;
+    uint64_t bytes_acks = 0;
+    uint64_t perdidos = 0;       // descartados por --perda (nos dois sentidos)
+};
+
+static std::string nomeDispositivo(const uint8_t *mac)
+{
+    char texto[2 * TAMANHO_MAC_GATEWAY + 1];
+    for (size_t i = 0; i < TAMANHO_MAC_GATEWAY; i++)
+        snprintf(texto + 2 * i, 3, "%02x", mac[i]);
+    return texto;
+}
+
+int main(int argc, char **argv)
+{
+    int porta = 8090;
+    std::string diretorio = "gateway_dados";
+    double perda = 0.0;
+    int duracao_s = 0; // 0 = ate SIGINT
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--porta")
+            porta = atoi(argv[i + 1]);
+        else if (opcao == "--dir")
+            diretorio = argv[i + 1];
+        else if (opcao == "--perda")
+            perda = atof(argv[i + 1]);
+        else if (opcao == "--duracao-s")
+            duracao_s = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (perda < 0.0 || perda >= 1.0)
+    {
+        fprintf(stderr, "--perda precisa estar em [0, 1)\n");
+        return 2;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+    endereco.sin_port = htons(porta);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&endereco, sizeof(endereco)) != 0)
+    {
+        perror("bind");
+        return 1;
+    }
+    struct timeval limite = {0, 200000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    mkdir(diretorio.c_str(), 0755);
+
+    signal(SIGINT, aoSinal);
+    signal(SIGTERM, aoSinal);
+    printf("[gateway] escutando udp na porta %d (perda %.2f), linhas em %s/\n", porta, perda, diretorio.c_str());
+    fflush(stdout);
+
+    std::mt19937 aleatorio(12345);
+    std::uniform_real_distribution<double> sorteio(0.0, 1.0);
+    std::map<std::string, uint32_t> confirmadas; // "<mac>_faixa<N>" -> maior seq sem buracos
+    EstatisticasGateway estatisticas;
+    time_t inicio = time(NULL);
+
+    while (!encerrar && (duracao_s == 0 || time(NULL) - inicio < duracao_s))
+    {
+        uint8_t datagrama[TAMANHO_MAXIMO_DATAGRAMA + 1];
+        struct sockaddr_in origem;
+        socklen_t tamanho_origem = sizeof(origem);
+        ssize_t n = recvfrom(fd, datagrama, sizeof(datagrama), 0, (struct sockaddr *)&origem, &tamanho_origem);
+        if (n <= 0)
+            continue;
+        if (perda > 0 && sorteio(aleatorio) < perda)
+        {
+            estatisticas.perdidos++;
+            continue;
+        }
+        estatisticas.datagramas++;
+        estatisticas.bytes += n;
+
+        CabecalhoLoteGateway cabecalho;
+        ContextoLoteGateway contexto;
+        const uint8_t *p;
+        if (!verificarDatagrama(datagrama, n, DATAGRAMA_LOTE) ||
+            !lerCabecalhoLoteGateway(datagrama, n, cabecalho, contexto, p))
+        {
+            estatisticas.invalidos++;
+            continue;
+        }
+
+        std::string chave = nomeDispositivo(cabecalho.dispositivo) + "_faixa" + std::to_string(cabecalho.faixa);
+        uint32_t &confirmada = confirmadas[chave];
+        if (cabecalho.base_confirmada && cabecalho.base > confirmada)
+            confirmada = cabecalho.base;
+
+        uint32_t primeira = 0, ultima = 0;
+        if (cabecalho.base > confirmada)
+        {
+            estatisticas.fora_de_ordem++;
+        }
+        else
+        {
+            std::string linhas;
+            const uint8_t *fim = datagrama + n - TAMANHO_CRC_DATAGRAMA;
+            LinhaDecodificada registro;
+            while (lerRegistroLoteGateway(p, fim, cabecalho, contexto, registro))
+            {
+                if (primeira == 0)
+                    primeira = registro.sequencia;
+                ultima = registro.sequencia;
+                if (registro.sequencia <= confirmada)
+                {
+                    estatisticas.duplicados++;
+                    continue;
+                }
+                char linha[tamanhoMaximoLinhaRegistro(MAXIMO_CANAIS) + 1];
+                linhas.append(linha, formatarLinhaGateway(registro, cabecalho, linha));
+                linhas += '\n';
+                confirmada = registro.sequencia;
+                estatisticas.registros++;
+            }
+            if (p != fim)
+                estatisticas.invalidos++;
+
+            if (!linhas.empty())
+            {
+                FILE *arquivo = fopen((diretorio + "/" + chave + ".csv").c_str(), "a");
+                if (arquivo)
+                {
+                    fwrite(linhas.data(), 1, linhas.size(), arquivo);
+                    fclose(arquivo);
+                }
+            }
+        }
+
+        if (perda > 0 && sorteio(aleatorio) < perda)
+        {
+            estatisticas.perdidos++;
+            continue;
+        }
+        uint8_t ack[TAMANHO_ACK_GATEWAY];
+        size_t tamanho_ack =
+            montarAckGateway(cabecalho.dispositivo, cabecalho.faixa, primeira, ultima, confirmada, ack);
+        sendto(fd, ack, tamanho_ack, 0, (struct sockaddr *)&origem, tamanho_origem);
+        estatisticas.acks++;
+        estatisticas.bytes_acks += tamanho_ack;
+    }
+    close(fd);
+
+    printf("\n[gateway] relatorio\n");
+    printf("  datagramas: %llu (%llu bytes, %llu invalidos, %llu fora de ordem)\n",
+           (unsigned long long)estatisticas.datagramas, (unsigned long long)estatisticas.bytes,
+           (unsigned long long)estatisticas.invalidos, (unsigned long long)estatisticas.fora_de_ordem);
+    printf("  registros gravados: %llu (duplicados descartados: %llu)\n", (unsigned long long)estatisticas.registros,
+           (unsigned long long)estatisticas.duplicados);
+    printf("  acks: %llu (%llu bytes); perdidos por --perda: %llu\n", (unsigned long long)estatisticas.acks,
+           (unsigned long long)estatisticas.bytes_acks, (unsigned long long)estatisticas.perdidos);
+    for (const auto &faixa : confirmadas)
+        printf("  %s: confirmado ate seq %u\n", faixa.first.c_str(), faixa.second);
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ *  [i] gerador de carga para o servidor de ingestao (build nativo)
+ *
+ *  emula N dispositivos rodando o GerenciadorUpload real contra o servidor
+ *  local: cada dispositivo acumula um backlog no seu proprio LittleFS
+ *  simulado e todos reconectam ao mesmo tempo (cenario pos-queda).
+ *
+ *  uso: gerador_carga_upload [--dispositivos 100] [--registros 288]
+ *                            [--url http://127.0.0.1:8080/api] [--rodadas 1]
+ *
+ *  relata vazao, latencia p50/p99 por dispositivo e amplificacao de
+ *  retentativas (POSTs enviados / lotes entregues).
+ *
+ *  com --rodadas N, quem ainda tem registros na flash reconecta de novo
+ *  (proximo ciclo com wifi); ao fim, "registros gerados" deve bater com
+ *  os "registros aceitos" do servidor, mesmo com acks perdidos.
+ */
+
+#include "config.h"
+#include "gerenciador_upload.h"
+#include "gerenciador_wifi.h"
+#include <algorithm>
+#include <vector>
+
+struct ResultadoDispositivo
+{
+    bool sucesso;
+    uint32_t latencia_ms; // do inicio do envio ate o fim das retentativas (primeira rodada)
+};
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+static std::string raizDispositivo(int indice)
+{
+    return "carga_fs/disp_" + std::to_string(indice);
+}
+
+// um mac por dispositivo: identifica o dispositivo no servidor
+static std::string macDispositivo(int indice)
+{
+    char mac[18];
+    snprintf(mac, sizeof(mac), "02:00:00:%02x:%02x:%02x", (indice >> 16) & 0xff, (indice >> 8) & 0xff, indice & 0xff);
+    return mac;
+}
+
+/*
+ * grava o backlog de um dispositivo (periodo de 5 min, como em campo)
+ */
+static void gerarBacklog(int indice, int registros)
+{
+    LittleFS.definirRaiz(raizDispositivo(indice));
+    LittleFS.begin(true);
+    LittleFS.remove("/dados_log.csv");
+
+    GerenciadorArmazenamento armazenamento;
+    armazenamento.iniciar();
+
+    CanalMock geradores[NUMERO_CANAIS];
+    for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+    {
+        ConfigCanalMock config = GerenciadorSensores::canais()[c].mock;
+        config.semente += indice;
+        geradores[c].configurar(config);
+    }
+
+    uint32_t epoch = 1700000000;
+    for (int i = 0; i < registros; i++, epoch += TEMPO_DEEP_SLEEP_COMPLETO / 1000)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores sensores;
+        sensores.canais.limpar();
+        sensores.faixas = 0;
+        for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+        {
+            float valor;
+            if (geradores[c].gerar(epoch, valor))
+                sensores.canais.definir(c, escalarValor(valor, GerenciadorSensores::canais()[c].casas));
+        }
+        sensores.timestamp_leitura = i;
+        armazenamento.salvarRegistro(tempo, sensores);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int dispositivos = 100;
+    int registros = 288; // um dia de backlog a cada 5 min
+    int rodadas = 1;
+    std::string url = SERVIDOR_URL;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--dispositivos")
+            dispositivos = atoi(argv[i + 1]);
+        else if (opcao == "--registros")
+            registros = atoi(argv[i + 1]);
+        else if (opcao == "--url")
+            url = argv[i + 1];
+        else if (opcao == "--rodadas")
+            rodadas = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+
+    Serial.silenciar(true);
+    mkdir("carga_fs", 0755);
+
+    printf("[carga] gerando backlog: %d dispositivos x %d registros\n", dispositivos, registros);
+    for (int i = 0; i < dispositivos; i++)
+        gerarBacklog(i, registros);
+
+    // o radio simulado e compartilhado: conecta uma vez para todos
+    GerenciadorWiFi wifi;
+    wifi.conectar();
+
+    // todos reconectam juntos; nas rodadas seguintes, so quem ficou com pendencias
+    std::vector<ResultadoDispositivo> resultados(dispositivos);
+    std::vector<char> pendente(dispositivos, 1); // char: cada thread escreve o seu
+    unsigned long inicio = millis();
+    printf("[carga] enviando para %s\n", url.c_str());
+
+    for (int rodada = 0; rodada < rodadas; rodada++)
+    {
+        std::atomic<bool> largada{false};
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < dispositivos; i++)
+        {
+            if (!pendente[i])
+                continue;
+            threads.emplace_back([&, i, rodada]()
+                                 {
+                LittleFS.definirRaiz(raizDispositivo(i));
+                WiFi.definirMac(macDispositivo(i));
+                GerenciadorArmazenamento armazenamento;
+                armazenamento.iniciar();
+                GerenciadorUpload upload(url.c_str());
+
+                while (!largada)
+                    std::this_thread::yield();
+
+                unsigned long inicio_envio = millis();
+                bool sucesso = upload.enviarComRetentativas(armazenamento);
+                pendente[i] = armazenamento.existemDadosPendentes();
+                if (rodada == 0)
+                {
+                    resultados[i].sucesso = sucesso;
+                    resultados[i].latencia_ms = millis() - inicio_envio;
+                } });
+        }
+
+        largada = true;
+        for (std::thread &t : threads)
+            t.join();
+    }
+    double segundos = (millis() - inicio) / 1000.0;
+
+    std::vector<uint32_t> latencias;
+    int sucessos = 0;
+    for (const ResultadoDispositivo &r : resultados)
+    {
+        latencias.push_back(r.latencia_ms);
+        if (r.sucesso)
+            sucessos++;
+    }
+
+    // cada dispositivo envia varios lotes: a base sao os lotes confirmados (200 com ack), nao os dispositivos
+    uint32_t posts = contadores_http.requisicoes;
+    uint32_t lotes = posts - contadores_http.falhas;
+    printf("\n[carga] relatorio\n");
+    printf("  dispositivos com upload ok: %d de %d\n", sucessos, dispositivos);
+    printf("  POSTs enviados: %u (falhas: %u, lotes confirmados: %u)\n", posts, contadores_http.falhas.load(), lotes);
+    printf("  amplificacao de retentativas: %.2fx\n", lotes ? (double)posts / lotes : 0.0);
+    printf("  bytes enviados: %llu\n", (unsigned long long)contadores_http.bytes_enviados.load());
+    printf("  vazao: %.1f registros/s em %.2f s\n", (double)sucessos * registros / segundos, segundos);
+    printf("  latencia por dispositivo p50: %u ms, p99: %u ms\n", percentil(latencias, 0.50), percentil(latencias, 0.99));
+    int pendentes = std::count(pendente.begin(), pendente.end(), 1);
+    printf("  registros gerados: %llu\n", (unsigned long long)dispositivos * registros);
+    printf("  dispositivos com pendencias apos %d rodada(s): %d\n", rodadas, pendentes);
+
+    return pendentes == 0 ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/*
+ *  [i] jitter da grade de amostragem (build nativo)
+ *
+ *  simula `ciclos` despertares de um dispositivo com as contas reais do
+ *  GerenciadorSleep (grade_amostragem.h) sobre um relogio virtual: tempo
+ *  acordado variavel, latencia do boot com jitter e RTC com deriva. o
+ *  NTP segue a regra do GerenciadorTempo (sync quando a incerteza passa
+ *  do limite, deriva medida entre dois syncs, media movel), com erro
+ *  gaussiano em cada resposta. botao ou LDR acordam o dispositivo no
+ *  meio de alguns sonos.
+ *
+ *  o mesmo calendario roda com o sono de duracao fixa (o antigo: periodo
+ *  contado do fim do ciclo, timer reiniciado a cada despertar) e com a
+ *  grade, e compara, so nas amostras acordadas pelo timer:
+ *
+ *    grade      distancia do timestamp ao alvo da grade no relogio do
+ *               dispositivo (o que vai para o log)
+ *    intervalo  desvio entre amostras seguidas, modulo o periodo
+ *    utc        distancia ao alvo no tempo real (inclui o erro do relogio)
+ *
+ *  e conta os epochs (em segundos) que nao caem em multiplo do periodo,
+ *  que quebram o delta-of-delta, e as fronteiras sem amostra. o max
+ *  inclui a convergencia da latencia de fabrica nos primeiros despertares.
+ *
+ *  uso: jitter_grade [--ciclos 10000] [--periodo-s 300] [--acordado-ms 2500]
+ *                    [--variacao-ms 2000] [--latencia-ms 1300] [--jitter-boot-ms 2]
+ *                    [--deriva-ppm 150] [--erro-ntp-ms 5] [--incerteza-ms 2000]
+ *                    [--botao-cada 50] [--limite-ms 10] [--semente 1]
+ *
+ *  sai com 1 se o p99 do jitter da grade passar de --limite-ms ou se
+ *  algum epoch por timer cair fora da grade.
+ */
+
+#include "config.h"
+#include "grade_amostragem.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Cenario
+{
+    uint32_t ciclos;
+    uint32_t periodo_ms;
+    uint32_t acordado_ms;    // acordado minimo (leitura, gravacao, upload)
+    uint32_t variacao_ms;    // acordado extra, uniforme (conexao, retentativas)
+    uint32_t latencia_ms;    // disparo do timer -> timestamp da amostra
+    double jitter_boot_ms;   // desvio padrao da latencia
+    double deriva_ppm;       // deriva real do RTC (positivo = adiantado)
+    double erro_ntp_ms;      // desvio padrao de cada resposta do NTP
+    uint32_t incerteza_ms;   // limite de incerteza antes de exigir NTP
+    uint32_t botao_cada;     // 1 despertar externo a cada N sonos (0 = nunca)
+    uint32_t semente;
+};
+
+struct Resultado
+{
+    std::vector<uint32_t> grade_us;     // |amostra - alvo| no relogio do dispositivo
+    std::vector<uint32_t> intervalo_us; // |intervalo - k x periodo|
+    std::vector<uint32_t> utc_us;       // |amostra - alvo| no tempo real
+    uint32_t amostras_timer;
+    uint32_t despertares_externos;
+    uint32_t epochs_fora;  // epoch em segundos fora de multiplo do periodo
+    uint32_t slots_pulados;
+    uint32_t syncs;
+};
+
+// RELOGIO VIRTUAL
+
+/*
+ * relogio do dispositivo em funcao do tempo real: o relogio livre (RTC)
+ * conta com a deriva real desde o ultimo sync; o epoch e esse relogio
+ * corrigido pela deriva medida, como no GerenciadorTempo
+ */
+struct RelogioVirtual
+{
+    double deriva_real_ppm;
+    double deriva_ppm;    // medida (0 ate o segundo sync)
+    bool deriva_medida;
+    int64_t real_sync_us; // tempo real no ultimo sync
+    int64_t us_sincronizacao; // relogio do sistema no ultimo sync (valor do NTP)
+    uint32_t syncs;
+
+    int64_t livre(int64_t real_us) const
+    {
+        return us_sincronizacao + (int64_t)llround((real_us - real_sync_us) * (1.0 + deriva_real_ppm / 1e6));
+    }
+
+    int64_t ler(int64_t real_us) const
+    {
+        int64_t decorrido_us = livre(real_us) - us_sincronizacao;
+        return us_sincronizacao + decorrido_us - (int64_t)(decorrido_us * (deriva_ppm / 1000000.0));
+    }
+
+    // GerenciadorTempo::precisaSincronizar
+    bool precisaSincronizar(int64_t real_us, uint32_t limite_ms) const
+    {
+        if (syncs == 0)
+            return true;
+        double ppm = deriva_medida ? DERIVA_RESIDUAL_PPM : DERIVA_MAXIMA_PPM;
+        int64_t decorrido_us = livre(real_us) - us_sincronizacao;
+        return INCERTEZA_NTP_MS + (uint32_t)(decorrido_us / 1000 * ppm / 1000000.0) > limite_ms;
+    }
+
+    // GerenciadorTempo::sincronizarSeNecessario + medirDeriva
+    void sincronizar(int64_t real_us, int64_t ntp_us)
+    {
+        int64_t antes_us = livre(real_us);
+        int64_t intervalo_us = antes_us - us_sincronizacao;
+        if (syncs > 0 && intervalo_us >= INTERVALO_MINIMO_DERIVA_MS * 1000LL)
+        {
+            double nova = (double)(antes_us - ntp_us) / intervalo_us * 1000000.0;
+            deriva_ppm = deriva_medida ? 0.5 * deriva_ppm + 0.5 * nova : nova;
+            deriva_medida = true;
+        }
+        real_sync_us = real_us;
+        us_sincronizacao = ntp_us;
+        syncs++;
+    }
+};
+
+static uint32_t modulo(int64_t valor)
+{
+    return (uint32_t)(valor < 0 ? -valor : valor);
+}
+
+// desvio do multiplo de passo mais proximo
+static int64_t desvioMultiplo(int64_t valor, int64_t passo)
+{
+    int64_t resto = ((valor % passo) + passo) % passo;
+    return resto > passo / 2 ? resto - passo : resto;
+}
+
+/*
+ * um calendario de despertares; grade = false e o sono de duracao fixa
+ */
+static Resultado simular(const Cenario &c, bool grade)
+{
+    std::mt19937_64 aleatorio(c.semente);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    int64_t periodo_us = (int64_t)c.periodo_ms * 1000;
+    int64_t atraso_us = (int64_t)ATRASO_GRADE_MS * 1000;
+
+    Resultado r = {};
+    EstadoGrade estado = {};
+    iniciarGrade(estado);
+
+    // cold boot numa fase qualquer do periodo, sync NTP no primeiro ciclo
+    int64_t real_us = (int64_t)EPOCH_FALLBACK * 1000000 + (int64_t)(uniforme(aleatorio) * periodo_us);
+    RelogioVirtual relogio = {c.deriva_ppm, 0.0, false, real_us, real_us, 0};
+
+    bool por_timer = false;
+    int64_t anterior_us = 0; // ultima amostra por timer (dispositivo)
+    for (uint32_t i = 0; i < c.ciclos; i++)
+    {
+        // boot ate o timestamp da leitura
+        double latencia = c.latencia_ms + c.jitter_boot_ms * normal(aleatorio);
+        int64_t amostra_real = real_us + (int64_t)(std::max(0.0, latencia) * 1000);
+        int64_t amostra_us = relogio.ler(amostra_real);
+
+        if (por_timer)
+        {
+            registrarAmostraGrade(estado, amostra_us);
+            r.amostras_timer++;
+            r.grade_us.push_back(modulo(desvioMultiplo(amostra_us - atraso_us, periodo_us)));
+            r.utc_us.push_back(modulo(desvioMultiplo(amostra_real - atraso_us, periodo_us)));
+            if (anterior_us != 0)
+                r.intervalo_us.push_back(modulo(desvioMultiplo(amostra_us - anterior_us, periodo_us)));
+            if ((amostra_us / 1000000) % (c.periodo_ms / 1000) != 0)
+                r.epochs_fora++;
+            anterior_us = amostra_us;
+        }
+
+        // resto do ciclo; o NTP roda no radio, depois da leitura
+        int64_t fim_real = amostra_real + (int64_t)(c.acordado_ms + uniforme(aleatorio) * c.variacao_ms) * 1000;
+        if (relogio.precisaSincronizar(fim_real, c.incerteza_ms))
+            relogio.sincronizar(fim_real, fim_real + (int64_t)(c.erro_ntp_ms * 1000 * normal(aleatorio)));
+
+        // sono pedido ao timer do RTC, que conta com a deriva real
+        uint64_t sono_rtc_us =
+            grade ? planejarSonoGrade(estado, relogio.ler(fim_real), c.periodo_ms,
+                                    relogio.deriva_medida ? relogio.deriva_ppm : 0.0f)
+                  : (uint64_t)c.periodo_ms * 1000;
+        int64_t sono_real_us = (int64_t)(sono_rtc_us / (1.0 + c.deriva_ppm / 1e6));
+
+        // botao ou LDR no meio do sono: amostra fora da grade
+        por_timer = !(c.botao_cada > 0 && uniforme(aleatorio) * c.botao_cada < 1.0);
+        if (!por_timer)
+        {
+            sono_real_us = (int64_t)(uniforme(aleatorio) * sono_real_us);
+            r.despertares_externos++;
+        }
+        real_us = fim_real + sono_real_us;
+    }
+
+    r.slots_pulados = estado.slots_pulados;
+    r.syncs = relogio.syncs;
+    return r;
+}
+
+// RELATORIO
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+static void imprimirMetrica(const char *nome, const std::vector<uint32_t> &valores)
+{
+    uint32_t pior = valores.empty() ? 0 : *std::max_element(valores.begin(), valores.end());
+    printf("  %-10s %10.3f %10.3f %10.3f\n", nome, percentil(valores, 0.50) / 1000.0, percentil(valores, 0.99) / 1000.0,
+           pior / 1000.0);
+}
+
+static void imprimirResultado(const char *nome, const Resultado &r)
+{
+    printf("\n[grade] %s: %u amostras por timer, %u despertares externos\n", nome, r.amostras_timer,
+           r.despertares_externos);
+    printf("  %-10s %10s %10s %10s   (ms)\n", "", "p50", "p99", "max");
+    imprimirMetrica("grade", r.grade_us);
+    imprimirMetrica("intervalo", r.intervalo_us);
+    imprimirMetrica("utc", r.utc_us);
+    printf("  epochs fora da grade: %u (%.1f%%), fronteiras sem amostra: %u, syncs NTP: %u\n", r.epochs_fora,
+           r.amostras_timer ? 100.0 * r.epochs_fora / r.amostras_timer : 0.0, r.slots_pulados, r.syncs);
+}
+
+int main(int argc, char **argv)
+{
+    Cenario c = {10000, TEMPO_DEEP_SLEEP_COMPLETO, 2500, 2000, 1300, 2.0, 150.0, 5.0, LIMITE_INCERTEZA_MS, 50, 1};
+    double limite_ms = 10.0;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        const char *valor = argv[i + 1];
+        if (opcao == "--ciclos")
+            c.ciclos = strtoul(valor, NULL, 10);
+        else if (opcao == "--periodo-s")
+            c.periodo_ms = strtoul(valor, NULL, 10) * 1000;
+        else if (opcao == "--acordado-ms")
+            c.acordado_ms = strtoul(valor, NULL, 10);
+        else if (opcao == "--variacao-ms")
+            c.variacao_ms = strtoul(valor, NULL, 10);
+        else if (opcao == "--latencia-ms")
+            c.latencia_ms = strtoul(valor, NULL, 10);
+        else if (opcao == "--jitter-boot-ms")
+            c.jitter_boot_ms = atof(valor);
+        else if (opcao == "--deriva-ppm")
+            c.deriva_ppm = atof(valor);
+        else if (opcao == "--erro-ntp-ms")
+            c.erro_ntp_ms = atof(valor);
+        else if (opcao == "--incerteza-ms")
+            c.incerteza_ms = strtoul(valor, NULL, 10);
+        else if (opcao == "--botao-cada")
+            c.botao_cada = strtoul(valor, NULL, 10);
+        else if (opcao == "--limite-ms")
+            limite_ms = atof(valor);
+        else if (opcao == "--semente")
+            c.semente = strtoul(valor, NULL, 10);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (c.ciclos == 0 || c.periodo_ms < 1000 || c.periodo_ms % 1000 != 0 || c.incerteza_ms <= INCERTEZA_NTP_MS)
+    {
+        fprintf(stderr, "--ciclos e --periodo-s precisam ser positivos e --incerteza-ms maior que %u\n",
+                INCERTEZA_NTP_MS);
+        return 2;
+    }
+
+    printf("[grade] %u ciclos de %u s, acordado %u..%u ms, latencia %u ms (+-%.1f), RTC %+.0f ppm, "
+           "NTP +-%.1f ms ao passar de %u ms de incerteza\n",
+           c.ciclos, c.periodo_ms / 1000, c.acordado_ms, c.acordado_ms + c.variacao_ms, c.latencia_ms,
+           c.jitter_boot_ms, c.deriva_ppm, c.erro_ntp_ms, c.incerteza_ms);
+
+    imprimirResultado("sono fixo", simular(c, false));
+    Resultado grade = simular(c, true);
+    imprimirResultado("grade", grade);
+
+    bool ok = percentil(grade.grade_us, 0.99) <= limite_ms * 1000 && grade.epochs_fora == 0;
+    printf("\n[grade] p99 da grade <= %.1f ms e epochs na grade -> %s\n", limite_ms, ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
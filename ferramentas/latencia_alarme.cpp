@@ -0,0 +1,177 @@
+/*
+ *  [i] latencia alarme -> servidor com backlog grande (build nativo)
+ *
+ *  grava `dias` de historico na faixa bruta, sem upload (dispositivo
+ *  fora da rede), e entao provoca alarmes: a temperatura simulada alterna
+ *  entre 20 e 40 graus, cruzando o limite da regra de alarme a cada
+ *  leitura. para cada alarme mede da leitura ate o servidor confirmar a
+ *  faixa de alarme (gravacao + conexao do radio + POST), como no ciclo
+ *  que acorda o radio so para o alarme.
+ *
+ *  depois esvazia a faixa bruta do mais antigo para o mais novo, como era
+ *  o upload antes das faixas: e o tempo que o ultimo alarme esperaria
+ *  atras do historico.
+ *
+ *  uso: latencia_alarme [--dias 30] [--alarmes 10] [--conexao-ms 0]
+ *                       [--url http://127.0.0.1:8080/api] [--raiz alarme_fs]
+ *
+ *  precisa do servidor_ingestao rodando (--latencia-ms simula a WAN).
+ */
+
+#include "config.h"
+#include "gerenciador_upload.h"
+#include "gerenciador_wifi.h"
+#include <algorithm>
+#include <vector>
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+/*
+ * historico so na faixa bruta, terminando em `fim`
+ */
+static uint32_t gerarBacklog(GerenciadorArmazenamento &armazenamento, int dias, uint32_t periodo_s, uint32_t fim)
+{
+    CanalMock geradores[NUMERO_CANAIS];
+    for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+        geradores[c].configurar(GerenciadorSensores::canais()[c].mock);
+
+    uint32_t registros = (uint32_t)dias * 86400 / periodo_s;
+    uint32_t epoch = fim - registros * periodo_s;
+    for (uint32_t i = 0; i < registros; i++, epoch += periodo_s)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores sensores;
+        sensores.canais.limpar();
+        sensores.faixas = 0;
+        for (uint8_t c = 0; c < NUMERO_CANAIS; c++)
+        {
+            float valor;
+            if (geradores[c].gerar(epoch, valor))
+                sensores.canais.definir(c, escalarValor(valor, GerenciadorSensores::canais()[c].casas));
+        }
+        sensores.timestamp_leitura = i;
+        armazenamento.salvarRegistro(tempo, sensores);
+    }
+    return registros;
+}
+
+int main(int argc, char **argv)
+{
+    int dias = 30;
+    int alarmes = 10;
+    unsigned long conexao_ms = 0;
+    std::string url = SERVIDOR_URL;
+    std::string raiz = "alarme_fs";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--dias")
+            dias = atoi(argv[i + 1]);
+        else if (opcao == "--alarmes")
+            alarmes = atoi(argv[i + 1]);
+        else if (opcao == "--conexao-ms")
+            conexao_ms = atol(argv[i + 1]);
+        else if (opcao == "--url")
+            url = argv[i + 1];
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (dias < 0 || alarmes <= 0)
+    {
+        fprintf(stderr, "--dias e --alarmes precisam ser positivos\n");
+        return 2;
+    }
+
+    // dispositivo novo: logs e seqs das faixas zerados
+    LittleFS.definirRaiz(raiz);
+    LittleFS.begin(true);
+    Preferences nvs;
+    nvs.begin(ESPACO_NVS_CONFIG, false);
+    for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+    {
+        LittleFS.remove(faixas()[f].arquivo);
+        nvs.remove(faixas()[f].chave_nvs);
+    }
+    nvs.end();
+
+    Serial.silenciar(true);
+    GerenciadorArmazenamento armazenamento;
+    GerenciadorSensores sensores;
+    GerenciadorUpload upload(url.c_str());
+    GerenciadorWiFi wifi;
+    armazenamento.iniciar();
+    sensores.iniciar();
+
+    uint32_t periodo_s = TEMPO_DEEP_SLEEP_COMPLETO / 1000;
+    uint32_t epoch = time(NULL) - alarmes * periodo_s;
+    uint32_t registros = gerarBacklog(armazenamento, dias, periodo_s, epoch);
+    File log = armazenamento.abrirLeitura(armazenamento.arquivoLog());
+    printf("[alarme] backlog: %u registros (%d dias), %u bytes na faixa bruta\n", registros, dias,
+           log ? (unsigned)log.size() : 0u);
+    log.close();
+
+    // degrau de 20 graus a cada leitura: cruza o limite de alarme (35) na ida e na volta
+    ConfigCanalMock degrau = {PERFIL_DEGRAU, 20.0, 20.0, 2 * periodo_s, 0, 0.0, 0.0, 1};
+    sensores.canalMock(CANAL_TEMPERATURA).configurar(degrau);
+    WiFi.definirLatenciaConexao(conexao_ms);
+
+    std::vector<uint32_t> latencias;
+    uint32_t posts_alarme = 0;
+    for (int i = 0; i < alarmes; i++, epoch += periodo_s)
+    {
+        DadosTempo tempo = {epoch, 0, true, INCERTEZA_NTP_MS};
+        DadosSensores dados = sensores.lerSensores(epoch);
+        if (!(dados.faixas & (1u << FAIXA_ALARME)))
+            continue;
+
+        // radio desligado entre ciclos: o alarme paga a conexao
+        WiFi.disconnect();
+        uint32_t posts_antes = contadores_http.requisicoes;
+        unsigned long inicio = micros();
+        armazenamento.salvarRegistro(tempo, dados);
+        bool entregue = wifi.conectar() && upload.enviarComRetentativas(armazenamento, 1u << FAIXA_ALARME);
+        unsigned long latencia_us = micros() - inicio;
+
+        if (!entregue)
+        {
+            fprintf(stderr, "[alarme] alarme %d nao entregue - servidor em %s?\n", i, url.c_str());
+            return 1;
+        }
+        latencias.push_back(latencia_us);
+        posts_alarme += contadores_http.requisicoes - posts_antes;
+    }
+
+    // antes das faixas: um envio do mais antigo ao mais novo, alarme no fim da fila
+    WiFi.disconnect();
+    uint32_t posts_antes = contadores_http.requisicoes;
+    uint64_t bytes_antes = contadores_http.bytes_enviados;
+    unsigned long inicio = micros();
+    bool esvaziou = wifi.conectar() && upload.enviarComRetentativas(armazenamento, 1u << FAIXA_BRUTA);
+    unsigned long fila_us = micros() - inicio;
+
+    printf("\n[alarme] relatorio\n");
+    printf("  alarmes entregues: %zu (%u POSTs, sem retentativas: %s)\n", latencias.size(), posts_alarme,
+           posts_alarme == latencias.size() ? "sim" : "nao");
+    printf("  alarme -> servidor p50: %.1f ms, max: %.1f ms (conexao simulada %lu ms)\n",
+           percentil(latencias, 0.50) / 1000.0, percentil(latencias, 1.0) / 1000.0, conexao_ms);
+    printf("  faixa bruta do mais antigo ao mais novo: %.1f ms, %u POSTs de ate %u bytes, %llu bytes%s\n",
+           fila_us / 1000.0, contadores_http.requisicoes - posts_antes, TAMANHO_MAXIMO_LOTE,
+           (unsigned long long)(contadores_http.bytes_enviados - bytes_antes), esvaziou ? "" : " (incompleto)");
+    printf("  o ultimo alarme esperaria %.1fx mais atras do historico\n",
+           latencias.empty() ? 0.0 : (double)fila_us / percentil(latencias, 0.50));
+
+    return esvaziou && !latencias.empty() ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+#ifndef ARDUINO_NATIVO_H
+#define ARDUINO_NATIVO_H
+
+/*
+ *  [i] stand-in do core Arduino para o build nativo (host)
+ *
+ *  cobre apenas o que os gerenciadores usam: String, Serial, millis/delay,
+ *  pinos e o necessario do esp-idf. o objetivo e rodar o mesmo codigo dos
+ *  gerenciadores nas ferramentas e benchmarks do host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+using std::isnan;
+
+#define AMBIENTE_NATIVO 1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+
+// atributos de secao do esp32 nao tem efeito no host
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// STRING
+
+class String
+{
+private:
+    std::string texto;
+
+public:
+    String() {}
+    String(const char *c) : texto(c ? c : "") {}
+    String(const std::string &c) : texto(c) {}
+    String(char c) : texto(1, c) {}
+    String(int v) : texto(std::to_string(v)) {}
+    String(unsigned int v) : texto(std::to_string(v)) {}
+    String(long v) : texto(std::to_string(v)) {}
+    String(unsigned long v) : texto(std::to_string(v)) {}
+    String(long long v) : texto(std::to_string(v)) {}
+    String(unsigned long long v) : texto(std::to_string(v)) {}
+    String(double v, unsigned int casas = 2)
+    {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", casas, v);
+        texto = buffer;
+    }
+    String(float v, unsigned int casas = 2) : String((double)v, casas) {}
+
+    unsigned int length() const { return texto.size(); }
+    const char *c_str() const { return texto.c_str(); }
+    bool reserve(unsigned int tamanho)
+    {
+        texto.reserve(tamanho);
+        return true;
+    }
+
+    void trim()
+    {
+        size_t inicio = texto.find_first_not_of(" \t\r\n");
+        size_t fim = texto.find_last_not_of(" \t\r\n");
+        texto = inicio == std::string::npos ? "" : texto.substr(inicio, fim - inicio + 1);
+    }
+
+    String &operator+=(const String &outro)
+    {
+        texto += outro.texto;
+        return *this;
+    }
+    String &operator+=(const char *outro)
+    {
+        texto += outro;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        texto += c;
+        return *this;
+    }
+    bool concat(const char *dados, unsigned int tamanho)
+    {
+        texto.append(dados, tamanho);
+        return true;
+    }
+
+    friend String operator+(const String &a, const String &b) { return String(a.texto + b.texto); }
+    friend String operator+(const String &a, const char *b) { return String(a.texto + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.texto); }
+
+    bool operator==(const String &outro) const { return texto == outro.texto; }
+    bool operator==(const char *outro) const { return texto == outro; }
+    bool operator!=(const String &outro) const { return texto != outro.texto; }
+    bool equals(const String &outro) const { return texto == outro.texto; }
+    char operator[](unsigned int i) const { return texto[i]; }
+    char charAt(unsigned int i) const { return texto[i]; }
+
+    int indexOf(char c, unsigned int de = 0) const
+    {
+        size_t p = texto.find(c, de);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    int indexOf(const String &s, unsigned int de = 0) const
+    {
+        size_t p = texto.find(s.texto, de);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int de) const
+    {
+        return de >= texto.size() ? String() : String(texto.substr(de));
+    }
+    String substring(unsigned int de, unsigned int ate) const
+    {
+        return de >= texto.size() || ate <= de ? String() : String(texto.substr(de, ate - de));
+    }
+    bool startsWith(const String &prefixo) const { return texto.compare(0, prefixo.texto.size(), prefixo.texto) == 0; }
+    long toInt() const { return strtol(texto.c_str(), NULL, 10); }
+    float toFloat() const { return strtof(texto.c_str(), NULL); }
+};
+
+// PRINT / SERIAL
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *dados, size_t tamanho)
+    {
+        size_t n = 0;
+        while (tamanho--)
+            n += write(*dados++);
+        return n;
+    }
+    size_t write(const char *texto) { return write((const uint8_t *)texto, strlen(texto)); }
+
+    size_t print(const String &v) { return write((const uint8_t *)v.c_str(), v.length()); }
+    size_t print(const char *v) { return write(v); }
+    size_t print(char v) { return write((uint8_t)v); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(long long v) { return print(String(v)); }
+    size_t print(unsigned long long v) { return print(String(v)); }
+    size_t print(double v, int casas = 2) { return print(String(v, casas)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &v)
+    {
+        size_t n = print(v);
+        return n + println();
+    }
+    size_t println(double v, int casas)
+    {
+        size_t n = print(v, casas);
+        return n + println();
+    }
+
+    int printf(const char *formato, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[512];
+        va_list args;
+        va_start(args, formato);
+        int n = vsnprintf(buffer, sizeof(buffer), formato, args);
+        va_end(args);
+        write((const uint8_t *)buffer, n < (int)sizeof(buffer) ? n : sizeof(buffer) - 1);
+        return n;
+    }
+};
+
+class HardwareSerial : public Print
+{
+private:
+    std::atomic<bool> silencioso{false};
+    int pty = -1;     // lado mestre do pseudo-terminal (ver abrirPty)
+    int escravo = -1; // mantido aberto: o cliente pode conectar e sair sem hangup
+
+    void escreverPty(const uint8_t *dados, size_t tamanho)
+    {
+        while (tamanho > 0)
+        {
+            ssize_t n = ::write(pty, dados, tamanho);
+            if (n > 0)
+            {
+                dados += n;
+                tamanho -= n;
+            }
+            else if (n < 0 && errno != EAGAIN && errno != EINTR)
+                return;
+            else
+            {
+                struct pollfd espera = {pty, POLLOUT, 0};
+                poll(&espera, 1, 100);
+            }
+        }
+    }
+
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    void updateBaudRate(unsigned long) {}
+    int available()
+    {
+        int n = 0;
+        if (pty < 0 || ioctl(pty, FIONREAD, &n) < 0)
+            return 0;
+        return n;
+    }
+    int read()
+    {
+        uint8_t c;
+        return pty >= 0 && ::read(pty, &c, 1) == 1 ? c : -1;
+    }
+    void flush() { fflush(stdout); }
+
+    // ferramentas com muitos dispositivos simulados desligam os logs
+    void silenciar(bool valor) { silencioso = valor; }
+
+    /*
+     * troca o stdout por um pseudo-terminal em modo raw (console serial do
+     * dispositivo simulado); retorna o caminho para o cliente abrir
+     */
+    const char *abrirPty()
+    {
+        pty = posix_openpt(O_RDWR | O_NOCTTY);
+        if (pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0)
+            return NULL;
+        const char *caminho = ptsname(pty);
+        escravo = open(caminho, O_RDWR | O_NOCTTY);
+        struct termios modo;
+        if (escravo < 0 || tcgetattr(escravo, &modo) != 0)
+            return NULL;
+        cfmakeraw(&modo); // sem eco nem traducao de quebras
+        tcsetattr(escravo, TCSANOW, &modo);
+        fcntl(pty, F_SETFL, fcntl(pty, F_GETFL) | O_NONBLOCK);
+        return caminho;
+    }
+
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *dados, size_t tamanho) override
+    {
+        if (pty >= 0)
+            escreverPty(dados, tamanho);
+        else if (!silencioso)
+            fwrite(dados, 1, tamanho, stdout);
+        return tamanho;
+    }
+    operator bool() const { return true; }
+};
+
+inline HardwareSerial Serial;
+
+// TEMPO E PINOS
+
+// instante do "reset": a suite de desempenho volta para agora a cada boot simulado
+inline std::chrono::steady_clock::time_point &inicioNativo()
+{
+    static std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    return inicio;
+}
+
+inline unsigned long millis()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now() - inicioNativo()).count();
+}
+
+inline unsigned long micros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now() - inicioNativo()).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+// sem sensores no host: leitura fora da faixa valida, os gerenciadores caem nos mocks.
+// benchmarks trocam por um sinal sintetico com definirLeituraAnalogica
+typedef uint16_t (*FonteAnalogica)(uint8_t pino);
+inline FonteAnalogica &fonteAnalogica()
+{
+    static FonteAnalogica fonte = NULL;
+    return fonte;
+}
+inline void definirLeituraAnalogica(FonteAnalogica fonte) { fonteAnalogica() = fonte; }
+inline uint16_t analogRead(uint8_t pino) { return fonteAnalogica() ? fonteAnalogica()(pino) : 0; }
+
+// NTP: o relogio do host ja esta sincronizado
+inline void configTime(long, int, const char *, const char * = NULL, const char * = NULL) {}
+inline bool getLocalTime(struct tm *info, uint32_t = 5000)
+{
+    time_t agora = time(NULL);
+    localtime_r(&agora, info);
+    return true;
+}
+
+#include "esp_sleep.h"
+
+#endif
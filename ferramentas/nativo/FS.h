@@ -0,0 +1,83 @@
+#ifndef FS_NATIVO_H
+#define FS_NATIVO_H
+
+#include "Arduino.h"
+
+/*
+ *  stand-in do File do Arduino sobre stdio
+ *  cada thread pode ter sua propria raiz (ver LittleFS.h), o que permite
+ *  simular varios dispositivos no mesmo processo
+ */
+
+class File : public Print
+{
+private:
+    FILE *arquivo;
+    std::string nome;
+    bool escrita;
+
+public:
+    // simula o program/erase da flash: o close de um arquivo aberto para escrita espera
+    static std::atomic<unsigned long> &latenciaEscrita()
+    {
+        static std::atomic<unsigned long> ms(0);
+        return ms;
+    }
+
+    File() : arquivo(NULL), escrita(false) {}
+    File(FILE *f, const std::string &n, bool para_escrita = false) : arquivo(f), nome(n), escrita(para_escrita) {}
+
+    operator bool() const { return arquivo != NULL; }
+
+    using Print::write;
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, arquivo); }
+    size_t write(const uint8_t *dados, size_t tamanho) override { return fwrite(dados, 1, tamanho, arquivo); }
+
+    size_t read(uint8_t *destino, size_t tamanho) { return fread(destino, 1, tamanho, arquivo); }
+    int read() { return fgetc(arquivo); }
+    int peek()
+    {
+        int c = fgetc(arquivo);
+        if (c != EOF)
+            ungetc(c, arquivo);
+        return c;
+    }
+
+    size_t size()
+    {
+        long atual = ftell(arquivo);
+        fseek(arquivo, 0, SEEK_END);
+        long total = ftell(arquivo);
+        fseek(arquivo, atual, SEEK_SET);
+        return total;
+    }
+    size_t position() { return ftell(arquivo); }
+    bool seek(uint32_t posicao) { return fseek(arquivo, posicao, SEEK_SET) == 0; }
+    int available() { return (int)(size() - position()); }
+
+    String readStringUntil(char terminador)
+    {
+        std::string linha;
+        int c;
+        while ((c = fgetc(arquivo)) != EOF && c != terminador)
+            linha += (char)c;
+        return String(linha);
+    }
+
+    void flush() { fflush(arquivo); }
+    void close()
+    {
+        if (arquivo)
+        {
+            fclose(arquivo);
+            if (escrita && latenciaEscrita())
+                delay(latenciaEscrita());
+        }
+        arquivo = NULL;
+    }
+
+    const char *name() const { return nome.c_str(); }
+    File openNextFile() { return File(); }
+};
+
+#endif
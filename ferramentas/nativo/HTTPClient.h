@@ -0,0 +1,174 @@
+#ifndef HTTPCLIENT_NATIVO_H
+#define HTTPCLIENT_NATIVO_H
+
+#include "Arduino.h"
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/*
+ *  stand-in do HTTPClient: HTTP/1.1 sobre sockets POSIX (sem TLS)
+ *  uma conexao por requisicao, como o cliente do esp32 usa no upload
+ */
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// contadores globais, usados pelas ferramentas para medir retentativas
+struct ContadoresHTTPNativo
+{
+    std::atomic<uint32_t> requisicoes{0};
+    std::atomic<uint32_t> falhas{0}; // erro de conexao ou codigo != 200
+    std::atomic<uint64_t> bytes_enviados{0};
+    std::atomic<uint64_t> bytes_recebidos{0};
+};
+
+inline ContadoresHTTPNativo contadores_http;
+
+class HTTPClient
+{
+private:
+    std::string host;
+    std::string porta;
+    std::string caminho;
+    std::vector<std::string> cabecalhos;
+    std::string resposta;
+    uint16_t timeout_ms;
+
+    int conectar()
+    {
+        struct addrinfo dicas = {};
+        struct addrinfo *enderecos = NULL;
+        dicas.ai_family = AF_INET;
+        dicas.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), porta.c_str(), &dicas, &enderecos) != 0)
+            return -1;
+
+        int fd = socket(enderecos->ai_family, enderecos->ai_socktype, enderecos->ai_protocol);
+        struct timeval limite = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limite, sizeof(limite));
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+
+        if (fd < 0 || ::connect(fd, enderecos->ai_addr, enderecos->ai_addrlen) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(enderecos);
+        return fd;
+    }
+
+    static bool enviarTudo(int fd, const char *dados, size_t tamanho)
+    {
+        while (tamanho > 0)
+        {
+            ssize_t n = ::send(fd, dados, tamanho, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            dados += n;
+            tamanho -= n;
+        }
+        return true;
+    }
+
+    int requisicao(const char *metodo, const uint8_t *corpo, size_t tamanho)
+    {
+        contadores_http.requisicoes++;
+        resposta.clear();
+
+        int fd = conectar();
+        if (fd < 0)
+        {
+            contadores_http.falhas++;
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+
+        std::string pedido = std::string(metodo) + " " + caminho + " HTTP/1.1\r\n";
+        pedido += "Host: " + host + "\r\nConnection: close\r\n";
+        for (const std::string &cabecalho : cabecalhos)
+            pedido += cabecalho + "\r\n";
+        pedido += "Content-Length: " + std::to_string(tamanho) + "\r\n\r\n";
+
+        if (!enviarTudo(fd, pedido.data(), pedido.size()) || !enviarTudo(fd, (const char *)corpo, tamanho))
+        {
+            ::close(fd);
+            contadores_http.falhas++;
+            return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+        }
+        contadores_http.bytes_enviados += pedido.size() + tamanho;
+
+        // le ate o servidor fechar (Connection: close)
+        std::string bruto;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+            bruto.append(buffer, n);
+        ::close(fd);
+        contadores_http.bytes_recebidos += bruto.size();
+
+        int codigo = 0;
+        if (bruto.size() < 12 || sscanf(bruto.c_str(), "HTTP/1.%*d %d", &codigo) != 1)
+        {
+            contadores_http.falhas++;
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+
+        size_t inicio_corpo = bruto.find("\r\n\r\n");
+        if (inicio_corpo != std::string::npos)
+            resposta = bruto.substr(inicio_corpo + 4);
+
+        if (codigo != HTTP_CODE_OK)
+            contadores_http.falhas++;
+        return codigo;
+    }
+
+public:
+    HTTPClient() : timeout_ms(5000) {}
+
+    /*
+     * aceita apenas urls http://host[:porta]/caminho
+     */
+    bool begin(const String &url)
+    {
+        std::string texto = url.c_str();
+        const std::string esquema = "http://";
+        if (texto.compare(0, esquema.size(), esquema) != 0)
+            return false;
+
+        texto = texto.substr(esquema.size());
+        size_t barra = texto.find('/');
+        std::string autoridade = texto.substr(0, barra);
+        caminho = barra == std::string::npos ? "/" : texto.substr(barra);
+
+        size_t dois_pontos = autoridade.find(':');
+        host = autoridade.substr(0, dois_pontos);
+        porta = dois_pontos == std::string::npos ? "80" : autoridade.substr(dois_pontos + 1);
+        cabecalhos.clear();
+        return true;
+    }
+
+    void addHeader(const String &nome, const String &valor)
+    {
+        cabecalhos.push_back(std::string(nome.c_str()) + ": " + valor.c_str());
+    }
+
+    void setTimeout(uint16_t ms) { timeout_ms = ms; }
+
+    int POST(const String &corpo) { return requisicao("POST", (const uint8_t *)corpo.c_str(), corpo.length()); }
+    int POST(uint8_t *corpo, size_t tamanho) { return requisicao("POST", corpo, tamanho); }
+    int GET() { return requisicao("GET", NULL, 0); }
+
+    String getString() { return String(resposta); }
+    int getSize() { return resposta.size(); }
+    void end() { cabecalhos.clear(); }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef LITTLEFS_NATIVO_H
+#define LITTLEFS_NATIVO_H
+
+#include "Arduino.h"
+#include "FS.h"
+#include <sys/stat.h>
+
+/*
+ *  stand-in do LittleFS: arquivos num diretorio do host
+ *  a raiz e por thread, para simular varios dispositivos no mesmo processo;
+ *  threads novas partem da raiz padrao
+ */
+
+class SistemaArquivosNativo
+{
+private:
+    // raiz das threads que nao chamaram definirRaiz (ex.: tarefas do GerenciadorCiclo)
+    static std::string &raizPadrao()
+    {
+        static std::string diretorio = "nativo_fs";
+        return diretorio;
+    }
+
+    static std::string &raiz()
+    {
+        thread_local std::string diretorio = raizPadrao();
+        return diretorio;
+    }
+
+    std::string caminho(const char *nome) { return raiz() + nome; }
+
+public:
+    void definirRaiz(const std::string &diretorio) { raiz() = diretorio; }
+    void definirRaizPadrao(const std::string &diretorio) { raizPadrao() = raiz() = diretorio; }
+
+    // tempo de program + commit de metadados por open-append-close (ver File::close)
+    void definirLatenciaEscrita(unsigned long ms) { File::latenciaEscrita() = ms; }
+
+    bool begin(bool = false, const char * = "/littlefs", uint8_t = 10, const char * = NULL)
+    {
+        mkdir(raiz().c_str(), 0755);
+        return true;
+    }
+    void end() {}
+
+    File open(const char *nome, const char *modo = "r")
+    {
+        const char *modo_stdio = modo[0] == 'a' ? "a+b" : (modo[0] == 'w' ? "w+b" : "rb");
+        return File(fopen(caminho(nome).c_str(), modo_stdio), nome, modo[0] != 'r');
+    }
+
+    bool exists(const char *nome)
+    {
+        struct stat info;
+        return stat(caminho(nome).c_str(), &info) == 0;
+    }
+    bool remove(const char *nome) { return ::remove(caminho(nome).c_str()) == 0; }
+    bool rename(const char *de, const char *para) { return ::rename(caminho(de).c_str(), caminho(para).c_str()) == 0; }
+
+    size_t totalBytes() { return 0x160000; }
+    size_t usedBytes() { return 0; }
+};
+
+inline SistemaArquivosNativo LittleFS;
+
+#endif
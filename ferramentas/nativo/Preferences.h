@@ -0,0 +1,75 @@
+#ifndef PREFERENCES_NATIVO_H
+#define PREFERENCES_NATIVO_H
+
+#include "Arduino.h"
+#include "LittleFS.h"
+
+/*
+ *  stand-in do Preferences (NVS): um arquivo por chave na raiz do LittleFS
+ *  simulado, entao cada dispositivo emulado tem seu proprio NVS
+ */
+
+class Preferences
+{
+private:
+    std::string espaco;
+    bool somente_leitura = false;
+    bool aberto = false;
+
+    std::string caminho(const char *chave) { return "/nvs_" + espaco + "_" + chave; }
+
+public:
+    bool begin(const char *nome, bool leitura = false, const char * = NULL)
+    {
+        espaco = nome;
+        somente_leitura = leitura;
+        aberto = LittleFS.begin(true);
+        return aberto;
+    }
+    void end() { aberto = false; }
+
+    bool isKey(const char *chave) { return aberto && LittleFS.exists(caminho(chave).c_str()); }
+    bool remove(const char *chave) { return aberto && !somente_leitura && LittleFS.remove(caminho(chave).c_str()); }
+
+    size_t putBytes(const char *chave, const void *valor, size_t tamanho)
+    {
+        if (!aberto || somente_leitura)
+            return 0;
+        File arquivo = LittleFS.open(caminho(chave).c_str(), "w");
+        if (!arquivo)
+            return 0;
+        size_t escritos = arquivo.write((const uint8_t *)valor, tamanho);
+        arquivo.close();
+        return escritos;
+    }
+
+    size_t putUInt(const char *chave, uint32_t valor) { return putBytes(chave, &valor, sizeof(valor)); }
+    uint32_t getUInt(const char *chave, uint32_t padrao = 0)
+    {
+        uint32_t valor;
+        return getBytesLength(chave) == sizeof(valor) && getBytes(chave, &valor, sizeof(valor)) == sizeof(valor) ? valor
+                                                                                                                 : padrao;
+    }
+
+    size_t getBytesLength(const char *chave)
+    {
+        if (!isKey(chave))
+            return 0;
+        File arquivo = LittleFS.open(caminho(chave).c_str(), "r");
+        size_t tamanho = arquivo.size();
+        arquivo.close();
+        return tamanho;
+    }
+
+    size_t getBytes(const char *chave, void *destino, size_t maximo)
+    {
+        if (!isKey(chave))
+            return 0;
+        File arquivo = LittleFS.open(caminho(chave).c_str(), "r");
+        size_t lidos = arquivo.read((uint8_t *)destino, maximo);
+        arquivo.close();
+        return lidos;
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef WIFI_NATIVO_H
+#define WIFI_NATIVO_H
+
+#include "Arduino.h"
+
+// stand-in do radio: no host a rede (loopback) esta sempre disponivel
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_DISCONNECTED = 6,
+    WL_CONNECTED = 3
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1
+} wifi_mode_t;
+
+class IPAddress
+{
+public:
+    String toString() const { return "127.0.0.1"; }
+    operator String() const { return toString(); }
+};
+
+class WiFiClass
+{
+private:
+    std::atomic<bool> conectado{false};
+    std::atomic<unsigned long> conectado_em{0};
+    unsigned long latencia_ms = 0;
+
+    // mac por thread, para simular varios dispositivos no mesmo processo
+    // (sem heap: o upload le o mac no caminho quente)
+    static char *mac()
+    {
+        thread_local char endereco[18] = "02:00:00:00:00:01";
+        return endereco;
+    }
+
+public:
+    // simula o tempo de associacao + DHCP do radio real
+    void definirLatenciaConexao(unsigned long ms) { latencia_ms = ms; }
+
+    wl_status_t begin(const char *, const char * = NULL, int32_t = 0)
+    {
+        conectado_em = millis() + latencia_ms;
+        conectado = true;
+        return latencia_ms ? WL_DISCONNECTED : WL_CONNECTED;
+    }
+    wl_status_t status() { return conectado && millis() >= conectado_em ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool disconnect(bool = false)
+    {
+        conectado = false;
+        return true;
+    }
+    bool mode(wifi_mode_t) { return true; }
+    void definirMac(const std::string &endereco) { snprintf(mac(), 18, "%s", endereco.c_str()); }
+    String macAddress() { return String(mac()); }
+    uint8_t *macAddress(uint8_t *bytes)
+    {
+        unsigned valores[6] = {};
+        sscanf(mac(), "%x:%x:%x:%x:%x:%x", &valores[0], &valores[1], &valores[2], &valores[3], &valores[4],
+               &valores[5]);
+        for (uint8_t i = 0; i < 6; i++)
+            bytes[i] = valores[i];
+        return bytes;
+    }
+    IPAddress localIP() { return IPAddress(); }
+    int8_t RSSI() { return conectado ? -55 : 0; }
+};
+
+inline WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CONFIG_SECRET_H
+#define CONFIG_SECRET_H
+
+#include <stdint.h>
+
+/*
+ * credenciais do build nativo: servidor de ingestao local (ferramentas/)
+ * um src/config_privado.h, se existir, tem prioridade
+ */
+
+const char *WIFI_SSID = "host";
+const char *WIFI_SENHA = "";
+const char *SERVIDOR_URL = "http://127.0.0.1:8080/api";
+
+// https: as ferramentas leem a CA e a chave que o servidor_tls gera
+const char *SERVIDOR_CA_PEM = "";
+const char *SERVIDOR_CHAVE_SHA256 = "";
+
+// gateway: o stand-in do esp-now manda tudo para o gateway_local em udp
+const uint8_t GATEWAY_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xFE};
+
+#endif
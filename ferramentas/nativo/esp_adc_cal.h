@@ -0,0 +1,71 @@
+#ifndef ESP_ADC_CAL_NATIVO_H
+#define ESP_ADC_CAL_NATIVO_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  stand-in da calibracao do ADC pelo eFuse: caracteristica linear
+ *  (coeficientes em Q16, como no esp-idf) derivada do vref informado,
+ *  cobrindo 0-3300 mV com a vref padrao de 1100 mV (atenuacao de 11 dB)
+ */
+
+typedef enum
+{
+    ADC_UNIT_1 = 1,
+    ADC_UNIT_2 = 2
+} adc_unit_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_11
+} adc_atten_t;
+
+typedef enum
+{
+    ADC_WIDTH_BIT_9,
+    ADC_WIDTH_BIT_10,
+    ADC_WIDTH_BIT_11,
+    ADC_WIDTH_BIT_12
+} adc_bits_width_t;
+
+typedef enum
+{
+    ESP_ADC_CAL_VAL_EFUSE_VREF,
+    ESP_ADC_CAL_VAL_EFUSE_TP,
+    ESP_ADC_CAL_VAL_DEFAULT_VREF
+} esp_adc_cal_value_t;
+
+typedef struct
+{
+    adc_unit_t adc_num;
+    adc_atten_t atten;
+    adc_bits_width_t bit_width;
+    uint32_t coeff_a;
+    uint32_t coeff_b;
+    uint32_t vref;
+} esp_adc_cal_characteristics_t;
+
+inline esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unidade, adc_atten_t atenuacao,
+                                                    adc_bits_width_t largura, uint32_t vref_padrao,
+                                                    esp_adc_cal_characteristics_t *caracteristicas)
+{
+    memset(caracteristicas, 0, sizeof(*caracteristicas));
+    caracteristicas->adc_num = unidade;
+    caracteristicas->atten = atenuacao;
+    caracteristicas->bit_width = largura;
+    caracteristicas->vref = vref_padrao;
+    caracteristicas->coeff_a = (uint32_t)((uint64_t)vref_padrao * 3 * 65536 / 4095);
+    caracteristicas->coeff_b = 0;
+    return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+inline uint32_t esp_adc_cal_raw_to_voltage(uint32_t leitura, const esp_adc_cal_characteristics_t *caracteristicas)
+{
+    return (uint32_t)(((uint64_t)caracteristicas->coeff_a * leitura + caracteristicas->coeff_b + 32768) >> 16);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ESP_HEAP_CAPS_NATIVO_H
+#define ESP_HEAP_CAPS_NATIVO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/*
+ *  stand-in do heap do esp32: valores de um heap de DRAM tipico,
+ *  ajustaveis para simular vazamento ou fragmentacao nas ferramentas
+ *  (atomicos: a suite de desempenho os atualiza do operator new, em
+ *  qualquer thread)
+ */
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+struct HeapNativo
+{
+    std::atomic<size_t> livre{180 * 1024};
+    std::atomic<size_t> maior_bloco{110 * 1024};
+    std::atomic<size_t> minimo{172 * 1024};
+
+    void definir(size_t bytes_livres, size_t bytes_maior_bloco)
+    {
+        livre = bytes_livres;
+        maior_bloco = bytes_maior_bloco < bytes_livres ? bytes_maior_bloco : bytes_livres;
+        if (livre < minimo)
+            minimo = livre.load();
+    }
+};
+
+inline HeapNativo heap_nativo;
+
+inline size_t heap_caps_get_free_size(uint32_t) { return heap_nativo.livre; }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return heap_nativo.maior_bloco; }
+inline size_t heap_caps_get_minimum_free_size(uint32_t) { return heap_nativo.minimo; }
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef ESP_NOW_NATIVO_H
+#define ESP_NOW_NATIVO_H
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/*
+ *  stand-in do esp-now: cada quadro vira um datagrama udp para o gateway
+ *  local (ferramentas/gateway_local), 127.0.0.1:8090 por padrao
+ *
+ *  uma thread recebe as respostas e chama o callback, como a tarefa do
+ *  wifi no esp32. todo par registrado e o mesmo gateway udp; um
+ *  dispositivo por processo (o socket e global).
+ */
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_KEY_LEN 16
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_ERR_ESPNOW_NOT_INIT 0x3069
+#define ESP_ERR_ESPNOW_ARG 0x306A
+#define ESP_ERR_ESPNOW_NO_MEM 0x306B
+#define ESP_ERR_ESPNOW_EXIST 0x306E
+
+typedef struct
+{
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void *priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t *mac_addr, const uint8_t *data, int data_len);
+
+// contadores globais, usados pelas ferramentas para medir bytes no ar
+struct ContadoresEspNowNativo
+{
+    std::atomic<uint32_t> enviados{0};
+    std::atomic<uint32_t> recebidos{0};
+    std::atomic<uint64_t> bytes_enviados{0};
+    std::atomic<uint64_t> bytes_recebidos{0};
+};
+
+inline ContadoresEspNowNativo contadores_esp_now;
+
+struct EspNowNativo
+{
+    int fd = -1;
+    struct sockaddr_in gateway = {};
+    uint8_t mac_par[ESP_NOW_ETH_ALEN] = {};
+    bool tem_par = false;
+    std::atomic<bool> ativo{false};
+    std::atomic<esp_now_recv_cb_t> ao_receber{nullptr};
+    std::thread receptor;
+
+    EspNowNativo() { definirGateway("127.0.0.1", 8090); }
+
+    void definirGateway(const char *host, uint16_t porta)
+    {
+        gateway.sin_family = AF_INET;
+        gateway.sin_port = htons(porta);
+        inet_pton(AF_INET, host, &gateway.sin_addr);
+    }
+
+    void receber()
+    {
+        uint8_t buffer[ESP_NOW_MAX_DATA_LEN + 1];
+        while (ativo)
+        {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            esp_now_recv_cb_t callback = ao_receber;
+            if (n <= 0 || n > ESP_NOW_MAX_DATA_LEN || !callback)
+                continue;
+            contadores_esp_now.recebidos++;
+            contadores_esp_now.bytes_recebidos += n;
+            callback(mac_par, buffer, (int)n);
+        }
+    }
+};
+
+inline EspNowNativo esp_now_nativo;
+
+inline esp_err_t esp_now_init()
+{
+    EspNowNativo &enlace = esp_now_nativo;
+    if (enlace.ativo)
+        return ESP_OK;
+
+    enlace.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (enlace.fd < 0)
+        return ESP_FAIL;
+    struct timeval limite = {0, 100000}; // a thread confere `ativo` a cada 100 ms
+    setsockopt(enlace.fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    enlace.ativo = true;
+    enlace.receptor = std::thread(&EspNowNativo::receber, &enlace);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_now_deinit()
+{
+    EspNowNativo &enlace = esp_now_nativo;
+    if (!enlace.ativo)
+        return ESP_OK;
+    enlace.ativo = false;
+
+    // datagrama vazio para o proprio socket: acorda a thread sem esperar o timeout
+    struct sockaddr_in proprio = {};
+    socklen_t tamanho = sizeof(proprio);
+    getsockname(enlace.fd, (struct sockaddr *)&proprio, &tamanho);
+    proprio.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::sendto(enlace.fd, "", 0, 0, (const struct sockaddr *)&proprio, tamanho);
+    enlace.receptor.join();
+    ::close(enlace.fd);
+    enlace.fd = -1;
+    enlace.tem_par = false;
+    enlace.ao_receber = nullptr;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t callback)
+{
+    esp_now_nativo.ao_receber = callback;
+    return esp_now_nativo.ativo ? ESP_OK : ESP_ERR_ESPNOW_NOT_INIT;
+}
+
+inline bool esp_now_is_peer_exist(const uint8_t *mac)
+{
+    return esp_now_nativo.tem_par && memcmp(esp_now_nativo.mac_par, mac, ESP_NOW_ETH_ALEN) == 0;
+}
+
+inline esp_err_t esp_now_add_peer(const esp_now_peer_info_t *par)
+{
+    if (!esp_now_nativo.ativo)
+        return ESP_ERR_ESPNOW_NOT_INIT;
+    if (esp_now_is_peer_exist(par->peer_addr))
+        return ESP_ERR_ESPNOW_EXIST;
+    memcpy(esp_now_nativo.mac_par, par->peer_addr, ESP_NOW_ETH_ALEN);
+    esp_now_nativo.tem_par = true;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_now_send(const uint8_t *, const uint8_t *dados, size_t tamanho)
+{
+    EspNowNativo &enlace = esp_now_nativo;
+    if (!enlace.ativo)
+        return ESP_ERR_ESPNOW_NOT_INIT;
+    if (!enlace.tem_par || tamanho == 0 || tamanho > ESP_NOW_MAX_DATA_LEN)
+        return ESP_ERR_ESPNOW_ARG;
+
+    ssize_t n = ::sendto(enlace.fd, dados, tamanho, 0, (const struct sockaddr *)&enlace.gateway, sizeof(enlace.gateway));
+    if (n != (ssize_t)tamanho)
+        return errno == ENOBUFS || errno == EAGAIN ? ESP_ERR_ESPNOW_NO_MEM : ESP_FAIL;
+    contadores_esp_now.enviados++;
+    contadores_esp_now.bytes_enviados += tamanho;
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef ESP_PARTITION_NATIVO_H
+#define ESP_PARTITION_NATIVO_H
+
+#include "Arduino.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <memory>
+#include <vector>
+
+/*
+ *  stand-in das particoes da flash: cada particao declarada e um arquivo
+ *  do host, mapeado com mmap como o esp_partition_mmap mapeia a flash
+ *
+ *  a escrita segue a flash NOR (so zera bits: o byte gravado e o AND com
+ *  o atual) e o apagamento volta setores de 4 KiB a 0xFF. nenhuma
+ *  particao existe ate ser declarada: ferramentas sem declaracao rodam
+ *  como um esp32 com a tabela de particoes padrao.
+ */
+
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+    ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+    ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef enum
+{
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct
+{
+    void *flash_chip;
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+struct ParticaoNativa
+{
+    esp_partition_t info;
+    uint8_t *mapa;
+};
+
+struct ParticoesNativo
+{
+    std::vector<std::unique_ptr<ParticaoNativa>> tabela;
+    uint32_t proximo_endereco = 0x330000;
+
+    /*
+     * particao de dados com rotulo e subtipo, guardada em caminho
+     * (criada apagada se nao existir; reaberta com o conteudo anterior)
+     */
+    const esp_partition_t *declarar(const char *rotulo, uint8_t subtipo, uint32_t tamanho, const std::string &caminho)
+    {
+        int fd = open(caminho.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return NULL;
+        struct stat info;
+        fstat(fd, &info);
+        if ((uint32_t)info.st_size != tamanho && ftruncate(fd, tamanho) != 0)
+        {
+            ::close(fd);
+            return NULL;
+        }
+        void *mapa = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapa == MAP_FAILED)
+            return NULL;
+        if ((uint32_t)info.st_size < tamanho)
+            memset((uint8_t *)mapa + info.st_size, 0xFF, tamanho - info.st_size);
+
+        std::unique_ptr<ParticaoNativa> particao(new ParticaoNativa());
+        particao->info.type = ESP_PARTITION_TYPE_DATA;
+        particao->info.subtype = (esp_partition_subtype_t)subtipo;
+        particao->info.address = proximo_endereco;
+        particao->info.size = tamanho;
+        snprintf(particao->info.label, sizeof(particao->info.label), "%s", rotulo);
+        particao->mapa = (uint8_t *)mapa;
+        proximo_endereco += tamanho;
+        tabela.push_back(std::move(particao));
+        return &tabela.back()->info;
+    }
+
+    ParticaoNativa *buscar(const esp_partition_t *particao)
+    {
+        for (auto &p : tabela)
+            if (&p->info == particao)
+                return p.get();
+        return NULL;
+    }
+};
+
+inline ParticoesNativo particoes_nativo;
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t subtipo,
+                                                       const char *rotulo)
+{
+    for (auto &p : particoes_nativo.tabela)
+    {
+        if (p->info.type == tipo && (subtipo == ESP_PARTITION_SUBTYPE_ANY || p->info.subtype == subtipo) &&
+            (rotulo == NULL || strcmp(p->info.label, rotulo) == 0))
+            return &p->info;
+    }
+    return NULL;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *particao, size_t deslocamento, void *destino,
+                                    size_t tamanho)
+{
+    ParticaoNativa *p = particoes_nativo.buscar(particao);
+    if (!p || deslocamento + tamanho > particao->size)
+        return ESP_ERR_INVALID_ARG;
+    memcpy(destino, p->mapa + deslocamento, tamanho);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *particao, size_t deslocamento, const void *origem,
+                                     size_t tamanho)
+{
+    ParticaoNativa *p = particoes_nativo.buscar(particao);
+    if (!p || deslocamento + tamanho > particao->size)
+        return ESP_ERR_INVALID_ARG;
+    const uint8_t *dados = (const uint8_t *)origem;
+    for (size_t i = 0; i < tamanho; i++)
+        p->mapa[deslocamento + i] &= dados[i];
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *particao, size_t deslocamento, size_t tamanho)
+{
+    ParticaoNativa *p = particoes_nativo.buscar(particao);
+    if (!p || deslocamento + tamanho > particao->size)
+        return ESP_ERR_INVALID_ARG;
+    if (deslocamento % SPI_FLASH_SEC_SIZE != 0 || tamanho % SPI_FLASH_SEC_SIZE != 0)
+        return ESP_ERR_INVALID_SIZE;
+    memset(p->mapa + deslocamento, 0xFF, tamanho);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t *particao, size_t deslocamento, size_t tamanho,
+                                    spi_flash_mmap_memory_t, const void **saida, spi_flash_mmap_handle_t *handle)
+{
+    ParticaoNativa *p = particoes_nativo.buscar(particao);
+    if (!p || deslocamento + tamanho > particao->size)
+        return ESP_ERR_INVALID_ARG;
+    *saida = p->mapa + deslocamento;
+    *handle = 0;
+    return ESP_OK;
+}
+
+inline void spi_flash_munmap(spi_flash_mmap_handle_t) {}
+
+#endif
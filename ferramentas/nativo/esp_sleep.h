@@ -0,0 +1,35 @@
+#ifndef ESP_SLEEP_NATIVO_H
+#define ESP_SLEEP_NATIVO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// stand-in do deep sleep: no host o processo simplesmente termina
+
+typedef int esp_err_t;
+typedef int gpio_num_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER
+} esp_sleep_wakeup_cause_t;
+
+typedef enum
+{
+    ESP_EXT1_WAKEUP_ALL_LOW,
+    ESP_EXT1_WAKEUP_ANY_HIGH
+} esp_sleep_ext1_wakeup_mode_t;
+
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t) { return ESP_OK; }
+inline esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t, int) { return ESP_OK; }
+inline esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t, esp_sleep_ext1_wakeup_mode_t) { return ESP_OK; }
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+inline void esp_deep_sleep_start() { exit(0); }
+
+#endif
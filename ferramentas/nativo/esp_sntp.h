@@ -0,0 +1,15 @@
+#ifndef ESP_SNTP_NATIVO_H
+#define ESP_SNTP_NATIVO_H
+
+// o relogio do host ja vem sincronizado pelo sistema operacional
+
+typedef enum
+{
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+inline sntp_sync_status_t sntp_get_sync_status() { return SNTP_SYNC_STATUS_COMPLETED; }
+
+#endif
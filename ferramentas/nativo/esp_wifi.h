@@ -0,0 +1,21 @@
+#ifndef ESP_WIFI_NATIVO_H
+#define ESP_WIFI_NATIVO_H
+
+#include "Arduino.h"
+
+// stand-in do driver wifi: no host nao ha canal a sintonizar
+
+typedef enum
+{
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP = 1
+} wifi_interface_t;
+
+typedef enum
+{
+    WIFI_SECOND_CHAN_NONE = 0
+} wifi_second_chan_t;
+
+inline esp_err_t esp_wifi_set_channel(uint8_t, wifi_second_chan_t) { return ESP_OK; }
+
+#endif
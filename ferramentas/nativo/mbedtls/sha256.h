@@ -0,0 +1,7 @@
+#ifndef MBEDTLS_SHA256_NATIVO_H
+#define MBEDTLS_SHA256_NATIVO_H
+
+// stand-in: o subconjunto usado do mbedTLS fica todo em ssl.h
+#include "ssl.h"
+
+#endif
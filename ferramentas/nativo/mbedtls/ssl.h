@@ -0,0 +1,542 @@
+#ifndef MBEDTLS_NATIVO_H
+#define MBEDTLS_NATIVO_H
+
+/*
+ * stand-in do subconjunto do mbedTLS 2.28 (esp-idf 4.4) usado pelo
+ * cliente_tls.h, implementado sobre o OpenSSL do host. o handshake e de
+ * verdade (TLS 1.2, o maximo do mbedTLS 2.x), entao bytes e idas e voltas
+ * medidos no host sao os do dispositivo; so o tempo de cpu difere.
+ *
+ * os contextos sao structs de ponteiros do OpenSSL, na pilha como no mbedTLS.
+ * build: -lssl -lcrypto
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+// CODIGOS
+
+#define MBEDTLS_ERR_NET_SOCKET_FAILED -0x0042
+#define MBEDTLS_ERR_NET_CONNECT_FAILED -0x0044
+#define MBEDTLS_ERR_NET_RECV_FAILED -0x004C
+#define MBEDTLS_ERR_NET_SEND_FAILED -0x004E
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+#define MBEDTLS_ERR_NET_UNKNOWN_HOST -0x0052
+#define MBEDTLS_ERR_ASN1_BUF_TOO_SMALL -0x006C
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED -0x2700
+#define MBEDTLS_ERR_X509_INVALID_FORMAT -0x2180
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA -0x7100
+#define MBEDTLS_ERR_SSL_CONN_EOF -0x7280
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY -0x7880
+#define MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE -0x7180
+#define MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL -0x6A00
+#define MBEDTLS_ERR_SSL_WANT_READ -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE -0x6880
+#define MBEDTLS_ERR_SSL_TIMEOUT -0x6800
+
+#define MBEDTLS_X509_BADCERT_EXPIRED 0x01
+#define MBEDTLS_X509_BADCERT_CN_MISMATCH 0x04
+#define MBEDTLS_X509_BADCERT_NOT_TRUSTED 0x08
+#define MBEDTLS_X509_BADCERT_OTHER 0x0100
+
+#define MBEDTLS_NET_PROTO_TCP 0
+#define MBEDTLS_SSL_IS_CLIENT 0
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+#define MBEDTLS_SSL_VERIFY_NONE 0
+#define MBEDTLS_SSL_VERIFY_OPTIONAL 1
+#define MBEDTLS_SSL_VERIFY_REQUIRED 2
+#define MBEDTLS_SSL_SESSION_TICKETS_DISABLED 0
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED 1
+
+typedef int mbedtls_ssl_send_t(void *ctx, const unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void *ctx, unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+// SOCKETS
+
+struct mbedtls_net_context
+{
+    int fd;
+};
+
+inline void mbedtls_net_init(mbedtls_net_context *ctx) { ctx->fd = -1; }
+
+inline int mbedtls_net_connect(mbedtls_net_context *ctx, const char *host, const char *porta, int)
+{
+    struct addrinfo dicas = {};
+    struct addrinfo *enderecos = NULL;
+    dicas.ai_family = AF_INET;
+    dicas.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, porta, &dicas, &enderecos) != 0)
+        return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+
+    int fd = socket(enderecos->ai_family, enderecos->ai_socktype, enderecos->ai_protocol);
+    int um = 1;
+    if (fd >= 0)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    if (fd >= 0 && ::connect(fd, enderecos->ai_addr, enderecos->ai_addrlen) != 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(enderecos);
+    if (fd < 0)
+        return MBEDTLS_ERR_NET_CONNECT_FAILED;
+    ctx->fd = fd;
+    return 0;
+}
+
+inline int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    ssize_t n = ::send(((mbedtls_net_context *)ctx)->fd, buf, len, MSG_NOSIGNAL);
+    if (n >= 0)
+        return (int)n;
+    return errno == EPIPE || errno == ECONNRESET ? MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+inline int mbedtls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    struct pollfd espera = {((mbedtls_net_context *)ctx)->fd, POLLIN, 0};
+    int pronto = poll(&espera, 1, timeout ? (int)timeout : -1);
+    if (pronto == 0)
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    if (pronto < 0)
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+
+    ssize_t n = ::recv(espera.fd, buf, len, 0);
+    if (n >= 0)
+        return (int)n;
+    return errno == ECONNRESET ? MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+inline void mbedtls_net_free(mbedtls_net_context *ctx)
+{
+    if (ctx->fd >= 0)
+        ::close(ctx->fd);
+    ctx->fd = -1;
+}
+
+// ALEATORIEDADE (o OpenSSL semeia o proprio gerador)
+
+struct mbedtls_entropy_context
+{
+    int nada;
+};
+
+struct mbedtls_ctr_drbg_context
+{
+    int nada;
+};
+
+inline void mbedtls_entropy_init(mbedtls_entropy_context *) {}
+inline void mbedtls_entropy_free(mbedtls_entropy_context *) {}
+inline int mbedtls_entropy_func(void *, unsigned char *saida, size_t tamanho)
+{
+    return RAND_bytes(saida, (int)tamanho) == 1 ? 0 : -1;
+}
+
+inline void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *) {}
+inline void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *) {}
+inline int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *, int (*)(void *, unsigned char *, size_t), void *,
+                                 const unsigned char *, size_t)
+{
+    return 0;
+}
+inline int mbedtls_ctr_drbg_random(void *, unsigned char *saida, size_t tamanho)
+{
+    return RAND_bytes(saida, (int)tamanho) == 1 ? 0 : -1;
+}
+
+// HASH E CHAVES
+
+inline int mbedtls_sha256_ret(const unsigned char *entrada, size_t tamanho, unsigned char saida[32], int is224)
+{
+    if (is224)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    SHA256(entrada, tamanho, saida);
+    return 0;
+}
+
+struct mbedtls_pk_context
+{
+    EVP_PKEY *chave; // emprestada do certificado
+};
+
+/*
+ * como no mbedTLS: escreve no fim do buffer e retorna o tamanho
+ */
+inline int mbedtls_pk_write_pubkey_der(mbedtls_pk_context *ctx, unsigned char *buf, size_t tamanho)
+{
+    int n = ctx->chave ? i2d_PUBKEY(ctx->chave, NULL) : -1;
+    if (n <= 0)
+        return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    if ((size_t)n > tamanho)
+        return MBEDTLS_ERR_ASN1_BUF_TOO_SMALL;
+    unsigned char *p = buf + tamanho - n;
+    i2d_PUBKEY(ctx->chave, &p);
+    return n;
+}
+
+// CERTIFICADOS
+
+/*
+ * lista encadeada como no mbedTLS; o primeiro elemento e o proprio contexto
+ */
+struct mbedtls_x509_crt
+{
+    X509 *x509;
+    mbedtls_pk_context pk;
+    mbedtls_x509_crt *next;
+};
+
+inline void mbedtls_x509_crt_init(mbedtls_x509_crt *crt) { memset(crt, 0, sizeof(*crt)); }
+
+inline void mbedtls_x509_crt_free(mbedtls_x509_crt *crt)
+{
+    mbedtls_x509_crt *atual = crt;
+    while (atual)
+    {
+        mbedtls_x509_crt *proximo = atual->next;
+        if (atual->x509)
+            X509_free(atual->x509);
+        if (atual != crt)
+            delete atual;
+        atual = proximo;
+    }
+    memset(crt, 0, sizeof(*crt));
+}
+
+/*
+ * so PEM; tamanho inclui o '\0' final, como no mbedTLS
+ */
+inline int mbedtls_x509_crt_parse(mbedtls_x509_crt *crt, const unsigned char *buf, size_t tamanho)
+{
+    if (tamanho == 0 || buf[tamanho - 1] != '\0')
+        return MBEDTLS_ERR_X509_INVALID_FORMAT;
+
+    BIO *entrada = BIO_new_mem_buf(buf, (int)tamanho - 1);
+    mbedtls_x509_crt *fim = crt;
+    while (fim->x509 && fim->next)
+        fim = fim->next;
+
+    int lidos = 0;
+    X509 *x509;
+    while ((x509 = PEM_read_bio_X509(entrada, NULL, NULL, NULL)) != NULL)
+    {
+        if (fim->x509)
+        {
+            fim->next = new mbedtls_x509_crt();
+            fim = fim->next;
+        }
+        fim->x509 = x509;
+        fim->pk.chave = X509_get0_pubkey(x509);
+        lidos++;
+    }
+    BIO_free(entrada);
+    ERR_clear_error();
+    return lidos > 0 ? 0 : MBEDTLS_ERR_X509_INVALID_FORMAT;
+}
+
+// SESSAO
+
+struct mbedtls_ssl_session
+{
+    SSL_SESSION *sessao;
+};
+
+inline void mbedtls_ssl_session_init(mbedtls_ssl_session *s) { s->sessao = NULL; }
+
+inline void mbedtls_ssl_session_free(mbedtls_ssl_session *s)
+{
+    if (s->sessao)
+        SSL_SESSION_free(s->sessao);
+    s->sessao = NULL;
+}
+
+inline int mbedtls_ssl_session_save(const mbedtls_ssl_session *s, unsigned char *buf, size_t tamanho, size_t *escritos)
+{
+    int n = s->sessao ? i2d_SSL_SESSION(s->sessao, NULL) : 0;
+    if (n <= 0)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    *escritos = n;
+    if ((size_t)n > tamanho)
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    i2d_SSL_SESSION(s->sessao, &buf);
+    return 0;
+}
+
+inline int mbedtls_ssl_session_load(mbedtls_ssl_session *s, const unsigned char *buf, size_t tamanho)
+{
+    mbedtls_ssl_session_free(s);
+    s->sessao = d2i_SSL_SESSION(NULL, &buf, (long)tamanho);
+    return s->sessao ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+// CONFIGURACAO
+
+struct mbedtls_ssl_config
+{
+    SSL_CTX *ctx;
+    int modo_verificacao;
+    uint32_t timeout_leitura;
+    int (*verificar)(void *, mbedtls_x509_crt *, int, uint32_t *);
+    void *contexto_verificar;
+};
+
+inline void mbedtls_ssl_config_init(mbedtls_ssl_config *conf) { memset(conf, 0, sizeof(*conf)); }
+
+inline int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int, int, int)
+{
+    conf->ctx = SSL_CTX_new(TLS_client_method());
+    if (!conf->ctx)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    // mbedTLS 2.x nao tem TLS 1.3
+    SSL_CTX_set_max_proto_version(conf->ctx, TLS1_2_VERSION);
+    SSL_CTX_set_session_cache_mode(conf->ctx, SSL_SESS_CACHE_OFF);
+    conf->modo_verificacao = MBEDTLS_SSL_VERIFY_REQUIRED;
+    return 0;
+}
+
+inline void mbedtls_ssl_config_free(mbedtls_ssl_config *conf)
+{
+    if (conf->ctx)
+        SSL_CTX_free(conf->ctx);
+    conf->ctx = NULL;
+}
+
+inline void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int modo) { conf->modo_verificacao = modo; }
+inline void mbedtls_ssl_conf_rng(mbedtls_ssl_config *, int (*)(void *, unsigned char *, size_t), void *) {}
+inline void mbedtls_ssl_conf_read_timeout(mbedtls_ssl_config *conf, uint32_t ms) { conf->timeout_leitura = ms; }
+
+inline void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int usar)
+{
+    if (usar)
+        SSL_CTX_clear_options(conf->ctx, SSL_OP_NO_TICKET);
+    else
+        SSL_CTX_set_options(conf->ctx, SSL_OP_NO_TICKET);
+}
+
+inline void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca, void *)
+{
+    X509_STORE *loja = SSL_CTX_get_cert_store(conf->ctx);
+    for (; ca && ca->x509; ca = ca->next)
+        X509_STORE_add_cert(loja, ca->x509);
+}
+
+inline void mbedtls_ssl_conf_verify(mbedtls_ssl_config *conf, int (*f)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                                    void *p)
+{
+    conf->verificar = f;
+    conf->contexto_verificar = p;
+}
+
+// CONEXAO
+
+struct mbedtls_ssl_context
+{
+    SSL *ssl;
+    const mbedtls_ssl_config *conf;
+    void *bio;
+    mbedtls_ssl_send_t *enviar;
+    mbedtls_ssl_recv_t *receber;
+    mbedtls_ssl_recv_timeout_t *receber_timeout;
+    uint32_t flags_verificacao;
+};
+
+inline int mbedtls_nativo_indice()
+{
+    static int indice = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    return indice;
+}
+
+/*
+ * leva as falhas do OpenSSL para os flags do mbedTLS e chama o callback
+ * de verificacao do cliente em cada certificado da cadeia
+ */
+inline int mbedtls_nativo_verificar(int ok, X509_STORE_CTX *loja)
+{
+    SSL *ssl = (SSL *)X509_STORE_CTX_get_ex_data(loja, SSL_get_ex_data_X509_STORE_CTX_idx());
+    mbedtls_ssl_context *contexto = (mbedtls_ssl_context *)SSL_get_ex_data(ssl, mbedtls_nativo_indice());
+
+    uint32_t flags = 0;
+    if (!ok)
+    {
+        int erro = X509_STORE_CTX_get_error(loja);
+        if (erro == X509_V_ERR_CERT_HAS_EXPIRED || erro == X509_V_ERR_CERT_NOT_YET_VALID)
+            flags = MBEDTLS_X509_BADCERT_EXPIRED;
+        else if (erro == X509_V_ERR_HOSTNAME_MISMATCH)
+            flags = MBEDTLS_X509_BADCERT_CN_MISMATCH;
+        else
+            flags = MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    }
+
+    const mbedtls_ssl_config *conf = contexto->conf;
+    if (conf->verificar)
+    {
+        mbedtls_x509_crt certificado = {X509_STORE_CTX_get_current_cert(loja), {NULL}, NULL};
+        certificado.pk.chave = X509_get0_pubkey(certificado.x509);
+        if (conf->verificar(conf->contexto_verificar, &certificado, X509_STORE_CTX_get_error_depth(loja), &flags) != 0)
+            flags |= MBEDTLS_X509_BADCERT_OTHER;
+    }
+
+    contexto->flags_verificacao |= flags;
+    return flags == 0 || conf->modo_verificacao != MBEDTLS_SSL_VERIFY_REQUIRED;
+}
+
+inline int mbedtls_nativo_bio_escrever(BIO *bio, const char *dados, int tamanho)
+{
+    mbedtls_ssl_context *contexto = (mbedtls_ssl_context *)BIO_get_data(bio);
+    BIO_clear_retry_flags(bio);
+    int n = contexto->enviar(contexto->bio, (const unsigned char *)dados, tamanho);
+    if (n == MBEDTLS_ERR_SSL_WANT_WRITE)
+        BIO_set_retry_write(bio);
+    return n >= 0 ? n : -1;
+}
+
+inline int mbedtls_nativo_bio_ler(BIO *bio, char *dados, int tamanho)
+{
+    mbedtls_ssl_context *contexto = (mbedtls_ssl_context *)BIO_get_data(bio);
+    BIO_clear_retry_flags(bio);
+    int n = contexto->receber_timeout
+                ? contexto->receber_timeout(contexto->bio, (unsigned char *)dados, tamanho, contexto->conf->timeout_leitura)
+                : contexto->receber(contexto->bio, (unsigned char *)dados, tamanho);
+    if (n == MBEDTLS_ERR_SSL_WANT_READ)
+        BIO_set_retry_read(bio);
+    return n >= 0 ? n : -1;
+}
+
+inline long mbedtls_nativo_bio_controle(BIO *, int comando, long, void *)
+{
+    return comando == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+inline BIO_METHOD *mbedtls_nativo_metodo_bio()
+{
+    static BIO_METHOD *metodo = NULL;
+    if (!metodo)
+    {
+        metodo = BIO_meth_new(BIO_TYPE_SOURCE_SINK | BIO_get_new_index(), "mbedtls_bio");
+        BIO_meth_set_write(metodo, mbedtls_nativo_bio_escrever);
+        BIO_meth_set_read(metodo, mbedtls_nativo_bio_ler);
+        BIO_meth_set_ctrl(metodo, mbedtls_nativo_bio_controle);
+    }
+    return metodo;
+}
+
+inline void mbedtls_ssl_init(mbedtls_ssl_context *ssl) { memset(ssl, 0, sizeof(*ssl)); }
+
+inline int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    ssl->conf = conf;
+    ssl->ssl = SSL_new(conf->ctx);
+    if (!ssl->ssl)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    SSL_set_ex_data(ssl->ssl, mbedtls_nativo_indice(), ssl);
+    SSL_set_verify(ssl->ssl, conf->modo_verificacao == MBEDTLS_SSL_VERIFY_NONE ? SSL_VERIFY_NONE : SSL_VERIFY_PEER,
+                   mbedtls_nativo_verificar);
+    return 0;
+}
+
+inline int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *host)
+{
+    SSL_set_tlsext_host_name(ssl->ssl, host);
+    return SSL_set1_host(ssl->ssl, host) == 1 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+inline void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                                mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout)
+{
+    ssl->bio = p_bio;
+    ssl->enviar = f_send;
+    ssl->receber = f_recv;
+    ssl->receber_timeout = f_recv_timeout;
+    BIO *bio = BIO_new(mbedtls_nativo_metodo_bio());
+    BIO_set_data(bio, ssl);
+    BIO_set_init(bio, 1);
+    SSL_set_bio(ssl->ssl, bio, bio);
+}
+
+inline int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *sessao)
+{
+    return sessao->sessao && SSL_set_session(ssl->ssl, sessao->sessao) == 1 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+inline int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *destino)
+{
+    mbedtls_ssl_session_free(destino);
+    destino->sessao = SSL_get1_session(ssl->ssl);
+    return destino->sessao ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+}
+
+inline int mbedtls_nativo_erro(const mbedtls_ssl_context *ssl, int retorno)
+{
+    int erro = SSL_get_error(ssl->ssl, retorno);
+    ERR_clear_error();
+    switch (erro)
+    {
+    case SSL_ERROR_WANT_READ:
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    case SSL_ERROR_WANT_WRITE:
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    case SSL_ERROR_ZERO_RETURN:
+        return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+    case SSL_ERROR_SYSCALL:
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    default:
+        return ssl->flags_verificacao ? MBEDTLS_ERR_X509_CERT_VERIFY_FAILED : MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE;
+    }
+}
+
+inline int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    int retorno = SSL_connect(ssl->ssl);
+    return retorno == 1 ? 0 : mbedtls_nativo_erro(ssl, retorno);
+}
+
+inline uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context *ssl) { return ssl->flags_verificacao; }
+
+inline int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t tamanho)
+{
+    int n = SSL_write(ssl->ssl, buf, (int)tamanho);
+    return n > 0 ? n : mbedtls_nativo_erro(ssl, n);
+}
+
+inline int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t tamanho)
+{
+    int n = SSL_read(ssl->ssl, buf, (int)tamanho);
+    if (n > 0)
+        return n;
+    int erro = mbedtls_nativo_erro(ssl, n);
+    return erro == MBEDTLS_ERR_SSL_CONN_EOF ? 0 : erro;
+}
+
+inline int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    SSL_shutdown(ssl->ssl);
+    ERR_clear_error();
+    return 0;
+}
+
+inline void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
+{
+    if (ssl->ssl)
+        SSL_free(ssl->ssl);
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+#endif
@@ -0,0 +1,617 @@
+/*
+ *  [i] servidor de ingestao de referencia (host)
+ *
+ *  recebe os POSTs do GerenciadorUpload e contabiliza registros, bytes e
+ *  latencia. pode injetar erros 5xx e latencia para estudar o protocolo
+ *  quando muitos dispositivos reconectam ao mesmo tempo.
+ *
+ *  uso: servidor_ingestao [--porta 8080] [--trabalhadores 64]
+ *                         [--erro-5xx 0.0] [--latencia-ms 0] [--jitter-ms 0]
+ *                         [--duracao-s 0] [--config "v=2;periodo_s=600;tentativas=5"]
+ *                         [--perder-ack 0.0]
+ *
+ *  com --config, dispositivos que anunciam config_versao menor recebem o
+ *  delta na propria resposta do upload (linha "cfg;...", ver
+ *  GerenciadorConfig no firmware; limite<i> ajusta a regra i das faixas).
+ *
+ *  cada formato de payload e tratado por uma entrada na tabela de
+ *  tratadores, escolhida pelo Content-Type.
+ *
+ *  o bloco "telemetria" de cada upload (heap, fragmentacao, RSSI, resets,
+ *  ver GerenciadorTelemetria) e resumido no relatorio como saude da frota.
+ *
+ *  uploads com "dispositivo" e "lote" (faixa de prioridade, intervalo de
+ *  seq e chave de idempotencia) sao deduplicados: o servidor guarda por
+ *  dispositivo e faixa o maior seq gravado, descarta registros ate ele e responde "ack;seq=N".
+ *  com --perder-ack p o lote e gravado mas a conexao fecha sem resposta,
+ *  como um ack perdido na volta; o relatorio conta duplicados descartados
+ *  e lacunas de seq (registros perdidos).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CONFIGURACAO
+
+struct ConfigServidor
+{
+    int porta = 8080;
+    int trabalhadores = 64;
+    double prob_erro = 0.0;  // probabilidade de responder 503
+    double prob_perder_ack = 0.0; // probabilidade de gravar e fechar sem responder
+    int latencia_ms = 0;     // latencia fixa por requisicao
+    int jitter_ms = 0;       // latencia extra uniforme em [0, jitter]
+    int duracao_s = 0;       // 0 = ate SIGINT
+    std::string config;      // delta de config "v=N;chave=valor;..." (vazio = nenhum)
+    uint32_t versao_config = 0;
+};
+
+// ESTATISTICAS
+
+struct Estatisticas
+{
+    std::atomic<uint64_t> requisicoes{0};
+    std::atomic<uint64_t> erros_injetados{0};
+    std::atomic<uint64_t> rejeitadas{0};
+    std::atomic<uint64_t> registros{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> configs_enviadas{0};
+    std::atomic<uint64_t> acks_perdidos{0};
+    std::atomic<int64_t> primeira_us{0}; // janela ativa, para a vazao
+    std::atomic<int64_t> ultima_us{0};
+
+    std::mutex trava_latencias;
+    std::vector<uint32_t> latencias_us;
+};
+
+// SAUDE DA FROTA (bloco "telemetria" dos uploads)
+
+struct SaudeFrota
+{
+    std::mutex trava;
+    uint64_t relatos = 0;
+    uint64_t soma_fragmentacao = 0;
+    long fragmentacao_maxima = 0;
+    long heap_minimo = -1;     // -1 = nenhum relato
+    long rssi_minimo = 0;
+    uint64_t sinal_fraco = 0;  // relatos com rssi < LIMIAR_RSSI_FRACO
+    uint64_t com_reset_anormal = 0;
+    uint64_t com_falhas_upload = 0;
+};
+
+const long LIMIAR_RSSI_FRACO = -80;
+
+static SaudeFrota saude_frota;
+
+// DEDUPLICACAO (seq por dispositivo e faixa)
+
+struct EstadoDispositivo
+{
+    uint32_t confirmada = 0; // maior seq gravado
+};
+
+struct Deduplicacao
+{
+    std::mutex trava;
+    std::map<std::string, EstadoDispositivo> dispositivos; // "mac/faixa": cada faixa tem seq proprio
+    std::set<std::string> chaves; // chaves de idempotencia ja vistas
+    uint64_t duplicados = 0;      // registros descartados por seq ja gravado
+    uint64_t lotes_repetidos = 0;
+    uint64_t lacunas = 0;         // seqs que nunca chegaram
+};
+
+static Deduplicacao deduplicacao;
+
+static Estatisticas estatisticas;
+static std::atomic<bool> executando{true};
+static ConfigServidor configuracao;
+
+// REQUISICAO HTTP
+
+struct Requisicao
+{
+    std::string metodo;
+    std::string caminho;
+    std::string tipo_conteudo;
+    std::string corpo;
+};
+
+struct Resposta
+{
+    int codigo;
+    std::string corpo;
+    uint32_t registros;
+};
+
+static std::string valorCabecalho(const std::string &cabecalhos, const char *nome)
+{
+    std::string chave = std::string("\r\n") + nome + ":";
+    std::string minusculo = cabecalhos;
+    std::transform(minusculo.begin(), minusculo.end(), minusculo.begin(), ::tolower);
+    size_t p = minusculo.find(chave);
+    if (p == std::string::npos)
+        return "";
+
+    p += chave.size();
+    size_t fim = cabecalhos.find("\r\n", p);
+    std::string valor = cabecalhos.substr(p, fim - p);
+    valor.erase(0, valor.find_first_not_of(' '));
+    return valor;
+}
+
+static bool lerRequisicao(int fd, Requisicao &req)
+{
+    std::string bruto;
+    char buffer[8192];
+    size_t fim_cabecalhos = std::string::npos;
+
+    while (fim_cabecalhos == std::string::npos)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        bruto.append(buffer, n);
+        fim_cabecalhos = bruto.find("\r\n\r\n");
+    }
+
+    std::string cabecalhos = "\r\n" + bruto.substr(0, fim_cabecalhos + 2);
+    char metodo[16] = {0}, caminho[1024] = {0};
+    sscanf(bruto.c_str(), "%15s %1023s", metodo, caminho);
+    req.metodo = metodo;
+    req.caminho = caminho;
+    req.tipo_conteudo = valorCabecalho(cabecalhos, "content-type");
+
+    size_t tamanho = strtoul(valorCabecalho(cabecalhos, "content-length").c_str(), NULL, 10);
+    req.corpo = bruto.substr(fim_cabecalhos + 4);
+    while (req.corpo.size() < tamanho)
+    {
+        ssize_t n = recv(fd, buffer, std::min(sizeof(buffer), tamanho - req.corpo.size()), 0);
+        if (n <= 0)
+            return false;
+        req.corpo.append(buffer, n);
+    }
+    return true;
+}
+
+static void enviarResposta(int fd, const Resposta &resp)
+{
+    const char *texto = resp.codigo == 200 ? "OK" : (resp.codigo == 503 ? "Service Unavailable" : "Bad Request");
+    std::string saida = "HTTP/1.1 " + std::to_string(resp.codigo) + " " + texto + "\r\n";
+    saida += "Content-Type: text/plain\r\nConnection: close\r\n";
+    saida += "Content-Length: " + std::to_string(resp.corpo.size()) + "\r\n\r\n" + resp.corpo;
+    send(fd, saida.data(), saida.size(), MSG_NOSIGNAL);
+}
+
+// TRATADORES DE FORMATO
+
+/*
+ * campo numerico de um objeto json plano ("chave": valor); false se ausente
+ */
+static bool campoNumerico(const std::string &corpo, size_t de, const char *chave, long &valor)
+{
+    std::string procurado = std::string("\"") + chave + "\": ";
+    size_t p = corpo.find(procurado, de);
+    if (p == std::string::npos)
+        return false;
+    valor = strtol(corpo.c_str() + p + procurado.size(), NULL, 10);
+    return true;
+}
+
+static void contabilizarTelemetria(const std::string &corpo)
+{
+    size_t bloco = corpo.find("\"telemetria\": {");
+    if (bloco == std::string::npos)
+        return;
+
+    long fragmentacao = 0, heap_minimo = 0, rssi = 0, resets = 0, falhas = 0;
+    campoNumerico(corpo, bloco, "frag_pct", fragmentacao);
+    campoNumerico(corpo, bloco, "heap_min", heap_minimo);
+    campoNumerico(corpo, bloco, "rssi_min", rssi);
+    campoNumerico(corpo, bloco, "resets_anormais", resets);
+    campoNumerico(corpo, bloco, "falhas_upload_seguidas", falhas);
+
+    std::lock_guard<std::mutex> trava(saude_frota.trava);
+    saude_frota.relatos++;
+    saude_frota.soma_fragmentacao += fragmentacao;
+    saude_frota.fragmentacao_maxima = std::max(saude_frota.fragmentacao_maxima, fragmentacao);
+    if (saude_frota.heap_minimo < 0 || heap_minimo < saude_frota.heap_minimo)
+        saude_frota.heap_minimo = heap_minimo;
+    if (rssi < saude_frota.rssi_minimo)
+        saude_frota.rssi_minimo = rssi;
+    saude_frota.sinal_fraco += rssi != 0 && rssi < LIMIAR_RSSI_FRACO;
+    saude_frota.com_reset_anormal += resets > 0;
+    saude_frota.com_falhas_upload += falhas > 0;
+}
+
+/*
+ * campo texto de um objeto json plano ("chave": "valor"); vazio se ausente
+ */
+static std::string campoTexto(const std::string &corpo, const char *chave)
+{
+    std::string procurado = std::string("\"") + chave + "\": \"";
+    size_t p = corpo.find(procurado);
+    if (p == std::string::npos)
+        return "";
+    p += procurado.size();
+    size_t fim = corpo.find('"', p);
+    return fim == std::string::npos ? "" : corpo.substr(p, fim - p);
+}
+
+/*
+ * grava so os registros com seq acima do ja confirmado para o dispositivo
+ * retorna os registros aceitos; confirmada recebe o novo maior seq
+ */
+static uint32_t gravarLote(const std::string &corpo, size_t inicio, size_t fim, uint32_t &confirmada)
+{
+    std::string dispositivo = campoTexto(corpo, "dispositivo") + "/" + campoTexto(corpo, "faixa");
+    std::string chave = campoTexto(corpo, "chave");
+
+    std::lock_guard<std::mutex> trava(deduplicacao.trava);
+    if (!deduplicacao.chaves.insert(chave).second)
+        deduplicacao.lotes_repetidos++;
+
+    // primeiro contato: a numeracao do dispositivo comeca no lote
+    auto estado = deduplicacao.dispositivos.find(dispositivo);
+    bool conhecido = estado != deduplicacao.dispositivos.end();
+    EstadoDispositivo &atual = deduplicacao.dispositivos[dispositivo];
+
+    uint32_t aceitos = 0;
+    for (size_t p = inicio; p < fim;)
+    {
+        size_t proximo = corpo.find(';', p);
+        if (proximo == std::string::npos || proximo > fim)
+            proximo = fim;
+        uint32_t seq = strtoul(corpo.c_str() + p, NULL, 10);
+        p = proximo + 1;
+        if (seq == 0)
+            continue; // linha sem seq
+
+        if (!conhecido)
+        {
+            atual.confirmada = seq - 1;
+            conhecido = true;
+        }
+        if (seq <= atual.confirmada)
+        {
+            deduplicacao.duplicados++;
+            continue;
+        }
+        deduplicacao.lacunas += seq - atual.confirmada - 1;
+        atual.confirmada = seq;
+        aceitos++;
+    }
+    confirmada = atual.confirmada;
+    return aceitos;
+}
+
+/*
+ * formato atual: {"dados": "<linha csv>;<linha csv>;...", ...metadados}
+ */
+static Resposta tratarJSON(const Requisicao &req)
+{
+    const std::string chave = "\"dados\": \"";
+    size_t inicio = req.corpo.find(chave);
+    if (inicio == std::string::npos)
+        return {400, "sem campo dados", 0};
+
+    inicio += chave.size();
+    size_t fim = req.corpo.find('"', inicio);
+    if (fim == std::string::npos)
+        return {400, "json truncado", 0};
+
+    Resposta resp = {200, "ok", 0};
+    if (req.corpo.find("\"lote\": {") != std::string::npos && fim > inicio)
+    {
+        uint32_t confirmada;
+        resp.registros = gravarLote(req.corpo, inicio, fim, confirmada);
+        resp.corpo += "\nack;seq=" + std::to_string(confirmada);
+    }
+    else
+    {
+        resp.registros = fim > inicio ? 1 : 0;
+        for (size_t i = inicio; i < fim; i++)
+            if (req.corpo[i] == ';')
+                resp.registros++;
+    }
+    contabilizarTelemetria(req.corpo);
+
+    // delta de config so para quem esta em versao anterior
+    if (configuracao.versao_config > 0)
+    {
+        const std::string chave_versao = "\"config_versao\": ";
+        size_t p = req.corpo.find(chave_versao);
+        uint32_t versao = p == std::string::npos ? 0 : strtoul(req.corpo.c_str() + p + chave_versao.size(), NULL, 10);
+        if (p != std::string::npos && versao < configuracao.versao_config)
+        {
+            resp.corpo += "\ncfg;" + configuracao.config;
+            estatisticas.configs_enviadas++;
+        }
+    }
+
+    return resp;
+}
+
+/*
+ * csv cru: uma linha por registro, cabecalho opcional
+ */
+static Resposta tratarCSV(const Requisicao &req)
+{
+    uint32_t registros = 0;
+    size_t p = 0;
+    while (p < req.corpo.size())
+    {
+        size_t fim = req.corpo.find('\n', p);
+        if (fim == std::string::npos)
+            fim = req.corpo.size();
+        if (fim > p && isdigit((unsigned char)req.corpo[p]))
+            registros++;
+        p = fim + 1;
+    }
+    return {200, "ok", registros};
+}
+
+/*
+ * formatos binarios/comprimidos: aceitos e contabilizados em bytes;
+ * a decodificacao entra aqui quando o formato for definido no firmware
+ */
+static Resposta tratarBinario(const Requisicao &req)
+{
+    if (req.corpo.empty())
+        return {400, "payload vazio", 0};
+    return {200, "ok", 0};
+}
+
+struct Tratador
+{
+    const char *tipo_conteudo;
+    Resposta (*tratar)(const Requisicao &req);
+};
+
+static const Tratador tratadores[] = {
+    {"application/json", tratarJSON},
+    {"text/csv", tratarCSV},
+    {"application/octet-stream", tratarBinario},
+};
+
+static Resposta despachar(const Requisicao &req)
+{
+    if (req.metodo != "POST")
+        return {400, "apenas POST", 0};
+
+    for (const Tratador &tratador : tratadores)
+        if (req.tipo_conteudo.compare(0, strlen(tratador.tipo_conteudo), tratador.tipo_conteudo) == 0)
+            return tratador.tratar(req);
+
+    return {400, "content-type desconhecido", 0};
+}
+
+// LACO DOS TRABALHADORES
+
+static void trabalhador(int servidor, const ConfigServidor &config, uint32_t semente)
+{
+    std::mt19937 aleatorio(semente);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+
+    while (executando)
+    {
+        int cliente = accept(servidor, NULL, NULL);
+        if (cliente < 0)
+            continue;
+
+        // o socket aceito herda o timeout curto do accept
+        struct timeval limite = {5, 0};
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+
+        auto inicio = std::chrono::steady_clock::now();
+        Requisicao req;
+        if (!lerRequisicao(cliente, req))
+        {
+            close(cliente);
+            continue;
+        }
+
+        int espera = config.latencia_ms + (config.jitter_ms ? (int)(uniforme(aleatorio) * config.jitter_ms) : 0);
+        if (espera > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(espera));
+
+        Resposta resp;
+        if (uniforme(aleatorio) < config.prob_erro)
+        {
+            resp = {503, "erro injetado", 0};
+            estatisticas.erros_injetados++;
+        }
+        else
+        {
+            resp = despachar(req);
+            if (resp.codigo == 200)
+            {
+                estatisticas.registros += resp.registros;
+                estatisticas.bytes += req.corpo.size();
+            }
+            else
+            {
+                estatisticas.rejeitadas++;
+            }
+        }
+
+        // gravado, mas a resposta nunca chega ao dispositivo
+        if (resp.codigo == 200 && uniforme(aleatorio) < config.prob_perder_ack)
+            estatisticas.acks_perdidos++;
+        else
+            enviarResposta(cliente, resp);
+        close(cliente);
+
+        uint32_t latencia_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - inicio)
+                                   .count();
+        int64_t agora_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        int64_t zero = 0;
+        estatisticas.primeira_us.compare_exchange_strong(zero, agora_us - latencia_us);
+        estatisticas.ultima_us = agora_us;
+
+        estatisticas.requisicoes++;
+        std::lock_guard<std::mutex> trava(estatisticas.trava_latencias);
+        estatisticas.latencias_us.push_back(latencia_us);
+    }
+}
+
+static uint32_t percentil(std::vector<uint32_t> &valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+static void imprimirRelatorio()
+{
+    double segundos = (estatisticas.ultima_us - estatisticas.primeira_us) / 1000000.0;
+    std::vector<uint32_t> latencias;
+    {
+        std::lock_guard<std::mutex> trava(estatisticas.trava_latencias);
+        latencias = estatisticas.latencias_us;
+    }
+
+    printf("\n[servidor] relatorio\n");
+    printf("  requisicoes: %llu\n", (unsigned long long)estatisticas.requisicoes.load());
+    printf("  erros 5xx injetados: %llu\n", (unsigned long long)estatisticas.erros_injetados.load());
+    printf("  rejeitadas (4xx): %llu\n", (unsigned long long)estatisticas.rejeitadas.load());
+    printf("  registros aceitos: %llu\n", (unsigned long long)estatisticas.registros.load());
+    printf("  bytes aceitos: %llu\n", (unsigned long long)estatisticas.bytes.load());
+    printf("  deltas de config enviados: %llu\n", (unsigned long long)estatisticas.configs_enviadas.load());
+    printf("  acks perdidos (injetados): %llu\n", (unsigned long long)estatisticas.acks_perdidos.load());
+    {
+        std::lock_guard<std::mutex> trava(deduplicacao.trava);
+        if (!deduplicacao.dispositivos.empty())
+        {
+            printf("  faixas de dispositivos com seq: %zu\n", deduplicacao.dispositivos.size());
+            printf("  registros duplicados descartados: %llu (lotes repetidos: %llu)\n",
+                   (unsigned long long)deduplicacao.duplicados, (unsigned long long)deduplicacao.lotes_repetidos);
+            printf("  lacunas de seq (registros perdidos): %llu\n", (unsigned long long)deduplicacao.lacunas);
+        }
+    }
+    printf("  vazao: %.1f registros/s\n", segundos > 0 ? estatisticas.registros / segundos : 0.0);
+    printf("  latencia p50: %.2f ms\n", percentil(latencias, 0.50) / 1000.0);
+    printf("  latencia p99: %.2f ms\n", percentil(latencias, 0.99) / 1000.0);
+
+    std::lock_guard<std::mutex> trava(saude_frota.trava);
+    if (saude_frota.relatos > 0)
+    {
+        printf("\n[servidor] saude da frota (%llu relatos de telemetria)\n", (unsigned long long)saude_frota.relatos);
+        printf("  fragmentacao do heap: media %.1f%%, maxima %ld%%\n",
+               (double)saude_frota.soma_fragmentacao / saude_frota.relatos, saude_frota.fragmentacao_maxima);
+        printf("  menor heap livre: %ld bytes\n", saude_frota.heap_minimo);
+        printf("  pior rssi: %ld dBm (%llu relatos abaixo de %ld dBm)\n", saude_frota.rssi_minimo,
+               (unsigned long long)saude_frota.sinal_fraco, LIMIAR_RSSI_FRACO);
+        printf("  com resets anormais: %llu\n", (unsigned long long)saude_frota.com_reset_anormal);
+        printf("  com falhas de upload seguidas: %llu\n", (unsigned long long)saude_frota.com_falhas_upload);
+    }
+    fflush(stdout);
+}
+
+static void aoSinal(int)
+{
+    executando = false;
+}
+
+int main(int argc, char **argv)
+{
+    ConfigServidor &config = configuracao;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--porta")
+            config.porta = atoi(argv[i + 1]);
+        else if (opcao == "--trabalhadores")
+            config.trabalhadores = atoi(argv[i + 1]);
+        else if (opcao == "--erro-5xx")
+            config.prob_erro = atof(argv[i + 1]);
+        else if (opcao == "--latencia-ms")
+            config.latencia_ms = atoi(argv[i + 1]);
+        else if (opcao == "--jitter-ms")
+            config.jitter_ms = atoi(argv[i + 1]);
+        else if (opcao == "--perder-ack")
+            config.prob_perder_ack = atof(argv[i + 1]);
+        else if (opcao == "--duracao-s")
+            config.duracao_s = atoi(argv[i + 1]);
+        else if (opcao == "--config")
+        {
+            config.config = argv[i + 1];
+            if (config.config.compare(0, 2, "v=") != 0 || (config.versao_config = atoi(argv[i + 1] + 2)) == 0)
+            {
+                fprintf(stderr, "--config deve comecar com v=<versao maior que 0>\n");
+                return 2;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+
+    int servidor = socket(AF_INET, SOCK_STREAM, 0);
+    int um = 1;
+    setsockopt(servidor, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+
+    // accept com timeout para os trabalhadores perceberem o fim
+    struct timeval limite = {0, 200000};
+    setsockopt(servidor, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+
+    struct sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+    endereco.sin_port = htons(config.porta);
+    if (bind(servidor, (struct sockaddr *)&endereco, sizeof(endereco)) != 0 || listen(servidor, 4096) != 0)
+    {
+        perror("bind/listen");
+        return 1;
+    }
+
+    signal(SIGINT, aoSinal);
+    signal(SIGTERM, aoSinal);
+
+    printf("[servidor] escutando na porta %d (%d trabalhadores, erro %.2f, ack perdido %.2f, latencia %d+%d ms)\n",
+           config.porta, config.trabalhadores, config.prob_erro, config.prob_perder_ack, config.latencia_ms,
+           config.jitter_ms);
+    fflush(stdout);
+
+    auto inicio = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.trabalhadores; i++)
+        threads.emplace_back(trabalhador, servidor, std::cref(config), 1234 + i);
+
+    while (executando)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (config.duracao_s > 0 && std::chrono::steady_clock::now() - inicio >= std::chrono::seconds(config.duracao_s))
+            executando = false;
+    }
+
+    for (std::thread &t : threads)
+        t.join();
+    close(servidor);
+
+    imprimirRelatorio();
+    return 0;
+}
@@ -0,0 +1,448 @@
+/*
+ *  [i] servidor TLS local (host): termina o https e repassa ao servidor_ingestao
+ *
+ *  faz o papel do balanceador com certificado na frente da ingestao. gera
+ *  uma CA e um certificado ECDSA P-256 para "localhost" (ou reaproveita os
+ *  de --dir), grava ca.pem e imprime o sha256 da chave publica para fixar
+ *  no firmware. TLS 1.2, como o mbedTLS 2.x do esp32, com retomada por
+ *  ticket (RFC 5077) ou por id de sessao.
+ *
+ *  uso: servidor_tls [--porta 8443] [--destino 127.0.0.1:8080] [--dir tls_servidor]
+ *                    [--retomada ticket|id|nenhuma] [--rtt-ms 0] [--trabalhadores 8]
+ *
+ *  --rtt-ms atrasa cada voo do servidor em uma ida e volta: o handshake
+ *  completo paga as duas que paga na WAN, o retomado so uma.
+ *  reiniciar o servidor troca a chave dos tickets (sessoes antigas viram
+ *  handshake completo), mas mantem a CA e a chave do --dir.
+ *
+ *  o relatorio separa handshakes completos e retomados, com os bytes de
+ *  cada, vistos do lado do servidor.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+// CONFIGURACAO
+
+struct ConfigTLS
+{
+    int porta = 8443;
+    std::string destino_host = "127.0.0.1";
+    std::string destino_porta = "8080";
+    std::string dir = "tls_servidor";
+    std::string retomada = "ticket";
+    int rtt_ms = 0;
+    int trabalhadores = 8;
+};
+
+const long VALIDADE_SESSAO_S = 86400; // como VALIDADE_SESSAO_TLS_S do firmware
+
+// ESTATISTICAS
+
+struct EstatisticasTLS
+{
+    std::atomic<uint64_t> completos{0};
+    std::atomic<uint64_t> retomados{0};
+    std::atomic<uint64_t> falhas{0};
+    std::atomic<uint64_t> bytes_completos{0}; // lidos + escritos no handshake
+    std::atomic<uint64_t> bytes_retomados{0};
+    std::atomic<uint64_t> repasses_falhos{0};
+};
+
+static EstatisticasTLS estatisticas;
+static std::atomic<bool> executando{true};
+
+static void aoSinal(int)
+{
+    executando = false;
+}
+
+// CERTIFICADOS
+
+static EVP_PKEY *gerarChave()
+{
+    EVP_PKEY *chave = NULL;
+    EVP_PKEY_CTX *contexto = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    EVP_PKEY_keygen_init(contexto);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(contexto, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(contexto, &chave);
+    EVP_PKEY_CTX_free(contexto);
+    return chave;
+}
+
+static void adicionarExtensao(X509 *certificado, X509V3_CTX *contexto, int nid, const char *valor)
+{
+    X509_EXTENSION *extensao = X509V3_EXT_conf_nid(NULL, contexto, nid, valor);
+    X509_add_ext(certificado, extensao, -1);
+    X509_EXTENSION_free(extensao);
+}
+
+/*
+ * emissor NULL = autoassinado (a CA)
+ */
+static X509 *emitir(EVP_PKEY *chave, const char *nome, X509 *emissor, EVP_PKEY *chave_emissor, long serial)
+{
+    X509 *certificado = X509_new();
+    X509_set_version(certificado, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificado), serial);
+    X509_gmtime_adj(X509_getm_notBefore(certificado), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(certificado), 365L * 86400);
+    X509_set_pubkey(certificado, chave);
+
+    X509_NAME *sujeito = X509_get_subject_name(certificado);
+    X509_NAME_add_entry_by_txt(sujeito, "CN", MBSTRING_ASC, (const unsigned char *)nome, -1, -1, 0);
+    X509_set_issuer_name(certificado, emissor ? X509_get_subject_name(emissor) : sujeito);
+
+    X509V3_CTX contexto;
+    X509V3_set_ctx(&contexto, emissor ? emissor : certificado, certificado, NULL, NULL, 0);
+    if (!emissor)
+    {
+        adicionarExtensao(certificado, &contexto, NID_basic_constraints, "critical,CA:TRUE");
+        adicionarExtensao(certificado, &contexto, NID_key_usage, "critical,keyCertSign,cRLSign");
+    }
+    else
+    {
+        adicionarExtensao(certificado, &contexto, NID_basic_constraints, "CA:FALSE");
+        adicionarExtensao(certificado, &contexto, NID_subject_alt_name, "DNS:localhost");
+    }
+    X509_sign(certificado, chave_emissor, EVP_sha256());
+    return certificado;
+}
+
+static bool gravarPEM(const std::string &caminho, X509 *certificado, EVP_PKEY *chave)
+{
+    FILE *arquivo = fopen(caminho.c_str(), "w");
+    if (!arquivo)
+        return false;
+    bool ok = certificado ? PEM_write_X509(arquivo, certificado) : PEM_write_PrivateKey(arquivo, chave, NULL, NULL, 0, NULL, NULL);
+    fclose(arquivo);
+    return ok;
+}
+
+/*
+ * reaproveita servidor.pem/servidor.key do diretorio ou gera CA + servidor
+ */
+static bool carregarCertificados(const std::string &dir, X509 *&certificado, EVP_PKEY *&chave)
+{
+    FILE *arquivo_certificado = fopen((dir + "/servidor.pem").c_str(), "r");
+    FILE *arquivo_chave = fopen((dir + "/servidor.key").c_str(), "r");
+    if (arquivo_certificado && arquivo_chave)
+    {
+        certificado = PEM_read_X509(arquivo_certificado, NULL, NULL, NULL);
+        chave = PEM_read_PrivateKey(arquivo_chave, NULL, NULL, NULL);
+    }
+    if (arquivo_certificado)
+        fclose(arquivo_certificado);
+    if (arquivo_chave)
+        fclose(arquivo_chave);
+    if (certificado && chave)
+    {
+        printf("[tls] certificados de %s/\n", dir.c_str());
+        return true;
+    }
+
+    mkdir(dir.c_str(), 0755);
+    EVP_PKEY *chave_ca = gerarChave();
+    X509 *ca = emitir(chave_ca, "datalogger CA de teste", NULL, chave_ca, 1);
+    chave = gerarChave();
+    certificado = emitir(chave, "localhost", ca, chave_ca, 2);
+    bool ok = gravarPEM(dir + "/ca.pem", ca, NULL) && gravarPEM(dir + "/servidor.pem", certificado, NULL) &&
+              gravarPEM(dir + "/servidor.key", NULL, chave);
+    X509_free(ca);
+    EVP_PKEY_free(chave_ca);
+    if (ok)
+        printf("[tls] CA e certificado novos em %s/ (ca.pem para o firmware)\n", dir.c_str());
+    return ok;
+}
+
+/*
+ * sha256 da SubjectPublicKeyInfo, o valor de SERVIDOR_CHAVE_SHA256
+ */
+static std::string chaveSHA256(EVP_PKEY *chave)
+{
+    unsigned char *der = NULL;
+    int tamanho = i2d_PUBKEY(chave, &der);
+    unsigned char hash[32];
+    SHA256(der, tamanho, hash);
+    OPENSSL_free(der);
+
+    char hexa[65];
+    for (int i = 0; i < 32; i++)
+        sprintf(hexa + 2 * i, "%02x", hash[i]);
+    return hexa;
+}
+
+// ATRASO POR VOO
+
+/*
+ * o primeiro write depois de um read e o inicio de um voo do servidor:
+ * espera uma ida e volta antes dele
+ */
+struct EstadoVoo
+{
+    int rtt_ms;
+    bool leu;
+};
+
+static long aoUsarSocket(BIO *bio, int operacao, const char *, size_t, int, long, int ret, size_t *)
+{
+    EstadoVoo *voo = (EstadoVoo *)BIO_get_callback_arg(bio);
+    if (operacao == (BIO_CB_READ | BIO_CB_RETURN) && ret > 0)
+        voo->leu = true;
+    else if (operacao == BIO_CB_WRITE && voo->leu)
+    {
+        voo->leu = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(voo->rtt_ms));
+    }
+    return operacao & BIO_CB_RETURN ? ret : 1;
+}
+
+// REPASSE
+
+/*
+ * le uma requisicao http inteira (cabecalhos + content-length) do tls
+ */
+static bool lerRequisicao(SSL *ssl, std::string &requisicao)
+{
+    char buffer[8192];
+    size_t fim_cabecalhos = std::string::npos;
+    while (fim_cabecalhos == std::string::npos)
+    {
+        int n = SSL_read(ssl, buffer, sizeof(buffer));
+        if (n <= 0)
+            return false;
+        requisicao.append(buffer, n);
+        fim_cabecalhos = requisicao.find("\r\n\r\n");
+    }
+
+    std::string cabecalhos = requisicao.substr(0, fim_cabecalhos);
+    for (char &c : cabecalhos)
+        c = tolower(c);
+    size_t campo = cabecalhos.find("content-length:");
+    size_t tamanho = campo == std::string::npos ? 0 : strtoul(cabecalhos.c_str() + campo + 15, NULL, 10);
+    while (requisicao.size() < fim_cabecalhos + 4 + tamanho)
+    {
+        int n = SSL_read(ssl, buffer, sizeof(buffer));
+        if (n <= 0)
+            return false;
+        requisicao.append(buffer, n);
+    }
+    return true;
+}
+
+/*
+ * envia ao servidor de ingestao e le a resposta ate ele fechar
+ */
+static bool repassar(const ConfigTLS &config, const std::string &requisicao, std::string &resposta)
+{
+    struct addrinfo dicas = {};
+    struct addrinfo *enderecos = NULL;
+    dicas.ai_family = AF_INET;
+    dicas.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(config.destino_host.c_str(), config.destino_porta.c_str(), &dicas, &enderecos) != 0)
+        return false;
+    int fd = socket(enderecos->ai_family, enderecos->ai_socktype, enderecos->ai_protocol);
+    bool conectado = fd >= 0 && connect(fd, enderecos->ai_addr, enderecos->ai_addrlen) == 0;
+    freeaddrinfo(enderecos);
+    if (!conectado)
+    {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    bool enviado = send(fd, requisicao.data(), requisicao.size(), MSG_NOSIGNAL) == (ssize_t)requisicao.size();
+    char buffer[8192];
+    ssize_t n;
+    while (enviado && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        resposta.append(buffer, n);
+    close(fd);
+    return enviado && !resposta.empty();
+}
+
+// LACO DOS TRABALHADORES
+
+static void trabalhador(int servidor, SSL_CTX *contexto, const ConfigTLS &config)
+{
+    while (executando)
+    {
+        int cliente = accept(servidor, NULL, NULL);
+        if (cliente < 0)
+            continue;
+
+        struct timeval limite = {5, 0};
+        setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+        int um = 1;
+        setsockopt(cliente, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+
+        EstadoVoo voo = {config.rtt_ms, false};
+        BIO *bio = BIO_new_socket(cliente, BIO_CLOSE);
+        if (config.rtt_ms > 0)
+        {
+            BIO_set_callback_ex(bio, aoUsarSocket);
+            BIO_set_callback_arg(bio, (char *)&voo);
+        }
+        SSL *ssl = SSL_new(contexto);
+        SSL_set_bio(ssl, bio, bio);
+
+        if (SSL_accept(ssl) != 1)
+        {
+            estatisticas.falhas++;
+            ERR_clear_error();
+            SSL_free(ssl);
+            continue;
+        }
+
+        uint64_t bytes = BIO_number_read(bio) + BIO_number_written(bio);
+        if (SSL_session_reused(ssl))
+        {
+            estatisticas.retomados++;
+            estatisticas.bytes_retomados += bytes;
+        }
+        else
+        {
+            estatisticas.completos++;
+            estatisticas.bytes_completos += bytes;
+        }
+
+        std::string requisicao, resposta;
+        if (lerRequisicao(ssl, requisicao))
+        {
+            if (!repassar(config, requisicao, resposta))
+            {
+                estatisticas.repasses_falhos++;
+                resposta = "HTTP/1.1 502 Bad Gateway\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+            }
+            SSL_write(ssl, resposta.data(), resposta.size());
+        }
+        SSL_shutdown(ssl);
+        ERR_clear_error();
+        SSL_free(ssl);
+    }
+}
+
+static void imprimirRelatorio()
+{
+    uint64_t completos = estatisticas.completos, retomados = estatisticas.retomados;
+    printf("\n[tls] relatorio\n");
+    printf("  handshakes completos: %llu (%.0f bytes em media)\n", (unsigned long long)completos,
+           completos ? (double)estatisticas.bytes_completos / completos : 0.0);
+    printf("  handshakes retomados: %llu (%.0f bytes em media)\n", (unsigned long long)retomados,
+           retomados ? (double)estatisticas.bytes_retomados / retomados : 0.0);
+    printf("  handshakes falhos: %llu\n", (unsigned long long)estatisticas.falhas.load());
+    printf("  repasses falhos (ingestao fora do ar): %llu\n", (unsigned long long)estatisticas.repasses_falhos.load());
+}
+
+int main(int argc, char **argv)
+{
+    ConfigTLS config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--porta")
+            config.porta = atoi(argv[i + 1]);
+        else if (opcao == "--destino")
+        {
+            std::string destino = argv[i + 1];
+            size_t dois_pontos = destino.find(':');
+            config.destino_host = destino.substr(0, dois_pontos);
+            if (dois_pontos != std::string::npos)
+                config.destino_porta = destino.substr(dois_pontos + 1);
+        }
+        else if (opcao == "--dir")
+            config.dir = argv[i + 1];
+        else if (opcao == "--retomada")
+            config.retomada = argv[i + 1];
+        else if (opcao == "--rtt-ms")
+            config.rtt_ms = atoi(argv[i + 1]);
+        else if (opcao == "--trabalhadores")
+            config.trabalhadores = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (config.retomada != "ticket" && config.retomada != "id" && config.retomada != "nenhuma")
+    {
+        fprintf(stderr, "--retomada deve ser ticket, id ou nenhuma\n");
+        return 2;
+    }
+
+    X509 *certificado = NULL;
+    EVP_PKEY *chave = NULL;
+    if (!carregarCertificados(config.dir, certificado, chave))
+    {
+        fprintf(stderr, "nao foi possivel gravar os certificados em %s\n", config.dir.c_str());
+        return 1;
+    }
+
+    SSL_CTX *contexto = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_set_min_proto_version(contexto, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(contexto, TLS1_2_VERSION);
+    SSL_CTX_use_certificate(contexto, certificado);
+    SSL_CTX_use_PrivateKey(contexto, chave);
+    SSL_CTX_set_session_id_context(contexto, (const unsigned char *)"datalogger", 10);
+    SSL_CTX_set_timeout(contexto, VALIDADE_SESSAO_S);
+    if (config.retomada != "ticket")
+        SSL_CTX_set_options(contexto, SSL_OP_NO_TICKET);
+    if (config.retomada == "nenhuma")
+        SSL_CTX_set_session_cache_mode(contexto, SSL_SESS_CACHE_OFF);
+
+    int servidor = socket(AF_INET, SOCK_STREAM, 0);
+    int um = 1;
+    setsockopt(servidor, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+    struct timeval limite = {0, 200000};
+    setsockopt(servidor, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+
+    struct sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+    endereco.sin_port = htons(config.porta);
+    if (bind(servidor, (struct sockaddr *)&endereco, sizeof(endereco)) != 0 || listen(servidor, 1024) != 0)
+    {
+        perror("bind/listen");
+        return 1;
+    }
+
+    signal(SIGINT, aoSinal);
+    signal(SIGTERM, aoSinal);
+
+    printf("[tls] escutando na porta %d -> %s:%s (retomada: %s, rtt %d ms)\n", config.porta,
+           config.destino_host.c_str(), config.destino_porta.c_str(), config.retomada.c_str(), config.rtt_ms);
+    printf("[tls] SERVIDOR_CHAVE_SHA256 = \"%s\"\n", chaveSHA256(chave).c_str());
+    fflush(stdout);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.trabalhadores; i++)
+        threads.emplace_back(trabalhador, servidor, contexto, std::cref(config));
+    for (std::thread &t : threads)
+        t.join();
+    close(servidor);
+
+    imprimirRelatorio();
+    SSL_CTX_free(contexto);
+    X509_free(certificado);
+    EVP_PKEY_free(chave);
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ *  [i] deriva do RTC x trafego NTP (build nativo)
+ *
+ *  simula `dias` de leituras a cada `periodo-s` sobre um RTC com deriva
+ *  (`--deriva-ppm`, mais uma oscilacao diaria de `--variacao-ppm` como a
+ *  temperatura faz) e um NTP que falha com probabilidade `--falha-ntp`.
+ *  tres politicas de relogio no mesmo calendario:
+ *
+ *    ntp por boot   a anterior: NTP em todo despertar; se falha, o epoch
+ *                   volta para EPOCH_FALLBACK e segue dali
+ *    so limite      sync quando a incerteza passa do limite, sem corrigir
+ *                   a deriva (o limite cresce a DERIVA_MAXIMA_PPM)
+ *    atual          a regra do GerenciadorTempo: sync pelo limite, deriva
+ *                   medida entre syncs (media movel) e descontada
+ *
+ *  as contas de estimarEpoch/precisaSincronizar/sincronizar repetem as do
+ *  gerenciador_time.h sobre um relogio virtual (o do gerenciador e o do
+ *  sistema, que no host corre em tempo real).
+ *
+ *  relata o erro do timestamp contra o tempo real (p50/p99/max), leituras
+ *  sem tempo conhecido, leituras com erro acima da incerteza declarada,
+ *  timestamps fora de ordem e o trafego NTP (tentativas por dia e segundos
+ *  de radio gastos nelas: `--ntp-ms` num sync bem-sucedido, 20 x 500 ms
+ *  numa falha).
+ *
+ *  uso: simulador_deriva [--dias 30] [--periodo-s 300] [--deriva-ppm 150]
+ *                        [--variacao-ppm 10] [--erro-ntp-ms 5]
+ *                        [--falha-ntp 0.1] [--ntp-ms 300]
+ *                        [--limite-ms 2000] [--semente 1]
+ *
+ *  sai com 1 se a politica atual declarar uma incerteza menor que o erro
+ *  real em alguma leitura.
+ */
+
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+const double ESPERA_FALHA_NTP_S = 20 * 0.5; // 20 tentativas de 500 ms no sincronizarNTP
+
+// POLITICAS
+
+enum Politica
+{
+    NTP_POR_BOOT,
+    SO_LIMITE,
+    ATUAL
+};
+
+/*
+ * relogio do sistema (livre, mantido pelo RTC) + EstadoRelogio
+ */
+struct RelogioVirtual
+{
+    Politica politica;
+    int64_t livre_us = (int64_t)EPOCH_FALLBACK * 1000000; // cold boot: parte do fallback
+    int64_t us_sincronizacao = 0;
+    double deriva_ppm = 0.0;
+    bool deriva_medida = false;
+    uint32_t sincronizacoes = 0;
+
+    bool valido() const
+    {
+        return sincronizacoes > 0;
+    }
+
+    // GerenciadorTempo::calcularIncerteza
+    uint32_t incerteza() const
+    {
+        if (!valido())
+            return 0xFFFFFFFF;
+        double ppm = deriva_medida ? DERIVA_RESIDUAL_PPM : DERIVA_MAXIMA_PPM;
+        int64_t decorrido_us = livre_us - us_sincronizacao;
+        return INCERTEZA_NTP_MS + (uint32_t)(decorrido_us / 1000 * ppm / 1000000.0);
+    }
+
+    // GerenciadorTempo::corrigirDeriva
+    int64_t epochUs() const
+    {
+        if (!valido())
+            return livre_us;
+        int64_t decorrido_us = livre_us - us_sincronizacao;
+        return us_sincronizacao + decorrido_us - (int64_t)(decorrido_us * (deriva_ppm / 1000000.0));
+    }
+
+    // GerenciadorTempo::precisaSincronizar
+    bool precisaSincronizar(uint32_t limite_ms) const
+    {
+        if (politica == NTP_POR_BOOT)
+            return true;
+        return !valido() || incerteza() > limite_ms;
+    }
+
+    // sincronizarSeNecessario + medirDeriva; o SNTP ajusta o relogio do sistema
+    void sincronizar(int64_t ntp_us)
+    {
+        int64_t intervalo_us = livre_us - us_sincronizacao;
+        if (politica == ATUAL && valido() && intervalo_us >= INTERVALO_MINIMO_DERIVA_MS * 1000LL)
+        {
+            double nova = (double)(livre_us - ntp_us) / intervalo_us * 1000000.0;
+            deriva_ppm = deriva_medida ? 0.5 * deriva_ppm + 0.5 * nova : nova;
+            deriva_medida = true;
+        }
+        livre_us = ntp_us;
+        us_sincronizacao = ntp_us;
+        sincronizacoes++;
+    }
+
+    // antes: NTP falhou, o epoch volta para o fallback
+    void falhar()
+    {
+        if (politica == NTP_POR_BOOT)
+        {
+            livre_us = (int64_t)EPOCH_FALLBACK * 1000000;
+            sincronizacoes = 0;
+        }
+    }
+};
+
+// SIMULACAO
+
+struct Cenario
+{
+    uint32_t dias;
+    uint32_t periodo_s;
+    double deriva_ppm;
+    double variacao_ppm;
+    double erro_ntp_ms;
+    double falha_ntp;
+    uint32_t ntp_ms;
+    uint32_t limite_ms;
+    uint32_t semente;
+};
+
+struct Resultado
+{
+    std::vector<uint32_t> erro_us; // leituras com tempo conhecido
+    uint32_t leituras = 0;
+    uint32_t desconhecidas = 0;
+    uint32_t acima_incerteza = 0;
+    uint32_t fora_de_ordem = 0;
+    uint32_t tentativas = 0;
+    uint32_t syncs = 0;
+    double segundos_ntp = 0.0;
+};
+
+static Resultado simular(const Cenario &c, Politica politica)
+{
+    // mesma semente: as tres politicas veem as mesmas falhas e erros do NTP
+    std::mt19937_64 aleatorio(c.semente);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    Resultado r;
+    RelogioVirtual relogio;
+    relogio.politica = politica;
+
+    const double dia_s = 86400.0;
+    double real_s = 1700000000.0; // tempo real do primeiro despertar
+    int64_t anterior_us = INT64_MIN;
+    uint32_t leituras = (uint32_t)(c.dias * dia_s / c.periodo_s);
+
+    for (uint32_t i = 0; i < leituras; i++)
+    {
+        // NTP roda antes da leitura so na politica antiga (iniciar sincronizava)
+        bool ntp_ok = uniforme(aleatorio) >= c.falha_ntp;
+        double erro_ntp_us = c.erro_ntp_ms * 1000 * normal(aleatorio);
+        if (politica == NTP_POR_BOOT)
+        {
+            r.tentativas++;
+            r.segundos_ntp += ntp_ok ? c.ntp_ms / 1000.0 : ESPERA_FALHA_NTP_S;
+            if (ntp_ok)
+                relogio.sincronizar((int64_t)(real_s * 1e6 + erro_ntp_us));
+            else
+                relogio.falhar();
+        }
+
+        int64_t epoch_us = relogio.epochUs();
+        uint32_t incerteza_ms = relogio.incerteza();
+        r.leituras++;
+        if (!relogio.valido())
+            r.desconhecidas++;
+        else
+        {
+            double erro_us = fabs(epoch_us - real_s * 1e6);
+            r.erro_us.push_back((uint32_t)std::min(erro_us, 4e9));
+            if (erro_us > incerteza_ms * 1000.0)
+                r.acima_incerteza++;
+        }
+        if (epoch_us / 1000000 < anterior_us / 1000000)
+            r.fora_de_ordem++;
+        anterior_us = epoch_us;
+
+        // depois da leitura, com o wifi do upload: sync so se a incerteza exigir
+        if (politica != NTP_POR_BOOT && relogio.precisaSincronizar(c.limite_ms))
+        {
+            r.tentativas++;
+            r.segundos_ntp += ntp_ok ? c.ntp_ms / 1000.0 : ESPERA_FALHA_NTP_S;
+            if (ntp_ok)
+                relogio.sincronizar((int64_t)(real_s * 1e6 + erro_ntp_us));
+        }
+
+        // ate o proximo despertar o RTC conta com a deriva do momento
+        double meio_s = real_s + c.periodo_s / 2.0;
+        double ppm = c.deriva_ppm + c.variacao_ppm * sin(2 * M_PI * meio_s / dia_s);
+        relogio.livre_us += (int64_t)llround(c.periodo_s * 1e6 * (1.0 + ppm / 1e6));
+        real_s += c.periodo_s;
+    }
+
+    r.syncs = relogio.sincronizacoes;
+    return r;
+}
+
+// RELATORIO
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+static void imprimir(const char *nome, const Resultado &r, uint32_t dias)
+{
+    uint32_t pior = r.erro_us.empty() ? 0 : *std::max_element(r.erro_us.begin(), r.erro_us.end());
+    printf("  %-13s %9.1f %9.1f %10.1f %9u %9u %7u %11.1f %9.1f\n", nome, percentil(r.erro_us, 0.50) / 1000.0,
+           percentil(r.erro_us, 0.99) / 1000.0, pior / 1000.0, r.desconhecidas, r.acima_incerteza, r.fora_de_ordem,
+           (double)r.tentativas / dias, r.segundos_ntp / dias);
+}
+
+int main(int argc, char **argv)
+{
+    Cenario c = {30, TEMPO_DEEP_SLEEP_COMPLETO / 1000, 150.0, 10.0, 5.0, 0.1, 300, LIMITE_INCERTEZA_MS, 1};
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--dias")
+            c.dias = atol(argv[i + 1]);
+        else if (opcao == "--periodo-s")
+            c.periodo_s = atol(argv[i + 1]);
+        else if (opcao == "--deriva-ppm")
+            c.deriva_ppm = atof(argv[i + 1]);
+        else if (opcao == "--variacao-ppm")
+            c.variacao_ppm = atof(argv[i + 1]);
+        else if (opcao == "--erro-ntp-ms")
+            c.erro_ntp_ms = atof(argv[i + 1]);
+        else if (opcao == "--falha-ntp")
+            c.falha_ntp = atof(argv[i + 1]);
+        else if (opcao == "--ntp-ms")
+            c.ntp_ms = atol(argv[i + 1]);
+        else if (opcao == "--limite-ms")
+            c.limite_ms = atol(argv[i + 1]);
+        else if (opcao == "--semente")
+            c.semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (c.dias == 0 || c.periodo_s == 0 || c.falha_ntp < 0.0 || c.falha_ntp > 1.0)
+    {
+        fprintf(stderr, "--dias e --periodo-s precisam ser positivos e --falha-ntp ficar entre 0 e 1\n");
+        return 2;
+    }
+
+    Resultado antigo = simular(c, NTP_POR_BOOT);
+    Resultado so_limite = simular(c, SO_LIMITE);
+    Resultado atual = simular(c, ATUAL);
+
+    printf("[simulador_deriva] %u dias, leitura a cada %u s, RTC %.0f +- %.0f ppm, NTP com erro %.0f ms e %.0f%% "
+           "de falha, limite %u ms\n",
+           c.dias, c.periodo_s, c.deriva_ppm, c.variacao_ppm, c.erro_ntp_ms, c.falha_ntp * 100, c.limite_ms);
+    printf("  %-13s %9s %9s %10s %9s %9s %7s %11s %9s\n", "politica", "p50 ms", "p99 ms", "max ms", "sem tempo",
+           "> incert", "ordem", "ntp/dia", "s ntp/dia");
+    imprimir("ntp por boot", antigo, c.dias);
+    imprimir("so limite", so_limite, c.dias);
+    imprimir("atual", atual, c.dias);
+    printf("  (na politica anterior cada falha do NTP grava um epoch a partir do EPOCH_FALLBACK: conta em \"sem tempo\")\n");
+
+    bool ok = atual.acima_incerteza == 0;
+    printf("incerteza declarada cobre o erro real em todas as leituras da politica atual: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
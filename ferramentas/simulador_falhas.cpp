@@ -0,0 +1,292 @@
+/*
+ *  [i] falhas injetadas: filtro de Hampel e saude do canal (build nativo)
+ *
+ *  gera um trace de temperatura (22 C, ciclo diario de 4 C em 288
+ *  leituras, ruido gaussiano `--ruido`) e injeta tres tipos de falha:
+ *
+ *    picos     uma leitura isolada deslocada de `--pico-min`..`--pico-max` C
+ *              (chance `--prob-pico` por ciclo)
+ *    travado   o sensor fica preso no trilho (-40 C) por `--travado-ciclos`
+ *              leituras (chance `--prob-travado` por ciclo)
+ *    quedas    leituras NAN seguidas, de 1 a `--queda-max` ciclos
+ *              (chance `--prob-queda` por ciclo)
+ *
+ *  cada ciclo passa pelo mesmo caminho do lerSensores: SaudeSensor decide
+ *  se le o sensor real, registra falha ou sucesso, e o valor lido entra no
+ *  FiltroHampel com o desvio minimo do canal de temperatura. relata:
+ *
+ *    - picos detectados e falsos positivos nas leituras limpas
+ *    - leituras travadas marcadas e marcas nas MINIMO_JANELA_HAMPEL
+ *      leituras que seguem o travamento (a volta ao valor real tambem e um
+ *      degrau) e cada queda (a janela guarda valores de antes da espera)
+ *    - leituras reais tentadas durante as quedas, ciclos ate voltar a ok
+ *      depois de cada queda, e as leituras reais que o comportamento
+ *      antigo (simulado para sempre apos a primeira falha) teria perdido
+ *    - ns por amostra do filtro sozinho e do ciclo completo
+ *
+ *  uso: simulador_falhas [--ciclos 200000] [--ruido 0.05] [--prob-pico 0.01]
+ *                        [--pico-min 2] [--pico-max 8] [--prob-travado 0.0005]
+ *                        [--travado-ciclos 40] [--prob-queda 0.002]
+ *                        [--queda-max 30] [--semente 1]
+ *
+ *  sai com 1 se menos de 99% dos picos forem detectados, se mais de 0.1%
+ *  das leituras limpas forem marcadas ou se alguma queda nao terminar em ok.
+ */
+
+#include "config.h"
+#include "registro_canais.h"
+#include "saude_canal.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// canal de temperatura do GerenciadorSensores::canais()
+const uint8_t CASAS_TEMPERATURA = 2;
+const float DESVIO_ATIPICO_TEMPERATURA = 1.0f;
+const float TRILHO_TRAVADO = -40.0f;
+
+enum TipoAmostra
+{
+    AMOSTRA_LIMPA,
+    AMOSTRA_PICO,
+    AMOSTRA_TRAVADA,
+    AMOSTRA_TRANSICAO, // leituras ate a janela voltar a ter maioria real
+    AMOSTRA_RETOMADA,  // o mesmo depois de uma queda (janela velha)
+    AMOSTRA_QUEDA
+};
+
+struct Contagem
+{
+    uint32_t lidas = 0;
+    uint32_t marcadas = 0;
+
+    double taxa() const
+    {
+        return lidas ? 100.0 * marcadas / lidas : 0.0;
+    }
+};
+
+static double agoraNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ciclos = 200000;
+    float ruido = 0.05f;
+    double prob_pico = 0.01, prob_travado = 0.0005, prob_queda = 0.002;
+    float pico_min = 2.0f, pico_max = 8.0f;
+    uint32_t travado_ciclos = 40, queda_max = 30;
+    uint32_t semente = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--ciclos")
+            ciclos = atol(argv[i + 1]);
+        else if (opcao == "--ruido")
+            ruido = atof(argv[i + 1]);
+        else if (opcao == "--prob-pico")
+            prob_pico = atof(argv[i + 1]);
+        else if (opcao == "--pico-min")
+            pico_min = atof(argv[i + 1]);
+        else if (opcao == "--pico-max")
+            pico_max = atof(argv[i + 1]);
+        else if (opcao == "--prob-travado")
+            prob_travado = atof(argv[i + 1]);
+        else if (opcao == "--travado-ciclos")
+            travado_ciclos = atol(argv[i + 1]);
+        else if (opcao == "--prob-queda")
+            prob_queda = atof(argv[i + 1]);
+        else if (opcao == "--queda-max")
+            queda_max = atol(argv[i + 1]);
+        else if (opcao == "--semente")
+            semente = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (ciclos == 0 || ruido < 0.0f || pico_min <= 0.0f || pico_max < pico_min || queda_max == 0)
+    {
+        fprintf(stderr, "parametros invalidos\n");
+        return 2;
+    }
+
+    // TRACE
+
+    std::mt19937 aleatorio(semente);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    std::vector<float> trace(ciclos);
+    std::vector<uint8_t> tipo(ciclos, AMOSTRA_LIMPA);
+    uint32_t picos = 0, travamentos = 0, quedas = 0;
+    for (uint32_t c = 0; c < ciclos;)
+    {
+        float real = 22.0f + 4.0f * sinf(2.0f * (float)M_PI * c / 288.0f) + ruido * normal(aleatorio);
+        double sorteio = uniforme(aleatorio);
+
+        if (sorteio < prob_queda)
+        {
+            uint32_t duracao = 1 + aleatorio() % queda_max;
+            for (uint32_t k = 0; k < duracao && c < ciclos; k++, c++)
+            {
+                trace[c] = NAN;
+                tipo[c] = AMOSTRA_QUEDA;
+            }
+            quedas++;
+        }
+        else if (sorteio < prob_queda + prob_travado)
+        {
+            for (uint32_t k = 0; k < travado_ciclos && c < ciclos; k++, c++)
+            {
+                trace[c] = TRILHO_TRAVADO;
+                tipo[c] = AMOSTRA_TRAVADA;
+            }
+            for (uint32_t k = 0; k < MINIMO_JANELA_HAMPEL && c + k < ciclos; k++)
+                tipo[c + k] = AMOSTRA_TRANSICAO;
+            travamentos++;
+        }
+        else if (sorteio < prob_queda + prob_travado + prob_pico && tipo[c] == AMOSTRA_LIMPA)
+        {
+            float desvio = pico_min + (pico_max - pico_min) * uniforme(aleatorio);
+            trace[c++] = real + (aleatorio() & 1 ? desvio : -desvio);
+            tipo[c - 1] = AMOSTRA_PICO;
+            picos++;
+        }
+        else
+        {
+            trace[c++] = real;
+        }
+    }
+
+    // CICLOS (mesmo caminho do lerSensores)
+
+    std::vector<int32_t> escalados(ciclos);
+    for (uint32_t c = 0; c < ciclos; c++)
+        escalados[c] = isnan(trace[c]) ? 0 : escalarValor(trace[c], CASAS_TEMPERATURA);
+    const int32_t desvio_minimo = escalarValor(DESVIO_ATIPICO_TEMPERATURA, CASAS_TEMPERATURA);
+
+    FiltroHampel filtro = {};
+    SaudeSensor saude = {};
+    Contagem contagens[AMOSTRA_QUEDA + 1];
+    uint32_t tentativas_em_queda = 0, leituras_nao_tentadas = 0, quedas_ate_falho = 0;
+    uint32_t recuperacoes = 0, soma_recuperacao = 0, maior_recuperacao = 0;
+    bool nao_recuperadas;
+    uint32_t fim_ultima_queda = 0;
+    bool aguardando_ok = false;
+    uint32_t primeira_falha = ciclos;
+    uint32_t lidas_desde_queda = MINIMO_JANELA_HAMPEL;
+
+    double inicio = agoraNs();
+    for (uint32_t c = 0; c < ciclos; c++)
+    {
+        bool em_queda = tipo[c] == AMOSTRA_QUEDA;
+        if (em_queda && c > 0 && tipo[c - 1] != AMOSTRA_QUEDA)
+            aguardando_ok = false; // queda nova antes de recuperar: mede so a ultima
+        if (!em_queda && c > 0 && tipo[c - 1] == AMOSTRA_QUEDA)
+        {
+            fim_ultima_queda = c;
+            aguardando_ok = true;
+        }
+
+        if (!saude.deveTentar())
+        {
+            leituras_nao_tentadas += !em_queda;
+            continue;
+        }
+
+        if (em_queda)
+        {
+            tentativas_em_queda++;
+            lidas_desde_queda = 0;
+            primeira_falha = std::min(primeira_falha, c);
+            saude.registrarFalha();
+            quedas_ate_falho += saude.estado == SAUDE_FALHO && saude.falhas_seguidas == FALHAS_PARA_FALHO;
+            continue;
+        }
+
+        saude.registrarSucesso();
+        if (aguardando_ok && saude.estado == SAUDE_OK)
+        {
+            uint32_t duracao = c + 1 - fim_ultima_queda;
+            recuperacoes++;
+            soma_recuperacao += duracao;
+            maior_recuperacao = std::max(maior_recuperacao, duracao);
+            aguardando_ok = false;
+        }
+
+        uint8_t categoria = tipo[c];
+        if (categoria == AMOSTRA_LIMPA && lidas_desde_queda++ < MINIMO_JANELA_HAMPEL)
+            categoria = AMOSTRA_RETOMADA;
+        Contagem &contagem = contagens[categoria];
+        contagem.lidas++;
+        contagem.marcadas += filtro.avaliar(escalados[c], desvio_minimo);
+    }
+    double ns_ciclo = (agoraNs() - inicio) / ciclos;
+    // o trace pode acabar no meio da espera da ultima queda
+    nao_recuperadas = aguardando_ok && ciclos - fim_ultima_queda > ESPERA_MAXIMA_CICLOS + LEITURAS_PARA_RECUPERAR;
+
+    // filtro sozinho, sobre o mesmo trace sem as quedas
+    FiltroHampel so_filtro = {};
+    uint32_t marcas = 0, avaliadas = 0;
+    inicio = agoraNs();
+    for (uint32_t c = 0; c < ciclos; c++)
+    {
+        if (tipo[c] == AMOSTRA_QUEDA)
+            continue;
+        marcas += so_filtro.avaliar(escalados[c], desvio_minimo);
+        avaliadas++;
+    }
+    double ns_filtro = (agoraNs() - inicio) / std::max(avaliadas, 1u);
+
+    uint32_t reais = ciclos - std::count(tipo.begin(), tipo.end(), (uint8_t)AMOSTRA_QUEDA);
+    uint32_t perdidas_antigo = 0;
+    for (uint32_t c = primeira_falha; c < ciclos; c++)
+        perdidas_antigo += tipo[c] != AMOSTRA_QUEDA;
+
+    const Contagem &limpas = contagens[AMOSTRA_LIMPA];
+    const Contagem &pico = contagens[AMOSTRA_PICO];
+    double deteccao = pico.lidas ? 100.0 * pico.marcadas / pico.lidas : 100.0;
+
+    printf("[simulador_falhas] %u ciclos, janela de %u, limiar %.1f desvios, desvio minimo %.2f C\n", ciclos,
+           TAMANHO_JANELA_HAMPEL, LIMIAR_HAMPEL, DESVIO_ATIPICO_TEMPERATURA);
+    printf("injetado: %u picos (%.1f..%.1f C), %u travamentos de %u ciclos, %u quedas de ate %u ciclos\n", picos,
+           pico_min, pico_max, travamentos, travado_ciclos, quedas, queda_max);
+    printf("filtro de Hampel:\n");
+    printf("  %-34s %8u lidas %8u marcadas %7.2f %%\n", "picos", pico.lidas, pico.marcadas, pico.taxa());
+    printf("  %-34s %8u lidas %8u marcadas %7.3f %%\n", "limpas (falsos positivos)", limpas.lidas, limpas.marcadas,
+           limpas.taxa());
+    printf("  %-34s %8u lidas %8u marcadas %7.2f %%\n", "travadas no trilho",
+           contagens[AMOSTRA_TRAVADA].lidas, contagens[AMOSTRA_TRAVADA].marcadas, contagens[AMOSTRA_TRAVADA].taxa());
+    printf("  %-34s %8u lidas %8u marcadas %7.2f %%\n", "janela apos travamento",
+           contagens[AMOSTRA_TRANSICAO].lidas, contagens[AMOSTRA_TRANSICAO].marcadas,
+           contagens[AMOSTRA_TRANSICAO].taxa());
+    printf("  %-34s %8u lidas %8u marcadas %7.2f %%\n", "janela apos queda",
+           contagens[AMOSTRA_RETOMADA].lidas, contagens[AMOSTRA_RETOMADA].marcadas,
+           contagens[AMOSTRA_RETOMADA].taxa());
+    printf("saude do canal:\n");
+    printf("  %-34s %u de %u ciclos em queda\n", "leituras reais tentadas na queda", tentativas_em_queda,
+           ciclos - reais);
+    printf("  %-34s %u\n", "quedas que levaram a falho", quedas_ate_falho);
+    printf("  %-34s %u leituras boas (%.2f %%)\n", "em espera com o sensor bom", leituras_nao_tentadas,
+           100.0 * leituras_nao_tentadas / std::max(reais, 1u));
+    printf("  %-34s media %.1f, maior %u ciclos (%u quedas)\n", "da queda ate voltar a ok",
+           recuperacoes ? (double)soma_recuperacao / recuperacoes : 0.0, maior_recuperacao, recuperacoes);
+    printf("  %-34s %u de %u leituras reais (%.1f %%)\n", "perdidas no comportamento antigo", perdidas_antigo, reais,
+           100.0 * perdidas_antigo / std::max(reais, 1u));
+    printf("custo por amostra: filtro %.1f ns, ciclo completo %.1f ns (checksum %u)\n", ns_filtro, ns_ciclo, marcas);
+
+    bool ok = deteccao >= 99.0 && limpas.taxa() <= 0.1 && !nao_recuperadas;
+    printf("picos >= 99%%, falsos positivos <= 0.1%% e toda queda recuperada: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
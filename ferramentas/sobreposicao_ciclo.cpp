@@ -0,0 +1,244 @@
+/*
+ *  [i] sobreposicao do ciclo: radio x leitura + gravacao (build nativo)
+ *
+ *  cada ciclo e um boot do firmware no host, como na suite_desempenho,
+ *  sempre com upload completo. o mesmo ciclo roda de dois jeitos:
+ *
+ *    sequencial  o de antes: o wifi conecta primeiro (setup) e so entao
+ *                o ciclo le, grava e envia
+ *    pipeline    o GerenciadorCiclo atual: o radio conecta no nucleo 0
+ *                enquanto a leitura publica na fila SPSC e a tarefa de
+ *                gravacao esvazia a fila
+ *
+ *  a associacao vem do stand-in do WiFi (definirLatenciaConexao), para
+ *  cada valor de `--conexao-ms`; o program da flash, do stand-in do
+ *  LittleFS (`--escrita-ms` por open-append-close), ja que no host a
+ *  gravacao custaria quase nada.
+ *
+ *  relata a mediana de cada fase e do tempo acordado nos dois modos e
+ *  quanto da fase mais curta (conexao ou leitura + gravacao) o pipeline
+ *  escondeu: o esperado e acordado ~ max(conexao, leitura + gravacao) +
+ *  upload, em vez da soma.
+ *
+ *  uso: sobreposicao_ciclo [--ciclos 5] [--conexao-ms 0,500,1500,3000]
+ *                          [--escrita-ms 40] [--raiz sobreposicao_fs]
+ *                          [--url http://127.0.0.1:8080/api]
+ *
+ *  precisa do servidor_ingestao rodando (sem ele, sai com 2 antes do
+ *  primeiro ciclo). sai com 1 se o pipeline esconder menos de 80% da fase
+ *  mais curta em algum cenario.
+ */
+
+#include "config.h"
+#include "gerenciador_ciclo.h"
+#include "gerenciador_config.h"
+#include "gerenciador_sleep.h"
+#include <HTTPClient.h>
+#include <algorithm>
+#include <vector>
+
+struct Medida
+{
+    uint32_t conexao;
+    uint32_t gravacao; // leitura + gravacao, do inicio do ciclo
+    uint32_t upload;
+    uint32_t acordado;
+};
+
+/*
+ * um boot com upload completo; sequencial conecta o wifi antes do ciclo
+ */
+static Medida executarBoot(bool sequencial)
+{
+    GerenciadorArmazenamento armazenamento;
+    GerenciadorSensores sensores;
+    GerenciadorSleep sono;
+    GerenciadorTempo tempo;
+    GerenciadorWiFi wifi;
+    GerenciadorUpload upload;
+    GerenciadorRajada rajada;
+    GerenciadorConfig config;
+    GerenciadorEnergia energia;
+    GerenciadorTelemetria telemetria;
+    GerenciadorCiclo ciclo(tempo, sensores, armazenamento, wifi, upload, rajada, energia, telemetria);
+
+    energia.iniciar();
+    telemetria.iniciar();
+    rajada.armarPorDespertar(sono.aoAcordar());
+    sensores.iniciar();
+    config.carregar();
+    tempo.iniciar();
+    armazenamento.iniciar();
+    config.promoverPendente();
+    upload.configurar(config);
+    tempo.definirLimiteIncerteza(config.atual().limite_incerteza_ms);
+    sensores.definirLimitesRegras(config.atual().limites_regras);
+    ciclos_sem_upload = CICLOS_ENTRE_UPLOADS; // todo ciclo e de upload
+
+    Medida m = {0, 0, 0, 0};
+    unsigned long inicio = millis();
+    if (sequencial)
+    {
+        wifi.conectar();
+        m.conexao = millis() - inicio;
+    }
+    ciclo.executarCiclo();
+    const TemposCiclo &t = ciclo.obterTempos();
+    if (!sequencial)
+        m.conexao = t.conexao;
+    m.gravacao = t.gravacao;
+    m.upload = t.upload;
+    m.acordado = millis() - inicio;
+
+    energia.encerrarCiclo();
+    WiFi.disconnect(); // o deep sleep desliga o radio
+    return m;
+}
+
+static uint32_t mediana(std::vector<uint32_t> valores)
+{
+    std::nth_element(valores.begin(), valores.begin() + valores.size() / 2, valores.end());
+    return valores[valores.size() / 2];
+}
+
+static Medida medianas(const std::vector<Medida> &medidas)
+{
+    std::vector<uint32_t> conexao, gravacao, upload, acordado;
+    for (const Medida &m : medidas)
+    {
+        conexao.push_back(m.conexao);
+        gravacao.push_back(m.gravacao);
+        upload.push_back(m.upload);
+        acordado.push_back(m.acordado);
+    }
+    return {mediana(conexao), mediana(gravacao), mediana(upload), mediana(acordado)};
+}
+
+/*
+ * qualquer resposta http serve: so confere que ha um servidor ouvindo
+ */
+static bool servidorOuvindo(const std::string &url)
+{
+    HTTPClient http;
+    if (!http.begin(String(url.c_str())))
+        return false;
+    http.setTimeout(2000);
+    int codigo = http.GET();
+    http.end();
+    return codigo > 0;
+}
+
+/*
+ * "a,b,c" em milissegundos
+ */
+static std::vector<unsigned long> lerLista(const char *texto)
+{
+    std::vector<unsigned long> valores;
+    char *fim = NULL;
+    while (*texto)
+    {
+        valores.push_back(strtoul(texto, &fim, 10));
+        if (fim == texto)
+            return {};
+        texto = *fim == ',' ? fim + 1 : fim;
+    }
+    return valores;
+}
+
+int main(int argc, char **argv)
+{
+    int ciclos = 5;
+    std::vector<unsigned long> conexoes = {0, 500, 1500, 3000};
+    unsigned long escrita_ms = 40;
+    std::string raiz = "sobreposicao_fs";
+    std::string url = SERVIDOR_URL;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--ciclos")
+            ciclos = atoi(argv[i + 1]);
+        else if (opcao == "--conexao-ms")
+            conexoes = lerLista(argv[i + 1]);
+        else if (opcao == "--escrita-ms")
+            escrita_ms = atol(argv[i + 1]);
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--url")
+            url = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (ciclos <= 0 || conexoes.empty())
+    {
+        fprintf(stderr, "--ciclos precisa ser positivo e --conexao-ms uma lista de valores\n");
+        return 2;
+    }
+
+    if (!servidorOuvindo(url))
+    {
+        fprintf(stderr, "[sobreposicao_ciclo] nenhum servidor em %s - rode o servidor_ingestao antes\n", url.c_str());
+        return 2;
+    }
+
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0)
+        return 2;
+    LittleFS.definirRaizPadrao(raiz); // vale tambem para as tarefas do ciclo
+    LittleFS.begin(true);
+    LittleFS.definirLatenciaEscrita(escrita_ms);
+    Serial.silenciar(true);
+    if (url != SERVIDOR_URL)
+    {
+        GerenciadorConfig config;
+        config.carregar();
+        config.aplicarLocal(String(("url=" + url).c_str()));
+    }
+
+    printf("[sobreposicao_ciclo] %d ciclos por cenario, %lu ms por escrita na flash (medianas em ms)\n", ciclos,
+           escrita_ms);
+    printf("  %-8s %-11s %8s %16s %8s %9s %9s\n", "conexao", "modo", "conexao", "leitura+gravacao", "upload",
+           "acordado", "escondido");
+
+    bool ok = true;
+    for (unsigned long conexao_ms : conexoes)
+    {
+        WiFi.definirLatenciaConexao(conexao_ms);
+        std::vector<Medida> sequencial, pipeline;
+        for (int i = 0; i < ciclos; i++)
+        {
+            sequencial.push_back(executarBoot(true));
+            pipeline.push_back(executarBoot(false));
+        }
+        Medida s = medianas(sequencial);
+        Medida p = medianas(pipeline);
+
+        // no sequencial a gravacao conta do inicio do ciclo, depois da conexao
+        uint32_t trabalho = s.gravacao;
+        uint32_t menor = std::min(p.conexao, trabalho);
+        int32_t escondido = (int32_t)s.acordado - (int32_t)p.acordado;
+        double fracao = menor ? (double)escondido / menor : 1.0;
+        bool dentro = menor < 20 || fracao >= 0.8; // abaixo de 20 ms o ruido do host domina
+
+        printf("  %-8lu %-11s %8u %16u %8u %9u\n", conexao_ms, "sequencial", s.conexao, s.gravacao, s.upload,
+               s.acordado);
+        printf("  %-8s %-11s %8u %16u %8u %9u %8.0f%%%s\n", "", "pipeline", p.conexao, p.gravacao, p.upload,
+               p.acordado, 100.0 * fracao, dentro ? "" : "  <- pouca sobreposicao");
+        printf("  %-8s %-11s %8s %16s %8s %9u\n", "", "ideal", "", "", "",
+               std::max(p.conexao, trabalho) + p.upload);
+        ok = ok && dentro;
+    }
+
+    GerenciadorArmazenamento armazenamento;
+    armazenamento.iniciar();
+    bool confirmado = !armazenamento.existemDadosPendentes(TODAS_FAIXAS);
+    if (!confirmado)
+        printf("  [!] registros sem confirmacao do servidor (servidor_ingestao rodando?)\n");
+
+    ok = ok && confirmado;
+    printf("  %s\n", ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+/*
+ *  [i] suite de desempenho ponta a ponta (build nativo ou log do wokwi)
+ *
+ *  cada ciclo e um boot do firmware: os gerenciadores sao construidos de
+ *  novo (as variaveis RTC_DATA_ATTR do processo fazem o papel da memoria
+ *  RTC), o setup do main.cpp inicia os modulos e o GerenciadorCiclo real
+ *  le, grava no LittleFS (ou na particao crua, com --particao) e envia ao
+ *  servidor_ingestao local. o MonitorDesempenho do firmware fecha o ciclo
+ *  como no dispositivo.
+ *
+ *  o heap e o do processo: o operator new conta os bytes vivos, e o
+ *  stand-in do heap_caps acompanha ao vivo o livre e o menor livre desde
+ *  o boot simulado (sobre os 180 KiB livres do stand-in). tempo acordado
+ *  conta a partir do Serial.begin (o delay de 1 s do setup fica de fora).
+ *
+ *  compilada com VERIFICAR_HEAP: toda alocacao com um TrechoSemHeap vivo
+ *  (leitura, gravacao, montagem do lote - arena_ciclo.h) conta como
+ *  alocacao no caminho quente e reprova a suite. --rastrear 1 imprime a
+ *  pilha das primeiras. o relatorio traz tambem o pico da arena e o heap
+ *  ao fim de cada fase do ciclo.
+ *
+ *  a primeira metade dos ciclos le o ADC com --adc (padrao 2048, meio da
+ *  escala: NTC e LDR dentro dos limites), pelo caminho dos sensores reais
+ *  e da calibracao; a segunda le 0 (sensor nao respondendo), o que leva os
+ *  canais a falha e aos simulados. --adc 0 roda tudo com os simulados.
+ *
+ *  com --log, os ciclos vem das linhas "[desempenho]" de um log serial
+ *  (wokwi-cli --serial-log-file) em vez de rodar o firmware no host.
+ *
+ *  cada ciclo e comparado com os ORCAMENTO_CICLO_* do config.h; sai com 1
+ *  se algum ciclo passar, se nenhum ciclo rodar, se sobrar registro sem
+ *  confirmacao do servidor, se o caminho quente alocar no heap ou se
+ *  alguma leitura for descartada com a fila de registros cheia.
+ *
+ *  uso: suite_desempenho [--ciclos 20] [--url http://127.0.0.1:8080/api]
+ *                        [--raiz suite_desempenho_fs] [--conexao-ms 0] [--particao 1]
+ *                        [--rastrear 0] [--adc 2048]
+ *       suite_desempenho --log wokwi_serial.log
+ *
+ *  precisa do servidor_ingestao rodando (exceto com --log).
+ */
+
+#define VERIFICAR_HEAP // TrechoSemHeap conta as alocacoes do caminho quente
+
+#include "config.h"
+#include "desempenho_ciclo.h"
+#include "gerenciador_ciclo.h"
+#include "gerenciador_config.h"
+#include "gerenciador_sleep.h"
+#include <algorithm>
+#include <execinfo.h>
+#include <fstream>
+#include <vector>
+
+// HEAP DO PROCESSO
+
+const size_t HEAP_LIVRE_NATIVO = 180 * 1024; // livre no boot, como o stand-in do heap_caps
+const size_t CABECALHO_ALOCACAO = 16;        // guarda o tamanho, mantem o alinhamento do malloc
+
+static std::atomic<int64_t> bytes_vivos(0);
+static std::atomic<int64_t> vivos_boot(0);      // bytes_vivos no boot simulado
+static std::atomic<uint32_t> alocacoes_quentes(0); // dentro de TrechoSemHeap
+static std::atomic<uint64_t> bytes_quentes(0);
+static int rastrear = 0;          // pilhas de alocacoes quentes a imprimir
+static uint32_t descartados = 0; // leituras que nao couberam na fila de registros
+static uint16_t valor_adc = 0;    // devolvido pelo analogRead dos sensores
+static uint32_t leituras_adc = 0; // dos sensores reais com valor_adc valido
+
+/*
+ * heap_caps do stand-in segue os bytes vivos desde o boot
+ */
+static void atualizarHeap(int64_t vivos)
+{
+    int64_t usados = vivos - vivos_boot;
+    size_t livre = usados > 0 ? HEAP_LIVRE_NATIVO - (size_t)usados : HEAP_LIVRE_NATIVO;
+    heap_nativo.livre = livre;
+    size_t minimo = heap_nativo.minimo;
+    while (livre < minimo && !heap_nativo.minimo.compare_exchange_weak(minimo, livre))
+        ;
+}
+
+void *operator new(size_t tamanho)
+{
+    if (TrechoSemHeap::ativo())
+    {
+        alocacoes_quentes++;
+        bytes_quentes += tamanho;
+        if (rastrear > 0)
+        {
+            rastrear--;
+            TrechoComHeap pilha; // backtrace aloca na primeira chamada
+            void *quadros[16];
+            fprintf(stderr, "[suite] alocacao de %zu bytes no caminho quente:\n", tamanho);
+            backtrace_symbols_fd(quadros, backtrace(quadros, 16), 2);
+        }
+    }
+
+    char *bloco = (char *)malloc(tamanho + CABECALHO_ALOCACAO);
+    if (!bloco)
+        throw std::bad_alloc();
+    *(size_t *)bloco = tamanho;
+    atualizarHeap(bytes_vivos += tamanho);
+    return bloco + CABECALHO_ALOCACAO;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (!p)
+        return;
+    char *bloco = (char *)p - CABECALHO_ALOCACAO;
+    atualizarHeap(bytes_vivos -= *(size_t *)bloco);
+    free(bloco);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void *operator new[](size_t tamanho)
+{
+    return operator new(tamanho);
+}
+
+void operator delete[](void *p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+// CICLO DO FIRMWARE
+
+static uint16_t lerAdc(uint8_t pino)
+{
+    if ((pino == PINO_TERMISTOR || pino == PINO_FOTORESISTOR) && valor_adc != 0)
+        leituras_adc++;
+    return valor_adc;
+}
+
+/*
+ * um boot: setup + loop do main.cpp ate o deep sleep (sem o console)
+ * memoria recebe o fim de cada fase do ciclo
+ */
+static AmostraDesempenho executarBoot(MemoriaFase memoria[TOTAL_FASES_CICLO])
+{
+    // o boot parte do heap inteiro livre
+    vivos_boot = (int64_t)bytes_vivos;
+    heap_nativo.livre = HEAP_LIVRE_NATIVO;
+    heap_nativo.minimo = HEAP_LIVRE_NATIVO;
+    inicioNativo() = std::chrono::steady_clock::now(); // millis() = 0 no reset
+
+    GerenciadorArmazenamento armazenamento;
+    GerenciadorSensores sensores;
+    GerenciadorSleep sono;
+    GerenciadorTempo tempo;
+    GerenciadorWiFi wifi;
+    GerenciadorUpload upload;
+    GerenciadorRajada rajada;
+    GerenciadorConfig config;
+    GerenciadorEnergia energia;
+    GerenciadorTelemetria telemetria;
+    MonitorDesempenho monitor;
+    GerenciadorCiclo ciclo(tempo, sensores, armazenamento, wifi, upload, rajada, energia, telemetria);
+
+    // setup
+    energia.iniciar();
+    telemetria.iniciar();
+    monitor.iniciar();
+    rajada.armarPorDespertar(sono.aoAcordar());
+    sensores.iniciar();
+    config.carregar();
+    tempo.iniciar();
+    armazenamento.iniciar();
+
+    // loop
+    config.promoverPendente();
+    upload.configurar(config);
+    tempo.definirLimiteIncerteza(config.atual().limite_incerteza_ms);
+    sensores.definirLimitesRegras(config.atual().limites_regras);
+    ciclo.executarCiclo();
+    descartados += ciclo.registrosDescartados();
+    for (uint8_t f = 0; f < TOTAL_FASES_CICLO; f++)
+        memoria[f] = ciclo.obterMemoria((FaseCiclo)f);
+
+    AmostraDesempenho amostra = monitor.encerrarCiclo(energia.acordadoMs(), upload.bytesEnviados());
+    energia.encerrarCiclo();
+    WiFi.disconnect(); // o deep sleep desliga o radio
+    return amostra;
+}
+
+// RELATORIO
+
+static uint32_t percentil(std::vector<uint32_t> valores, double p)
+{
+    if (valores.empty())
+        return 0;
+    size_t indice = std::min(valores.size() - 1, (size_t)(p * valores.size()));
+    std::nth_element(valores.begin(), valores.begin() + indice, valores.end());
+    return valores[indice];
+}
+
+/*
+ * p50, p99 e pior caso de uma metrica; pior e o maior, ou o menor para pisos
+ */
+static bool imprimirMetrica(const char *nome, const std::vector<uint32_t> &valores, uint32_t orcamento, bool piso)
+{
+    uint32_t pior = piso ? *std::min_element(valores.begin(), valores.end())
+                         : *std::max_element(valores.begin(), valores.end());
+    bool dentro = piso ? pior >= orcamento : pior <= orcamento;
+    printf("  %-12s %9u %9u %9u   %s %u -> %s\n", nome, percentil(valores, 0.50),
+           piso ? percentil(valores, 0.01) : percentil(valores, 0.99), pior, piso ? ">=" : "<=", orcamento,
+           dentro ? "dentro" : "ESTOURADO");
+    return dentro;
+}
+
+int main(int argc, char **argv)
+{
+    int ciclos = 20;
+    std::string url = SERVIDOR_URL;
+    std::string raiz = "suite_desempenho_fs";
+    unsigned long conexao_ms = 0;
+    bool particao = false;
+    uint16_t adc = 2048;
+    std::string log;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--ciclos")
+            ciclos = atoi(argv[i + 1]);
+        else if (opcao == "--url")
+            url = argv[i + 1];
+        else if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--conexao-ms")
+            conexao_ms = atol(argv[i + 1]);
+        else if (opcao == "--particao")
+            particao = atoi(argv[i + 1]) != 0;
+        else if (opcao == "--log")
+            log = argv[i + 1];
+        else if (opcao == "--rastrear")
+            rastrear = atoi(argv[i + 1]);
+        else if (opcao == "--adc")
+            adc = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (ciclos <= 0)
+    {
+        fprintf(stderr, "--ciclos precisa ser positivo\n");
+        return 2;
+    }
+
+    std::vector<AmostraDesempenho> amostras;
+    bool confirmado = true;
+    MemoriaFase pior_fase[TOTAL_FASES_CICLO] = {}; // maior arena, menor heap de cada fase
+    for (uint8_t f = 0; f < TOTAL_FASES_CICLO; f++)
+        pior_fase[f].heap_livre = pior_fase[f].heap_minimo = UINT32_MAX;
+
+    if (!log.empty())
+    {
+        std::ifstream arquivo(log);
+        if (!arquivo)
+        {
+            fprintf(stderr, "nao abriu %s\n", log.c_str());
+            return 2;
+        }
+        std::string linha;
+        AmostraDesempenho amostra;
+        while (std::getline(arquivo, linha))
+        {
+            if (interpretarDesempenho(linha.c_str(), amostra))
+                amostras.push_back(amostra);
+        }
+        printf("[suite] %zu ciclos do log %s\n", amostras.size(), log.c_str());
+    }
+    else
+    {
+        // dispositivo novo: sem logs, seqs nem config gravados
+        std::string limpar = "rm -rf '" + raiz + "'";
+        if (system(limpar.c_str()) != 0)
+            return 2;
+        LittleFS.definirRaizPadrao(raiz); // vale tambem para as tarefas do ciclo
+        LittleFS.begin(true);
+        if (particao &&
+            !particoes_nativo.declarar(ROTULO_PARTICAO_REGISTROS, SUBTIPO_PARTICAO_REGISTROS, 0xC0000, raiz + "/registros.bin"))
+        {
+            fprintf(stderr, "nao criou a particao em %s\n", raiz.c_str());
+            return 2;
+        }
+        WiFi.definirLatenciaConexao(conexao_ms);
+        definirLeituraAnalogica(lerAdc);
+        Serial.silenciar(true);
+
+        // --url entra como ajuste local pelo console, gravado no NVS
+        if (url != SERVIDOR_URL)
+        {
+            GerenciadorConfig config;
+            config.carregar();
+            config.aplicarLocal(String(("url=" + url).c_str()));
+        }
+
+        for (int i = 0; i < ciclos; i++)
+        {
+            valor_adc = i < (ciclos + 1) / 2 ? adc : 0;
+            MemoriaFase memoria[TOTAL_FASES_CICLO];
+            amostras.push_back(executarBoot(memoria));
+            for (uint8_t f = 0; f < TOTAL_FASES_CICLO; f++)
+            {
+                if (memoria[f].heap_livre == 0)
+                    continue; // fase nao rodou (radio desligado)
+                pior_fase[f].arena_pico = std::max(pior_fase[f].arena_pico, memoria[f].arena_pico);
+                pior_fase[f].heap_livre = std::min(pior_fase[f].heap_livre, memoria[f].heap_livre);
+                pior_fase[f].heap_minimo = std::min(pior_fase[f].heap_minimo, memoria[f].heap_minimo);
+            }
+        }
+
+        // o ultimo ciclo enviou tudo: nada pode ficar so na flash
+        GerenciadorArmazenamento armazenamento;
+        armazenamento.iniciar();
+        confirmado = !armazenamento.existemDadosPendentes(TODAS_FAIXAS);
+        printf("[suite] %d ciclos no host (%s, conexao wifi simulada %lu ms)\n", ciclos,
+               particao ? "particao crua" : "littlefs", conexao_ms);
+        printf("  leituras reais do adc (%u): %u, depois simulados\n", adc, leituras_adc);
+    }
+
+    if (amostras.empty())
+    {
+        printf("  nenhum ciclo -> FALHOU\n");
+        return 1;
+    }
+
+    std::vector<uint32_t> acordado, heap, flash, enviados;
+    uint32_t acima = 0;
+    for (const AmostraDesempenho &a : amostras)
+    {
+        acordado.push_back(a.acordado_ms);
+        heap.push_back(a.heap_minimo);
+        flash.push_back(a.bytes_flash);
+        enviados.push_back(a.bytes_enviados);
+        acima += a.estouros != 0;
+    }
+
+    printf("  %-12s %9s %9s %9s   orcamento\n", "metrica", "p50", "p99", "pior");
+    imprimirMetrica("acordado_ms", acordado, ORCAMENTO_CICLO_ACORDADO_MS, false);
+    imprimirMetrica("heap_min", heap, ORCAMENTO_CICLO_HEAP_LIVRE, true);
+    imprimirMetrica("flash", flash, ORCAMENTO_CICLO_BYTES_FLASH, false);
+    imprimirMetrica("enviados", enviados, ORCAMENTO_CICLO_BYTES_ENVIADOS, false);
+    printf("  ciclos acima do orcamento: %u de %zu\n", acima, amostras.size());
+    if (!confirmado)
+        printf("  [!] registros sem confirmacao do servidor (servidor_ingestao rodando?)\n");
+
+    if (log.empty())
+    {
+        static const char *const nomes[TOTAL_FASES_CICLO] = {"leitura", "gravacao", "upload"};
+        printf("  %-12s %10s %10s %10s   (pior ciclo)\n", "fase", "arena_pico", "heap_livre", "heap_min");
+        for (uint8_t f = 0; f < TOTAL_FASES_CICLO; f++)
+            printf("  %-12s %10u %10u %10u\n", nomes[f], pior_fase[f].arena_pico, pior_fase[f].heap_livre,
+                   pior_fase[f].heap_minimo);
+        printf("  arena do ciclo: %u bytes (upload %u)\n", TAMANHO_ARENA_CICLO, ORCAMENTO_ARENA_UPLOAD);
+        printf("  alocacoes no caminho quente: %u (%llu bytes) -> %s\n", (unsigned)alocacoes_quentes,
+               (unsigned long long)bytes_quentes, alocacoes_quentes ? "FALHOU" : "nenhuma");
+    }
+
+    if (descartados)
+        printf("  [!] leituras descartadas com a fila de registros cheia: %u\n", descartados);
+
+    // --adc sem nenhuma leitura real: o caminho dos sensores reais nao foi medido
+    bool sensores_reais = !log.empty() || adc == 0 || leituras_adc > 0;
+    if (!sensores_reais)
+        printf("  [!] nenhuma leitura real do adc\n");
+
+    bool ok = acima == 0 && confirmado && alocacoes_quentes == 0 && descartados == 0 && sensores_reais;
+    printf("  %s\n", ok ? "ok" : "FALHOU");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+# suite de desempenho ponta a ponta, sem interface (ci ou linha de comando)
+#
+# roda o firmware no host contra o servidor_ingestao local, com os logs no
+# LittleFS e na particao crua; com WOKWI_CLI_TOKEN definido, roda tambem o
+# firmware no simulador do wokwi e le as linhas "[desempenho]" do serial.
+# sai com erro se algum ciclo passar dos ORCAMENTO_CICLO_* do config.h
+#
+# uso: ferramentas/suite_desempenho.sh [ciclos]   (padrao 20)
+
+set -e
+cd "$(dirname "$0")/.."
+CICLOS=${1:-20}
+SUITE=.pio/build/suite_desempenho/program
+
+pio run -e servidor_ingestao -e suite_desempenho
+.pio/build/servidor_ingestao/program --porta 8080 > suite_servidor.log 2>&1 &
+SERVIDOR=$!
+trap 'kill $SERVIDOR 2>/dev/null' EXIT
+sleep 1
+
+# associacao + dhcp de um roteador tipico
+$SUITE --ciclos "$CICLOS" --conexao-ms 1500
+$SUITE --ciclos "$CICLOS" --conexao-ms 1500 --particao 1 --raiz suite_desempenho_particao
+
+if [ -n "$WOKWI_CLI_TOKEN" ]; then
+    # ciclos de 30 s de sono simulado + a janela do console no primeiro boot
+    pio run -e esp32doit-devkit-v1
+    wokwi-cli --timeout $((CICLOS * 40000 + 60000)) --expect-text "[desempenho] ciclo=$CICLOS " \
+        --serial-log-file wokwi_serial.log .
+    $SUITE --log wokwi_serial.log
+fi
@@ -0,0 +1,47 @@
+#!/bin/sh
+# acks perdidos: nenhum registro duplicado nem perdido no servidor
+#
+# sobe o servidor_ingestao com --perder-ack (lote gravado, resposta nunca
+# enviada) e roda o gerador_carga_upload com varias rodadas, ate nenhum
+# dispositivo ficar com pendencias. sai com erro se os registros aceitos
+# pelo servidor nao baterem com os gerados, se nenhum duplicado tiver sido
+# descartado (o teste nao exercitou o reenvio) ou se houver lacuna de seq.
+#
+# uso: ferramentas/teste_ack_perdido.sh [dispositivos] [prob_perder_ack]   (padrao 20 e 0.3)
+
+set -e
+cd "$(dirname "$0")/.."
+DISPOSITIVOS=${1:-20}
+PERDER_ACK=${2:-0.3}
+PORTA=8090
+LOG=teste_ack_servidor.log
+
+pio run -e servidor_ingestao -e gerador_carga_upload
+.pio/build/servidor_ingestao/program --porta $PORTA --perder-ack "$PERDER_ACK" > $LOG 2>&1 &
+SERVIDOR=$!
+trap 'kill $SERVIDOR 2>/dev/null' EXIT
+sleep 1
+
+rm -rf carga_fs
+CARGA=$(.pio/build/gerador_carga_upload/program --dispositivos "$DISPOSITIVOS" --registros 288 --rodadas 20 \
+    --url "http://127.0.0.1:$PORTA/api") || { echo "$CARGA"; echo "[ack] dispositivos com pendencias apos as rodadas"; exit 1; }
+echo "$CARGA"
+
+kill -INT $SERVIDOR
+wait $SERVIDOR || true
+trap - EXIT
+cat $LOG
+
+valor() { sed -n "s/^ *$2: \([0-9]*\).*/\1/p" "$1" | tail -n 1; }
+echo "$CARGA" > teste_ack_carga.log
+GERADOS=$(valor teste_ack_carga.log "registros gerados")
+ACEITOS=$(valor $LOG "registros aceitos")
+DUPLICADOS=$(valor $LOG "registros duplicados descartados")
+LACUNAS=$(valor $LOG "lacunas de seq (registros perdidos)")
+PERDIDOS=$(valor $LOG "acks perdidos (injetados)")
+
+echo "[ack] gerados $GERADOS, aceitos $ACEITOS, duplicados descartados $DUPLICADOS, lacunas $LACUNAS, acks perdidos $PERDIDOS"
+[ -n "$GERADOS" ] && [ "$GERADOS" = "$ACEITOS" ] || { echo "[ack] FALHOU: aceitos != gerados"; exit 1; }
+[ "${DUPLICADOS:-0}" -gt 0 ] || { echo "[ack] FALHOU: nenhum reenvio deduplicado (aumente a prob. de ack perdido)"; exit 1; }
+[ "${LACUNAS:-1}" = 0 ] || { echo "[ack] FALHOU: lacunas de seq"; exit 1; }
+echo "[ack] ok"
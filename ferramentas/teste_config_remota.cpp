@@ -0,0 +1,165 @@
+/*
+ *  [i] config remota: validacao do delta e limites das regras (build nativo)
+ *
+ *  cada caso parte de um NVS vazio (raiz do LittleFS apagada), entrega
+ *  uma resposta de upload com a linha "cfg;..." ao aplicarDelta e confere
+ *  se o delta foi aceito ou rejeitado por inteiro. os aceitos sao lidos de
+ *  volta do NVS por outro GerenciadorConfig (carregar + promoverPendente)
+ *  e os campos conferidos: periodo, tentativas, espera, incerteza, url e
+ *  os limite<i> das REGRAS_FAIXAS, cada um dentro do minimo e do maximo da
+ *  propria regra.
+ *
+ *  no fim, os limites vao ao GerenciadorSensores como no setup do
+ *  firmware (definirLimitesRegras) e a leitura simulada de temperatura
+ *  (~22 graus) so dispara a regra de alarme com o limite vindo do delta.
+ *
+ *  uso: teste_config_remota [--raiz teste_config_fs]
+ *
+ *  sai com 1 se algum caso divergir.
+ */
+
+#include "config.h"
+#include "gerenciador_config.h"
+#include "gerenciador_sensores.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static std::string raiz = "teste_config_fs";
+
+static void limparNvs()
+{
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0)
+        exit(2);
+    LittleFS.begin(true);
+}
+
+/*
+ * config que o proximo despertar usaria, lida do NVS
+ */
+static ConfigRemota lerGravada()
+{
+    GerenciadorConfig config;
+    config.carregar();
+    config.promoverPendente();
+    return config.atual();
+}
+
+struct Caso
+{
+    const char *delta;   // linha sem o "cfg;"
+    bool aceito;         // aplicarDelta deve aceitar
+    uint32_t periodo_ms; // 0 = fabrica
+    float limite0;       // regra 0 de REGRAS_FAIXAS (acima, temperatura)
+    float limite1;       // regra 1 (abaixo, temperatura)
+    float limite3;       // regra 3 (variacao, luminosidade)
+};
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+
+    LittleFS.definirRaiz(raiz);
+    Serial.silenciar(true);
+
+    uint8_t quantidade;
+    const RegraFaixa *regras = GerenciadorSensores::regras(quantidade);
+    const float l0 = regras[0].limite, l1 = regras[1].limite, l3 = regras[3].limite;
+    const uint32_t p = TEMPO_AMOSTRAGEM;
+
+    const Caso casos[] = {
+        {"v=2;periodo_s=600;tentativas=5;espera_ms=3000;incerteza_ms=5000", true, 600000, l0, l1, l3},
+        {"v=2;limite0=32.5;limite3=150", true, p, 32.5f, l1, 150.0f},
+        {"v=2;limite1=-10.25", true, p, l0, -10.25f, l3},
+        {"v=2;limite0=125", true, p, 125.0f, l1, l3},
+        {"v=2;limite0=125.01", false, 0, l0, l1, l3},
+        {"v=2;limite1=-40.5", false, 0, l0, l1, l3},
+        {"v=2;limite3=0.5", false, 0, l0, l1, l3},
+        {"v=2;limite0=abc", false, 0, l0, l1, l3},
+        {"v=2;limite0=1.23456", false, 0, l0, l1, l3},
+        {"v=2;limite0=", false, 0, l0, l1, l3},
+        {"v=2;limite0=-", false, 0, l0, l1, l3},
+        {"v=2;limite0=3.", false, 0, l0, l1, l3},
+        {"v=2;periodo_s=600;limite0=999", false, 0, l0, l1, l3},
+        {"v=2;limite99=10;limitex=1", true, p, l0, l1, l3},
+        {"v=2;chave_nova=1;limite0=30", true, p, 30.0f, l1, l3},
+        {"v=2;periodo_s=5", false, 0, l0, l1, l3},
+        {"v=2;tentativas=0", false, 0, l0, l1, l3},
+        {"v=2;url=ftp://servidor", false, 0, l0, l1, l3},
+        {"periodo_s=600;limite0=30", false, 0, l0, l1, l3},
+    };
+
+    printf("[teste_config_remota] %zu deltas, %u regras em REGRAS_FAIXAS\n", sizeof(casos) / sizeof(casos[0]),
+           quantidade);
+
+    bool ok = true;
+    for (const Caso &caso : casos)
+    {
+        limparNvs();
+        GerenciadorConfig config;
+        config.carregar();
+        bool aceito = config.aplicarDelta(String("ok\ncfg;") + caso.delta + "\n");
+
+        ConfigRemota gravada = lerGravada();
+        uint32_t periodo_esperado = caso.aceito ? caso.periodo_ms : TEMPO_AMOSTRAGEM;
+        bool confere = aceito == caso.aceito && gravada.versao == (caso.aceito ? 2 : 0) &&
+                       gravada.periodo_amostragem_ms == periodo_esperado && gravada.limites_regras[0] == caso.limite0 &&
+                       gravada.limites_regras[1] == caso.limite1 && gravada.limites_regras[3] == caso.limite3;
+        ok = ok && confere;
+        printf("  %-7s %-9s %s\n", confere ? "ok" : "FALHOU", aceito ? "aceito" : "rejeitado", caso.delta);
+        if (!confere)
+            printf("          gravado: v%u, periodo %u ms, limites %.2f %.2f %.2f\n", gravada.versao,
+                   gravada.periodo_amostragem_ms, gravada.limites_regras[0], gravada.limites_regras[1],
+                   gravada.limites_regras[3]);
+    }
+
+    // versao igual ou anterior a ja gravada nao substitui
+    limparNvs();
+    {
+        GerenciadorConfig config;
+        config.carregar();
+        bool nova = config.aplicarDelta("cfg;v=3;limite0=20");
+        bool antiga = config.aplicarDelta("cfg;v=2;limite0=25");
+        bool igual = config.aplicarDelta("cfg;v=3;limite0=26");
+        ConfigRemota gravada = lerGravada();
+        bool confere = nova && !antiga && !igual && gravada.versao == 3 && gravada.limites_regras[0] == 20.0f;
+        ok = ok && confere;
+        printf("  %-7s versao 3 mantida contra v2 e outra v3\n", confere ? "ok" : "FALHOU");
+    }
+
+    // regras das faixas com os limites da config, como no setup
+    limparNvs();
+    {
+        GerenciadorSensores sensores;
+        sensores.iniciar();
+        ConfigRemota fabrica = lerGravada();
+        sensores.definirLimitesRegras(fabrica.limites_regras);
+        uint8_t antes = sensores.lerSensores(1700000000).faixas;
+
+        GerenciadorConfig config;
+        config.carregar();
+        config.aplicarDelta("cfg;v=2;limite0=15");
+        ConfigRemota remota = lerGravada();
+        sensores.definirLimitesRegras(remota.limites_regras);
+        uint8_t depois = sensores.lerSensores(1700000300).faixas;
+
+        bool confere = !(antes & (1u << FAIXA_ALARME)) && (depois & (1u << FAIXA_ALARME));
+        ok = ok && confere;
+        printf("  %-7s alarme de temperatura so com limite0=15 do delta (faixas %02x -> %02x)\n",
+               confere ? "ok" : "FALHOU", antes, depois);
+    }
+
+    printf("todos os deltas validados como esperado: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+/*
+ *  [i] diario na particao: anel, linha interrompida e formato (build nativo)
+ *
+ *  declara uma particao "registros" pequena no stand-in (--setores por
+ *  faixa, arquivo em --raiz) e exercita o DiarioParticao da faixa bruta
+ *  com linhas do codec (formatarLinhaRegistro, crc32):
+ *
+ *    anel       grava ate o anel encher (acrescentar recusa), le tudo com
+ *               proximaLinha, confirma e volta a gravar por varias voltas,
+ *               com as geracoes passando do numero de setores. cada volta
+ *               tem que devolver exatamente os seq gravados, em ordem
+ *    copia      percorrerCopiaDiario sobre a particao mapeada (o que o
+ *               exportador_logs le de um dump) ve as mesmas linhas ativas
+ *    cortada    uma linha pela metade no fim da cabeca, como num corte de
+ *               energia; ao montar de novo a quebra e gravada, o trecho sai
+ *               como linha nao integra e as linhas seguintes voltam integras
+ *    formato    montar com outro cabecalho do csv entrega os setores antigos
+ *               ao visitante, libera-os e o seq continua; as linhas novas
+ *               abrem setor com o cabecalho novo
+ *
+ *  uso: teste_diario_particao [--raiz teste_diario_fs] [--setores 4]
+ *
+ *  sai com 1 se algum caso divergir.
+ */
+
+#include "config.h"
+#include "diario_particao.h"
+#include "registro_canais.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+struct DescritorTeste
+{
+    const char *nome;
+    uint8_t casas;
+};
+
+static const DescritorTeste CANAIS[] = {{"temperatura", 2}, {"luminosidade", 2}};
+static const char CABECALHO[] = "seq,timestamp,incerteza_ms,mapa,marcas,temperatura,luminosidade,crc32";
+static const char CABECALHO_NOVO[] = "seq,timestamp,incerteza_ms,mapa,marcas,temperatura,luminosidade,umidade,crc32";
+
+/*
+ * linha do registro seq, com a quebra
+ */
+static size_t linhaDe(uint32_t sequencia, char *saida)
+{
+    RegistroCanais<2> registro;
+    registro.limpar();
+    registro.definir(0, 2000 + sequencia % 500);
+    if (sequencia % 3)
+        registro.definir(1, 30000 + sequencia);
+    uint32_t crc;
+    size_t tamanho = formatarLinhaRegistro(sequencia, 1700000000 + sequencia * 300, 50, registro, CANAIS, saida, crc);
+    saida[tamanho++] = '\n';
+    return tamanho;
+}
+
+struct Leitura
+{
+    std::vector<uint32_t> sequencias; // das linhas integras, em ordem
+    uint32_t nao_integras = 0;
+};
+
+static void decodificar(const char *linha, size_t tamanho, const FormatoLog &formato, Leitura &leitura)
+{
+    LinhaDecodificada decodificada;
+    if (decodificarLinhaRegistro(linha, tamanho, formato, decodificada) == LINHA_INTEGRA)
+        leitura.sequencias.push_back(decodificada.sequencia);
+    else
+        leitura.nao_integras++;
+}
+
+static Leitura lerFaixa(const DiarioParticao &diario, const char *cabecalho)
+{
+    FormatoLog formato = formatoDoCabecalho(cabecalho, strlen(cabecalho));
+    Leitura leitura;
+    uint32_t posicao = 0;
+    TrechoRegistro trecho;
+    while (diario.proximaLinha(FAIXA_BRUTA, posicao, trecho))
+        decodificar(trecho.dados, trecho.tamanho, formato, leitura);
+    return leitura;
+}
+
+/*
+ * linhas dos setores ativos da faixa bruta numa copia da particao, cada
+ * setor com o formato do proprio cabecalho
+ */
+static Leitura lerCopia(const uint8_t *mapa, size_t tamanho)
+{
+    Leitura leitura;
+    percorrerCopiaDiario(mapa, tamanho, [&](uint8_t faixa, uint32_t, bool liberado, const char *texto, size_t n) {
+        if (faixa != FAIXA_BRUTA || liberado)
+            return;
+        const char *fim = texto + n;
+        const char *quebra = (const char *)memchr(texto, '\n', n);
+        FormatoLog formato = formatoDoCabecalho(texto, quebra - texto);
+        for (const char *linha = quebra + 1; linha < fim;)
+        {
+            const char *proxima = (const char *)memchr(linha, '\n', fim - linha);
+            const char *fim_linha = proxima ? proxima : fim;
+            decodificar(linha, fim_linha - linha, formato, leitura);
+            linha = fim_linha + 1;
+        }
+    });
+    return leitura;
+}
+
+static bool sequenciasDe(const Leitura &leitura, uint32_t primeira, uint32_t ultima)
+{
+    if (leitura.sequencias.size() != ultima - primeira + 1)
+        return false;
+    for (size_t i = 0; i < leitura.sequencias.size(); i++)
+        if (leitura.sequencias[i] != primeira + i)
+            return false;
+    return true;
+}
+
+static bool acrescentar(DiarioParticao &diario, uint32_t sequencia)
+{
+    char linha[tamanhoMaximoLinhaRegistro(2) + 2];
+    uint32_t programados, apagados;
+    return diario.acrescentar(FAIXA_BRUTA, linha, linhaDe(sequencia, linha), sequencia, programados, apagados);
+}
+
+int main(int argc, char **argv)
+{
+    std::string raiz = "teste_diario_fs";
+    uint32_t setores = 4;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opcao = argv[i];
+        if (opcao == "--raiz")
+            raiz = argv[i + 1];
+        else if (opcao == "--setores")
+            setores = atol(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "opcao desconhecida: %s\n", opcao.c_str());
+            return 2;
+        }
+    }
+    if (setores < 2)
+    {
+        fprintf(stderr, "--setores precisa ser ao menos 2\n");
+        return 2;
+    }
+
+    std::string limpar = "rm -rf '" + raiz + "'";
+    if (system(limpar.c_str()) != 0 || mkdir(raiz.c_str(), 0755) != 0)
+        return 2;
+    const esp_partition_t *particao =
+        particoes_nativo.declarar(ROTULO_PARTICAO_REGISTROS, SUBTIPO_PARTICAO_REGISTROS,
+                                  setores * NUMERO_FAIXAS * TAMANHO_SETOR_DIARIO, raiz + "/registros.bin");
+    const uint8_t *mapa;
+    spi_flash_mmap_handle_t mapeamento;
+    if (!particao || esp_partition_mmap(particao, 0, particao->size, SPI_FLASH_MMAP_DATA, (const void **)&mapa,
+                                        &mapeamento) != ESP_OK)
+    {
+        fprintf(stderr, "nao foi possivel criar a particao em %s\n", raiz.c_str());
+        return 2;
+    }
+
+    printf("[teste_diario_particao] %u setores de %u bytes por faixa\n", setores, TAMANHO_SETOR_DIARIO);
+    bool ok = true;
+    uint32_t proxima = 1; // proximo seq a gravar
+
+    // anel: encher, ler, confirmar e dar varias voltas
+    {
+        DiarioParticao diario;
+        bool montou = diario.montar(ROTULO_PARTICAO_REGISTROS, CABECALHO, [](const char *, size_t) {});
+        uint32_t voltas = 0, cheio = 0, gravados_total = 0;
+        bool confere = montou;
+        while (confere && voltas < 3 * setores)
+        {
+            uint32_t primeira = proxima;
+            while (acrescentar(diario, proxima))
+                proxima++;
+            if (cheio == 0)
+                cheio = proxima - primeira;
+            gravados_total += proxima - primeira;
+
+            // a cauda pode ter linhas ja confirmadas na volta anterior
+            Leitura leitura = lerFaixa(diario, CABECALHO);
+            size_t pular = 0;
+            while (pular < leitura.sequencias.size() && leitura.sequencias[pular] < primeira)
+                pular++;
+            leitura.sequencias.erase(leitura.sequencias.begin(), leitura.sequencias.begin() + pular);
+            confere = proxima > primeira && leitura.nao_integras == 0 && sequenciasDe(leitura, primeira, proxima - 1) &&
+                      diario.ultimaSequencia(FAIXA_BRUTA) == proxima - 1 &&
+                      diario.setoresOcupados(FAIXA_BRUTA) == setores;
+
+            diario.liberarAte(FAIXA_BRUTA, proxima - 1);
+            confere = confere && diario.setoresOcupados(FAIXA_BRUTA) == 1;
+            voltas++;
+        }
+        ok = ok && confere;
+        printf("  %-7s anel: %u voltas, %u registros (%u com o anel vazio), geracao da cabeca > %u setores\n",
+               confere ? "ok" : "FALHOU", voltas, gravados_total, cheio, setores);
+    }
+
+    // copia: o dump mapeado tem as mesmas linhas ativas que o diario entrega
+    {
+        DiarioParticao diario;
+        diario.montar(ROTULO_PARTICAO_REGISTROS, CABECALHO, [](const char *, size_t) {});
+        for (int i = 0; i < 150 && acrescentar(diario, proxima); i++)
+            proxima++;
+        Leitura pelo_diario = lerFaixa(diario, CABECALHO);
+        Leitura pela_copia = lerCopia(mapa, particao->size);
+        bool confere = pela_copia.sequencias == pelo_diario.sequencias && pela_copia.nao_integras == 0 &&
+                       !pelo_diario.sequencias.empty() && pelo_diario.sequencias.back() == proxima - 1;
+        ok = ok && confere;
+        printf("  %-7s copia: %zu linhas ativas iguais as do diario, em ordem de geracao\n", confere ? "ok" : "FALHOU",
+               pela_copia.sequencias.size());
+    }
+
+    // cortada: meia linha no fim da cabeca, depois montar de novo
+    {
+        // cabeca recem-aberta, com espaco para a meia linha
+        {
+            DiarioParticao diario;
+            diario.montar(ROTULO_PARTICAO_REGISTROS, CABECALHO, [](const char *, size_t) {});
+            diario.liberarAte(FAIXA_BRUTA, proxima - 1);
+            while (diario.setoresOcupados(FAIXA_BRUTA) < 2 && acrescentar(diario, proxima))
+                proxima++;
+        }
+        uint32_t fim = 0;
+        bool terminava = true;
+        percorrerCopiaDiario(mapa, particao->size, [&](uint8_t faixa, uint32_t, bool liberado, const char *texto,
+                                                       size_t n) {
+            if (faixa == FAIXA_BRUTA && !liberado)
+                fim = texto + n - (const char *)mapa; // a ultima visitada e a cabeca
+        });
+        char linha[tamanhoMaximoLinhaRegistro(2) + 2];
+        size_t tamanho = linhaDe(proxima, linha);
+        esp_partition_write(particao, fim, linha, tamanho / 2);
+        percorrerCopiaDiario(mapa, particao->size, [&](uint8_t faixa, uint32_t, bool liberado, const char *texto,
+                                                       size_t n) {
+            if (faixa == FAIXA_BRUTA && !liberado)
+                terminava = texto[n - 1] == '\n';
+        });
+
+        DiarioParticao diario;
+        diario.montar(ROTULO_PARTICAO_REGISTROS, CABECALHO, [](const char *, size_t) {});
+        bool reparada = mapa[fim + tamanho / 2] == '\n';
+        uint32_t depois = diario.ultimaSequencia(FAIXA_BRUTA) + 1;
+        for (int i = 0; i < 3; i++)
+            acrescentar(diario, depois + i);
+        Leitura leitura = lerFaixa(diario, CABECALHO);
+        std::vector<uint32_t> &lidas = leitura.sequencias;
+        std::vector<uint32_t> esperadas = {proxima - 1, depois, depois + 1, depois + 2};
+        bool confere = !terminava && reparada && leitura.nao_integras == 1 && depois > proxima &&
+                       lidas.size() >= 4 && std::vector<uint32_t>(lidas.end() - 4, lidas.end()) == esperadas;
+        ok = ok && confere;
+        printf("  %-7s cortada: quebra gravada ao montar, 1 linha nao integra, seq segue em %u\n",
+               confere ? "ok" : "FALHOU", depois);
+        proxima = depois + 3;
+    }
+
+    // formato: outro cabecalho do csv libera os setores antigos
+    {
+        Leitura antes = lerCopia(mapa, particao->size);
+        Leitura entregues;
+        uint32_t setores_antigos = 0;
+        DiarioParticao diario;
+        diario.montar(ROTULO_PARTICAO_REGISTROS, CABECALHO_NOVO, [&](const char *texto, size_t n) {
+            setores_antigos++;
+            const char *quebra = (const char *)memchr(texto, '\n', n);
+            FormatoLog formato = formatoDoCabecalho(texto, quebra - texto);
+            for (const char *linha = quebra + 1; linha < texto + n;)
+            {
+                const char *proxima_quebra = (const char *)memchr(linha, '\n', texto + n - linha);
+                if (!proxima_quebra)
+                    break;
+                decodificar(linha, proxima_quebra - linha, formato, entregues);
+                linha = proxima_quebra + 1;
+            }
+        });
+        bool liberou = diario.setoresOcupados(FAIXA_BRUTA) == 0 && lerCopia(mapa, particao->size).sequencias.empty();
+        bool seq_continua = diario.ultimaSequencia(FAIXA_BRUTA) == proxima - 1;
+
+        char linha[tamanhoMaximoLinhaRegistro(3) + 2];
+        RegistroCanais<3> registro;
+        registro.limpar();
+        registro.definir(2, 655);
+        static const DescritorTeste canais_novos[] = {{"temperatura", 2}, {"luminosidade", 2}, {"umidade", 1}};
+        uint32_t crc, programados, apagados;
+        size_t tamanho = formatarLinhaRegistro(proxima, 1800000000, 50, registro, canais_novos, linha, crc);
+        linha[tamanho++] = '\n';
+        bool gravou = diario.acrescentar(FAIXA_BRUTA, linha, tamanho, proxima, programados, apagados);
+        Leitura nova = lerFaixa(diario, CABECALHO_NOVO);
+
+        bool confere = setores_antigos > 0 && entregues.sequencias == antes.sequencias &&
+                       entregues.nao_integras == antes.nao_integras && liberou && seq_continua && gravou &&
+                       sequenciasDe(nova, proxima, proxima) && nova.nao_integras == 0 &&
+                       sequenciasDe(lerCopia(mapa, particao->size), proxima, proxima);
+        ok = ok && confere;
+        printf("  %-7s formato: %u setores antigos entregues (%zu linhas) e liberados, seq segue em %u\n",
+               confere ? "ok" : "FALHOU", setores_antigos, entregues.sequencias.size(), proxima);
+    }
+
+    printf("todos os casos do diario conferem: %s\n", ok ? "sim" : "NAO");
+    return ok ? 0 : 1;
+}
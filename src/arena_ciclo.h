@@ -0,0 +1,228 @@
+#ifndef ARENA_CICLO_H
+#define ARENA_CICLO_H
+
+#include "config.h"
+#include "Arduino.h"
+
+/*
+ *  [i] arena do ciclo: rascunho dos gerenciadores sem heap
+ *
+ *  um bloco estatico de TAMANHO_ARENA_CICLO bytes, dividido pelos
+ *  orcamentos ORCAMENTO_ARENA_* do config.h. alocar() so avanca o topo
+ *  (sem free, sem fragmentacao); MarcaArena devolve o que foi tirado no
+ *  escopo, em ordem de pilha. reiniciar() zera tudo no inicio de cada
+ *  ciclo, junto com o pico, que a instrumentacao do ciclo le ao fim de
+ *  cada fase.
+ *
+ *  o heap do idf continua para o que nao e nosso (wifi, lwip, mbedtls,
+ *  descritores do vfs). no caminho quente o resto nao toca o heap: com
+ *  VERIFICAR_HEAP definido, TrechoSemHeap marca esses trechos e a suite
+ *  de desempenho falha em qualquer alocacao dentro deles.
+ *
+ *  so a tarefa do radio tira rascunho da arena (o corpo do upload); a
+ *  aquisicao e a gravacao usam a pilha. no host cada thread tem a sua
+ *  arena, como cada dispositivo simulado tem a sua raiz no LittleFS.
+ */
+
+enum DonoArena
+{
+    ARENA_ARMAZENAMENTO,
+    ARENA_UPLOAD,
+    ARENA_SENSORES,
+    ARENA_TEMPO,
+    TOTAL_DONOS_ARENA
+};
+
+// CLASSE ARENA DO CICLO
+
+class ArenaCiclo
+{
+private:
+    alignas(8) uint8_t memoria[TAMANHO_ARENA_CICLO > 0 ? TAMANHO_ARENA_CICLO : 1];
+    uint32_t topo;                          // proximo byte livre
+    uint32_t pico;                          // maior topo desde reiniciar()
+    uint32_t usado_dono[TOTAL_DONOS_ARENA]; // em uso por dono
+    uint32_t pico_dono[TOTAL_DONOS_ARENA];
+    uint32_t estouros; // pedidos recusados por orcamento desde reiniciar()
+
+public:
+    ArenaCiclo()
+    {
+        reiniciar();
+    }
+
+    static uint32_t orcamento(DonoArena dono)
+    {
+        static const uint32_t orcamentos[TOTAL_DONOS_ARENA] = {ORCAMENTO_ARENA_ARMAZENAMENTO, ORCAMENTO_ARENA_UPLOAD,
+                                                               ORCAMENTO_ARENA_SENSORES, ORCAMENTO_ARENA_TEMPO};
+        return orcamentos[dono];
+    }
+
+    /*
+     * inicio do ciclo: nada do ciclo anterior continua valido
+     */
+    void reiniciar()
+    {
+        topo = 0;
+        pico = 0;
+        estouros = 0;
+        memset(usado_dono, 0, sizeof(usado_dono));
+        memset(pico_dono, 0, sizeof(pico_dono));
+    }
+
+    /*
+     * tamanho bytes (alinhados a 8) do orcamento do dono
+     * NULL se o dono ja usou o orcamento: quem chama trata como falta de memoria
+     */
+    void *alocar(DonoArena dono, uint32_t tamanho)
+    {
+        uint32_t alinhado = (tamanho + 7) & ~7u;
+        if (usado_dono[dono] + alinhado > orcamento(dono) || topo + alinhado > TAMANHO_ARENA_CICLO)
+        {
+            estouros++;
+            return NULL;
+        }
+
+        void *bloco = memoria + topo;
+        topo += alinhado;
+        usado_dono[dono] += alinhado;
+        if (topo > pico)
+            pico = topo;
+        if (usado_dono[dono] > pico_dono[dono])
+            pico_dono[dono] = usado_dono[dono];
+        return bloco;
+    }
+
+    uint32_t usado() const
+    {
+        return topo;
+    }
+
+    uint32_t picoUsado() const
+    {
+        return pico;
+    }
+
+    uint32_t picoDono(DonoArena dono) const
+    {
+        return pico_dono[dono];
+    }
+
+    uint32_t estourosOrcamento() const
+    {
+        return estouros;
+    }
+
+    friend class MarcaArena;
+};
+
+/*
+ * arena do processo (no host, da thread)
+ */
+inline ArenaCiclo &arenaCiclo()
+{
+#ifdef AMBIENTE_NATIVO
+    static thread_local ArenaCiclo arena;
+#else
+    static ArenaCiclo arena;
+#endif
+    return arena;
+}
+
+/*
+ *  [i] devolve a arena ao estado da construcao ao sair do escopo
+ *  escopos aninhados em ordem de pilha, como variaveis locais
+ */
+class MarcaArena
+{
+private:
+    ArenaCiclo &arena;
+    uint32_t topo;
+    uint32_t usado_dono[TOTAL_DONOS_ARENA];
+
+    MarcaArena(const MarcaArena &);
+    MarcaArena &operator=(const MarcaArena &);
+
+public:
+    MarcaArena(ArenaCiclo &a) : arena(a), topo(a.topo)
+    {
+        memcpy(usado_dono, a.usado_dono, sizeof(usado_dono));
+    }
+
+    ~MarcaArena()
+    {
+        arena.topo = topo;
+        memcpy(arena.usado_dono, usado_dono, sizeof(usado_dono));
+    }
+};
+
+// TRECHOS SEM HEAP
+
+#ifdef VERIFICAR_HEAP
+
+/*
+ *  [i] caminho quente: o operator new da suite conta toda alocacao feita
+ *  com um TrechoSemHeap vivo na thread. TrechoComHeap abre uma excecao
+ *  dentro dele, para o que o idf aloca por conta propria (ex: descritor
+ *  de arquivo do vfs)
+ */
+class TrechoSemHeap
+{
+public:
+    static int &profundidade()
+    {
+        static thread_local int p = 0;
+        return p;
+    }
+
+    static bool ativo()
+    {
+        return profundidade() > 0;
+    }
+
+    TrechoSemHeap()
+    {
+        profundidade()++;
+    }
+
+    ~TrechoSemHeap()
+    {
+        profundidade()--;
+    }
+};
+
+class TrechoComHeap
+{
+private:
+    int anterior;
+
+public:
+    TrechoComHeap() : anterior(TrechoSemHeap::profundidade())
+    {
+        TrechoSemHeap::profundidade() = 0;
+    }
+
+    ~TrechoComHeap()
+    {
+        TrechoSemHeap::profundidade() = anterior;
+    }
+};
+
+#else
+
+// sem VERIFICAR_HEAP os trechos so documentam o caminho quente
+class TrechoSemHeap
+{
+public:
+    TrechoSemHeap() {}
+};
+
+class TrechoComHeap
+{
+public:
+    TrechoComHeap() {}
+};
+
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef BUFFER_TEXTO_H
+#define BUFFER_TEXTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ *  [i] texto montado num buffer fixo (pilha ou arena do ciclo), sem heap
+ *
+ *  os fragmentos json do upload escrevem aqui em vez de concatenar
+ *  String. o que nao cabe e descartado e estourou() passa a true; o
+ *  texto fica sempre terminado em '\0'.
+ *
+ *  decimais sao formatados em inteiros: o printf de float da newlib
+ *  passa pelo dtoa, que aloca.
+ */
+class BufferTexto
+{
+private:
+    char *dados;
+    size_t capacidade; // com o '\0'
+    size_t tamanho_atual;
+    bool cheio;
+
+public:
+    BufferTexto(char *buffer, size_t tamanho) : dados(buffer), capacidade(buffer ? tamanho : 0)
+    {
+        limpar();
+    }
+
+    void limpar()
+    {
+        tamanho_atual = 0;
+        cheio = false;
+        if (capacidade > 0)
+            dados[0] = '\0';
+    }
+
+    BufferTexto &acrescentar(const char *texto, size_t tamanho)
+    {
+        if (tamanho_atual + tamanho >= capacidade)
+        {
+            cheio = true;
+            return *this;
+        }
+        memcpy(dados + tamanho_atual, texto, tamanho);
+        tamanho_atual += tamanho;
+        dados[tamanho_atual] = '\0';
+        return *this;
+    }
+
+    BufferTexto &acrescentar(const char *texto)
+    {
+        return acrescentar(texto, strlen(texto));
+    }
+
+    BufferTexto &acrescentar(char c)
+    {
+        return acrescentar(&c, 1);
+    }
+
+    BufferTexto &inteiro(int32_t valor)
+    {
+        char numero[12];
+        return acrescentar(numero, snprintf(numero, sizeof(numero), "%ld", (long)valor));
+    }
+
+    BufferTexto &natural(uint32_t valor)
+    {
+        char numero[12];
+        return acrescentar(numero, snprintf(numero, sizeof(numero), "%lu", (unsigned long)valor));
+    }
+
+    /*
+     * valor com casas decimais (arredondado), como String(valor, casas)
+     * nan e infinito viram null (json valido)
+     */
+    BufferTexto &decimal(float valor, uint8_t casas)
+    {
+        if (isnan(valor) || isinf(valor))
+            return acrescentar("null");
+
+        int64_t escala = 1;
+        for (uint8_t i = 0; i < casas; i++)
+            escala *= 10;
+        double escalado = fabs((double)valor) * escala + 0.5;
+        if (escalado >= 9e18)
+            return acrescentar("null");
+
+        uint64_t inteiro_escalado = (uint64_t)escalado;
+        char numero[32];
+        int n = snprintf(numero, sizeof(numero), "%s%llu", valor < 0 && inteiro_escalado > 0 ? "-" : "",
+                         (unsigned long long)(inteiro_escalado / escala));
+        if (casas > 0)
+            n += snprintf(numero + n, sizeof(numero) - n, ".%0*llu", (int)casas,
+                          (unsigned long long)(inteiro_escalado % escala));
+        return acrescentar(numero, n);
+    }
+
+    const char *c_str() const
+    {
+        return capacidade > 0 ? dados : "";
+    }
+
+    size_t tamanho() const
+    {
+        return tamanho_atual;
+    }
+
+    bool valido() const
+    {
+        return capacidade > 0;
+    }
+
+    bool estourou() const
+    {
+        return cheio;
+    }
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef CALIBRACAO_H
+#define CALIBRACAO_H
+
+#include <math.h>
+#include <stdint.h>
+
+/*
+ *  [i] modelos de calibracao dos sensores
+ *
+ *  NTC: Steinhart-Hart, 1/T = a + b ln(R) + c ln(R)^3, ajustado por tres
+ *  pontos de referencia. a equacao Beta do config.h e o caso c = 0.
+ *
+ *  LDR: lei de potencia R = R10 (lux / 10)^-gama, ajustada por minimos
+ *  quadrados em log-log com dois ou mais pontos.
+ *
+ *  as conversoes completas (ADC -> mV -> R -> grandeza) sao compiladas no
+ *  boot em tabelas de PONTOS_TABELA_CALIBRACAO pontos indexadas pela
+ *  leitura crua; a leitura so interpola, sem log/pow.
+ *
+ *  sem Arduino, para o ajuste e as tabelas serem exercitados no host.
+ */
+
+const uint16_t LEITURA_ADC_MAXIMA = 4095; // ADC de 12 bits
+const uint8_t BITS_PASSO_TABELA = 4;      // 1 ponto a cada 16 codigos
+const uint16_t PONTOS_TABELA_CALIBRACAO = ((LEITURA_ADC_MAXIMA + 1) >> BITS_PASSO_TABELA) + 1;
+
+const double ZERO_KELVIN = -273.15;
+
+struct CoeficientesSteinhartHart
+{
+    double a;
+    double b;
+    double c;
+};
+
+struct CurvaLDR
+{
+    float r10;  // resistencia em 10 lux (ohms)
+    float gama; // inclinacao log-log
+};
+
+// MODELOS
+
+/*
+ * resistencia do sensor no lado de baixo de um divisor com resistor serie
+ * retorna NAN fora da faixa do divisor
+ */
+inline float resistenciaDivisor(float milivolts, float alimentacao_mv, float resistor_serie)
+{
+    if (milivolts <= 0.0f || milivolts >= alimentacao_mv)
+        return NAN;
+    return resistor_serie * milivolts / (alimentacao_mv - milivolts);
+}
+
+inline double temperaturaSteinhartHart(const CoeficientesSteinhartHart &coef, double resistencia)
+{
+    if (!(resistencia > 0.0))
+        return NAN;
+    double l = log(resistencia);
+    return 1.0 / (coef.a + coef.b * l + coef.c * l * l * l) + ZERO_KELVIN;
+}
+
+inline float luminosidadeLDR(const CurvaLDR &curva, float resistencia)
+{
+    if (!(resistencia > 0.0f))
+        return NAN;
+    return 10.0f * powf(curva.r10 / resistencia, 1.0f / curva.gama);
+}
+
+/*
+ * Steinhart-Hart equivalente a equacao Beta (c = 0)
+ */
+inline CoeficientesSteinhartHart steinhartHartDeBeta(double beta, double r25)
+{
+    CoeficientesSteinhartHart coef;
+    coef.b = 1.0 / beta;
+    coef.a = 1.0 / (25.0 - ZERO_KELVIN) - coef.b * log(r25);
+    coef.c = 0.0;
+    return coef;
+}
+
+// AJUSTES
+
+/*
+ * ajuste exato por tres pontos (resistencia em ohms, temperatura em celsius)
+ * retorna false se os pontos forem degenerados
+ */
+inline bool ajustarSteinhartHart(const double resistencia[3], const double temperatura_c[3],
+                                 CoeficientesSteinhartHart &coef)
+{
+    double l[3], y[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if (!(resistencia[i] > 0.0) || !(temperatura_c[i] > ZERO_KELVIN))
+            return false;
+        l[i] = log(resistencia[i]);
+        y[i] = 1.0 / (temperatura_c[i] - ZERO_KELVIN);
+    }
+
+    if (l[1] == l[0] || l[2] == l[0] || l[2] == l[1] || l[0] + l[1] + l[2] == 0.0)
+        return false;
+
+    double g2 = (y[1] - y[0]) / (l[1] - l[0]);
+    double g3 = (y[2] - y[0]) / (l[2] - l[0]);
+
+    coef.c = (g3 - g2) / (l[2] - l[1]) / (l[0] + l[1] + l[2]);
+    coef.b = g2 - coef.c * (l[0] * l[0] + l[0] * l[1] + l[1] * l[1]);
+    coef.a = y[0] - (coef.b + l[0] * l[0] * coef.c) * l[0];
+
+    // NTC: 1/T cresce com ln(R)
+    return isfinite(coef.a) && isfinite(coef.b) && isfinite(coef.c) && coef.b > 0.0;
+}
+
+/*
+ * minimos quadrados de log10(R) sobre log10(lux / 10)
+ * retorna false com menos de dois niveis de luz distintos
+ */
+inline bool ajustarCurvaLDR(const float *luminosidade, const float *resistencia, uint8_t pontos, CurvaLDR &curva)
+{
+    double soma_x = 0, soma_y = 0, soma_xx = 0, soma_xy = 0;
+    for (uint8_t i = 0; i < pontos; i++)
+    {
+        if (!(luminosidade[i] > 0.0f) || !(resistencia[i] > 0.0f))
+            return false;
+        double x = log10(luminosidade[i] / 10.0);
+        double y = log10((double)resistencia[i]);
+        soma_x += x;
+        soma_y += y;
+        soma_xx += x * x;
+        soma_xy += x * y;
+    }
+
+    double denominador = pontos * soma_xx - soma_x * soma_x;
+    if (pontos < 2 || fabs(denominador) < 1e-12)
+        return false;
+
+    double inclinacao = (pontos * soma_xy - soma_x * soma_y) / denominador;
+    double intercepto = (soma_y - inclinacao * soma_x) / pontos;
+
+    curva.gama = -inclinacao;
+    curva.r10 = pow(10.0, intercepto);
+    return curva.gama > 0.0f && isfinite(curva.r10);
+}
+
+// TABELA DE CONVERSAO
+
+/*
+ *  [i] leitura crua -> grandeza por interpolacao linear
+ *  cada ponto e avaliado no boot com a conversao completa
+ */
+struct TabelaConversao
+{
+    float valores[PONTOS_TABELA_CALIBRACAO];
+
+    /*
+     * converter(leitura) -> grandeza, avaliada em cada ponto da tabela
+     * o divisor satura em 0 e no fundo de escala: os pontos das pontas sao
+     * extrapolados para o segmento acertar 1 e LEITURA_ADC_MAXIMA - 1
+     */
+    template <typename Conversao>
+    void construir(Conversao converter)
+    {
+        const uint16_t ultimo = PONTOS_TABELA_CALIBRACAO - 1;
+        const float passo = 1 << BITS_PASSO_TABELA;
+
+        for (uint16_t i = 1; i < ultimo; i++)
+        {
+            valores[i] = converter((uint16_t)(i << BITS_PASSO_TABELA));
+        }
+
+        float inicio = converter(1);
+        valores[0] = valores[1] - (valores[1] - inicio) * passo / (passo - 1);
+
+        uint16_t leitura_final = LEITURA_ADC_MAXIMA - 1;
+        float distancia = leitura_final - ((ultimo - 1) << BITS_PASSO_TABELA);
+        float fim = converter(leitura_final);
+        valores[ultimo] = valores[ultimo - 1] + (fim - valores[ultimo - 1]) * passo / distancia;
+    }
+
+    float converter(uint16_t leitura) const
+    {
+        if (leitura > LEITURA_ADC_MAXIMA)
+            leitura = LEITURA_ADC_MAXIMA;
+        uint16_t indice = leitura >> BITS_PASSO_TABELA;
+        float fracao = (leitura & ((1 << BITS_PASSO_TABELA) - 1)) * (1.0f / (1 << BITS_PASSO_TABELA));
+        return valores[indice] + (valores[indice + 1] - valores[indice]) * fracao;
+    }
+};
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef CLIENTE_TLS_H
+#define CLIENTE_TLS_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "buffer_texto.h"
+#include "codec_registro.h"
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+/*
+ *  [i] cliente https com servidor fixado e sessao retomada
+ *
+ *  um handshake completo (troca de chaves ECDHE, cadeia de certificados e
+ *  verificacao) custa duas idas e voltas e centenas de ms de cpu e radio.
+ *  a sessao negociada (ticket ou id de sessao, TLS 1.2) fica na memoria RTC
+ *  e o proximo despertar a oferece: se o servidor aceita, o handshake e
+ *  abreviado - uma ida e volta, sem certificado e sem troca de chaves.
+ *
+ *  confianca (config_privado.h), pelo menos uma das duas:
+ *    SERVIDOR_CA_PEM        cadeia da CA; o certificado precisa validar e
+ *                           bater com o host da url
+ *    SERVIDOR_CHAVE_SHA256  sha256 em hexa da chave publica do servidor
+ *                           (SubjectPublicKeyInfo DER). sozinha dispensa a
+ *                           CA e a validade, que dependem do relogio
+ *
+ *  a confianca so e verificada no handshake completo: a sessao retomada
+ *  vem de um handshake que ja passou por ela.
+ *
+ *  o custo de cada handshake (ms e bytes) e comparado ao orcamento do
+ *  config.h e contado na memoria RTC, e vai junto do upload.
+ */
+
+// SESSAO NA MEMORIA RTC
+
+struct SessaoTLS
+{
+    uint32_t crc;       // dos campos abaixo; 0 = sem sessao
+    uint32_t criada_em; // epoch do handshake completo que a criou
+    char host[TAMANHO_URL_SERVIDOR];
+    uint16_t tamanho;
+    uint8_t dados[TAMANHO_MAXIMO_SESSAO_TLS]; // mbedtls_ssl_session_save
+};
+
+struct CustoHandshake
+{
+    uint32_t duracao_ms;      // do ClientHello ao Finished (sem o connect TCP)
+    uint16_t bytes_enviados;  // bytes TLS no socket durante o handshake
+    uint16_t bytes_recebidos;
+    bool retomado;
+};
+
+struct EstatisticasTLS
+{
+    uint32_t completos;
+    uint32_t retomados;
+    uint32_t acima_orcamento;
+    uint32_t falhas;          // conexao, handshake ou confianca
+    CustoHandshake ultimo;
+};
+
+RTC_DATA_ATTR SessaoTLS sessao_tls;
+RTC_DATA_ATTR EstatisticasTLS estatisticas_tls;
+
+/*
+ * ancoras de confianca em uso; as ferramentas do host trocam pelas do
+ * servidor local
+ */
+struct ConfiancaTLS
+{
+    const char *ca_pem;
+    const char *chave_sha256;
+};
+
+inline ConfiancaTLS &confiancaTLS()
+{
+    static ConfiancaTLS atual = {SERVIDOR_CA_PEM, SERVIDOR_CHAVE_SHA256};
+    return atual;
+}
+
+inline uint32_t crcSessaoTLS()
+{
+    return crc32((const uint8_t *)&sessao_tls.criada_em, sizeof(sessao_tls) - sizeof(sessao_tls.crc)) | 1;
+}
+
+inline void esquecerSessaoTLS()
+{
+    memset(&sessao_tls, 0, sizeof(sessao_tls));
+}
+
+/*
+ * fragmento json do upload: handshakes desde o cold boot e o ultimo custo
+ */
+inline void estatisticasTLSJSON(BufferTexto &json)
+{
+    const EstatisticasTLS &e = estatisticas_tls;
+    json.acrescentar("\"tls\": {\"completos\": ").natural(e.completos);
+    json.acrescentar(", \"retomados\": ").natural(e.retomados);
+    json.acrescentar(", \"acima_orcamento\": ").natural(e.acima_orcamento);
+    json.acrescentar(", \"falhas\": ").natural(e.falhas);
+    json.acrescentar(", \"ultimo_ms\": ").natural(e.ultimo.duracao_ms);
+    json.acrescentar(", \"ultimo_bytes\": ").natural(e.ultimo.bytes_enviados + e.ultimo.bytes_recebidos);
+    json.acrescentar(", \"ultimo_retomado\": ").acrescentar(e.ultimo.retomado ? "true" : "false").acrescentar('}');
+}
+
+// CLASSE CLIENTE TLS
+
+class ClienteTLS
+{
+private:
+    mbedtls_net_context rede;
+    mbedtls_entropy_context entropia;
+    mbedtls_ctr_drbg_context aleatorio;
+    mbedtls_x509_crt ca;
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_context ssl;
+
+    uint32_t bytes_enviados; // no socket, desde o connect
+    uint32_t bytes_recebidos;
+    bool certificado_recebido; // so no handshake completo
+    bool chave_confere;
+    CustoHandshake custo;
+
+    static int enviar(void *contexto, const unsigned char *dados, size_t tamanho)
+    {
+        ClienteTLS *cliente = (ClienteTLS *)contexto;
+        int n = mbedtls_net_send(&cliente->rede, dados, tamanho);
+        if (n > 0)
+            cliente->bytes_enviados += n;
+        return n;
+    }
+
+    static int receber(void *contexto, unsigned char *dados, size_t tamanho, uint32_t timeout_ms)
+    {
+        ClienteTLS *cliente = (ClienteTLS *)contexto;
+        int n = mbedtls_net_recv_timeout(&cliente->rede, dados, tamanho, timeout_ms);
+        if (n > 0)
+            cliente->bytes_recebidos += n;
+        return n;
+    }
+
+    /*
+     * chamado para cada certificado da cadeia recebida; so registra, a
+     * decisao fica para depois do handshake (modo OPTIONAL)
+     */
+    static int verificar(void *contexto, mbedtls_x509_crt *certificado, int profundidade, uint32_t *)
+    {
+        ClienteTLS *cliente = (ClienteTLS *)contexto;
+        cliente->certificado_recebido = true;
+        if (profundidade == 0)
+            cliente->chave_confere = chaveConfere(certificado);
+        return 0;
+    }
+
+    static bool chaveConfere(mbedtls_x509_crt *certificado)
+    {
+        const char *esperada = confiancaTLS().chave_sha256;
+        if (!esperada || strlen(esperada) != 64)
+            return false;
+
+        // SubjectPublicKeyInfo DER, escrito no fim do buffer
+        unsigned char der[600];
+        int tamanho = mbedtls_pk_write_pubkey_der(&certificado->pk, der, sizeof(der));
+        if (tamanho <= 0)
+            return false;
+
+        unsigned char hash[32];
+        mbedtls_sha256_ret(der + sizeof(der) - tamanho, tamanho, hash, 0);
+        char hexa[65];
+        for (uint8_t i = 0; i < 32; i++)
+            sprintf(hexa + 2 * i, "%02x", hash[i]);
+        return strcasecmp(hexa, esperada) == 0;
+    }
+
+    /*
+     * sessao da RTC para o host, se integra e dentro da validade
+     */
+    bool oferecerSessao(const char *host, mbedtls_ssl_session &sessao)
+    {
+        if (sessao_tls.crc == 0 || sessao_tls.crc != crcSessaoTLS() || strcmp(sessao_tls.host, host) != 0)
+            return false;
+
+        uint32_t agora = time(NULL);
+        if (agora - sessao_tls.criada_em > VALIDADE_SESSAO_TLS_S)
+        {
+            Serial.println("[tls] sessao guardada expirou");
+            esquecerSessaoTLS();
+            return false;
+        }
+
+        return mbedtls_ssl_session_load(&sessao, sessao_tls.dados, sessao_tls.tamanho) == 0 &&
+               mbedtls_ssl_set_session(&ssl, &sessao) == 0;
+    }
+
+    /*
+     * grava a sessao (com o ticket novo, se veio) para o proximo despertar
+     */
+    void guardarSessao(const char *host)
+    {
+        mbedtls_ssl_session sessao;
+        mbedtls_ssl_session_init(&sessao);
+
+        size_t tamanho = 0;
+        uint32_t criada_em = custo.retomado ? sessao_tls.criada_em : (uint32_t)time(NULL);
+        if (mbedtls_ssl_get_session(&ssl, &sessao) == 0 &&
+            mbedtls_ssl_session_save(&sessao, sessao_tls.dados, sizeof(sessao_tls.dados), &tamanho) == 0)
+        {
+            sessao_tls.criada_em = criada_em;
+            strncpy(sessao_tls.host, host, sizeof(sessao_tls.host) - 1);
+            sessao_tls.host[sizeof(sessao_tls.host) - 1] = '\0';
+            sessao_tls.tamanho = tamanho;
+            sessao_tls.crc = crcSessaoTLS();
+        }
+        else
+        {
+            Serial.println("[tls] sessao de " + String(tamanho) + " bytes nao cabe na RTC");
+            esquecerSessaoTLS();
+        }
+        mbedtls_ssl_session_free(&sessao);
+    }
+
+    void registrarCusto()
+    {
+        EstatisticasTLS &e = estatisticas_tls;
+        e.ultimo = custo;
+        if (custo.retomado)
+            e.retomados++;
+        else
+            e.completos++;
+
+        uint32_t orcamento = custo.retomado ? ORCAMENTO_HANDSHAKE_RETOMADO_MS : ORCAMENTO_HANDSHAKE_COMPLETO_MS;
+        String resumo = String(custo.retomado ? "retomado" : "completo") + " em " + String(custo.duracao_ms) + " ms, " +
+                        String(custo.bytes_enviados) + "/" + String(custo.bytes_recebidos) + " bytes";
+        if (custo.duracao_ms > orcamento)
+        {
+            e.acima_orcamento++;
+            Serial.println("[!] handshake " + resumo + " - acima do orcamento de " + String(orcamento) + " ms");
+        }
+        else
+        {
+            Serial.println("[tls] handshake " + resumo);
+        }
+    }
+
+    bool falhar(const char *etapa, int codigo)
+    {
+        char texto[16];
+        sprintf(texto, "-0x%04x", (unsigned)-codigo);
+        Serial.println("[!] tls: " + String(etapa) + " falhou (" + texto + ")");
+        estatisticas_tls.falhas++;
+        fechar();
+        return false;
+    }
+
+public:
+    ClienteTLS() : bytes_enviados(0), bytes_recebidos(0), certificado_recebido(false), chave_confere(false)
+    {
+        memset(&custo, 0, sizeof(custo));
+        mbedtls_net_init(&rede);
+        mbedtls_entropy_init(&entropia);
+        mbedtls_ctr_drbg_init(&aleatorio);
+        mbedtls_x509_crt_init(&ca);
+        mbedtls_ssl_config_init(&conf);
+        mbedtls_ssl_init(&ssl);
+    }
+
+    ~ClienteTLS()
+    {
+        fechar();
+        mbedtls_ssl_free(&ssl);
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_x509_crt_free(&ca);
+        mbedtls_ctr_drbg_free(&aleatorio);
+        mbedtls_entropy_free(&entropia);
+    }
+
+    /**
+     * conecta e faz o handshake, oferecendo a sessao guardada
+     * retorna false sem ancora de confianca ou se o servidor nao confere
+     */
+    bool conectar(const char *host, const char *porta, uint32_t timeout_ms)
+    {
+        const ConfiancaTLS &confianca = confiancaTLS();
+        bool com_ca = confianca.ca_pem && confianca.ca_pem[0];
+        bool com_chave = confianca.chave_sha256 && confianca.chave_sha256[0];
+        if (!com_ca && !com_chave)
+        {
+            Serial.println("[!] tls: sem SERVIDOR_CA_PEM nem SERVIDOR_CHAVE_SHA256 no config_privado.h");
+            return false;
+        }
+
+        int ret = mbedtls_ctr_drbg_seed(&aleatorio, mbedtls_entropy_func, &entropia, NULL, 0);
+        if (ret != 0)
+            return falhar("semente", ret);
+
+        ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+        if (ret != 0)
+            return falhar("config", ret);
+        if (com_ca)
+        {
+            ret = mbedtls_x509_crt_parse(&ca, (const unsigned char *)confianca.ca_pem, strlen(confianca.ca_pem) + 1);
+            if (ret != 0)
+                return falhar("SERVIDOR_CA_PEM", ret);
+            mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+        }
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+        mbedtls_ssl_conf_verify(&conf, verificar, this);
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &aleatorio);
+        mbedtls_ssl_conf_read_timeout(&conf, timeout_ms);
+        mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+        ret = mbedtls_ssl_setup(&ssl, &conf);
+        if (ret == 0)
+            ret = mbedtls_ssl_set_hostname(&ssl, host);
+        if (ret != 0)
+            return falhar("setup", ret);
+
+        ret = mbedtls_net_connect(&rede, host, porta, MBEDTLS_NET_PROTO_TCP);
+        if (ret != 0)
+            return falhar("conexao", ret);
+        mbedtls_ssl_set_bio(&ssl, this, enviar, NULL, receber);
+
+        mbedtls_ssl_session sessao;
+        mbedtls_ssl_session_init(&sessao);
+        bool oferecida = oferecerSessao(host, sessao);
+
+        uint32_t enviados_antes = bytes_enviados, recebidos_antes = bytes_recebidos;
+        unsigned long inicio = millis();
+        while ((ret = mbedtls_ssl_handshake(&ssl)) == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+            ;
+        custo.duracao_ms = millis() - inicio;
+        custo.bytes_enviados = bytes_enviados - enviados_antes;
+        custo.bytes_recebidos = bytes_recebidos - recebidos_antes;
+        custo.retomado = oferecida && !certificado_recebido;
+        mbedtls_ssl_session_free(&sessao);
+
+        if (ret != 0)
+        {
+            // sessao recusada com erro (e nao com handshake completo): nao oferece de novo
+            if (oferecida)
+                esquecerSessaoTLS();
+            return falhar("handshake", ret);
+        }
+
+        if (!custo.retomado)
+        {
+            uint32_t flags = mbedtls_ssl_get_verify_result(&ssl);
+            if ((com_ca && flags != 0) || (com_chave && !chave_confere))
+            {
+                char texto[12];
+                sprintf(texto, "0x%x", (unsigned)flags);
+                Serial.println("[!] tls: servidor nao confere com " +
+                               String(com_chave && !chave_confere ? "a chave fixada" : "a CA") + " (flags " +
+                               texto + ")");
+                esquecerSessaoTLS();
+                return falhar("confianca", MBEDTLS_ERR_X509_CERT_VERIFY_FAILED);
+            }
+        }
+
+        registrarCusto();
+        guardarSessao(host);
+        return true;
+    }
+
+    bool escreverTudo(const uint8_t *dados, size_t tamanho)
+    {
+        while (tamanho > 0)
+        {
+            int n = mbedtls_ssl_write(&ssl, dados, tamanho);
+            if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE)
+                continue;
+            if (n <= 0)
+                return false;
+            dados += n;
+            tamanho -= n;
+        }
+        return true;
+    }
+
+    /**
+     * retorna bytes lidos, 0 no fim da conexao ou erro negativo do mbedTLS
+     */
+    int ler(uint8_t *dados, size_t tamanho)
+    {
+        int n;
+        while ((n = mbedtls_ssl_read(&ssl, dados, tamanho)) == MBEDTLS_ERR_SSL_WANT_READ ||
+               n == MBEDTLS_ERR_SSL_WANT_WRITE)
+            ;
+        return n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ? 0 : n;
+    }
+
+    void fechar()
+    {
+        if (rede.fd >= 0)
+            mbedtls_ssl_close_notify(&ssl);
+        mbedtls_net_free(&rede);
+    }
+
+    const CustoHandshake &handshake() const
+    {
+        return custo;
+    }
+
+    uint32_t bytesEnviados() const
+    {
+        return bytes_enviados;
+    }
+
+    uint32_t bytesRecebidos() const
+    {
+        return bytes_recebidos;
+    }
+};
+
+#endif
@@ -0,0 +1,335 @@
+#ifndef CODEC_REGISTRO_H
+#define CODEC_REGISTRO_H
+
+#include "registro_canais.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  [i] codec das linhas do /dados_log.csv
+ *
+ *  linha: seq,epoch,incerteza_ms,mapa,marcas,v0,...,vN,crc32
+ *  seq e o numero do registro no dispositivo (1, 2, ...), crescente e
+ *  continuo entre reboots: identifica o registro no upload. o crc32 (IEEE, 8 digitos hexa) cobre todos os bytes antes da ultima
+ *  virgula, entao a linha e verificada sem conhecer a tabela de canais e
+ *  sem nada que nao esteja no arquivo. o firmware grava e as ferramentas
+ *  do host leem com este mesmo codigo (sem Arduino, sem alocacao).
+ *
+ *  logs anteriores terminam na coluna "checksum", uma soma que incluia o
+ *  millis da leitura (nao gravado): sao decodificados, mas nao verificaveis.
+ *  logs sem a coluna seq decodificam com sequencia 0.
+ */
+
+const size_t TAMANHO_CRC_TEXTO = 8;
+
+// CRC32
+
+struct TabelaCRC32
+{
+    uint32_t valores[256];
+
+    TabelaCRC32()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (uint8_t bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+            valores[i] = crc;
+        }
+    }
+};
+
+/*
+ * anterior continua um crc ja calculado (arquivo lido em blocos)
+ */
+inline uint32_t crc32(const uint8_t *dados, size_t tamanho, uint32_t anterior = 0)
+{
+    static const TabelaCRC32 tabela;
+    uint32_t crc = ~anterior;
+    for (size_t i = 0; i < tamanho; i++)
+        crc = tabela.valores[(crc ^ dados[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// FORMATO DO ARQUIVO
+
+/*
+ * formato deduzido do cabecalho (versoes anteriores continuam legiveis)
+ */
+struct FormatoLog
+{
+    bool valido;  // cabecalho com mapa de canais
+    bool sequencia; // primeira coluna e o seq
+    bool marcas;  // coluna de marcas (simulado/atipico)
+    bool crc;     // ultima coluna e crc32 (senao, soma antiga)
+    uint8_t canais;
+    const char *nomes[MAXIMO_CANAIS]; // apontam para o texto do cabecalho
+    uint8_t tamanhos_nomes[MAXIMO_CANAIS];
+};
+
+inline FormatoLog formatoDoCabecalho(const char *cabecalho, size_t tamanho)
+{
+    FormatoLog formato;
+    memset(&formato, 0, sizeof(formato));
+
+    const char *colunas[MAXIMO_CANAIS + 7];
+    size_t tamanhos[MAXIMO_CANAIS + 7];
+    uint8_t n = 0;
+    size_t inicio = 0;
+    for (size_t i = 0; i <= tamanho && n < MAXIMO_CANAIS + 7; i++)
+    {
+        if (i == tamanho || cabecalho[i] == ',' || cabecalho[i] == '\r' || cabecalho[i] == '\n')
+        {
+            colunas[n] = cabecalho + inicio;
+            tamanhos[n++] = i - inicio;
+            inicio = i + 1;
+            if (i < tamanho && cabecalho[i] != ',')
+                break;
+        }
+    }
+
+    auto colunaE = [&](uint8_t i, const char *texto) -> bool {
+        return tamanhos[i] == strlen(texto) && memcmp(colunas[i], texto, tamanhos[i]) == 0;
+    };
+    formato.sequencia = n > 0 && colunaE(0, "seq");
+    uint8_t base = formato.sequencia ? 1 : 0;
+    if (n < base + 4 || !colunaE(base, "timestamp") || !colunaE(base + 1, "incerteza_ms") || !colunaE(base + 2, "mapa"))
+        return formato;
+
+    formato.marcas = colunaE(base + 3, "marcas");
+    formato.crc = colunaE(n - 1, "crc32");
+    if (!formato.crc && !colunaE(n - 1, "checksum"))
+        return formato;
+
+    uint8_t primeira = base + (formato.marcas ? 4 : 3);
+    if (n - 1 < primeira)
+        return formato;
+    formato.canais = n - 1 - primeira;
+    for (uint8_t i = 0; i < formato.canais; i++)
+    {
+        formato.nomes[i] = colunas[primeira + i];
+        formato.tamanhos_nomes[i] = tamanhos[primeira + i];
+    }
+    formato.valido = true;
+    return formato;
+}
+
+// CODIFICACAO
+
+/*
+ * inteiro sem sinal em decimal; retorna o tamanho
+ */
+inline size_t formatarNatural(uint32_t valor, char *saida)
+{
+    char digitos[10];
+    size_t n = 0;
+    do
+    {
+        digitos[n++] = '0' + valor % 10;
+        valor /= 10;
+    } while (valor > 0);
+
+    for (size_t i = 0; i < n; i++)
+        saida[i] = digitos[n - 1 - i];
+    return n;
+}
+
+constexpr size_t tamanhoMaximoLinhaRegistro(uint8_t canais)
+{
+    return 10 + 1 + 10 + 1 + 10 + 1 + tamanhoMaximoCanaisCSV(canais) + 1 + TAMANHO_CRC_TEXTO;
+}
+
+/*
+ * escreve a linha completa (sem quebra) em saida, terminada em zero
+ * saida precisa de tamanhoMaximoLinhaRegistro + 1 bytes; crc recebe o valor gravado
+ */
+template <typename Descritor, uint8_t Capacidade>
+inline size_t formatarLinhaRegistro(uint32_t sequencia, uint32_t epoch, uint32_t incerteza_ms,
+                                    const RegistroCanais<Capacidade> &canais, const Descritor *descritores, char *saida,
+                                    uint32_t &crc)
+{
+    static const char hexa[] = "0123456789abcdef";
+
+    size_t tamanho = formatarNatural(sequencia, saida);
+    saida[tamanho++] = ',';
+    tamanho += formatarNatural(epoch, saida + tamanho);
+    saida[tamanho++] = ',';
+    tamanho += formatarNatural(incerteza_ms, saida + tamanho);
+    saida[tamanho++] = ',';
+    tamanho += formatarCanaisCSV(canais, descritores, saida + tamanho);
+
+    crc = crc32((const uint8_t *)saida, tamanho);
+    saida[tamanho++] = ',';
+    for (int8_t deslocamento = 28; deslocamento >= 0; deslocamento -= 4)
+        saida[tamanho++] = hexa[(crc >> deslocamento) & 0xF];
+    saida[tamanho] = '\0';
+    return tamanho;
+}
+
+// DECODIFICACAO
+
+enum ResultadoLinha
+{
+    LINHA_INTEGRA,        // crc confere
+    LINHA_NAO_VERIFICADA, // formato antigo, sem crc
+    LINHA_CORROMPIDA,     // crc nao confere
+    LINHA_MALFORMADA      // campos faltando ou invalidos
+};
+
+struct LinhaDecodificada
+{
+    uint32_t sequencia; // 0 = log sem coluna seq
+    uint32_t epoch;
+    uint32_t incerteza_ms;
+    uint32_t mapa;
+    uint32_t simulados;
+    uint32_t atipicos;
+    int32_t valores[MAXIMO_CANAIS];  // so os presentes, em ordem de canal
+    uint8_t casas[MAXIMO_CANAIS];    // casas decimais de cada valor no texto
+};
+
+/*
+ * cursor sobre os campos de uma linha
+ */
+struct LeitorCampos
+{
+    const char *p;
+    const char *fim;
+
+    bool separador()
+    {
+        if (p >= fim || *p != ',')
+            return false;
+        p++;
+        return true;
+    }
+
+    bool natural(uint32_t &valor)
+    {
+        const char *inicio = p;
+        uint64_t acumulado = 0;
+        while (p < fim && *p >= '0' && *p <= '9')
+        {
+            acumulado = acumulado * 10 + (*p++ - '0');
+            if (acumulado > 0xFFFFFFFFu)
+                return false;
+        }
+        valor = (uint32_t)acumulado;
+        return p > inicio;
+    }
+
+    bool hexadecimal(uint32_t &valor)
+    {
+        const char *inicio = p;
+        valor = 0;
+        while (p < fim && p - inicio < 8)
+        {
+            char c = *p;
+            uint8_t digito;
+            if (c >= '0' && c <= '9')
+                digito = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digito = c - 'a' + 10;
+            else
+                break;
+            valor = (valor << 4) | digito;
+            p++;
+        }
+        return p > inicio;
+    }
+
+    bool pontoFixo(int32_t &valor, uint8_t &casas)
+    {
+        bool negativo = p < fim && *p == '-';
+        if (negativo)
+            p++;
+        const char *inicio = p;
+        int64_t acumulado = 0;
+        casas = 0;
+        bool ponto = false;
+        while (p < fim)
+        {
+            if (*p >= '0' && *p <= '9')
+            {
+                acumulado = acumulado * 10 + (*p - '0');
+                if (acumulado > 0x80000000LL || (ponto && ++casas > MAXIMO_CASAS_DECIMAIS))
+                    return false;
+            }
+            else if (*p == '.' && !ponto)
+                ponto = true;
+            else
+                break;
+            p++;
+        }
+        if (p == inicio || (!negativo && acumulado > INT32_MAX))
+            return false;
+        valor = negativo ? (int32_t)-acumulado : (int32_t)acumulado;
+        return true;
+    }
+};
+
+/*
+ * decodifica uma linha (sem a quebra) no formato do cabecalho e confere o crc
+ */
+inline ResultadoLinha decodificarLinhaRegistro(const char *linha, size_t tamanho, const FormatoLog &formato,
+                                               LinhaDecodificada &saida)
+{
+    while (tamanho > 0 && linha[tamanho - 1] == '\r')
+        tamanho--;
+
+    LeitorCampos leitor = {linha, linha + tamanho};
+    saida.sequencia = 0;
+    saida.simulados = 0;
+    saida.atipicos = 0;
+
+    if (formato.sequencia && (!leitor.natural(saida.sequencia) || !leitor.separador()))
+        return LINHA_MALFORMADA;
+    if (!leitor.natural(saida.epoch) || !leitor.separador() || !leitor.natural(saida.incerteza_ms) ||
+        !leitor.separador() || !leitor.hexadecimal(saida.mapa) || !leitor.separador())
+        return LINHA_MALFORMADA;
+
+    if (formato.marcas)
+    {
+        if (leitor.p < leitor.fim && *leitor.p == 's')
+        {
+            leitor.p++;
+            if (!leitor.hexadecimal(saida.simulados))
+                return LINHA_MALFORMADA;
+        }
+        if (leitor.p < leitor.fim && *leitor.p == 'o')
+        {
+            leitor.p++;
+            if (!leitor.hexadecimal(saida.atipicos))
+                return LINHA_MALFORMADA;
+        }
+        if (!leitor.separador())
+            return LINHA_MALFORMADA;
+    }
+
+    uint8_t presentes = __builtin_popcount(saida.mapa);
+    if (formato.canais < MAXIMO_CANAIS && (saida.mapa >> formato.canais) != 0)
+        return LINHA_MALFORMADA;
+    for (uint8_t i = 0; i < presentes; i++)
+    {
+        if (!leitor.pontoFixo(saida.valores[i], saida.casas[i]) || !leitor.separador())
+            return LINHA_MALFORMADA;
+    }
+
+    const char *fim_dados = leitor.p - 1; // a virgula antes da verificacao
+    if (!formato.crc)
+    {
+        uint32_t soma;
+        return leitor.natural(soma) && leitor.p == leitor.fim ? LINHA_NAO_VERIFICADA : LINHA_MALFORMADA;
+    }
+
+    uint32_t crc_gravado;
+    if (leitor.fim - leitor.p != (ptrdiff_t)TAMANHO_CRC_TEXTO || !leitor.hexadecimal(crc_gravado) ||
+        leitor.p != leitor.fim)
+        return LINHA_MALFORMADA;
+
+    return crc32((const uint8_t *)linha, fim_dados - linha) == crc_gravado ? LINHA_INTEGRA : LINHA_CORROMPIDA;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef COMPRESSAO_RAJADA_H
+#define COMPRESSAO_RAJADA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ *  [i] compactacao sem perdas das rajadas (delta + zigzag + varint)
+ *
+ *  amostras do ADC em sequencia rapida mudam pouco entre si: guarda-se a
+ *  diferenca para a amostra anterior, mapeada para inteiro sem sinal
+ *  (zigzag) e escrita em 7 bits por byte (varint). diferencas de ate
+ *  +-63 ocupam 1 byte; o pior caso de 12 bits ocupa 2.
+ *
+ *  sem Arduino e sem alocacao, entao o mesmo codigo decodifica no host.
+ */
+
+const uint16_t ASSINATURA_RAJADA = 0x4A52; // "RJ" em little-endian
+const uint8_t VERSAO_RAJADA = 1;
+
+/*
+ *  [i] cabecalho de um bloco em /rajadas.bin
+ *  seguido de tamanho_dados bytes: canal 0 inteiro, depois canal 1, ...
+ */
+struct CabecalhoRajada
+{
+    uint16_t assinatura;    // ASSINATURA_RAJADA
+    uint8_t versao;         // VERSAO_RAJADA
+    uint8_t gatilho;        // o que disparou a captura (GatilhoRajada)
+    uint32_t epoch;         // inicio da rajada
+    uint16_t frequencia_hz; // taxa efetivamente atingida
+    uint16_t amostras;      // amostras por canal
+    uint16_t tamanho_dados; // bytes compactados apos o cabecalho
+    uint16_t verificacao;   // fletcher-16 dos bytes compactados
+};
+
+static_assert(sizeof(CabecalhoRajada) == 16, "cabecalho da rajada deve ter 16 bytes");
+
+// pior caso por amostra de 16 bits: zigzag de 17 bits em 3 bytes
+inline size_t tamanhoMaximoCompactado(size_t amostras)
+{
+    return amostras * 3;
+}
+
+/*
+ * codifica n amostras em destino, retorna os bytes escritos
+ * destino precisa de tamanhoMaximoCompactado(n) bytes
+ */
+inline size_t codificarDeltaVarint(const uint16_t *amostras, size_t n, uint8_t *destino)
+{
+    uint8_t *p = destino;
+    int32_t anterior = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t delta = (int32_t)amostras[i] - anterior;
+        anterior = amostras[i];
+
+        uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        while (zigzag >= 0x80)
+        {
+            *p++ = (uint8_t)(zigzag | 0x80);
+            zigzag >>= 7;
+        }
+        *p++ = (uint8_t)zigzag;
+    }
+
+    return p - destino;
+}
+
+/*
+ * decodifica n amostras de origem
+ * retorna os bytes consumidos ou 0 se os dados acabarem antes
+ */
+inline size_t decodificarDeltaVarint(const uint8_t *origem, size_t tamanho, uint16_t *amostras, size_t n)
+{
+    size_t posicao = 0;
+    int32_t anterior = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t zigzag = 0;
+        uint8_t deslocamento = 0;
+        uint8_t byte;
+        do
+        {
+            if (posicao >= tamanho || deslocamento > 14)
+                return 0;
+            byte = origem[posicao++];
+            zigzag |= (uint32_t)(byte & 0x7F) << deslocamento;
+            deslocamento += 7;
+        } while (byte & 0x80);
+
+        int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        anterior += delta;
+        amostras[i] = (uint16_t)anterior;
+    }
+
+    return posicao;
+}
+
+inline uint16_t fletcher16(const uint8_t *dados, size_t tamanho)
+{
+    uint16_t soma1 = 0, soma2 = 0;
+    for (size_t i = 0; i < tamanho; i++)
+    {
+        soma1 = (soma1 + dados[i]) % 255;
+        soma2 = (soma2 + soma1) % 255;
+    }
+    return (soma2 << 8) | soma1;
+}
+
+#endif
@@ -18,9 +18,14 @@
 #define AMBIENTE_FISICO false
 #pragma message "🔧 Ambiente: WOKWI via PlatformIO"
 
-// método 3: se não é Wokwi, assume que é físico
+// método 3: build nativo no host (ferramentas/nativo)
+#elif defined(AMBIENTE_NATIVO)
+#define AMBIENTE_FISICO false
+#pragma message "🔧 Ambiente: HOST NATIVO (ferramentas)"
+
+// método 4: se não é Wokwi, assume que é físico
+// (AMBIENTE_WOKWI fica indefinido para que os #ifdef escolham o caminho real)
 #else
-#define AMBIENTE_WOKWI false
 #define AMBIENTE_FISICO true
 #pragma message "🔧 Ambiente: ESP32 FÍSICO"
 #endif
@@ -31,6 +36,7 @@
 #define PINO_BOTAO 33        // GPIO para botão de wake-up
 #define PINO_TERMISTOR 35    // GPIO para leitura do NTC
 #define PINO_FOTORESISTOR 34 // GPIO para leitura do LDR
+#define PINO_LDR_DIGITAL 25  // GPIO da saída digital (comparador) do LDR
 
 // CONFIGURAÇÕES DE TEMPO
 
@@ -38,6 +44,35 @@
 #define TEMPO_DEEP_SLEEP_DEMO 30000      // 30 segundos entre leituras (para testes)
 #define TEMPO_DEEP_SLEEP_COMPLETO 300000 // 5 minutos (300000 ms) - versão final
 
+#ifdef AMBIENTE_WOKWI
+#define TEMPO_AMOSTRAGEM TEMPO_DEEP_SLEEP_DEMO
+#else
+#define TEMPO_AMOSTRAGEM TEMPO_DEEP_SLEEP_COMPLETO
+#endif
+
+// CONFIGURAÇÕES DO RELÓGIO
+
+// NTP só é refeito quando o erro estimado passa do limite
+const uint32_t LIMITE_INCERTEZA_MS = 2000;          // erro máximo aceito no timestamp
+const uint32_t INCERTEZA_NTP_MS = 50;               // erro logo após um sync NTP
+const float DERIVA_MAXIMA_PPM = 500.0;              // RTC sem deriva medida (oscilador RC)
+const float DERIVA_RESIDUAL_PPM = 20.0;             // erro restante após corrigir a deriva
+const uint32_t INTERVALO_MINIMO_DERIVA_MS = 600000; // intervalo mínimo para medir deriva
+const uint32_t EPOCH_FALLBACK = 1609459200;         // ponto de partida sem nenhum sync
+const int32_t FUSO_HORARIO_S = -3 * 3600;           // GMT-3 (Brasília), só na exibição
+
+// grade de amostragem (grade_amostragem.h): amostras em epoch múltiplo do período
+// estimativa inicial do disparo do timer até o timestamp da amostra (depois é medida)
+#ifdef AMBIENTE_WOKWI
+const uint32_t LATENCIA_DESPERTAR_MS = 100;  // sono simulado: volta ao loop sem boot
+#else
+const uint32_t LATENCIA_DESPERTAR_MS = 1500; // boot + setup (inclui o delay de 1 s)
+#endif
+const uint32_t ATRASO_GRADE_MS = 500;       // alvo no meio do segundo: o epoch em segundos trunca na fronteira
+const uint32_t SONO_MINIMO_MS = 1000;       // fronteira mais próxima que isso fica para o slot seguinte
+const float GANHO_LATENCIA_GRADE = 0.25;    // fração do erro de cada amostra aplicada à latência
+const uint32_t ERRO_MAXIMO_GRADE_MS = 5000; // erro maior (NTP ajustou o relógio) não corrige a latência
+
 // CONFIGURAÇÕES DE SENSORES
 
 // carâmetros dos sensores
@@ -45,16 +80,152 @@ const float BETA_TERMISTOR = 3950.0; // coeficiente Beta do termistor NTC
 const float GAMA_LDR = 0.7;          // coeficiente Gama do LDR
 const float RESISTENCIA_LDR = 33.0;  // resistência do LDR em 10 lux
 
+// calibração (valores de fábrica; cada dispositivo grava os seus no NVS)
+const float RESISTENCIA_NTC_25C = 10000.0;  // resistência nominal do NTC a 25 °C
+const float RESISTOR_SERIE_NTC = 10000.0;   // resistor fixo do divisor do NTC
+const float RESISTOR_SERIE_LDR = 2000.0;    // resistor fixo do divisor do LDR
+const float TENSAO_DIVISORES_MV = 3300.0;   // alimentação dos divisores
+const uint32_t TENSAO_REFERENCIA_ADC_MV = 1100; // vref padrão sem calibração no eFuse
+
+// saúde dos canais e filtro de atípicos (ver saude_canal.h)
+const uint8_t TAMANHO_JANELA_HAMPEL = 7;     // leituras na janela (memória RTC)
+const float LIMIAR_HAMPEL = 3.0;             // desvios (1.4826 x MAD) para marcar atípico
+const uint8_t FALHAS_PARA_FALHO = 3;         // falhas seguidas até pôr o sensor em espera
+const uint8_t LEITURAS_PARA_RECUPERAR = 3;   // sucessos seguidos para voltar a ok
+const uint16_t ESPERA_MAXIMA_CICLOS = 64;    // teto da espera exponencial entre retentativas
+
+// perfis dos dados simulados (ver gerador_carga.h)
+// perfil, base, amplitude, periodo (s), fase (s), ruido, prob. de falha, semente
+#define MOCK_TEMPERATURA {PERFIL_SENOIDE, 22.5, 2.5, 86400, 64800, 0.05, 0.0, 0x7E3A11}
+#define MOCK_LUMINOSIDADE {PERFIL_DIURNO, 100.0, 900.0, 86400, 64800, 15.0, 0.0, 0x1C5D07}
+
 // DECISÕES DE COMPORTAMENTO
 
 // controle para sensores reais ou mocks
 #define SENSORES_REAIS true // tentar ler sensores físicos/virtuais
 #define SENSORES_MOCKS true // usar dados simulados se sensores falharem
 
+// CONFIGURAÇÕES DO CICLO
+
+#define NUCLEO_RADIO 0                  // pilha wifi roda no PRO_CPU; loop() no APP_CPU
+#define NUCLEO_GRAVACAO 0               // consumidor da fila no PRO_CPU, ao lado do radio que lê o log
+#define CAPACIDADE_FILA_REGISTROS 16    // registros em trânsito até a gravação (potência de 2)
+#define PILHA_TAREFA_RADIO 16384        // handshake TLS do mbedTLS + HTTPClient; os 8 KB do loopTask ficam no limite
+#define PILHA_TAREFA_GRAVACAO 8192      // formata e grava o registro com buffers na pilha
+
+// CONFIGURAÇÕES DE ENERGIA
+
+// corrente média por estado em mA (ESP32-WROOM a 240 MHz, datasheet + medições típicas)
+// radio e flash são incrementos somados à CPU enquanto ativos
+#define CORRENTES_ENERGIA {0.010, 45.0, 85.0, 20.0} // sono, cpu, radio, flash
+const float CAPACIDADE_BATERIA_MAH = 2000.0;       // bateria 18650 típica
+
+// CONFIGURAÇÕES DE RAJADA
+
+#define FREQUENCIA_RAJADA_HZ 1000    // amostras por segundo em cada canal
+#define DURACAO_RAJADA_MS 500        // janela de captura
+#define MAXIMO_AMOSTRAS_RAJADA 1024  // buffer pré-alocado por canal
+#define ARQUIVO_RAJADAS "/rajadas.bin"
+
+// CONFIGURAÇÕES DE ARMAZENAMENTO
+
+// vida util da flash NOR (ciclos de apagamento por bloco, datasheet)
+const uint32_t RESISTENCIA_CICLOS_FLASH = 100000;
+// particao spiffs/littlefs da tabela padrao do esp32 (1.375 MiB)
+const uint32_t TAMANHO_PARTICAO_PADRAO = 0x160000;
+// partição crua dos logs das faixas (particoes.csv, ver diario_particao.h);
+// sem ela na tabela de partições os logs ficam no LittleFS
+#define ROTULO_PARTICAO_REGISTROS "registros"
+const uint8_t SUBTIPO_PARTICAO_REGISTROS = 0x40; // faixa de subtipos de dados livre para a aplicação
+
+// CONFIGURAÇÕES DO CONSOLE SERIAL
+
+// comandos pela UART para recuperar dados sem Wi-Fi (ver console_serial.h)
+const uint32_t VELOCIDADE_CONSOLE = 115200;           // logs e comandos de texto
+const uint32_t VELOCIDADE_EXPORTACAO_PADRAO = 921600; // quadros binários da exportação
+const uint32_t VELOCIDADE_EXPORTACAO_MAXIMA = 2000000;
+const uint32_t JANELA_CONSOLE_MS = 10000;      // escuta após energizar (cabo USB) ou botão
+const uint32_t INATIVIDADE_CONSOLE_MS = 60000; // sessão fecha sem comandos
+const uint8_t JANELA_QUADROS_EXPORTACAO = 8;   // quadros em trânsito sem ACK
+const uint32_t TIMEOUT_ACK_EXPORTACAO_MS = 500;
+const uint8_t TIMEOUTS_EXPORTACAO_MAXIMOS = 10; // seguidos, sem progresso, até desistir
+
 // CONFIGURAÇÕES DE SERVIDOR
 
 // configurações de upload
 const int MAX_TENTATIVAS_UPLOAD = 3;
+const int ESPERA_ENTRE_TENTATIVAS_MS = 2000;
 const int TIMEOUT_UPLOAD_MS = 10000;
+const uint32_t TAMANHO_MAXIMO_LOTE = 8192; // bytes de registros por POST (faixas enviadas em lotes)
+const uint8_t CICLOS_ENTRE_UPLOADS = 1;    // 1 = todo ciclo; alarme liga o rádio em qualquer ciclo
+
+// CONFIGURAÇÕES DE TLS
+
+// urls https:// passam pelo cliente_tls.h (CA e/ou chave fixada no config_privado.h)
+const uint32_t ORCAMENTO_HANDSHAKE_COMPLETO_MS = 1500; // troca de chaves + cadeia, 2 idas e voltas
+const uint32_t ORCAMENTO_HANDSHAKE_RETOMADO_MS = 300;  // sessão da RTC aceita, 1 ida e volta
+const uint32_t VALIDADE_SESSAO_TLS_S = 86400;          // sessão mais velha volta ao handshake completo
+const uint16_t TAMANHO_MAXIMO_SESSAO_TLS = 1536;       // sessão serializada (ticket + certificado do servidor)
+
+// CONFIGURAÇÕES DE DESEMPENHO
+
+// orçamento de cada ciclo (desempenho_ciclo.h): a suite de desempenho falha quando algum ciclo passa
+const uint32_t ORCAMENTO_CICLO_ACORDADO_MS = 6000;    // boot + leitura + gravação + upload
+const uint32_t ORCAMENTO_CICLO_HEAP_LIVRE = 65536;    // piso do menor heap livre (bytes)
+const uint32_t ORCAMENTO_CICLO_BYTES_FLASH = 8192;    // programados na flash por ciclo
+const uint32_t ORCAMENTO_CICLO_BYTES_ENVIADOS = 4096; // corpos http + datagramas, em regime (sem backlog)
+
+// CONFIGURAÇÕES DE MEMÓRIA
+
+// orçamento estático de cada gerenciador (arena_ciclo.h): o objeto, conferido na compilação,
+// e o rascunho que ele tira da arena do ciclo (zerada a cada despertar). fora da arena, o
+// caminho quente (leitura, gravação, montagem do lote) não usa o heap
+const uint32_t ORCAMENTO_OBJETO_ARMAZENAMENTO = 512;
+const uint32_t ORCAMENTO_OBJETO_UPLOAD = 128;
+const uint32_t ORCAMENTO_OBJETO_SENSORES = 3072; // estado de saúde e geradores simulados por canal
+const uint32_t ORCAMENTO_OBJETO_TEMPO = 64;
+const uint32_t ORCAMENTO_ARENA_ARMAZENAMENTO = 0; // lê e grava com buffers na pilha
+const uint32_t TAMANHO_METADADOS_CICLO = 1024; // energia, saúde e telemetria do ciclo (json)
+const uint32_t TAMANHO_CORPO_UPLOAD = TAMANHO_MAXIMO_LOTE + 512 + TAMANHO_METADADOS_CICLO; // lote + metadados
+const uint32_t ORCAMENTO_ARENA_UPLOAD = TAMANHO_CORPO_UPLOAD + TAMANHO_METADADOS_CICLO;
+const uint32_t ORCAMENTO_ARENA_SENSORES = 0;
+const uint32_t ORCAMENTO_ARENA_TEMPO = 0;
+const uint32_t TAMANHO_ARENA_CICLO = ORCAMENTO_ARENA_ARMAZENAMENTO + ORCAMENTO_ARENA_UPLOAD +
+                                     ORCAMENTO_ARENA_SENSORES + ORCAMENTO_ARENA_TEMPO;
+
+// CONFIGURAÇÕES DO GATEWAY
+
+// lotes binários por esp-now a um gateway local (protocolo_gateway.h), sem associar ao wifi;
+// o http continua como reserva. MAC do gateway no config_privado.h
+const bool USAR_GATEWAY = false;
+const uint8_t CANAL_GATEWAY = 1;              // canal wifi em que o gateway escuta
+const uint32_t TIMEOUT_ACK_GATEWAY_MS = 50;   // silêncio após a rodada até reenviar
+const uint8_t RODADAS_GATEWAY = 3;            // rodadas seguidas sem progresso até cair no http
+
+// CONFIGURAÇÕES DAS FAIXAS DE UPLOAD
+
+// regras avaliadas a cada leitura (ver faixas_upload.h): faixa, canal, tipo, limite na unidade do canal
+// e a faixa aceita para o limite quando ele vem do servidor (chave limite<i>, i = linha da tabela)
+#define REGRAS_FAIXAS                                                       \
+  {                                                                         \
+    {FAIXA_ALARME, CANAL_TEMPERATURA, REGRA_ACIMA, 35.0, -40.0, 125.0},     \
+    {FAIXA_ALARME, CANAL_TEMPERATURA, REGRA_ABAIXO, 5.0, -40.0, 125.0},     \
+    {FAIXA_RESUMO, CANAL_TEMPERATURA, REGRA_VARIACAO, 1.0, 0.1, 50.0},      \
+    {FAIXA_RESUMO, CANAL_LUMINOSIDADE, REGRA_VARIACAO, 200.0, 1.0, 10000.0} \
+  }
+
+// CONFIGURAÇÃO REMOTA
+
+// espaço do NVS com a config remota, a calibração e os seqs das faixas
+const char *const ESPACO_NVS_CONFIG = "datalogger";
+
+// limites aceitos para os valores vindos do servidor (fora deles, o delta é rejeitado)
+const uint32_t PERIODO_AMOSTRAGEM_MINIMO_S = 10;
+const uint32_t PERIODO_AMOSTRAGEM_MAXIMO_S = 86400;
+const uint8_t TENTATIVAS_UPLOAD_MAXIMAS = 10;
+const uint32_t ESPERA_TENTATIVAS_MAXIMA_MS = 60000;
+const uint32_t LIMITE_INCERTEZA_MINIMO_MS = 100;
+const uint32_t LIMITE_INCERTEZA_MAXIMO_MS = 600000;
+const uint8_t TAMANHO_URL_SERVIDOR = 96;
 
 #endif
\ No newline at end of file
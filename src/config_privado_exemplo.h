@@ -2,6 +2,8 @@
 #ifndef CONFIG_SECRET_H
 #define CONFIG_SECRET_H
 
+#include <stdint.h>
+
 /*
  * renomear arquivo para config_privado.h
  */
@@ -10,4 +12,21 @@ const char *WIFI_SSID = "SUA_REDE_WIFI_AQUI";
 const char *WIFI_SENHA = "SUA_SENHA_AQUI";
 const char *SERVIDOR_URL = "https://seuserver.com/api";
 
+/*
+ * confianca do https (pelo menos uma):
+ * CA que assina o servidor, em PEM
+ * e/ou sha256 da chave publica do servidor:
+ *   openssl s_client -connect seuserver.com:443 </dev/null | openssl x509 -pubkey -noout |
+ *     openssl pkey -pubin -outform der | sha256sum
+ */
+const char *SERVIDOR_CA_PEM = "-----BEGIN CERTIFICATE-----\n"
+                              "...\n"
+                              "-----END CERTIFICATE-----\n";
+const char *SERVIDOR_CHAVE_SHA256 = "";
+
+/*
+ * gateway esp-now local (USAR_GATEWAY no config.h): MAC da estacao do gateway
+ */
+const uint8_t GATEWAY_MAC[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,409 @@
+#ifndef CONSOLE_SERIAL_H
+#define CONSOLE_SERIAL_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "gerenciador_armazenamento.h"
+#include "gerenciador_config.h"
+#include "gerenciador_energia.h"
+#include "gerenciador_sensores.h"
+#include "gerenciador_telemetria.h"
+#include "gerenciador_time.h"
+#include "protocolo_console.h"
+#include <esp_sleep.h>
+
+/*
+ *  [i] console de comandos na UART
+ *
+ *  sem wifi, os dados saem pelo cabo: o interpretador le linhas do Serial
+ *  sem bloquear e responde em texto, terminando com "ok ..." ou "erro: ...".
+ *  cada comando e ecoado como "> comando" antes da resposta, para o
+ *  cliente separar a resposta dos logs.
+ *
+ *      (linha vazia)          responde "pronto"
+ *      status                 saude, config, energia, telemetria, relogio, arquivos
+ *      consulta <ini> <fim>   linhas do log com epoch no intervalo
+ *      config                 configuracao ativa
+ *      config k=v;k=v         ajuste local, vale no proximo despertar
+ *      exportar [arq] [baud]  arquivo inteiro em quadros binarios (protocolo_console.h)
+ *      sair                   fecha a sessao
+ *
+ *  o deep sleep desliga a UART, entao o console so escuta por
+ *  JANELA_CONSOLE_MS apos energizar (ligar o cabo usb reinicia a placa) ou
+ *  apos o botao; cada comando mantem a sessao aberta por mais
+ *  INATIVIDADE_CONSOLE_MS. a exportacao bloqueia ate terminar.
+ */
+
+const uint8_t TAMANHO_LINHA_CONSOLE = 96;
+
+class GerenciadorConsole
+{
+private:
+    GerenciadorArmazenamento &armazenamento;
+    GerenciadorConfig &config;
+    GerenciadorSensores &sensores;
+    GerenciadorEnergia &energia;
+    GerenciadorTelemetria &telemetria;
+    GerenciadorTempo &tempo;
+
+    char linha[TAMANHO_LINHA_CONSOLE + 1];
+    uint8_t tamanho_linha;
+    bool linha_longa;
+    bool sessao_aberta;
+    bool sair_pedido;
+    unsigned long fim_sessao; // millis
+
+    uint8_t quadro[tamanhoQuadro(CARGA_MAXIMA_QUADRO)];
+    DecodificadorQuadros<4> respostas;
+
+    // EXPORTACAO
+
+    struct Exportacao
+    {
+        File arquivo;
+        uint32_t tamanho;
+        uint32_t blocos;
+        uint32_t crc;         // crc32 dos blocos ja enviados uma vez
+        uint32_t crc_blocos;  // blocos ja somados ao crc (enviados em ordem)
+        uint32_t retransmitidos;
+        const char *nome;
+    };
+
+    void enviarQuadro(Exportacao &exp, uint32_t sequencia)
+    {
+        uint8_t *carga = quadro + TAMANHO_CABECALHO_QUADRO;
+        size_t tamanho;
+
+        if (sequencia == 0)
+        {
+            size_t nome = strlen(exp.nome);
+            escreverU32(carga, exp.tamanho);
+            escreverU16(carga + 4, CARGA_MAXIMA_QUADRO);
+            carga[6] = JANELA_QUADROS_EXPORTACAO;
+            memcpy(carga + 7, exp.nome, nome);
+            tamanho = montarQuadro(QUADRO_INICIO, sequencia, carga, 7 + nome, quadro);
+        }
+        else if (sequencia > exp.blocos)
+        {
+            escreverU32(carga, exp.crc);
+            tamanho = montarQuadro(QUADRO_FIM, sequencia, carga, 4, quadro);
+        }
+        else
+        {
+            uint32_t posicao = (sequencia - 1) * CARGA_MAXIMA_QUADRO;
+            uint16_t bytes = exp.tamanho - posicao < CARGA_MAXIMA_QUADRO ? exp.tamanho - posicao : CARGA_MAXIMA_QUADRO;
+            if (exp.arquivo.position() != posicao)
+                exp.arquivo.seek(posicao);
+            bytes = exp.arquivo.read(carga, bytes);
+
+            // cada bloco entra no crc na primeira vez que sai (sempre em ordem)
+            if (sequencia == exp.crc_blocos + 1)
+            {
+                exp.crc = crc32(carga, bytes, exp.crc);
+                exp.crc_blocos = sequencia;
+            }
+            tamanho = montarQuadro(QUADRO_DADOS, sequencia, carga, bytes, quadro);
+        }
+
+        Serial.write(quadro, tamanho);
+    }
+
+    /*
+     * go-back-N: ate JANELA_QUADROS_EXPORTACAO quadros sem ACK; NAK ou
+     * timeout voltam ao primeiro pendente
+     */
+    bool transmitir(Exportacao &exp)
+    {
+        uint32_t ultimo = exp.blocos + 1; // FIM
+        uint32_t base = 0;                // primeiro quadro sem ACK
+        uint32_t proximo = 0;             // proximo a enviar
+        uint8_t timeouts = 0;
+        unsigned long progresso = millis();
+        respostas.recebidos = 0;
+
+        while (base <= ultimo)
+        {
+            while (proximo <= ultimo && proximo < base + JANELA_QUADROS_EXPORTACAO)
+                enviarQuadro(exp, proximo++);
+
+            while (Serial.available() > 0)
+            {
+                if (!respostas.alimentar(Serial.read()))
+                    continue;
+
+                uint32_t sequencia = respostas.sequencia();
+                if (respostas.tipo() == QUADRO_CANCELA)
+                    return false;
+                if ((respostas.tipo() == QUADRO_ACK || respostas.tipo() == QUADRO_NAK) && sequencia > base &&
+                    sequencia <= ultimo + 1)
+                {
+                    base = sequencia;
+                    timeouts = 0;
+                    progresso = millis();
+                }
+                if (respostas.tipo() == QUADRO_NAK && sequencia == base && sequencia < proximo)
+                {
+                    exp.retransmitidos += proximo - sequencia;
+                    proximo = sequencia;
+                }
+            }
+
+            if (millis() - progresso > TIMEOUT_ACK_EXPORTACAO_MS)
+            {
+                if (++timeouts > TIMEOUTS_EXPORTACAO_MAXIMOS)
+                    return false;
+                exp.retransmitidos += proximo - base;
+                proximo = base;
+                progresso = millis();
+            }
+            yield();
+        }
+        return true;
+    }
+
+    void exportar(const char *nome, uint32_t baud)
+    {
+        if (baud < VELOCIDADE_CONSOLE || baud > VELOCIDADE_EXPORTACAO_MAXIMA)
+        {
+            Serial.println("erro: baud fora de " + String(VELOCIDADE_CONSOLE) + ".." + String(VELOCIDADE_EXPORTACAO_MAXIMA));
+            return;
+        }
+
+        Exportacao exp;
+        exp.arquivo = armazenamento.abrirLeitura(nome);
+        if (!exp.arquivo)
+        {
+            Serial.println("erro: arquivo inexistente: " + String(nome));
+            return;
+        }
+        exp.nome = nome;
+        exp.tamanho = exp.arquivo.size();
+        exp.blocos = (exp.tamanho + CARGA_MAXIMA_QUADRO - 1) / CARGA_MAXIMA_QUADRO;
+        exp.crc = 0;
+        exp.crc_blocos = 0;
+        exp.retransmitidos = 0;
+
+        // o cliente troca de velocidade ao ler esta linha; o INICIO e
+        // retransmitido ate ele responder
+        Serial.println("ok exportando " + String(nome) + " " + String(exp.tamanho) + " bytes a " + String(baud));
+        Serial.flush();
+        Serial.updateBaudRate(baud);
+
+        unsigned long inicio = millis();
+        bool sucesso = transmitir(exp);
+        unsigned long duracao = millis() - inicio;
+        exp.arquivo.close();
+
+        Serial.flush();
+        delay(50); // ultimo ACK do cliente antes de ele voltar a velocidade
+        Serial.updateBaudRate(VELOCIDADE_CONSOLE);
+        while (Serial.available() > 0)
+            Serial.read();
+
+        if (!sucesso)
+        {
+            Serial.println("erro: exportacao interrompida");
+            return;
+        }
+        Serial.println("ok " + String(exp.tamanho) + " bytes em " + String(duracao) + " ms, " +
+                       String(exp.retransmitidos) + " quadros retransmitidos");
+    }
+
+    // INTERPRETADOR
+
+    /*
+     * separa a proxima palavra (modifica a linha); NULL no fim
+     */
+    static char *palavra(char *&cursor)
+    {
+        while (*cursor == ' ')
+            cursor++;
+        if (*cursor == '\0')
+            return NULL;
+        char *inicio = cursor;
+        while (*cursor != '\0' && *cursor != ' ')
+            cursor++;
+        if (*cursor == ' ')
+            *cursor++ = '\0';
+        return inicio;
+    }
+
+    static bool natural(const char *texto, uint32_t &valor)
+    {
+        LeitorCampos leitor = {texto, texto + strlen(texto)};
+        return leitor.natural(valor) && leitor.p == leitor.fim;
+    }
+
+    void executar(char *comando)
+    {
+        Serial.println("> " + String(comando));
+
+        char *cursor = comando;
+        char *nome = palavra(cursor);
+        if (nome == NULL)
+        {
+            Serial.println("pronto");
+            return;
+        }
+
+        if (strcmp(nome, "status") == 0)
+        {
+            sensores.imprimirStatus();
+            config.imprimirStatus();
+            energia.imprimirStatus();
+            telemetria.imprimirStatus();
+            tempo.imprimirTempoAtual();
+            armazenamento.listarArquivos();
+            armazenamento.imprimirEstatisticasFlash();
+            Serial.println("ok");
+        }
+        else if (strcmp(nome, "consulta") == 0)
+        {
+            char *texto_inicio = palavra(cursor);
+            char *texto_fim = palavra(cursor);
+            uint32_t inicio, fim;
+            if (!texto_inicio || !texto_fim || !natural(texto_inicio, inicio) || !natural(texto_fim, fim))
+            {
+                Serial.println("erro: uso: consulta <epoch_inicio> <epoch_fim>");
+                return;
+            }
+            uint32_t encontradas = armazenamento.consultarIntervalo(inicio, fim, Serial);
+            Serial.println("ok " + String(encontradas) + " registros");
+        }
+        else if (strcmp(nome, "config") == 0)
+        {
+            char *pares = palavra(cursor);
+            if (pares == NULL)
+            {
+                config.imprimirStatus();
+                Serial.println("ok");
+            }
+            else if (config.aplicarLocal(pares))
+            {
+                Serial.println("ok vale no proximo despertar");
+            }
+            else
+            {
+                Serial.println("erro: config rejeitada (chaves: periodo_s, tentativas, espera_ms, incerteza_ms, url)");
+            }
+        }
+        else if (strcmp(nome, "exportar") == 0)
+        {
+            char *arquivo = palavra(cursor);
+            char *texto_baud = palavra(cursor);
+            uint32_t baud = VELOCIDADE_EXPORTACAO_PADRAO;
+            if (texto_baud && !natural(texto_baud, baud))
+            {
+                Serial.println("erro: uso: exportar [arquivo] [baud]");
+                return;
+            }
+            exportar(arquivo ? arquivo : armazenamento.arquivoLog(), baud);
+        }
+        else if (strcmp(nome, "sair") == 0)
+        {
+            sair_pedido = true;
+            Serial.println("ok");
+        }
+        else
+        {
+            Serial.println("erro: comando desconhecido (status, consulta, config, exportar, sair)");
+        }
+    }
+
+    /*
+     * consome o que chegou na UART; retorna true se executou algum comando
+     */
+    bool processarEntrada()
+    {
+        bool executou = false;
+        while (Serial.available() > 0)
+        {
+            int c = Serial.read();
+            if (c < 0)
+                break;
+            if (c == '\r')
+                continue;
+            if (c != '\n')
+            {
+                if (tamanho_linha < TAMANHO_LINHA_CONSOLE)
+                    linha[tamanho_linha++] = c;
+                else
+                    linha_longa = true;
+                continue;
+            }
+
+            linha[tamanho_linha] = '\0';
+            if (linha_longa)
+                Serial.println("erro: linha maior que " + String(TAMANHO_LINHA_CONSOLE) + " caracteres");
+            else
+                executar(linha);
+            tamanho_linha = 0;
+            linha_longa = false;
+            executou = true;
+        }
+        return executou;
+    }
+
+public:
+    GerenciadorConsole(GerenciadorArmazenamento &armazenamento, GerenciadorConfig &config,
+                       GerenciadorSensores &sensores, GerenciadorEnergia &energia,
+                       GerenciadorTelemetria &telemetria, GerenciadorTempo &tempo)
+        : armazenamento(armazenamento), config(config), sensores(sensores), energia(energia),
+          telemetria(telemetria), tempo(tempo)
+    {
+        tamanho_linha = 0;
+        linha_longa = false;
+        sessao_aberta = false;
+        sair_pedido = false;
+        fim_sessao = 0;
+    }
+
+    /*
+     * energizacao (cabo usb) ou botao abrem a janela de escuta deste ciclo
+     */
+    void armarPorDespertar(esp_sleep_wakeup_cause_t causa)
+    {
+        if (causa == ESP_SLEEP_WAKEUP_UNDEFINED || causa == ESP_SLEEP_WAKEUP_EXT0)
+            abrirSessao(JANELA_CONSOLE_MS);
+    }
+
+    void abrirSessao(uint32_t duracao_ms)
+    {
+        sessao_aberta = true;
+        fim_sessao = millis() + duracao_ms;
+    }
+
+    bool sessaoAberta() const
+    {
+        return sessao_aberta;
+    }
+
+    /*
+     * antes de dormir: sem sessao so consome o que ja chegou; com sessao,
+     * atende ate ela expirar (ou "sair")
+     */
+    void atender()
+    {
+        if (sessao_aberta)
+        {
+            Serial.println("console: aguardando comandos (linha vazia responde \"pronto\")");
+        }
+
+        do
+        {
+            // quem mandou um comando fora da janela tambem ganha sessao
+            if (processarEntrada() && !sair_pedido)
+                abrirSessao(INATIVIDADE_CONSOLE_MS);
+            if (sessao_aberta && (sair_pedido || (long)(millis() - fim_sessao) >= 0))
+            {
+                sessao_aberta = false;
+                Serial.println("console: sessao encerrada");
+            }
+            sair_pedido = false;
+            if (sessao_aberta)
+                delay(10);
+        } while (sessao_aberta);
+    }
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef DESEMPENHO_CICLO_H
+#define DESEMPENHO_CICLO_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "estatisticas_flash.h"
+#include <esp_heap_caps.h>
+
+/*
+ *  [i] orcamento de desempenho por ciclo
+ *
+ *  ao fim de cada ciclo, antes de dormir, quatro numeros sao comparados
+ *  com os ORCAMENTO_CICLO_* do config.h: tempo acordado, menor heap livre
+ *  (marca d'agua do idf), bytes programados na flash e bytes entregues ao
+ *  radio. a linha "[desempenho] ..." tem formato fixo: a suite de
+ *  desempenho (ferramentas/suite_desempenho.cpp) le os mesmos campos do
+ *  serial do wokwi ou direto deste monitor no build nativo.
+ */
+
+// ORCAMENTOS ESTOURADOS (mascara)
+
+const uint8_t ESTOURO_ACORDADO = 1 << 0;
+const uint8_t ESTOURO_HEAP = 1 << 1;
+const uint8_t ESTOURO_FLASH = 1 << 2;
+const uint8_t ESTOURO_ENVIADOS = 1 << 3;
+
+struct AmostraDesempenho
+{
+    uint32_t ciclo;          // ciclos desde o cold boot
+    uint32_t acordado_ms;    // do despertar ate o fim do ciclo
+    uint32_t heap_minimo;    // menor heap livre desde o boot
+    uint32_t bytes_flash;    // programados na flash no ciclo
+    uint32_t bytes_enviados; // corpos http + datagramas do ciclo
+    uint8_t estouros;        // ESTOURO_* acima do orcamento
+};
+
+// CONTADORES NA MEMORIA RTC
+
+struct EstatisticasDesempenho
+{
+    uint32_t ciclos;
+    uint32_t acima_orcamento; // ciclos com algum orcamento estourado
+};
+
+RTC_DATA_ATTR EstatisticasDesempenho estatisticas_desempenho = {0, 0};
+
+/*
+ * orcamentos que a amostra estourou (ESTOURO_*)
+ */
+inline uint8_t verificarOrcamento(const AmostraDesempenho &a)
+{
+    uint8_t estouros = 0;
+    if (a.acordado_ms > ORCAMENTO_CICLO_ACORDADO_MS)
+        estouros |= ESTOURO_ACORDADO;
+    if (a.heap_minimo < ORCAMENTO_CICLO_HEAP_LIVRE)
+        estouros |= ESTOURO_HEAP;
+    if (a.bytes_flash > ORCAMENTO_CICLO_BYTES_FLASH)
+        estouros |= ESTOURO_FLASH;
+    if (a.bytes_enviados > ORCAMENTO_CICLO_BYTES_ENVIADOS)
+        estouros |= ESTOURO_ENVIADOS;
+    return estouros;
+}
+
+/*
+ * "[desempenho] ciclo=N acordado_ms=N heap_min=N flash=N enviados=N orcamento=ok|acima"
+ */
+inline int formatarDesempenho(const AmostraDesempenho &a, char *linha, size_t tamanho)
+{
+    return snprintf(linha, tamanho, "[desempenho] ciclo=%u acordado_ms=%u heap_min=%u flash=%u enviados=%u orcamento=%s",
+                    (unsigned)a.ciclo, (unsigned)a.acordado_ms, (unsigned)a.heap_minimo, (unsigned)a.bytes_flash,
+                    (unsigned)a.bytes_enviados, a.estouros ? "acima" : "ok");
+}
+
+/*
+ * le a linha de formatarDesempenho em qualquer ponto do texto (log serial)
+ */
+inline bool interpretarDesempenho(const char *texto, AmostraDesempenho &a)
+{
+    const char *linha = strstr(texto, "[desempenho] ciclo=");
+    unsigned ciclo, acordado, heap, flash, enviados;
+    if (!linha || sscanf(linha, "[desempenho] ciclo=%u acordado_ms=%u heap_min=%u flash=%u enviados=%u", &ciclo,
+                         &acordado, &heap, &flash, &enviados) != 5)
+        return false;
+
+    a.ciclo = ciclo;
+    a.acordado_ms = acordado;
+    a.heap_minimo = heap;
+    a.bytes_flash = flash;
+    a.bytes_enviados = enviados;
+    a.estouros = verificarOrcamento(a);
+    return true;
+}
+
+// CLASSE MONITOR DE DESEMPENHO
+
+class MonitorDesempenho
+{
+private:
+    uint32_t flash_inicio;    // bytes_programados no inicio do ciclo
+    uint32_t enviados_inicio; // bytesEnviados do upload no inicio do ciclo
+    AmostraDesempenho ultima;
+
+public:
+    MonitorDesempenho()
+    {
+        flash_inicio = 0;
+        enviados_inicio = 0;
+        memset(&ultima, 0, sizeof(ultima));
+    }
+
+    /*
+     * no boot, antes de qualquer gravacao (o contador do upload comeca em 0)
+     */
+    void iniciar()
+    {
+        flash_inicio = estatisticas_flash.bytes_programados;
+        enviados_inicio = 0;
+    }
+
+    /*
+     * fecha o ciclo: acordado_ms da contabilidade de energia, enviados do
+     * GerenciadorUpload (total desde o boot); o proximo ciclo comeca aqui
+     */
+    const AmostraDesempenho &encerrarCiclo(uint32_t acordado_ms, uint32_t enviados)
+    {
+        EstatisticasDesempenho &e = estatisticas_desempenho;
+        e.ciclos++;
+
+        ultima.ciclo = e.ciclos;
+        ultima.acordado_ms = acordado_ms;
+        ultima.heap_minimo = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+        ultima.bytes_flash = estatisticas_flash.bytes_programados - flash_inicio;
+        ultima.bytes_enviados = enviados - enviados_inicio;
+        ultima.estouros = verificarOrcamento(ultima);
+        if (ultima.estouros)
+            e.acima_orcamento++;
+
+        flash_inicio = estatisticas_flash.bytes_programados;
+        enviados_inicio = enviados;
+
+        char linha[160];
+        formatarDesempenho(ultima, linha, sizeof(linha));
+        Serial.println(linha);
+        if (ultima.estouros)
+        {
+            Serial.println(String("[!] acima do orcamento:") + (ultima.estouros & ESTOURO_ACORDADO ? " acordado" : "") +
+                           (ultima.estouros & ESTOURO_HEAP ? " heap" : "") +
+                           (ultima.estouros & ESTOURO_FLASH ? " flash" : "") +
+                           (ultima.estouros & ESTOURO_ENVIADOS ? " enviados" : ""));
+        }
+        return ultima;
+    }
+
+    const AmostraDesempenho &obterUltima() const
+    {
+        return ultima;
+    }
+};
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef DIARIO_PARTICAO_H
+#define DIARIO_PARTICAO_H
+
+#include "codec_registro.h"
+#include "faixas_upload.h"
+#include "esp_partition.h"
+#include <string.h>
+
+/*
+ *  [i] logs das faixas numa particao crua da flash, lidos sem copia
+ *
+ *  a particao ("registros" no particoes.csv) e dividida em uma regiao por
+ *  faixa, e cada regiao e um anel de setores de 4 KiB. o setor comeca com
+ *  um cabecalho binario e a linha de cabecalho do csv, e recebe as linhas
+ *  do log como no arquivo, cada uma com '\n'. o que nao foi gravado fica
+ *  0xFF (flash apagada): o fim dos dados de um setor e o primeiro 0xFF,
+ *  byte que nenhuma linha de texto tem. uma linha nunca cruza setores.
+ *
+ *  a particao inteira e mapeada uma vez (esp_partition_mmap; mmap de um
+ *  arquivo no host) e a leitura entrega trechos que apontam direto para a
+ *  flash: sem VFS, sem buffer e sem String por linha. o esp-idf invalida o
+ *  cache do trecho a cada gravacao/apagamento, entao o mapa ve o que
+ *  acabou de ser gravado.
+ *
+ *  setor com todos os registros confirmados e liberado zerando a palavra
+ *  de estado do cabecalho (so 1 -> 0, sem apagar); o apagamento fica para
+ *  quando o anel volta a ele. nada de regravar o log a cada upload.
+ */
+
+const uint32_t TAMANHO_SETOR_DIARIO = 4096;     // setor de apagamento da flash
+const uint32_t MARCA_SETOR_DIARIO = 0x31474552; // "REG1"
+const uint32_t SETOR_ATIVO = 0xFFFFFFFF;        // estado ainda apagado
+const uint32_t SETOR_LIBERADO = 0;
+
+struct CabecalhoSetorDiario
+{
+    uint32_t marca;    // gravada por ultimo: setor com marca tem o cabecalho completo
+    uint32_t geracao;  // ordem do setor no anel da faixa; o indice e geracao % setores
+    uint32_t primeira; // seq do registro que abriu o setor
+    uint32_t estado;   // SETOR_ATIVO ate todos os registros serem confirmados
+};
+
+/*
+ * linha do log na flash mapeada, sem a quebra
+ * vale ate o setor ser reciclado (depois de confirmado)
+ */
+struct TrechoRegistro
+{
+    const char *dados;
+    size_t tamanho;
+};
+
+struct AnelFaixa
+{
+    uint32_t inicio;  // deslocamento da regiao na particao
+    uint32_t setores;
+    uint32_t cauda;   // geracao do setor ativo mais antigo
+    uint32_t cabeca;  // geracao do setor em gravacao (ou a ultima usada, com o anel vazio)
+    uint32_t escrita; // proximo byte livre no setor da cabeca
+    uint32_t ultima;  // maior seq gravado (0 = nenhum)
+    bool vazio;       // nenhum setor ativo
+};
+
+// CLASSE DIARIO PARTICAO
+
+class DiarioParticao
+{
+private:
+    const esp_partition_t *particao;
+    const uint8_t *mapa;
+    spi_flash_mmap_handle_t mapeamento;
+    const char *cabecalho; // linha de cabecalho do csv, sem quebra
+    size_t tamanho_cabecalho;
+    AnelFaixa aneis[NUMERO_FAIXAS];
+
+    uint32_t deslocamentoSetor(const AnelFaixa &anel, uint32_t geracao) const
+    {
+        return anel.inicio + (geracao % anel.setores) * TAMANHO_SETOR_DIARIO;
+    }
+
+    const uint8_t *setor(const AnelFaixa &anel, uint32_t geracao) const
+    {
+        return mapa + deslocamentoSetor(anel, geracao);
+    }
+
+    static const CabecalhoSetorDiario &cabecalhoDe(const uint8_t *setor)
+    {
+        return *(const CabecalhoSetorDiario *)setor;
+    }
+
+    /*
+     * inicio dos registros no setor: depois do cabecalho binario e da linha do csv
+     * 0 se o setor foi gravado com outro cabecalho (outra versao do formato)
+     */
+    uint32_t inicioRegistros(const uint8_t *setor) const
+    {
+        const char *linha = (const char *)setor + sizeof(CabecalhoSetorDiario);
+        if (memcmp(linha, cabecalho, tamanho_cabecalho) != 0 || linha[tamanho_cabecalho] != '\n')
+            return 0;
+        return sizeof(CabecalhoSetorDiario) + tamanho_cabecalho + 1;
+    }
+
+    /*
+     * primeiro byte apagado a partir de de (fim dos dados gravados)
+     */
+    static uint32_t fimDados(const uint8_t *setor, uint32_t de)
+    {
+        while (de < TAMANHO_SETOR_DIARIO && setor[de] != 0xFF)
+            de++;
+        return de;
+    }
+
+    /*
+     * maior seq entre as linhas do setor a partir de de (0 = nenhuma)
+     */
+    static uint32_t maiorSequencia(const uint8_t *setor, uint32_t de)
+    {
+        uint32_t maior = 0;
+        uint32_t fim = fimDados(setor, de);
+        while (de < fim)
+        {
+            const char *linha = (const char *)setor + de;
+            const char *quebra = (const char *)memchr(linha, '\n', fim - de);
+            if (!quebra)
+                break;
+            LeitorCampos leitor = {linha, quebra};
+            uint32_t sequencia;
+            if (leitor.natural(sequencia) && leitor.separador() && sequencia > maior)
+                maior = sequencia;
+            de = quebra + 1 - (const char *)setor;
+        }
+        return maior;
+    }
+
+    bool gravar(uint32_t deslocamento, const void *dados, size_t tamanho)
+    {
+        return esp_partition_write(particao, deslocamento, dados, tamanho) == ESP_OK;
+    }
+
+    bool liberarSetor(uint32_t deslocamento)
+    {
+        return gravar(deslocamento + offsetof(CabecalhoSetorDiario, estado), &SETOR_LIBERADO, sizeof(uint32_t));
+    }
+
+    /*
+     * apaga o setor da geracao e grava o cabecalho; primeira e o seq do
+     * registro que vai abri-lo. retorna os bytes programados (0 em erro)
+     */
+    uint32_t abrirSetor(AnelFaixa &anel, uint32_t geracao, uint32_t primeira)
+    {
+        uint32_t deslocamento = deslocamentoSetor(anel, geracao);
+        if (esp_partition_erase_range(particao, deslocamento, TAMANHO_SETOR_DIARIO) != ESP_OK)
+            return 0;
+
+        // a marca vai por ultimo: um cabecalho interrompido nao e reconhecido
+        CabecalhoSetorDiario novo = {MARCA_SETOR_DIARIO, geracao, primeira, SETOR_ATIVO};
+        uint32_t linha = deslocamento + sizeof(CabecalhoSetorDiario);
+        if (!gravar(deslocamento + offsetof(CabecalhoSetorDiario, geracao), &novo.geracao, 2 * sizeof(uint32_t)) ||
+            !gravar(linha, cabecalho, tamanho_cabecalho) || !gravar(linha + tamanho_cabecalho, "\n", 1) ||
+            !gravar(deslocamento, &novo.marca, sizeof(uint32_t)))
+            return 0;
+
+        if (anel.vazio)
+            anel.cauda = geracao;
+        anel.cabeca = geracao;
+        anel.escrita = sizeof(CabecalhoSetorDiario) + tamanho_cabecalho + 1;
+        anel.vazio = false;
+        return anel.escrita;
+    }
+
+public:
+    DiarioParticao() : particao(NULL), mapa(NULL), mapeamento(0), cabecalho(""), tamanho_cabecalho(0)
+    {
+        memset(aneis, 0, sizeof(aneis));
+    }
+
+    /*
+     * mapeia a particao e refaz os aneis a partir dos cabecalhos dos setores
+     * false sem a particao na tabela: os logs continuam no LittleFS
+     *
+     * setores gravados com outro cabecalho do csv sao entregues a
+     * aoFormatoAnterior(texto, tamanho) - cabecalho do csv e linhas - em
+     * ordem de geracao e liberados; o seq deles continua contando para a faixa
+     */
+    template <typename Visitante>
+    bool montar(const char *rotulo, const char *linha_cabecalho, Visitante aoFormatoAnterior)
+    {
+        particao = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, rotulo);
+        if (!particao)
+            return false;
+
+        uint32_t setores = particao->size / TAMANHO_SETOR_DIARIO / NUMERO_FAIXAS;
+        tamanho_cabecalho = strlen(linha_cabecalho);
+        if (setores < 2 || sizeof(CabecalhoSetorDiario) + tamanho_cabecalho + 1 >= TAMANHO_SETOR_DIARIO / 2 ||
+            esp_partition_mmap(particao, 0, particao->size, SPI_FLASH_MMAP_DATA, (const void **)&mapa,
+                               &mapeamento) != ESP_OK)
+        {
+            particao = NULL;
+            return false;
+        }
+        cabecalho = linha_cabecalho;
+
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            AnelFaixa &anel = aneis[f];
+            anel.inicio = f * setores * TAMANHO_SETOR_DIARIO;
+            anel.setores = setores;
+            anel.cauda = 0;
+            anel.cabeca = 0;
+            anel.escrita = 0;
+            anel.ultima = 0;
+            anel.vazio = true;
+
+            // as geracoes ativas sao contiguas: a menor e a cauda, a maior a cabeca
+            for (uint32_t i = 0; i < setores; i++)
+            {
+                uint32_t deslocamento = anel.inicio + i * TAMANHO_SETOR_DIARIO;
+                const uint8_t *s = mapa + deslocamento;
+                const CabecalhoSetorDiario &c = cabecalhoDe(s);
+                if (c.marca != MARCA_SETOR_DIARIO)
+                    continue;
+                if (anel.vazio && c.geracao > anel.cabeca)
+                    anel.cabeca = c.geracao; // a proxima geracao segue a maior ja usada
+                if (c.estado != SETOR_ATIVO)
+                    continue;
+
+                if (inicioRegistros(s) == 0)
+                {
+                    uint32_t maior = maiorSequencia(s, sizeof(CabecalhoSetorDiario));
+                    if (maior > anel.ultima)
+                        anel.ultima = maior;
+                    continue;
+                }
+                if (anel.vazio || c.geracao < anel.cauda)
+                    anel.cauda = c.geracao;
+                if (anel.vazio || c.geracao > anel.cabeca)
+                    anel.cabeca = c.geracao;
+                anel.vazio = false;
+            }
+
+            // formato anterior: entregues em ordem de geracao, como foram gravados
+            while (true)
+            {
+                const uint8_t *antigo = NULL;
+                for (uint32_t i = 0; i < setores; i++)
+                {
+                    const uint8_t *s = mapa + anel.inicio + i * TAMANHO_SETOR_DIARIO;
+                    const CabecalhoSetorDiario &c = cabecalhoDe(s);
+                    if (c.marca == MARCA_SETOR_DIARIO && c.estado == SETOR_ATIVO && inicioRegistros(s) == 0 &&
+                        (!antigo || c.geracao < cabecalhoDe(antigo).geracao))
+                        antigo = s;
+                }
+                if (!antigo)
+                    break;
+                uint32_t fim = fimDados(antigo, sizeof(CabecalhoSetorDiario));
+                aoFormatoAnterior((const char *)antigo + sizeof(CabecalhoSetorDiario), fim - sizeof(CabecalhoSetorDiario));
+                if (!liberarSetor(antigo - mapa))
+                    break;
+            }
+            if (anel.vazio)
+                continue;
+
+            // gravacao interrompida no meio de uma linha: a quebra fecha o
+            // trecho (o crc o rejeita) e a proxima linha comeca inteira
+            const uint8_t *s = setor(anel, anel.cabeca);
+            uint32_t registros = inicioRegistros(s);
+            anel.escrita = fimDados(s, registros);
+            if (anel.escrita > registros && anel.escrita < TAMANHO_SETOR_DIARIO && s[anel.escrita - 1] != '\n' &&
+                gravar(deslocamentoSetor(anel, anel.cabeca) + anel.escrita, "\n", 1))
+                anel.escrita++;
+
+            uint32_t maior = maiorSequencia(s, registros);
+            if (maior == 0)
+                maior = cabecalhoDe(s).primeira - 1;
+            if (maior > anel.ultima)
+                anel.ultima = maior;
+        }
+        return true;
+    }
+
+    bool montado() const
+    {
+        return particao != NULL;
+    }
+
+    /*
+     * grava linha (com a quebra) no fim do anel da faixa
+     * false com o anel cheio de registros nao confirmados ou erro da flash
+     * programados e apagados recebem o custo na flash (bytes, setores)
+     */
+    bool acrescentar(uint8_t faixa, const char *linha, size_t tamanho, uint32_t sequencia, uint32_t &programados,
+                     uint32_t &apagados)
+    {
+        AnelFaixa &anel = aneis[faixa];
+        programados = 0;
+        apagados = 0;
+        if (anel.vazio || anel.escrita + tamanho > TAMANHO_SETOR_DIARIO)
+        {
+            uint32_t proxima = anel.cabeca + 1;
+            if (!anel.vazio && proxima - anel.cauda >= anel.setores)
+                return false;
+            programados = abrirSetor(anel, proxima, sequencia);
+            apagados = 1;
+            if (programados == 0)
+                return false;
+        }
+
+        if (!gravar(deslocamentoSetor(anel, anel.cabeca) + anel.escrita, linha, tamanho))
+            return false;
+        anel.escrita += tamanho;
+        anel.ultima = sequencia;
+        programados += tamanho;
+        return true;
+    }
+
+    /*
+     * proxima linha da faixa a partir de posicao (0 = registro mais antigo)
+     * posicao passa para depois da linha; false no fim do log
+     *
+     * posicao e 1 + o deslocamento da quebra da linha na regiao da faixa,
+     * valida ate o proximo liberarAte
+     */
+    bool proximaLinha(uint8_t faixa, uint32_t &posicao, TrechoRegistro &trecho) const
+    {
+        const AnelFaixa &anel = aneis[faixa];
+        if (anel.vazio)
+            return false;
+
+        uint32_t geracao = anel.cauda;
+        uint32_t deslocamento = 0;
+        if (posicao > 0)
+        {
+            uint32_t relativo = posicao - 1;
+            const CabecalhoSetorDiario &c =
+                cabecalhoDe(mapa + anel.inicio + relativo / TAMANHO_SETOR_DIARIO * TAMANHO_SETOR_DIARIO);
+            if (c.marca == MARCA_SETOR_DIARIO && c.geracao >= anel.cauda && c.geracao <= anel.cabeca)
+            {
+                geracao = c.geracao;
+                deslocamento = relativo % TAMANHO_SETOR_DIARIO + 1;
+            }
+        }
+
+        const uint8_t *s = setor(anel, geracao);
+        if (deslocamento == 0)
+            deslocamento = inicioRegistros(s);
+        while (true)
+        {
+            if (deslocamento < TAMANHO_SETOR_DIARIO && s[deslocamento] != 0xFF)
+            {
+                const uint8_t *quebra = (const uint8_t *)memchr(s + deslocamento, '\n', TAMANHO_SETOR_DIARIO - deslocamento);
+                if (quebra)
+                {
+                    trecho.dados = (const char *)s + deslocamento;
+                    trecho.tamanho = quebra - (s + deslocamento);
+                    posicao = (quebra - mapa) - anel.inicio + 1;
+                    return true;
+                }
+            }
+            if (geracao == anel.cabeca)
+                return false;
+            s = setor(anel, ++geracao);
+            deslocamento = inicioRegistros(s);
+        }
+    }
+
+    /*
+     * libera os setores da cauda com todos os registros ate confirmada
+     * (o setor seguinte abriu depois dela); a cabeca fica, pois recebe os
+     * proximos registros. retorna quantos setores foram liberados
+     */
+    uint32_t liberarAte(uint8_t faixa, uint32_t confirmada)
+    {
+        AnelFaixa &anel = aneis[faixa];
+        uint32_t liberados = 0;
+        while (!anel.vazio && anel.cauda != anel.cabeca &&
+               cabecalhoDe(setor(anel, anel.cauda + 1)).primeira - 1 <= confirmada &&
+               liberarSetor(deslocamentoSetor(anel, anel.cauda)))
+        {
+            anel.cauda++;
+            liberados++;
+        }
+        return liberados;
+    }
+
+    uint32_t ultimaSequencia(uint8_t faixa) const
+    {
+        return aneis[faixa].ultima;
+    }
+
+    uint32_t setoresOcupados(uint8_t faixa) const
+    {
+        return aneis[faixa].vazio ? 0 : aneis[faixa].cabeca - aneis[faixa].cauda + 1;
+    }
+
+    uint32_t setoresPorFaixa() const
+    {
+        return aneis[0].setores;
+    }
+};
+
+// COPIA DA PARTICAO (ferramentas do host)
+
+/*
+ * percorre uma copia da particao (dump da flash) sem monta-la nem grava-la:
+ * para cada faixa, os setores com marca em ordem de geracao. visitar
+ * recebe (faixa, geracao, liberado, texto, tamanho), com texto = linha de
+ * cabecalho do csv do proprio setor e linhas, ate o primeiro 0xFF; uma
+ * linha interrompida fica sem a quebra no fim
+ */
+template <typename Visitante>
+inline void percorrerCopiaDiario(const uint8_t *dados, size_t tamanho, Visitante visitar)
+{
+    uint32_t setores = tamanho / TAMANHO_SETOR_DIARIO / NUMERO_FAIXAS;
+    for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+    {
+        const uint8_t *regiao = dados + (size_t)f * setores * TAMANHO_SETOR_DIARIO;
+        bool primeira = true;
+        uint32_t anterior = 0;
+
+        // proxima geracao acima da anterior: poucos setores por faixa, busca linear
+        for (;;)
+        {
+            const uint8_t *escolhido = NULL;
+            CabecalhoSetorDiario menor = {0, 0, 0, 0};
+            for (uint32_t i = 0; i < setores; i++)
+            {
+                CabecalhoSetorDiario c;
+                memcpy(&c, regiao + i * TAMANHO_SETOR_DIARIO, sizeof(c));
+                if (c.marca != MARCA_SETOR_DIARIO || (!primeira && c.geracao <= anterior))
+                    continue;
+                if (!escolhido || c.geracao < menor.geracao)
+                {
+                    escolhido = regiao + i * TAMANHO_SETOR_DIARIO;
+                    menor = c;
+                }
+            }
+            if (!escolhido)
+                break;
+
+            const uint8_t *texto = escolhido + sizeof(CabecalhoSetorDiario);
+            size_t disponivel = TAMANHO_SETOR_DIARIO - sizeof(CabecalhoSetorDiario);
+            const uint8_t *apagado = (const uint8_t *)memchr(texto, 0xFF, disponivel);
+            visitar(f, menor.geracao, menor.estado != SETOR_ATIVO, (const char *)texto,
+                    apagado ? (size_t)(apagado - texto) : disponivel);
+            primeira = false;
+            anterior = menor.geracao;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef ESTATISTICAS_FLASH_H
+#define ESTATISTICAS_FLASH_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "buffer_texto.h"
+
+/*
+ *  [i] instrumentacao de desgaste da flash
+ *
+ *  conta bytes pedidos pela aplicacao contra bytes programados e blocos
+ *  apagados de fato, para estimar amplificacao de escrita e vida util.
+ *
+ *  - com MONITORAR_FLASH (ver platformio.ini) as chamadas do LittleFS a
+ *    esp_partition_write/erase_range sao interceptadas via -Wl,--wrap
+ *  - sem o hook, um modelo do LittleFS estima o que seria gravado
+ *    (copia do bloco final no append + commit de metadados)
+ *  - logs na particao crua (diario_particao.h) contam o custo exato:
+ *    os bytes da linha e o setor apagado ao abrir um novo
+ */
+
+#ifdef MONITORAR_FLASH
+#include "esp_partition.h"
+#endif
+
+// GEOMETRIA DO LITTLEFS
+
+const uint32_t FLASH_TAMANHO_BLOCO = 4096;      // bloco de apagamento
+const uint32_t FLASH_TAMANHO_PROGRAMACAO = 256; // unidade minima de programacao
+
+// ESTRUTURA DOS CONTADORES
+
+struct EstatisticasFlash
+{
+    uint32_t bytes_solicitados; // bytes de registro pedidos pela aplicacao
+    uint32_t bytes_programados; // bytes efetivamente programados na flash
+    uint32_t blocos_apagados;   // blocos de 4 KiB apagados
+    uint32_t escritas;          // operacoes de gravacao da aplicacao
+    uint32_t commits_metadados; // commits desde a ultima compactacao (modelo)
+};
+
+// contadores mantidos na memoria RTC (sobrevivem ao deep sleep)
+RTC_DATA_ATTR EstatisticasFlash estatisticas_flash = {0, 0, 0, 0, 0};
+
+#ifdef MONITORAR_FLASH
+
+// HOOK DO DISPOSITIVO DE BLOCO
+
+extern "C"
+{
+    esp_err_t __real_esp_partition_write(const esp_partition_t *particao, size_t deslocamento,
+                                         const void *origem, size_t tamanho);
+    esp_err_t __real_esp_partition_erase_range(const esp_partition_t *particao, size_t deslocamento,
+                                               size_t tamanho);
+
+    esp_err_t __wrap_esp_partition_write(const esp_partition_t *particao, size_t deslocamento,
+                                         const void *origem, size_t tamanho)
+    {
+        if (particao->subtype == ESP_PARTITION_SUBTYPE_DATA_SPIFFS || particao->subtype == SUBTIPO_PARTICAO_REGISTROS)
+            estatisticas_flash.bytes_programados += tamanho;
+        return __real_esp_partition_write(particao, deslocamento, origem, tamanho);
+    }
+
+    esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *particao, size_t deslocamento,
+                                               size_t tamanho)
+    {
+        if (particao->subtype == ESP_PARTITION_SUBTYPE_DATA_SPIFFS || particao->subtype == SUBTIPO_PARTICAO_REGISTROS)
+            estatisticas_flash.blocos_apagados += tamanho / FLASH_TAMANHO_BLOCO;
+        return __real_esp_partition_erase_range(particao, deslocamento, tamanho);
+    }
+}
+
+#endif
+
+// CLASSE MONITOR DE FLASH
+
+class MonitorFlash
+{
+private:
+    /*
+     * modelo de custo de um open-append-close no LittleFS
+     * o ultimo bloco parcial do arquivo e copiado para um bloco novo,
+     * e cada close grava um commit no par de metadados
+     * a contagem de commits fica na RTC: um ciclo faz poucos appends,
+     * entao so acumulando entre boots o par chega a ser compactado
+     */
+    void estimarAppend(uint32_t tamanho_arquivo, uint32_t tamanho_escrita)
+    {
+        uint32_t resto_bloco = tamanho_arquivo % FLASH_TAMANHO_BLOCO;
+        uint32_t dados = resto_bloco + tamanho_escrita;
+        uint32_t programados = ((dados + FLASH_TAMANHO_PROGRAMACAO - 1) / FLASH_TAMANHO_PROGRAMACAO) * FLASH_TAMANHO_PROGRAMACAO;
+
+        estatisticas_flash.bytes_programados += programados + FLASH_TAMANHO_PROGRAMACAO;
+        estatisticas_flash.blocos_apagados += (dados + FLASH_TAMANHO_BLOCO - 1) / FLASH_TAMANHO_BLOCO;
+
+        // bloco de metadados enche e e compactado no outro bloco do par
+        estatisticas_flash.commits_metadados++;
+        if (estatisticas_flash.commits_metadados >= FLASH_TAMANHO_BLOCO / FLASH_TAMANHO_PROGRAMACAO)
+        {
+            estatisticas_flash.commits_metadados = 0;
+            estatisticas_flash.blocos_apagados++;
+            estatisticas_flash.bytes_programados += FLASH_TAMANHO_PROGRAMACAO;
+        }
+    }
+
+public:
+    /*
+     * registra uma gravacao da aplicacao
+     * tamanho_arquivo e o tamanho antes do append
+     */
+    void registrarEscrita(uint32_t tamanho_arquivo, uint32_t tamanho_escrita)
+    {
+        estatisticas_flash.bytes_solicitados += tamanho_escrita;
+        estatisticas_flash.escritas++;
+
+#ifndef MONITORAR_FLASH
+        estimarAppend(tamanho_arquivo, tamanho_escrita);
+#endif
+    }
+
+    /*
+     * registra uma gravacao direta na particao crua dos logs
+     * sem copia de bloco nem metadados: programados e apagados sao exatos
+     */
+    void registrarEscritaCrua(uint32_t tamanho_escrita, uint32_t programados, uint32_t apagados)
+    {
+        estatisticas_flash.bytes_solicitados += tamanho_escrita;
+        estatisticas_flash.escritas++;
+
+#ifndef MONITORAR_FLASH
+        estatisticas_flash.bytes_programados += programados;
+        estatisticas_flash.blocos_apagados += apagados;
+#endif
+    }
+
+    /*
+     * registra reescrita completa de um arquivo (ex: limpeza apos upload)
+     * nao conta como bytes solicitados de registro
+     */
+    void registrarReescrita(uint32_t tamanho_escrita)
+    {
+#ifndef MONITORAR_FLASH
+        estimarAppend(0, tamanho_escrita);
+#endif
+    }
+
+    /*
+     * bytes programados por byte util de registro
+     */
+    float amplificacaoEscrita() const
+    {
+        if (estatisticas_flash.bytes_solicitados == 0)
+            return 0.0;
+        return (float)estatisticas_flash.bytes_programados / estatisticas_flash.bytes_solicitados;
+    }
+
+    /*
+     * vida util projetada em dias, assumindo o wear leveling dinamico do
+     * LittleFS espalhando os apagamentos por todos os blocos da particao
+     */
+    float vidaUtilDias(uint32_t tamanho_particao, uint32_t periodo_ms) const
+    {
+        if (estatisticas_flash.escritas == 0 || estatisticas_flash.blocos_apagados == 0)
+            return 0.0;
+
+        float apagamentos_por_ciclo = (float)estatisticas_flash.blocos_apagados / estatisticas_flash.escritas;
+        float ciclos_por_dia = 86400000.0 / periodo_ms;
+        float total_apagamentos = (float)(tamanho_particao / FLASH_TAMANHO_BLOCO) * RESISTENCIA_CICLOS_FLASH;
+
+        return total_apagamentos / (apagamentos_por_ciclo * ciclos_por_dia);
+    }
+
+    const EstatisticasFlash &obterEstatisticas() const
+    {
+        return estatisticas_flash;
+    }
+
+    /*
+     * fragmento json para o payload de upload
+     */
+    void formatarJSON(BufferTexto &json, uint32_t tamanho_particao, uint32_t periodo_ms) const
+    {
+        json.acrescentar("\"flash\": {\"solicitados\": ").natural(estatisticas_flash.bytes_solicitados);
+        json.acrescentar(", \"programados\": ").natural(estatisticas_flash.bytes_programados);
+        json.acrescentar(", \"apagados\": ").natural(estatisticas_flash.blocos_apagados);
+        json.acrescentar(", \"amplificacao\": ").decimal(amplificacaoEscrita(), 2);
+        json.acrescentar(", \"vida_dias\": ").decimal(vidaUtilDias(tamanho_particao, periodo_ms), 0);
+        json.acrescentar('}');
+    }
+
+    void imprimirStatus(uint32_t tamanho_particao, uint32_t periodo_ms) const
+    {
+        Serial.println("estatisticas da flash:");
+#ifdef MONITORAR_FLASH
+        Serial.println("  fonte: hook do dispositivo de bloco");
+#else
+        Serial.println("  fonte: modelo estimado do LittleFS");
+#endif
+        Serial.println("  bytes solicitados: " + String(estatisticas_flash.bytes_solicitados));
+        Serial.println("  bytes programados: " + String(estatisticas_flash.bytes_programados));
+        Serial.println("  blocos apagados: " + String(estatisticas_flash.blocos_apagados));
+        Serial.println("  amplificacao de escrita: " + String(amplificacaoEscrita(), 2) + "x");
+        Serial.println("  vida util projetada: " + String(vidaUtilDias(tamanho_particao, periodo_ms) / 365.0, 1) + " anos");
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef FAIXAS_UPLOAD_H
+#define FAIXAS_UPLOAD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ *  [i] faixas de prioridade do upload
+ *
+ *  todo registro vai para a faixa bruta (historico completo); regras por
+ *  canal copiam o registro tambem para a faixa de alarme ou de resumo.
+ *  cada faixa tem arquivo e seq proprios, e o upload esvazia as faixas em
+ *  ordem: um alarme nao espera atras de dias de historico bruto.
+ *
+ *  regras (tabela REGRAS_FAIXAS no config.h):
+ *    ACIMA / ABAIXO: entra na faixa ao cruzar o limite e ao voltar, entao
+ *                    o servidor recebe o inicio e o fim de cada evento
+ *    VARIACAO:       entra quando o valor se afasta do ultimo registrado
+ *                    na faixa por pelo menos o limite (banda morta)
+ *
+ *  o limite de cada regra pode vir do servidor (chave limite<i> do delta
+ *  de config, i = posicao na tabela), dentro de [minimo, maximo].
+ *
+ *  sem Arduino, para as regras rodarem no host.
+ */
+
+enum Faixa
+{
+    FAIXA_ALARME, // ordem = prioridade de envio
+    FAIXA_RESUMO,
+    FAIXA_BRUTA,
+    NUMERO_FAIXAS
+};
+
+const uint8_t TODAS_FAIXAS = (1u << NUMERO_FAIXAS) - 1;
+
+struct DescritorFaixa
+{
+    const char *nome;             // campo "faixa" do lote no upload
+    const char *arquivo;          // log da faixa no LittleFS
+    const char *chave_nvs;        // proximo seq quando o log da faixa esta vazio
+    const char *chave_confirmada; // maior seq confirmado (log na particao crua)
+};
+
+/*
+ * a faixa bruta mantem o arquivo e a chave de antes das faixas
+ */
+inline const DescritorFaixa *faixas()
+{
+    static const DescritorFaixa tabela[NUMERO_FAIXAS] = {
+        {"alarme", "/alarmes.csv", "seq_alarme", "conf_alarme"},
+        {"resumo", "/resumo.csv", "seq_resumo", "conf_resumo"},
+        {"bruta", "/dados_log.csv", "sequencia", "conf_bruta"},
+    };
+    return tabela;
+}
+
+// REGRAS
+
+enum TipoRegra
+{
+    REGRA_ACIMA,
+    REGRA_ABAIXO,
+    REGRA_VARIACAO
+};
+
+struct RegraFaixa
+{
+    uint8_t faixa;
+    uint8_t canal;
+    uint8_t tipo;
+    float limite; // na unidade do canal
+    float minimo; // faixa aceita para o limite vindo do servidor
+    float maximo;
+};
+
+const uint8_t MAXIMO_REGRAS_FAIXA = 16; // estado de cada regra fica na memoria RTC
+
+struct EstadoRegra
+{
+    bool ativa;          // ACIMA / ABAIXO: limite cruzado na ultima leitura
+    bool com_referencia; // VARIACAO: ja houve registro na faixa
+    int32_t referencia;  // VARIACAO: valor do ultimo registro na faixa
+};
+
+/*
+ * valor e limite em ponto fixo do canal
+ * retorna true quando o registro deve entrar na faixa da regra
+ */
+inline bool avaliarRegra(uint8_t tipo, int32_t valor, int32_t limite, EstadoRegra &estado)
+{
+    if (tipo == REGRA_VARIACAO)
+    {
+        if (estado.com_referencia && labs((long)valor - estado.referencia) < limite)
+            return false;
+        estado.referencia = valor;
+        estado.com_referencia = true;
+        return true;
+    }
+
+    bool ativa = tipo == REGRA_ACIMA ? valor > limite : valor < limite;
+    bool mudou = ativa != estado.ativa;
+    estado.ativa = ativa;
+    return mudou;
+}
+
+#endif
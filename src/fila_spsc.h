@@ -0,0 +1,102 @@
+#ifndef FILA_SPSC_H
+#define FILA_SPSC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+ *  [i] fila lock-free de um produtor e um consumidor (SPSC)
+ *
+ *  capacidade fixa (potencia de 2), sem alocacao. o produtor so escreve
+ *  em cabeca e o consumidor so escreve em cauda, entao bastam atomicos
+ *  com acquire/release - nada de mutex entre os nucleos.
+ *
+ *  cada lado fica na sua propria linha de cache e guarda uma copia do
+ *  indice do outro lado: o indice remoto so e relido quando a copia
+ *  indica fila cheia (produtor) ou vazia (consumidor).
+ */
+
+#ifdef AMBIENTE_NATIVO
+const size_t TAMANHO_LINHA_CACHE = 64; // x86-64 / arm64 do host
+#else
+const size_t TAMANHO_LINHA_CACHE = 32; // linha do cache de flash/psram do ESP32
+#endif
+
+template <typename T, uint32_t CAPACIDADE>
+class FilaSPSC
+{
+    static_assert((CAPACIDADE & (CAPACIDADE - 1)) == 0, "capacidade deve ser potencia de 2");
+
+private:
+    // lado do produtor
+    alignas(TAMANHO_LINHA_CACHE) std::atomic<uint32_t> cabeca; // proxima posicao de escrita
+    uint32_t cauda_conhecida;                                   // ultima cauda lida pelo produtor
+
+    // lado do consumidor
+    alignas(TAMANHO_LINHA_CACHE) std::atomic<uint32_t> cauda; // proxima posicao de leitura
+    uint32_t cabeca_conhecida;                                 // ultima cabeca lida pelo consumidor
+
+    alignas(TAMANHO_LINHA_CACHE) T itens[CAPACIDADE];
+
+public:
+    FilaSPSC() : cabeca(0), cauda_conhecida(0), cauda(0), cabeca_conhecida(0) {}
+
+    /*
+     * chamado apenas pelo produtor
+     * retorna false se a fila estiver cheia
+     */
+    bool inserir(const T &item)
+    {
+        uint32_t posicao = cabeca.load(std::memory_order_relaxed);
+        if (posicao - cauda_conhecida == CAPACIDADE)
+        {
+            cauda_conhecida = cauda.load(std::memory_order_acquire);
+            if (posicao - cauda_conhecida == CAPACIDADE)
+                return false;
+        }
+
+        itens[posicao & (CAPACIDADE - 1)] = item;
+        cabeca.store(posicao + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+     * chamado apenas pelo consumidor
+     * retorna false se a fila estiver vazia
+     */
+    bool remover(T &item)
+    {
+        uint32_t posicao = cauda.load(std::memory_order_relaxed);
+        if (posicao == cabeca_conhecida)
+        {
+            cabeca_conhecida = cabeca.load(std::memory_order_acquire);
+            if (posicao == cabeca_conhecida)
+                return false;
+        }
+
+        item = itens[posicao & (CAPACIDADE - 1)];
+        cauda.store(posicao + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+     * aproximado quando chamado com os dois lados ativos
+     */
+    uint32_t tamanho() const
+    {
+        return cabeca.load(std::memory_order_acquire) - cauda.load(std::memory_order_acquire);
+    }
+
+    bool vazia() const
+    {
+        return tamanho() == 0;
+    }
+
+    static constexpr uint32_t capacidade()
+    {
+        return CAPACIDADE;
+    }
+};
+
+#endif
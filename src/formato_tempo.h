@@ -0,0 +1,92 @@
+#ifndef FORMATO_TEMPO_H
+#define FORMATO_TEMPO_H
+
+#include <stdint.h>
+
+/*
+ *  [i] formatacao de data/hora sob demanda
+ *
+ *  os registros guardam apenas o epoch; o texto so e gerado na exibicao ou
+ *  na exportacao. conversao civil-from-days (algoritmo de H. Hinnant), sem
+ *  localtime/strftime, sem banco de fusos e sem alocacao.
+ */
+
+const uint8_t TAMANHO_DATA_HORA = 20; // "2024-01-15 14:30:25" + '\0'
+
+struct DataCivil
+{
+    int32_t ano;
+    uint8_t mes;     // 1 a 12
+    uint8_t dia;     // 1 a 31
+    uint8_t hora;    // 0 a 23
+    uint8_t minuto;  // 0 a 59
+    uint8_t segundo; // 0 a 59
+};
+
+/*
+ * converte segundos desde 1970-01-01 (ja com o fuso aplicado) em data civil
+ */
+inline DataCivil dataCivilDeEpoch(int64_t segundos)
+{
+    DataCivil data;
+
+    int64_t dias = segundos / 86400;
+    int32_t resto = (int32_t)(segundos % 86400);
+    if (resto < 0)
+    {
+        resto += 86400;
+        dias--;
+    }
+
+    data.hora = resto / 3600;
+    data.minuto = (resto % 3600) / 60;
+    data.segundo = resto % 60;
+
+    // eras de 400 anos comecando em 0000-03-01
+    dias += 719468;
+    int64_t era = (dias >= 0 ? dias : dias - 146096) / 146097;
+    uint32_t dia_da_era = (uint32_t)(dias - era * 146097);
+    uint32_t ano_da_era = (dia_da_era - dia_da_era / 1460 + dia_da_era / 36524 - dia_da_era / 146096) / 365;
+    uint32_t dia_do_ano = dia_da_era - (365 * ano_da_era + ano_da_era / 4 - ano_da_era / 100);
+    uint32_t mes_marco = (5 * dia_do_ano + 2) / 153;
+
+    data.dia = dia_do_ano - (153 * mes_marco + 2) / 5 + 1;
+    data.mes = mes_marco < 10 ? mes_marco + 3 : mes_marco - 9;
+    data.ano = (int32_t)(ano_da_era + era * 400) + (data.mes <= 2);
+
+    return data;
+}
+
+inline char *escreverDigitos(char *destino, uint32_t valor, uint8_t digitos)
+{
+    for (int8_t i = digitos - 1; i >= 0; i--)
+    {
+        destino[i] = '0' + valor % 10;
+        valor /= 10;
+    }
+    return destino + digitos;
+}
+
+/*
+ * escreve "AAAA-MM-DD hh:mm:ss" em destino (minimo TAMANHO_DATA_HORA bytes)
+ * fuso_s e o deslocamento do fuso em segundos (ex: -3 * 3600)
+ */
+inline void formatarDataHora(uint32_t epoch, int32_t fuso_s, char *destino)
+{
+    DataCivil data = dataCivilDeEpoch((int64_t)epoch + fuso_s);
+
+    char *p = escreverDigitos(destino, data.ano, 4);
+    *p++ = '-';
+    p = escreverDigitos(p, data.mes, 2);
+    *p++ = '-';
+    p = escreverDigitos(p, data.dia, 2);
+    *p++ = ' ';
+    p = escreverDigitos(p, data.hora, 2);
+    *p++ = ':';
+    p = escreverDigitos(p, data.minuto, 2);
+    *p++ = ':';
+    p = escreverDigitos(p, data.segundo, 2);
+    *p = '\0';
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef GERADOR_CARGA_H
+#define GERADOR_CARGA_H
+
+#include "codec_registro.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+/*
+ *  [i] gerador de carga sintetica para os sensores simulados
+ *
+ *  cada canal tem seu proprio perfil e sua propria semente, de modo que a
+ *  mesma configuracao sempre reproduz a mesma sequencia. nao depende do
+ *  Arduino, entao o mesmo codigo alimenta benchmarks no host.
+ */
+
+const float PI_2_CARGA = 6.28318530718f;
+
+// PERFIS DISPONIVEIS
+
+enum PerfilCarga
+{
+    PERFIL_SENOIDE, // oscilacao suave com o periodo configurado
+    PERFIL_DIURNO,  // meia onda positiva (ex: luz do dia), zero a noite
+    PERFIL_DEGRAU,  // alterna entre base e base + amplitude a cada meio periodo
+    PERFIL_REPLAY   // reproduz amostras gravadas (trace CSV)
+};
+
+// CONFIGURACAO DE UM CANAL
+
+struct ConfigCanalMock
+{
+    PerfilCarga perfil;
+    float base;        // valor medio (ou nivel baixo do degrau)
+    float amplitude;   // amplitude da oscilacao ou altura do degrau
+    uint32_t periodo;  // periodo do perfil em segundos
+    uint32_t fase;     // deslocamento do perfil em segundos
+    float ruido;       // desvio padrao do ruido gaussiano somado
+    float prob_falha;  // probabilidade de dropout por amostra (0 a 1)
+    uint32_t semente;  // semente do PRNG do canal
+};
+
+/*
+ *  [i] PRNG xorshift32: rapido, sem alocacao e deterministico
+ */
+class GeradorAleatorio
+{
+private:
+    uint32_t estado;
+
+public:
+    GeradorAleatorio(uint32_t semente = 1)
+    {
+        reiniciar(semente);
+    }
+
+    void reiniciar(uint32_t semente)
+    {
+        estado = semente ? semente : 0x9E3779B9;
+    }
+
+    uint32_t proximo()
+    {
+        estado ^= estado << 13;
+        estado ^= estado >> 17;
+        estado ^= estado << 5;
+        return estado;
+    }
+
+    // uniforme em [0, 1)
+    float uniforme()
+    {
+        return (proximo() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // normal aproximada (Irwin-Hall com 4 uniformes, desvio 1)
+    float normal()
+    {
+        float soma = uniforme() + uniforme() + uniforme() + uniforme();
+        return (soma - 2.0f) * 1.7320508f;
+    }
+};
+
+/*
+ *  [i] canal simulado independente
+ */
+class CanalMock
+{
+private:
+    ConfigCanalMock config;
+    GeradorAleatorio aleatorio;
+
+    // amostras de replay (memoria do chamador, nao copiada)
+    const float *trace;
+    size_t tamanho_trace;
+    size_t posicao_trace;
+
+    float valorPerfil(uint32_t tempo_s)
+    {
+        float angulo = PI_2_CARGA * (float)((tempo_s + config.fase) % config.periodo) / config.periodo;
+
+        switch (config.perfil)
+        {
+        case PERFIL_SENOIDE:
+            return config.base + config.amplitude * sinf(angulo);
+
+        case PERFIL_DIURNO:
+        {
+            float dia = sinf(angulo);
+            return config.base + (dia > 0.0f ? config.amplitude * dia : 0.0f);
+        }
+
+        case PERFIL_DEGRAU:
+            return ((tempo_s + config.fase) % config.periodo) < config.periodo / 2
+                       ? config.base
+                       : config.base + config.amplitude;
+
+        case PERFIL_REPLAY:
+        default:
+        {
+            if (tamanho_trace == 0)
+                return NAN;
+            float valor = trace[posicao_trace];
+            posicao_trace = (posicao_trace + 1) % tamanho_trace;
+            return valor;
+        }
+        }
+    }
+
+public:
+    CanalMock()
+    {
+        ConfigCanalMock padrao = {PERFIL_SENOIDE, 0.0f, 1.0f, 3600, 0, 0.0f, 0.0f, 1};
+        configurar(padrao);
+    }
+
+    void configurar(const ConfigCanalMock &nova_config)
+    {
+        config = nova_config;
+        if (config.periodo == 0)
+            config.periodo = 1;
+        trace = NULL;
+        tamanho_trace = 0;
+        reiniciar();
+    }
+
+    /*
+     * troca o perfil para replay das amostras informadas
+     * o buffer precisa continuar valido enquanto o canal for usado
+     */
+    void configurarReplay(const float *amostras, size_t quantidade)
+    {
+        config.perfil = PERFIL_REPLAY;
+        trace = amostras;
+        tamanho_trace = quantidade;
+        posicao_trace = 0;
+    }
+
+    /*
+     * volta ao inicio da sequencia (mesma semente, mesmo resultado)
+     */
+    void reiniciar()
+    {
+        aleatorio.reiniciar(config.semente);
+        posicao_trace = 0;
+    }
+
+    /*
+     * gera uma amostra para o instante tempo_s
+     * retorna false quando o canal simula uma falha (dropout)
+     */
+    bool gerar(uint32_t tempo_s, float &valor)
+    {
+        valor = valorPerfil(tempo_s);
+
+        if (config.ruido > 0.0f)
+            valor += config.ruido * aleatorio.normal();
+
+        if (config.prob_falha > 0.0f && aleatorio.uniforme() < config.prob_falha)
+        {
+            valor = NAN;
+            return false;
+        }
+
+        return !isnan(valor);
+    }
+
+    /*
+     * gera um lote de amostras sem alocacao (usado nos benchmarks do host)
+     * retorna quantas amostras foram validas
+     */
+    size_t gerarLote(uint32_t tempo_inicial, uint32_t passo_s, size_t quantidade,
+                     float *valores, bool *validos)
+    {
+        size_t total_validos = 0;
+        for (size_t i = 0; i < quantidade; i++)
+        {
+            validos[i] = gerar(tempo_inicial + i * passo_s, valores[i]);
+            if (validos[i])
+                total_validos++;
+        }
+        return total_validos;
+    }
+
+    const ConfigCanalMock &obterConfig() const
+    {
+        return config;
+    }
+};
+
+/*
+ * extrai os valores de um canal de um trace CSV (formato do dados_log.csv)
+ * o canal e achado pelo nome no cabecalho e a linha e decodificada pelo
+ * codec_registro: registros sem o canal no mapa e linhas corrompidas ou
+ * malformadas sao pulados. uma linha que nao comeca com digito e tomada
+ * como cabecalho (logs concatenados)
+ * retorna o numero de amostras gravadas em destino
+ */
+inline size_t lerTraceCSV(const char *texto, const char *canal, float *destino, size_t maximo)
+{
+    size_t quantidade = 0;
+    const char *linha = texto;
+    FormatoLog formato;
+    formato.valido = false;
+    int8_t indice = -1; // bit do canal no mapa do cabecalho atual
+    LinhaDecodificada decodificada;
+
+    while (*linha && quantidade < maximo)
+    {
+        const char *fim = linha;
+        while (*fim && *fim != '\n')
+            fim++;
+
+        if (*linha < '0' || *linha > '9')
+        {
+            formato = formatoDoCabecalho(linha, fim - linha);
+            indice = -1;
+            for (uint8_t i = 0; formato.valido && i < formato.canais; i++)
+            {
+                if (formato.tamanhos_nomes[i] == strlen(canal) &&
+                    memcmp(formato.nomes[i], canal, formato.tamanhos_nomes[i]) == 0)
+                    indice = i;
+            }
+        }
+        else if (indice >= 0)
+        {
+            ResultadoLinha resultado = decodificarLinhaRegistro(linha, fim - linha, formato, decodificada);
+            if ((resultado == LINHA_INTEGRA || resultado == LINHA_NAO_VERIFICADA) &&
+                ((decodificada.mapa >> indice) & 1u))
+            {
+                uint8_t posicao = __builtin_popcount(decodificada.mapa & ((1u << indice) - 1u));
+                destino[quantidade++] = valorReal(decodificada.valores[posicao], decodificada.casas[posicao]);
+            }
+        }
+
+        linha = *fim ? fim + 1 : fim;
+    }
+
+    return quantidade;
+}
+
+#endif
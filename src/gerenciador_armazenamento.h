@@ -3,63 +3,396 @@
 
 #include "config.h"
 #include "Arduino.h"
+#include "arena_ciclo.h"
+#include "codec_registro.h"
+#include "diario_particao.h"
+#include "gerenciador_config.h"
 #include "gerenciador_sensores.h"
 #include "gerenciador_time.h"
+#include "estatisticas_flash.h"
+#include "faixas_upload.h"
+#include "plataforma.h"
+#include "LittleFS.h"
+#include <Preferences.h>
 
-// BIBLIOTECAS LittleFS
+// BACKEND DE ARQUIVOS
 
-#ifdef AMBIENTE_WOKWI
-// wokwi: simulacao
-#include <FS.h>
-#else
-// esp32 fisico: LittleFS real
-#include "LittleFS.h"
-#endif
+/*
+ *  [i] LittleFS nas tres plataformas: flash real, flash emulada pelo wokwi
+ *  ou diretorio do host (stand-in nativo)
+ */
+struct ArquivosLittleFS
+{
+    static bool montar() { return LittleFS.begin(true); }
+    static File abrir(const char *caminho, const char *modo)
+    {
+        TrechoComHeap descritor; // o vfs aloca o descritor do arquivo
+        return LittleFS.open(caminho, modo);
+    }
+    static bool existe(const char *caminho) { return LittleFS.exists(caminho); }
+    static bool renomear(const char *de, const char *para) { return LittleFS.rename(de, para); }
+    static uint32_t capacidade() { return LittleFS.totalBytes(); }
+};
+
+// LEITURA EM BLOCOS
+
+const size_t TAMANHO_BLOCO_LEITURA = 512;
+
+/*
+ *  [i] linhas de um arquivo lidas em blocos, sem String por linha
+ *  cada linha e um trecho do proprio bloco; a que cruza o fim do bloco e
+ *  movida para o inicio antes da proxima leitura
+ */
+struct LeitorLinhas
+{
+    File &arquivo;
+    char bloco[TAMANHO_BLOCO_LEITURA];
+    size_t inicio;    // proxima linha no bloco
+    size_t fim;       // bytes validos no bloco
+    uint32_t posicao; // posicao no arquivo de bloco[0]
+
+    LeitorLinhas(File &f) : arquivo(f), inicio(0), fim(0), posicao(f.position()) {}
+
+    /*
+     * proxima linha (sem a quebra); seguinte recebe a posicao depois dela
+     * linha maior que o bloco ou sem quebra no fim do arquivo vem como esta
+     */
+    bool proxima(const char *&linha, size_t &tamanho, uint32_t &seguinte)
+    {
+        while (true)
+        {
+            const char *quebra = (const char *)memchr(bloco + inicio, '\n', fim - inicio);
+            size_t lidos = 0;
+            if (!quebra && !(inicio == 0 && fim == sizeof(bloco)))
+            {
+                memmove(bloco, bloco + inicio, fim - inicio);
+                posicao += inicio;
+                fim -= inicio;
+                inicio = 0;
+                lidos = arquivo.read((uint8_t *)bloco + fim, sizeof(bloco) - fim);
+                fim += lidos;
+                if (lidos > 0)
+                    continue;
+            }
+            if (!quebra && fim == inicio)
+                return false;
+
+            linha = bloco + inicio;
+            tamanho = quebra ? quebra - linha : fim - inicio;
+            inicio += tamanho + (quebra ? 1 : 0);
+            seguinte = posicao + inicio;
+            return true;
+        }
+    }
+};
 
 // ESTRUTURA PARA REGISTRO COMPLETO
 
 struct RegistroDados
 {
+    uint32_t sequencia; // numero do registro na faixa, continuo entre reboots
     DadosTempo tempo;
     DadosSensores sensores;
-    uint32_t checksum;
+    uint32_t checksum; // crc32 da linha gravada (codec_registro.h)
+};
+
+/*
+ *  [i] envio em andamento de uma faixa (RAM, vale para a sessao de upload)
+ *  lotes confirmados so avancam a posicao; o log e regravado (LittleFS) ou
+ *  tem os setores confirmados liberados (particao) uma vez no fim da
+ *  sessao (consolidarEnvio), nao a cada lote
+ */
+struct ProgressoFaixa
+{
+    uint32_t confirmada;  // maior seq confirmado pelo servidor
+    uint32_t posicao;     // inicio do proximo lote no log (0 = primeiro registro)
+    uint32_t fim_lote;    // posicao apos o ultimo lote lido
+    uint32_t ultima_lote; // seq da ultima linha do ultimo lote lido
+    bool regravar;        // ha registros confirmados ainda no arquivo
 };
 
 // CLASSE GERENCIADOR ARMAZENAMENTO
 
-class GerenciadorArmazenamento
+template <typename Arquivos>
+class GerenciadorArmazenamentoBase
 {
 private:
     bool sistema_arquivos_inicializado;
-    const char *nome_arquivo = "/dados_log.csv";
+    const char *nome_arquivo = faixas()[FAIXA_BRUTA].arquivo;
+    const char *nome_arquivo_anterior = "/dados_log_anterior.csv"; // log em formato antigo
+    const char *nome_arquivo_temporario = "/dados_log.tmp";         // registros ainda nao confirmados
+    String cabecalho_csv; // seq,timestamp,incerteza_ms,mapa,marcas,<canais da tabela>,crc32
+    const char *nome_arquivo_exportacao = "/faixa_exportada.csv";  // copia de um log da particao
+    MonitorFlash monitor_flash;
+    DiarioParticao diario; // logs das faixas na particao crua, quando a tabela a tem
+    uint32_t proxima_sequencia[NUMERO_FAIXAS]; // atribuida ao proximo registro gravado em cada faixa
+    ProgressoFaixa progresso[NUMERO_FAIXAS];
+
+    /*
+     * linha do registro pelo codec compartilhado com as ferramentas do host
+     * so os canais presentes: mapa e marcas em hexa, valores em ponto fixo, crc32 da linha
+     */
+    size_t formatarRegistroCSV(const RegistroDados &registro, char *linha, uint32_t &crc)
+    {
+        return formatarLinhaRegistro(registro.sequencia, registro.tempo.epoch, registro.tempo.incerteza_ms,
+                                     registro.sensores.canais, GerenciadorSensores::canais(), linha, crc);
+    }
 
-    uint32_t calcularChecksum(const RegistroDados &registro)
+    /*
+     * maior seq entre as ultimas linhas completas do log da faixa (0 = sem registros)
+     * le so o fim do arquivo; linha sem quebra (gravacao interrompida) nao conta
+     */
+    uint32_t ultimaSequenciaGravada(uint8_t faixa)
     {
-        uint32_t checksum = 0;
-        checksum += (uint32_t)registro.tempo.epoch;
-        checksum += (uint32_t)(registro.sensores.temperatura * 100);
-        checksum += (uint32_t)(registro.sensores.luminosidade * 100);
-        checksum += registro.sensores.timestamp_leitura;
-        return checksum;
+        if (diario.montado())
+            return diario.ultimaSequencia(faixa);
+
+        File arquivo = Arquivos::abrir(faixas()[faixa].arquivo, "r");
+        if (!arquivo)
+            return 0;
+
+        char final[2 * (tamanhoMaximoLinhaRegistro(NUMERO_CANAIS) + 2)];
+        size_t tamanho = arquivo.size();
+        size_t inicio = tamanho > sizeof(final) ? tamanho - sizeof(final) : 0;
+        arquivo.seek(inicio);
+        size_t lidos = arquivo.read((uint8_t *)final, sizeof(final));
+        arquivo.close();
+
+        // a primeira linha do trecho pode estar cortada
+        size_t i = 0;
+        if (inicio > 0)
+        {
+            while (i < lidos && final[i] != '\n')
+                i++;
+            i++;
+        }
+
+        uint32_t maior = 0;
+        while (i < lidos)
+        {
+            size_t fim = i;
+            while (fim < lidos && final[fim] != '\n')
+                fim++;
+            if (fim == lidos)
+                break;
+
+            LeitorCampos leitor = {final + i, final + fim};
+            uint32_t sequencia;
+            if (leitor.natural(sequencia) && leitor.separador() && sequencia > maior)
+                maior = sequencia;
+            i = fim + 1;
+        }
+        return maior;
+    }
+
+    static uint32_t sequenciaDaLinha(const char *linha, size_t tamanho)
+    {
+        LeitorCampos leitor = {linha, linha + tamanho};
+        uint32_t sequencia;
+        return leitor.natural(sequencia) ? sequencia : 0;
+    }
+
+    /*
+     * abre o log da faixa em posicao (0 = primeiro registro, apos o cabecalho)
+     */
+    File abrirPendentes(uint8_t faixa, uint32_t posicao)
+    {
+        File arquivo = Arquivos::abrir(faixas()[faixa].arquivo, "r");
+        if (!arquivo)
+            return arquivo;
+
+        if (posicao > 0 && posicao <= arquivo.size())
+            arquivo.seek(posicao);
+        else
+            while (arquivo.available() && arquivo.read() != '\n') // pula cabecalho, sem String
+                ;
+        return arquivo;
     }
 
-    String formatarRegistroCSV(const RegistroDados &registro)
+    /*
+     * seq confirmado vai para o NVS: com o log na particao os registros
+     * confirmados ficam no setor da cabeca, e nao podem voltar apos um reboot
+     */
+    bool guardarConfirmada(uint8_t faixa)
     {
-        String linha = "";
-        linha += String(registro.tempo.epoch) + ",";
-        linha += String(registro.tempo.data_hora) + ",";
-        linha += String(registro.sensores.temperatura, 2) + ",";
-        linha += String(registro.sensores.luminosidade, 2) + ",";
-        linha += String(registro.sensores.temperatura_valida ? "1" : "0") + ",";
-        linha += String(registro.sensores.luminosidade_valida ? "1" : "0") + ",";
-        linha += String(registro.checksum);
-        return linha;
+        Preferences nvs;
+        bool guardou = nvs.begin(ESPACO_NVS_CONFIG, false) &&
+                       nvs.putUInt(faixas()[faixa].chave_confirmada, progresso[faixa].confirmada) == sizeof(uint32_t);
+        nvs.end();
+        if (!guardou)
+            Serial.println("erro: nao foi possivel guardar a confirmacao no NVS");
+        return guardou;
+    }
+
+    /*
+     * fim da sessao na particao: libera os setores ja confirmados
+     */
+    bool liberarConfirmados(uint8_t faixa)
+    {
+        if (!guardarConfirmada(faixa))
+            return false;
+        uint32_t liberados = diario.liberarAte(faixa, progresso[faixa].confirmada);
+        progresso[faixa].posicao = 0;
+        progresso[faixa].regravar = false;
+        Serial.println("faixa " + String(faixas()[faixa].nome) + ": " + String(liberados) + " setor(es) liberado(s), " +
+                       String(diario.setoresOcupados(faixa)) + " em uso");
+        return true;
+    }
+
+    /*
+     * log da faixa na particao copiado para um arquivo do LittleFS
+     * (exportacao pelo console e ferramentas que leem o log como arquivo)
+     */
+    File copiarFaixa(uint8_t faixa)
+    {
+        File arquivo = Arquivos::abrir(nome_arquivo_exportacao, "w");
+        if (!arquivo)
+            return arquivo;
+        uint32_t bytes_escritos = arquivo.println(cabecalho_csv);
+        uint32_t confirmada = progresso[faixa].confirmada;
+        percorrerFaixa(faixa, 0, [&](const char *linha, size_t tamanho, uint32_t, uint32_t) -> bool {
+            if (sequenciaDaLinha(linha, tamanho) > confirmada)
+            {
+                bytes_escritos += arquivo.write((const uint8_t *)linha, tamanho);
+                bytes_escritos += arquivo.println();
+            }
+            return true;
+        });
+        arquivo.close();
+        monitor_flash.registrarReescrita(bytes_escritos);
+        return Arquivos::abrir(nome_arquivo_exportacao, "r");
+    }
+
+    /*
+     * setor da particao gravado com outro cabecalho do csv: vai para o log
+     * anterior no LittleFS (exportacao offline), como o log em arquivo
+     */
+    void preservarFormatoAnterior(const char *texto, size_t tamanho)
+    {
+        File arquivo = Arquivos::abrir(nome_arquivo_anterior, "a");
+        if (!arquivo)
+            return;
+
+        // a linha de cabecalho do setor so abre um arquivo novo
+        const char *quebra = (const char *)memchr(texto, '\n', tamanho);
+        if (arquivo.size() > 0 && quebra)
+        {
+            tamanho -= quebra + 1 - texto;
+            texto = quebra + 1;
+        }
+        uint32_t bytes_escritos = arquivo.write((const uint8_t *)texto, tamanho);
+        arquivo.close();
+        monitor_flash.registrarReescrita(bytes_escritos);
+    }
+
+    /*
+     * acrescenta o registro ao log da faixa com o proximo seq dela
+     */
+    bool gravarNaFaixa(uint8_t faixa, RegistroDados &registro)
+    {
+        registro.sequencia = proxima_sequencia[faixa];
+        char linha_csv[tamanhoMaximoLinhaRegistro(NUMERO_CANAIS) + 1];
+        size_t tamanho = formatarRegistroCSV(registro, linha_csv, registro.checksum);
+
+        if (diario.montado())
+        {
+            linha_csv[tamanho++] = '\n';
+            uint32_t programados, apagados;
+            if (!diario.acrescentar(faixa, linha_csv, tamanho, registro.sequencia, programados, apagados))
+            {
+                Serial.println("falha ao gravar na particao - faixa " + String(faixas()[faixa].nome) +
+                               " cheia de registros nao confirmados?");
+                return false;
+            }
+            monitor_flash.registrarEscritaCrua(tamanho, programados, apagados);
+            proxima_sequencia[faixa]++;
+            return true;
+        }
+
+        File arquivo = Arquivos::abrir(faixas()[faixa].arquivo, "a");
+        if (!arquivo)
+        {
+            Serial.println("falha ao abrir arquivo da faixa " + String(faixas()[faixa].nome));
+            return false;
+        }
+        uint32_t tamanho_anterior = arquivo.size();
+        uint32_t bytes_escritos = 0;
+        if (tamanho_anterior == 0)
+        {
+            bytes_escritos += arquivo.println(cabecalho_csv);
+        }
+        size_t bytes_linha = arquivo.println(linha_csv);
+        bytes_escritos += bytes_linha;
+        arquivo.close();
+        monitor_flash.registrarEscrita(tamanho_anterior, bytes_escritos);
+        if (bytes_linha == 0)
+        {
+            // sistema de arquivos cheio: o registro nao foi gravado
+            Serial.println("falha ao gravar no arquivo da faixa " + String(faixas()[faixa].nome));
+            return false;
+        }
+        proxima_sequencia[faixa]++;
+        return true;
+    }
+
+    /*
+     * log da faixa so com o cabecalho: tudo confirmado
+     * o proximo seq vai antes para o NVS, porque o log vazio nao o guarda mais
+     */
+    bool esvaziarFaixa(uint8_t faixa)
+    {
+        if (diario.montado())
+            return liberarConfirmados(faixa);
+
+        Preferences nvs;
+        if (!nvs.begin(ESPACO_NVS_CONFIG, false) ||
+            nvs.putUInt(faixas()[faixa].chave_nvs, proxima_sequencia[faixa]) != sizeof(uint32_t))
+        {
+            Serial.println("erro: nao foi possivel guardar a sequencia no NVS");
+            nvs.end();
+            return false;
+        }
+        nvs.end();
+
+        File arquivo = Arquivos::abrir(faixas()[faixa].arquivo, "w");
+        if (!arquivo)
+        {
+            Serial.println("erro: nao foi possivel limpar arquivo");
+            return false;
+        }
+        uint32_t bytes_escritos = arquivo.println(cabecalho_csv);
+        arquivo.close();
+        monitor_flash.registrarReescrita(bytes_escritos);
+
+        progresso[faixa].posicao = 0;
+        progresso[faixa].regravar = false;
+        return true;
+    }
+
+    uint32_t calcularChecksum(const RegistroDados &registro)
+    {
+        char linha[tamanhoMaximoLinhaRegistro(NUMERO_CANAIS) + 1];
+        uint32_t crc;
+        formatarRegistroCSV(registro, linha, crc);
+        return crc;
     }
 
 public:
-    GerenciadorArmazenamento()
+    GerenciadorArmazenamentoBase()
     {
         sistema_arquivos_inicializado = false;
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            proxima_sequencia[f] = 1;
+            progresso[f] = {0, 0, 0, 0, false};
+        }
+
+        cabecalho_csv = "seq,timestamp,incerteza_ms,mapa,marcas";
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            cabecalho_csv += "," + String(GerenciadorSensores::canais()[i].nome);
+        }
+        cabecalho_csv += ",crc32";
     }
 
     // METODOS EXISTENTES (mantidos iguais)
@@ -68,20 +401,49 @@ public:
     {
         Serial.println("\ninicializando LittleFS...");
 
-#ifdef AMBIENTE_WOKWI
-        Serial.println("wokwi: sistema de arquivos simulado");
-        sistema_arquivos_inicializado = true;
-#else
-        if (!LittleFS.begin(true))
+        if (!Arquivos::montar())
         {
             Serial.println("falha ao montar LittleFS");
             return false;
         }
         Serial.println("LittleFS montado com sucesso");
         sistema_arquivos_inicializado = true;
-#endif
+
+        // com a particao "registros" na tabela, os logs das faixas ficam nela
+        uint32_t setores_anteriores = 0;
+        if (diario.montar(ROTULO_PARTICAO_REGISTROS, cabecalho_csv.c_str(),
+                          [this, &setores_anteriores](const char *texto, size_t tamanho) {
+                              preservarFormatoAnterior(texto, tamanho);
+                              setores_anteriores++;
+                          }))
+        {
+            Serial.println("logs das faixas na particao " + String(ROTULO_PARTICAO_REGISTROS) + " (" +
+                           String(diario.setoresPorFaixa()) + " setores por faixa)");
+            if (setores_anteriores > 0)
+            {
+                Serial.println("[!] " + String(setores_anteriores) + " setor(es) em formato anterior copiados para " +
+                               String(nome_arquivo_anterior));
+            }
+        }
 
         criarCabecalho();
+
+        // a numeracao de cada faixa continua do ultimo registro do log ou,
+        // com o log esvaziado por um upload, do valor guardado no NVS
+        Preferences nvs;
+        bool com_nvs = nvs.begin(ESPACO_NVS_CONFIG, true);
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            uint32_t guardada = com_nvs ? nvs.getUInt(faixas()[f].chave_nvs, 1) : 1;
+            uint32_t ultima = ultimaSequenciaGravada(f);
+            proxima_sequencia[f] = ultima + 1 > guardada ? ultima + 1 : guardada;
+            if (diario.montado() && com_nvs)
+                progresso[f].confirmada = nvs.getUInt(faixas()[f].chave_confirmada, 0);
+            Serial.println("faixa " + String(faixas()[f].nome) + ": proximo registro seq " +
+                           String(proxima_sequencia[f]));
+        }
+        if (com_nvs)
+            nvs.end();
         return true;
     }
 
@@ -98,46 +460,87 @@ public:
         RegistroDados registro;
         registro.tempo = tempo;
         registro.sensores = sensores;
-        registro.checksum = calcularChecksum(registro);
 
-        String linha_csv = formatarRegistroCSV(registro);
+        // alarme e resumo recebem uma copia, com o seq da propria faixa
+        for (uint8_t f = 0; f < FAIXA_BRUTA; f++)
+        {
+            if ((sensores.faixas & (1u << f)) && gravarNaFaixa(f, registro))
+            {
+                Serial.print("registro tambem na faixa ");
+                Serial.print(faixas()[f].nome);
+                Serial.print(" (seq ");
+                Serial.print(registro.sequencia);
+                Serial.println(")");
+            }
+        }
 
-#ifdef AMBIENTE_WOKWI
-        Serial.println("registro CSV (simulado):");
-        Serial.println("   " + linha_csv);
+        if (!gravarNaFaixa(FAIXA_BRUTA, registro))
+        {
+            return false;
+        }
+        Serial.print("dados salvos no LittleFS (seq ");
+        Serial.print(registro.sequencia);
+        Serial.println(")");
         return true;
-#else
-        File arquivo = LittleFS.open(nome_arquivo, "a");
-        if (!arquivo)
+    }
+
+    /*
+     * anexa um bloco binario (ex: rajada compactada) a um arquivo proprio
+     * os registros CSV continuam no arquivo principal
+     */
+    bool salvarBloco(const char *caminho, const uint8_t *dados, size_t tamanho)
+    {
+        if (!sistema_arquivos_inicializado)
         {
-            Serial.println("falha ao abrir arquivo");
+            Serial.println("LittleFS nao inicializado");
             return false;
         }
-        if (arquivo.size() == 0)
+
+        File arquivo = Arquivos::abrir(caminho, "a");
+        if (!arquivo)
         {
-            arquivo.println("timestamp,data_hora,temperatura,luminosidade,temp_valida,lux_valida,checksum");
+            Serial.println("falha ao abrir " + String(caminho));
+            return false;
         }
-        arquivo.println(linha_csv);
+        uint32_t tamanho_anterior = arquivo.size();
+        uint32_t bytes_escritos = arquivo.write(dados, tamanho);
         arquivo.close();
-        Serial.println("dados salvos no LittleFS");
-        return true;
-#endif
+        monitor_flash.registrarEscrita(tamanho_anterior, bytes_escritos);
+        return bytes_escritos == tamanho;
     }
 
     void criarCabecalho()
     {
-#ifndef AMBIENTE_WOKWI
-        if (!LittleFS.exists(nome_arquivo))
+        // so a faixa bruta existia antes do formato atual
+        // log de outra versao do formato: preservado para exportacao offline
+        if (Arquivos::existe(nome_arquivo))
+        {
+            File arquivo = Arquivos::abrir(nome_arquivo, "r");
+            String cabecalho = arquivo ? arquivo.readStringUntil('\n') : String("");
+            if (arquivo)
+                arquivo.close();
+            cabecalho.trim();
+            if (cabecalho.length() > 0 && cabecalho != cabecalho_csv &&
+                Arquivos::renomear(nome_arquivo, nome_arquivo_anterior))
+            {
+                Serial.println("[!] log em formato anterior movido para " + String(nome_arquivo_anterior));
+            }
+        }
+
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
         {
-            File arquivo = LittleFS.open(nome_arquivo, "w");
+            if (diario.montado() || Arquivos::existe(faixas()[f].arquivo))
+                continue;
+
+            File arquivo = Arquivos::abrir(faixas()[f].arquivo, "w");
             if (arquivo)
             {
-                arquivo.println("timestamp,data_hora,temperatura,luminosidade,temp_valida,lux_valida,checksum");
+                uint32_t bytes_escritos = arquivo.println(cabecalho_csv);
                 arquivo.close();
-                Serial.println("cabecalho criado no arquivo");
+                monitor_flash.registrarReescrita(bytes_escritos);
+                Serial.println("cabecalho criado em " + String(faixas()[f].arquivo));
             }
         }
-#endif
     }
 
     bool verificarIntegridade(const RegistroDados &registro)
@@ -152,11 +555,7 @@ public:
     void listarArquivos()
     {
         Serial.println("\narquivos no LittleFS:");
-#ifdef AMBIENTE_WOKWI
-        Serial.println("   [simulacao wokwi]");
-        Serial.println("   /dados_log.csv");
-#else
-        File root = LittleFS.open("/");
+        File root = Arquivos::abrir("/", "r");
         File arquivo = root.openNextFile();
         while (arquivo)
         {
@@ -167,122 +566,330 @@ public:
             Serial.println(" bytes)");
             arquivo = root.openNextFile();
         }
-#endif
+
+        for (uint8_t f = 0; f < NUMERO_FAIXAS && diario.montado(); f++)
+        {
+            Serial.println("   [particao] faixa " + String(faixas()[f].nome) + ": " + String(diario.setoresOcupados(f)) +
+                           " de " + String(diario.setoresPorFaixa()) + " setores");
+        }
+    }
+
+    // METODOS DE DESGASTE DA FLASH
+
+    /**
+     * tamanho da particao do LittleFS (usado na projecao de vida util)
+     */
+    uint32_t tamanhoParticao()
+    {
+        if (!sistema_arquivos_inicializado)
+            return TAMANHO_PARTICAO_PADRAO;
+        return Arquivos::capacidade();
+    }
+
+    /**
+     * imprime amplificacao de escrita e vida util projetada
+     */
+    void imprimirEstatisticasFlash()
+    {
+        monitor_flash.imprimirStatus(tamanhoParticao(), TEMPO_AMOSTRAGEM);
+    }
+
+    /**
+     * tabela de canais no formato json para o upload (bit i do mapa = canal i)
+     */
+    void canaisJSON(BufferTexto &json)
+    {
+        json.acrescentar("\"canais\": [");
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            const DescritorCanal &canal = GerenciadorSensores::canais()[i];
+            if (i > 0)
+                json.acrescentar(", ");
+            json.acrescentar("{\"nome\": \"").acrescentar(canal.nome).acrescentar("\", \"casas\": ").natural(canal.casas);
+            json.acrescentar('}');
+        }
+        json.acrescentar(']');
+    }
+
+    /**
+     * estatisticas da flash no formato json para o upload
+     */
+    void estatisticasFlashJSON(BufferTexto &json)
+    {
+        monitor_flash.formatarJSON(json, tamanhoParticao(), TEMPO_AMOSTRAGEM);
     }
 
     // METODOS NOVOS - LEITURA E CONTROLE DE UPLOAD
 
     /**
-     * verifica se existem dados pendentes para upload
+     * verifica se alguma das faixas (bits de Faixa) tem registros por enviar
      */
-    bool existemDadosPendentes()
+    bool existemDadosPendentes(uint8_t faixas_envio = TODAS_FAIXAS)
     {
-#ifdef AMBIENTE_WOKWI
-        // wokwi: sempre retorna true para teste
-        return true;
-#else
         if (!sistema_arquivos_inicializado)
             return false;
 
-        File arquivo = LittleFS.open(nome_arquivo, "r");
-        if (!arquivo)
-            return false;
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            if (!(faixas_envio & (1u << f)) || proxima_sequencia[f] - 1 <= progresso[f].confirmada)
+                continue;
+
+            bool tem_dados = false;
+            percorrerFaixa(f, progresso[f].posicao, [&tem_dados](const char *, size_t, uint32_t, uint32_t) -> bool {
+                tem_dados = true;
+                return false;
+            });
+            if (tem_dados)
+                return true;
+        }
+        return false;
+    }
 
-        // pula cabecalho
-        arquivo.readStringUntil('\n');
+    /**
+     * percorre o log da faixa a partir de posicao (0 = primeiro registro)
+     *
+     * visitar(linha, tamanho, inicio, seguinte) recebe cada linha sem a
+     * quebra, apontando para a flash mapeada (particao) ou para o bloco de
+     * leitura (LittleFS) - sem copia e sem String; inicio e seguinte sao as
+     * posicoes para retomar na linha ou depois dela. para quando visitar
+     * retorna false
+     */
+    template <typename Visitante>
+    void percorrerFaixa(uint8_t faixa, uint32_t posicao, Visitante visitar)
+    {
+        if (diario.montado())
+        {
+            TrechoRegistro trecho;
+            uint32_t inicio = posicao;
+            while (diario.proximaLinha(faixa, posicao, trecho) && visitar(trecho.dados, trecho.tamanho, inicio, posicao))
+                inicio = posicao;
+            return;
+        }
 
-        // verifica se tem dados
-        bool tem_dados = arquivo.available() > 0;
+        File arquivo = abrirPendentes(faixa, posicao);
+        if (!arquivo)
+        {
+            Serial.println("erro: nao foi possivel abrir arquivo");
+            return;
+        }
+        LeitorLinhas leitor(arquivo);
+        const char *linha;
+        size_t tamanho;
+        uint32_t inicio = leitor.posicao;
+        while (leitor.proxima(linha, tamanho, posicao))
+        {
+            while (tamanho > 0 && (linha[tamanho - 1] == '\r' || linha[tamanho - 1] == ' '))
+                tamanho--;
+            if (!visitar(linha, tamanho, inicio, posicao))
+                break;
+            inicio = posicao;
+        }
         arquivo.close();
+    }
 
-        return tem_dados;
-#endif
+    /**
+     * percorre o proximo lote da faixa, com ate TAMANHO_MAXIMO_LOTE bytes de registros
+     * visitar(linha, tamanho) recebe cada registro do lote, sem copia (ver percorrerFaixa)
+     * primeira e ultima recebem a faixa de seq do lote (0 sem registros); retorna os
+     * bytes do lote com um separador entre registros
+     */
+    template <typename Visitante>
+    uint32_t lerLote(uint8_t faixa, uint32_t &primeira, uint32_t &ultima, Visitante visitar)
+    {
+        primeira = 0;
+        ultima = 0;
+        if (!sistema_arquivos_inicializado)
+        {
+            Serial.println("erro: LittleFS nao inicializado");
+            return 0;
+        }
+
+        ProgressoFaixa &envio = progresso[faixa];
+        uint32_t bytes = 0;
+        uint32_t fim_lote = envio.posicao;
+        percorrerFaixa(faixa, envio.posicao,
+                       [&](const char *linha, size_t tamanho, uint32_t inicio, uint32_t seguinte) -> bool {
+                           // confirmada por um ack parcial de lote anterior
+                           uint32_t sequencia = sequenciaDaLinha(linha, tamanho);
+                           if (tamanho == 0 || sequencia <= envio.confirmada)
+                           {
+                               fim_lote = seguinte;
+                               return true;
+                           }
+
+                           // lote cheio: a linha abre o proximo
+                           if (bytes > 0 && bytes + 1 + tamanho > TAMANHO_MAXIMO_LOTE)
+                           {
+                               fim_lote = inicio;
+                               return false;
+                           }
+
+                           if (primeira == 0)
+                               primeira = sequencia;
+                           ultima = sequencia;
+                           visitar(linha, tamanho);
+                           bytes += (bytes > 0 ? 1 : 0) + tamanho;
+                           fim_lote = seguinte;
+                           return true;
+                       });
+
+        envio.fim_lote = fim_lote;
+        envio.ultima_lote = ultima;
+        return bytes;
     }
 
     /**
-     * le dados do arquivo para enviar no upload
+     * registra a confirmacao do servidor (seq <= confirmada) para a faixa
+     * com tudo confirmado o log volta ao cabecalho; senao o proximo lote
+     * comeca depois do confirmado e o log e regravado em consolidarEnvio
      */
-    String lerDadosParaUpload()
+    bool marcarComoEnviado(uint8_t faixa, uint32_t confirmada)
     {
-        Serial.println("lendo dados do arquivo para upload...");
+        Serial.println("faixa " + String(faixas()[faixa].nome) + " confirmada ate seq " + String(confirmada));
 
-#ifdef AMBIENTE_WOKWI
-        // wokwi: dados de exemplo
-        String dados = "1705339825,2024-01-15 10:30:25,22.50,550.00,1,1,123456789";
-        Serial.println("dados para upload (simulados): " + dados);
-        return dados;
-#else
         if (!sistema_arquivos_inicializado)
         {
             Serial.println("erro: LittleFS nao inicializado");
-            return "";
+            return false;
         }
 
-        File arquivo = LittleFS.open(nome_arquivo, "r");
-        if (!arquivo)
+        ProgressoFaixa &envio = progresso[faixa];
+        if (confirmada > envio.confirmada)
+            envio.confirmada = confirmada;
+
+        if (envio.confirmada + 1 >= proxima_sequencia[faixa])
         {
-            Serial.println("erro: nao foi possivel abrir arquivo");
-            return "";
+            if (!esvaziarFaixa(faixa))
+                return false;
+            Serial.println("arquivo limpo - faixa " + String(faixas()[faixa].nome) + " sem pendencias");
+            return true;
         }
 
-        String dados = "";
-
-        // pula cabecalho
-        arquivo.readStringUntil('\n');
+        if (envio.confirmada >= envio.ultima_lote)
+            envio.posicao = envio.fim_lote;
+        envio.regravar = true;
+        return true;
+    }
 
-        // le todas as linhas de dados
-        while (arquivo.available())
+    /**
+     * fim da sessao de upload: faixas enviadas em parte ficam so com os
+     * registros nao confirmados (uma regravacao por sessao, nao por lote)
+     */
+    bool consolidarEnvio()
+    {
+        bool sucesso = true;
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
         {
-            String linha = arquivo.readStringUntil('\n');
-            linha.trim();
-            if (linha.length() > 0)
+            ProgressoFaixa &envio = progresso[f];
+            if (!sistema_arquivos_inicializado || !envio.regravar)
+                continue;
+            if (diario.montado())
             {
-                if (dados.length() > 0)
+                sucesso = liberarConfirmados(f) && sucesso;
+                continue;
+            }
+
+            File arquivo = Arquivos::abrir(nome_arquivo_temporario, "w");
+            if (!arquivo)
+            {
+                Serial.println("erro: nao foi possivel regravar a faixa " + String(faixas()[f].nome));
+                sucesso = false;
+                continue;
+            }
+
+            // linha a linha do bloco de leitura, como o copiarFaixa
+            uint32_t bytes_escritos = arquivo.println(cabecalho_csv);
+            uint32_t mantidos = 0;
+            percorrerFaixa(f, 0, [&](const char *linha, size_t tamanho, uint32_t, uint32_t) -> bool {
+                if (tamanho > 0 && sequenciaDaLinha(linha, tamanho) > envio.confirmada)
                 {
-                    dados += ";"; // separador entre registros
+                    bytes_escritos += arquivo.write((const uint8_t *)linha, tamanho);
+                    bytes_escritos += arquivo.println();
+                    mantidos++;
                 }
-                dados += linha;
+                return true;
+            });
+            arquivo.close();
+            monitor_flash.registrarReescrita(bytes_escritos);
+
+            if (!Arquivos::renomear(nome_arquivo_temporario, faixas()[f].arquivo))
+            {
+                Serial.println("erro: nao foi possivel substituir arquivo");
+                sucesso = false;
+                continue;
             }
+            envio.posicao = 0;
+            envio.regravar = false;
+            Serial.println("faixa " + String(faixas()[f].nome) + ": " + String(mantidos) +
+                           " registro(s) aguardando confirmacao");
         }
-        arquivo.close();
+        return sucesso;
+    }
+
+    // METODOS DE CONSULTA (console serial)
 
-        Serial.println("dados lidos: " + String(dados.length()) + " caracteres");
-        return dados;
-#endif
+    const char *arquivoLog() const
+    {
+        return nome_arquivo;
     }
 
     /**
-     * marca dados como enviados (limpa o arquivo)
+     * cabecalho dos logs das faixas (formato das linhas de lerLote)
      */
-    bool marcarComoEnviado()
+    const String &cabecalhoCSV() const
     {
-        Serial.println("marcando dados como enviados...");
+        return cabecalho_csv;
+    }
 
-#ifdef AMBIENTE_WOKWI
-        Serial.println("dados marcados como enviados (simulacao)");
-        return true;
-#else
+    /**
+     * abre um arquivo do LittleFS para leitura (File vazio se nao existir)
+     */
+    File abrirLeitura(const char *caminho)
+    {
         if (!sistema_arquivos_inicializado)
+            return File();
+        for (uint8_t f = 0; f < NUMERO_FAIXAS && diario.montado(); f++)
         {
-            Serial.println("erro: LittleFS nao inicializado");
-            return false;
+            if (strcmp(caminho, faixas()[f].arquivo) == 0)
+                return copiarFaixa(f);
         }
+        if (!Arquivos::existe(caminho))
+            return File();
+        return Arquivos::abrir(caminho, "r");
+    }
 
-        File arquivo = LittleFS.open(nome_arquivo, "w");
-        if (!arquivo)
-        {
-            Serial.println("erro: nao foi possivel limpar arquivo");
-            return false;
-        }
-
-        // recria apenas o cabecalho
-        arquivo.println("timestamp,data_hora,temperatura,luminosidade,temp_valida,lux_valida,checksum");
-        arquivo.close();
-
-        Serial.println("arquivo limpo - dados marcados como enviados");
-        return true;
-#endif
+    /**
+     * escreve em saida o cabecalho e as linhas com epoch em [inicio, fim]
+     * percorre o log sem String por linha; retorna quantas linhas casaram
+     */
+    uint32_t consultarIntervalo(uint32_t inicio, uint32_t fim, Print &saida)
+    {
+        if (!sistema_arquivos_inicializado || (!diario.montado() && !Arquivos::existe(nome_arquivo)))
+            return 0;
+
+        uint32_t encontradas = 0;
+        uint32_t confirmada = progresso[FAIXA_BRUTA].confirmada;
+        saida.println(cabecalho_csv);
+        percorrerFaixa(FAIXA_BRUTA, 0, [&](const char *linha, size_t tamanho, uint32_t, uint32_t) -> bool {
+            LeitorCampos leitor = {linha, linha + tamanho};
+            uint32_t sequencia, epoch;
+            if (leitor.natural(sequencia) && sequencia > confirmada && leitor.separador() && leitor.natural(epoch) &&
+                epoch >= inicio && epoch <= fim)
+            {
+                saida.write((const uint8_t *)linha, tamanho);
+                saida.println();
+                encontradas++;
+            }
+            return true;
+        });
+        return encontradas;
     }
 };
 
+typedef GerenciadorArmazenamentoBase<Plataforma::Arquivos> GerenciadorArmazenamento;
+
+// orcamento de memoria do gerenciador (config.h)
+static_assert(sizeof(GerenciadorArmazenamento) <= ORCAMENTO_OBJETO_ARMAZENAMENTO,
+              "GerenciadorArmazenamento acima do orcamento de memoria");
+
 #endif
\ No newline at end of file
@@ -0,0 +1,288 @@
+#ifndef GERENCIADOR_CALIBRACAO_H
+#define GERENCIADOR_CALIBRACAO_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "calibracao.h"
+#include "plataforma.h"
+#include <Preferences.h>
+#include <esp_adc_cal.h>
+
+/*
+ *  [i] calibracao por dispositivo
+ *
+ *  coeficientes do NTC (Steinhart-Hart), da curva do LDR e dos divisores
+ *  ficam no NVS; sem gravacao valem os de fabrica do config.h (equacao
+ *  Beta). no boot a cadeia leitura -> mV (ADC) -> resistencia -> grandeza
+ *  e avaliada uma vez por ponto e compilada em tabelas; a leitura de cada
+ *  ciclo so interpola.
+ */
+
+// BACKENDS DE ADC
+
+/**
+ * esp32 fisico: caracteristica do ADC gravada no eFuse (vref ou dois pontos)
+ */
+struct AdcEfuse
+{
+    static esp_adc_cal_characteristics_t &caracteristicas()
+    {
+        static esp_adc_cal_characteristics_t valor;
+        return valor;
+    }
+
+    static const char *iniciar()
+    {
+        esp_adc_cal_value_t origem = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                              TENSAO_REFERENCIA_ADC_MV, &caracteristicas());
+        switch (origem)
+        {
+        case ESP_ADC_CAL_VAL_EFUSE_TP:
+            return "eFuse (dois pontos)";
+        case ESP_ADC_CAL_VAL_EFUSE_VREF:
+            return "eFuse (vref)";
+        default:
+            return "vref padrao";
+        }
+    }
+
+    static float milivolts(uint16_t leitura)
+    {
+        return esp_adc_cal_raw_to_voltage(leitura, &caracteristicas());
+    }
+};
+
+/**
+ * wokwi: ADC ideal, fundo de escala na alimentacao dos divisores
+ */
+struct AdcIdeal
+{
+    static const char *iniciar()
+    {
+        return "ideal";
+    }
+
+    static float milivolts(uint16_t leitura)
+    {
+        return leitura * TENSAO_DIVISORES_MV / LEITURA_ADC_MAXIMA;
+    }
+};
+
+// COEFICIENTES GRAVADOS NO NVS
+
+const uint32_t ASSINATURA_CALIBRACAO = 0xCA11B001;
+const char *const CHAVE_NVS_CALIBRACAO = "calibracao";
+
+struct CoeficientesCalibracao
+{
+    uint32_t assinatura;
+    CoeficientesSteinhartHart ntc;
+    CurvaLDR ldr;
+    float resistor_serie_ntc;
+    float resistor_serie_ldr;
+    float tensao_divisores_mv;
+};
+
+// CLASSE GERENCIADOR CALIBRACAO
+
+template <typename Adc>
+class GerenciadorCalibracaoBase
+{
+private:
+    CoeficientesCalibracao coeficientes;
+    TabelaConversao tabela_temperatura;
+    TabelaConversao tabela_luminosidade;
+    const char *origem_adc;
+    bool do_dispositivo; // false = fabrica
+    uint32_t tempo_compilacao_us;
+
+    static CoeficientesCalibracao coeficientesPadrao()
+    {
+        CoeficientesCalibracao padrao;
+        memset(&padrao, 0, sizeof(padrao));
+        padrao.assinatura = ASSINATURA_CALIBRACAO;
+        padrao.ntc = steinhartHartDeBeta(BETA_TERMISTOR, RESISTENCIA_NTC_25C);
+        padrao.ldr.r10 = RESISTENCIA_LDR * 1000.0;
+        padrao.ldr.gama = GAMA_LDR;
+        padrao.resistor_serie_ntc = RESISTOR_SERIE_NTC;
+        padrao.resistor_serie_ldr = RESISTOR_SERIE_LDR;
+        padrao.tensao_divisores_mv = TENSAO_DIVISORES_MV;
+        return padrao;
+    }
+
+    /*
+     * avalia a cadeia completa em cada ponto das tabelas (log/pow so aqui)
+     */
+    void compilarTabelas()
+    {
+        unsigned long inicio = micros();
+        const CoeficientesCalibracao &c = coeficientes;
+
+        tabela_temperatura.construir([&c](uint16_t leitura) -> float {
+            float r = resistenciaDivisor(Adc::milivolts(leitura), c.tensao_divisores_mv, c.resistor_serie_ntc);
+            return temperaturaSteinhartHart(c.ntc, r);
+        });
+
+        tabela_luminosidade.construir([&c](uint16_t leitura) -> float {
+            float r = resistenciaDivisor(Adc::milivolts(leitura), c.tensao_divisores_mv, c.resistor_serie_ldr);
+            return luminosidadeLDR(c.ldr, r);
+        });
+
+        tempo_compilacao_us = micros() - inicio;
+    }
+
+public:
+    GerenciadorCalibracaoBase()
+    {
+        coeficientes = coeficientesPadrao();
+        origem_adc = "";
+        do_dispositivo = false;
+        tempo_compilacao_us = 0;
+    }
+
+    /*
+     * carrega os coeficientes do NVS, caracteriza o ADC e compila as tabelas
+     */
+    void iniciar()
+    {
+        coeficientes = coeficientesPadrao();
+        do_dispositivo = false;
+
+        Preferences nvs;
+        if (nvs.begin(ESPACO_NVS_CONFIG, true))
+        {
+            CoeficientesCalibracao gravados;
+            if (nvs.getBytesLength(CHAVE_NVS_CALIBRACAO) == sizeof(CoeficientesCalibracao) &&
+                nvs.getBytes(CHAVE_NVS_CALIBRACAO, &gravados, sizeof(CoeficientesCalibracao)) ==
+                    sizeof(CoeficientesCalibracao) &&
+                gravados.assinatura == ASSINATURA_CALIBRACAO)
+            {
+                coeficientes = gravados;
+                do_dispositivo = true;
+            }
+            nvs.end();
+        }
+
+        origem_adc = Adc::iniciar();
+        compilarTabelas();
+    }
+
+    // CONVERSAO (caminho de cada leitura)
+
+    float temperatura(uint16_t leitura) const
+    {
+        return tabela_temperatura.converter(leitura);
+    }
+
+    float luminosidade(uint16_t leitura) const
+    {
+        return tabela_luminosidade.converter(leitura);
+    }
+
+    /*
+     * resistencia vista agora (para medir os pontos de referencia)
+     */
+    float resistenciaNTC(uint16_t leitura) const
+    {
+        return resistenciaDivisor(Adc::milivolts(leitura), coeficientes.tensao_divisores_mv,
+                                  coeficientes.resistor_serie_ntc);
+    }
+
+    float resistenciaLDR(uint16_t leitura) const
+    {
+        return resistenciaDivisor(Adc::milivolts(leitura), coeficientes.tensao_divisores_mv,
+                                  coeficientes.resistor_serie_ldr);
+    }
+
+    // GRAVACAO DE COEFICIENTES
+
+    /*
+     * grava coeficientes no NVS e recompila as tabelas
+     */
+    bool gravar(const CoeficientesCalibracao &novos)
+    {
+        CoeficientesCalibracao gravados = novos;
+        gravados.assinatura = ASSINATURA_CALIBRACAO;
+
+        Preferences nvs;
+        if (!nvs.begin(ESPACO_NVS_CONFIG, false) ||
+            nvs.putBytes(CHAVE_NVS_CALIBRACAO, &gravados, sizeof(CoeficientesCalibracao)) !=
+                sizeof(CoeficientesCalibracao))
+        {
+            Serial.println("[!] falha ao gravar calibracao no NVS");
+            nvs.end();
+            return false;
+        }
+        nvs.end();
+
+        coeficientes = gravados;
+        do_dispositivo = true;
+        compilarTabelas();
+        return true;
+    }
+
+    /*
+     * ajusta o NTC por tres pontos de referencia e grava
+     */
+    bool calibrarNTC(const double resistencia[3], const double temperatura_c[3])
+    {
+        CoeficientesCalibracao novos = coeficientes;
+        if (!ajustarSteinhartHart(resistencia, temperatura_c, novos.ntc))
+        {
+            Serial.println("[!] pontos de calibracao do NTC invalidos");
+            return false;
+        }
+        return gravar(novos);
+    }
+
+    /*
+     * ajusta a curva do LDR (dois ou mais niveis de luz) e grava
+     */
+    bool calibrarLDR(const float *luminosidade, const float *resistencia, uint8_t pontos)
+    {
+        CoeficientesCalibracao novos = coeficientes;
+        if (!ajustarCurvaLDR(luminosidade, resistencia, pontos, novos.ldr))
+        {
+            Serial.println("[!] pontos de calibracao do LDR invalidos");
+            return false;
+        }
+        return gravar(novos);
+    }
+
+    /*
+     * volta aos coeficientes de fabrica
+     */
+    void restaurarFabrica()
+    {
+        Preferences nvs;
+        if (nvs.begin(ESPACO_NVS_CONFIG, false))
+        {
+            nvs.remove(CHAVE_NVS_CALIBRACAO);
+            nvs.end();
+        }
+        coeficientes = coeficientesPadrao();
+        do_dispositivo = false;
+        compilarTabelas();
+    }
+
+    const CoeficientesCalibracao &atuais() const
+    {
+        return coeficientes;
+    }
+
+    void imprimirStatus() const
+    {
+        Serial.println("calibracao (" + String(do_dispositivo ? "do dispositivo" : "fabrica") + "):");
+        Serial.println("  adc: " + String(origem_adc));
+        Serial.println("  ntc: a=" + String(coeficientes.ntc.a * 1e3, 6) + "e-3 b=" +
+                       String(coeficientes.ntc.b * 1e4, 6) + "e-4 c=" + String(coeficientes.ntc.c * 1e7, 6) + "e-7");
+        Serial.println("  ldr: r10=" + String(coeficientes.ldr.r10, 0) + " ohm, gama=" +
+                       String(coeficientes.ldr.gama, 3));
+        Serial.println("  tabelas: " + String(PONTOS_TABELA_CALIBRACAO) + " pontos, compiladas em " +
+                       String(tempo_compilacao_us) + " us");
+    }
+};
+
+typedef GerenciadorCalibracaoBase<Plataforma::Adc> GerenciadorCalibracao;
+
+#endif
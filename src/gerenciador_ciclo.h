@@ -0,0 +1,513 @@
+#ifndef GERENCIADOR_CICLO_H
+#define GERENCIADOR_CICLO_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "arena_ciclo.h"
+#include "buffer_texto.h"
+#include "gerenciador_armazenamento.h"
+#include "gerenciador_energia.h"
+#include "gerenciador_rajada.h"
+#include "gerenciador_sensores.h"
+#include "gerenciador_telemetria.h"
+#include "gerenciador_time.h"
+#include "gerenciador_upload.h"
+#include "gerenciador_wifi.h"
+#include "fila_spsc.h"
+#include "tarefa.h"
+#include <atomic>
+#include <esp_heap_caps.h>
+
+/*
+ *  [i] ciclo de vigilia em pipeline nos dois nucleos
+ *
+ *  o radio comeca a conectar assim que o ciclo inicia (nucleo 0, onde roda
+ *  a pilha wifi) enquanto a leitura acontece no nucleo 1.
+ *
+ *  estagios: aquisicao (+ rajada) -> fila SPSC -> gravacao -> upload
+ *  a aquisicao (nucleo 1) so publica o registro na fila; a tarefa de
+ *  gravacao (nucleo 0, que fica quase todo ocioso esperando a associacao)
+ *  consome e escreve na flash. uma escrita lenta (apagamento de bloco) ou
+ *  um upload travado nao atrasam mais o instante da amostra.
+ *
+ *  tempo acordado ~ max(conexao, leitura + gravacao) + upload,
+ *  em vez da soma de todas as fases.
+ *
+ *  o upload completo (todas as faixas) acontece a cada CICLOS_ENTRE_UPLOADS
+ *  ciclos. nos demais o radio fica desligado, a menos que a leitura dispare
+ *  um alarme (ou sobre alarme de ciclo anterior): ai o radio liga depois da
+ *  gravacao e envia so a faixa de alarme.
+ *
+ *  com o gateway local habilitado (USAR_GATEWAY) o radio nao associa:
+ *  depois da gravacao os lotes saem em datagramas esp-now. so se o
+ *  gateway nao confirmar tudo (ou o NTP precisar de rede) o wifi conecta
+ *  e o restante vai pelo http.
+ *
+ *  o ciclo comeca zerando a arena (arena_ciclo.h). ao fim de cada fase,
+ *  na tarefa que a executou, ficam o pico da arena e o heap: com as fases
+ *  sobrepostas nos dois nucleos, o heap minimo e o do boot ate ali.
+ *  leitura, gravacao e montagem do lote rodam em TrechoSemHeap.
+ */
+
+// ciclos desde o ultimo upload completo bem-sucedido (sobrevive ao deep sleep)
+RTC_DATA_ATTR uint16_t ciclos_sem_upload;
+
+// TEMPOS DE CADA FASE (ms)
+
+struct TemposCiclo
+{
+    uint32_t conexao;   // radio: wifi ate conectar (ou desistir)
+    uint32_t aquisicao; // leitura ate publicar na fila
+    uint32_t gravacao;  // ate o ultimo registro da fila estar na flash
+    uint32_t upload;    // ntp + envio, apos a gravacao
+    uint32_t total;     // acordado no ciclo
+};
+
+// MEMORIA AO FIM DE CADA FASE
+
+enum FaseCiclo
+{
+    FASE_AQUISICAO,
+    FASE_GRAVACAO,
+    FASE_UPLOAD,
+    TOTAL_FASES_CICLO
+};
+
+struct MemoriaFase
+{
+    uint32_t arena_pico;  // bytes da arena do ciclo ate o fim da fase
+    uint32_t heap_livre;  // no fim da fase
+    uint32_t heap_minimo; // menor heap livre desde o boot, ate o fim da fase
+};
+
+// CLASSE GERENCIADOR DE CICLO
+
+class GerenciadorCiclo
+{
+private:
+    GerenciadorTempo &tempo;
+    GerenciadorSensores &sensores;
+    GerenciadorArmazenamento &armazenamento;
+    GerenciadorWiFi &wifi;
+    GerenciadorUpload &upload;
+    GerenciadorRajada &rajada;
+    GerenciadorEnergia &energia;
+    GerenciadorTelemetria &telemetria;
+
+    Tarefa tarefa_radio;
+    Tarefa tarefa_gravacao;
+    FilaSPSC<RegistroDados, CAPACIDADE_FILA_REGISTROS> fila_registros;
+    std::atomic<bool> aquisicao_concluida;
+    std::atomic<bool> gravacao_concluida;
+    uint32_t registros_gravados;
+    uint32_t registros_descartados; // fila cheia sem consumidor rodando
+    bool gravacao_paralela;         // a tarefa de gravacao consome enquanto a aquisicao publica
+    uint8_t faixas_envio;           // faixas que o radio envia neste ciclo (0 = radio desligado)
+    uint8_t faixas_disparadas;      // regras disparadas pelas leituras do ciclo
+    bool via_gateway;               // tenta o gateway antes de associar ao wifi
+    unsigned long inicio_radio;
+
+    unsigned long inicio_ciclo;
+    int64_t us_amostra; // epoch (us) do timestamp da leitura, para a grade de amostragem
+    TemposCiclo tempos;
+    MemoriaFase memoria[TOTAL_FASES_CICLO];
+
+    void registrarMemoria(FaseCiclo fase)
+    {
+        memoria[fase].arena_pico = arenaCiclo().picoUsado();
+        memoria[fase].heap_livre = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        memoria[fase].heap_minimo = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    }
+
+    static void executarTarefaRadio(void *contexto)
+    {
+        ((GerenciadorCiclo *)contexto)->executarRadio();
+    }
+
+    static void executarTarefaGravacao(void *contexto)
+    {
+        ((GerenciadorCiclo *)contexto)->executarGravacao();
+    }
+
+    /*
+     * so a tarefa de gravacao escreve na flash: com a fila cheia, espera
+     * ela liberar uma posicao; sem consumidor rodando (tarefa nao criada,
+     * a gravacao so vem depois), descarta e conta
+     */
+    void publicarRegistro(const RegistroDados &registro)
+    {
+        while (!fila_registros.inserir(registro))
+        {
+            if (!gravacao_paralela)
+            {
+                registros_descartados++;
+                Serial.println("[!] fila de registros cheia - leitura descartada");
+                return;
+            }
+            delay(1);
+        }
+    }
+
+    /*
+     * nucleo 1: le tempo e sensores e publica o registro na fila
+     */
+    void executarAquisicao()
+    {
+        TrechoSemHeap quente;
+
+        Serial.println("obtendo timestamp...");
+        DadosTempo dados_tempo = tempo.obterTempo();
+        us_amostra = tempo.epochUs();
+
+        Serial.println("lendo sensores...");
+        DadosSensores dados_sensores = sensores.lerSensores(dados_tempo.epoch);
+
+        RegistroDados registro;
+        registro.tempo = dados_tempo;
+        registro.sensores = dados_sensores;
+        registro.checksum = 0;
+        publicarRegistro(registro);
+        faixas_disparadas |= dados_sensores.faixas;
+
+        // exibe dados coletados
+        char data_hora[TAMANHO_DATA_HORA];
+        formatarDataHora(dados_tempo.epoch, FUSO_HORARIO_S, data_hora);
+        Serial.println("\ndados coletados:");
+        Serial.print("  timestamp: ");
+        Serial.print(dados_tempo.epoch);
+        Serial.print(" (");
+        Serial.print(data_hora);
+        Serial.println(")");
+        Serial.print("  incerteza: ");
+        Serial.print(dados_tempo.incerteza_ms);
+        Serial.println(" ms");
+
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            const DescritorCanal &canal = GerenciadorSensores::canais()[i];
+            Serial.print("  ");
+            Serial.print(canal.nome);
+            Serial.print(": ");
+            if (dados_sensores.canais.tem(i))
+            {
+                char valor[24];
+                BufferTexto texto(valor, sizeof(valor));
+                texto.decimal(GerenciadorSensores::valorCanal(dados_sensores, i), canal.casas);
+                Serial.print(texto.c_str());
+                Serial.print(" ");
+                Serial.print(canal.unidade);
+                if (dados_sensores.canais.simulados & (1u << i))
+                    Serial.print(" (simulado)");
+                if (dados_sensores.canais.atipicos & (1u << i))
+                    Serial.print(" (atipico)");
+                Serial.println();
+            }
+            else
+            {
+                Serial.println("sem leitura");
+            }
+        }
+
+        // evento transitorio: rajada em kHz enquanto o radio conecta
+        GatilhoRajada gatilho = rajada.verificarGatilho();
+        if (gatilho != GATILHO_NENHUM)
+        {
+            rajada.capturar(gatilho, dados_tempo.epoch);
+        }
+
+        tempos.aquisicao = millis() - inicio_ciclo;
+        registrarMemoria(FASE_AQUISICAO);
+        aquisicao_concluida.store(true, std::memory_order_release);
+    }
+
+    /*
+     * nucleo 0: consumidor da fila, grava cada registro na flash
+     */
+    void executarGravacao()
+    {
+        TrechoSemHeap quente;
+        RegistroDados registro;
+        bool fim = false;
+        uint32_t us_flash = 0; // tempo com a flash escrevendo, para a energia
+
+        while (!fim)
+        {
+            // le a flag antes de esvaziar: o que foi publicado antes dela
+            // e drenado nesta mesma volta
+            fim = aquisicao_concluida.load(std::memory_order_acquire);
+
+            while (fila_registros.remover(registro))
+            {
+                Serial.println("\nsalvando dados...");
+                uint32_t inicio_escrita = micros();
+                bool salvo = armazenamento.salvarRegistro(registro.tempo, registro.sensores);
+                us_flash += micros() - inicio_escrita;
+                if (salvo)
+                {
+                    Serial.println("dados salvos com sucesso");
+                    registros_gravados++;
+                }
+                else
+                {
+                    Serial.println("falha ao salvar dados");
+                }
+            }
+
+            if (!fim)
+            {
+                delay(1);
+            }
+        }
+
+        if (rajada.temPendente())
+        {
+            uint32_t inicio_escrita = micros();
+            rajada.salvar(armazenamento);
+            us_flash += micros() - inicio_escrita;
+        }
+
+        energia.registrarFlash(us_flash / 1000);
+        energia.registrarAmostras(registros_gravados);
+        tempos.gravacao = millis() - inicio_ciclo;
+        registrarMemoria(FASE_GRAVACAO);
+        gravacao_concluida.store(true, std::memory_order_release);
+    }
+
+    /*
+     * nucleo 0: conecta o radio, espera a aquisicao e envia
+     */
+    void executarRadio()
+    {
+        inicio_radio = millis();
+        if (!via_gateway && !wifi.estaConectado())
+        {
+            wifi.conectar();
+        }
+        tempos.conexao = millis() - inicio_ciclo;
+
+        // ntp e upload usam o relogio e o arquivo: so depois da gravacao
+        while (!gravacao_concluida.load(std::memory_order_acquire))
+        {
+            delay(1);
+        }
+        unsigned long inicio_upload = millis();
+
+        // heap e sinal com o ciclo no pico: registros gravados, payload ainda por montar
+        const AmostraTelemetria &amostra = telemetria.amostrar(wifi.obterForcaSinal(), tempos.conexao);
+
+        Serial.println();
+        Serial.print(registros_gravados);
+        Serial.println(" registro(s) novo(s) para o upload");
+
+        if (via_gateway)
+        {
+            if (upload.enviarPorGateway(armazenamento, faixas_envio))
+            {
+                telemetria.registrarUpload(true);
+                if (faixas_envio == TODAS_FAIXAS)
+                {
+                    ciclos_sem_upload = 0;
+                }
+                tempos.upload = millis() - inicio_upload;
+                registrarMemoria(FASE_UPLOAD);
+                return;
+            }
+
+            // reserva: associa agora e o http retoma do que o gateway confirmou
+            wifi.conectar();
+            tempos.conexao = millis() - inicio_ciclo;
+        }
+
+        Serial.println("verificando conexao para upload...");
+        if (wifi.estaConectado())
+        {
+            // refaz o NTP apenas se a incerteza do relogio passou do limite
+            tempo.sincronizarSeNecessario();
+
+            Serial.println("wifi disponivel (" + wifi.obterIP() + ", " + String(amostra.rssi_dbm) +
+                           " dBm) - iniciando upload de dados");
+
+            // campos do ciclo na arena, ate o fim da sessao
+            BufferTexto extras((char *)arenaCiclo().alocar(ARENA_UPLOAD, TAMANHO_METADADOS_CICLO),
+                               TAMANHO_METADADOS_CICLO);
+            energia.formatarJSON(extras);
+            extras.acrescentar(", ");
+            sensores.saudeJSON(extras);
+            extras.acrescentar(", ");
+            telemetria.formatarJSON(extras);
+            if (extras.estourou())
+                Serial.println("[!] metadados do ciclo passaram de TAMANHO_METADADOS_CICLO - enviados sem eles");
+            upload.definirMetadadosExtras(extras.valido() && !extras.estourou() ? extras.c_str() : NULL);
+            bool sucesso = upload.enviarComRetentativas(armazenamento, faixas_envio);
+            upload.definirMetadadosExtras(NULL);
+            telemetria.registrarUpload(sucesso);
+            if (sucesso && faixas_envio == TODAS_FAIXAS)
+            {
+                ciclos_sem_upload = 0;
+            }
+        }
+        else
+        {
+            Serial.println("wifi indisponivel - dados mantidos localmente");
+        }
+
+        tempos.upload = millis() - inicio_upload;
+        registrarMemoria(FASE_UPLOAD);
+    }
+
+public:
+    GerenciadorCiclo(GerenciadorTempo &gerenciador_tempo, GerenciadorSensores &gerenciador_sensores,
+                     GerenciadorArmazenamento &gerenciador_armazenamento, GerenciadorWiFi &gerenciador_wifi,
+                     GerenciadorUpload &gerenciador_upload, GerenciadorRajada &gerenciador_rajada,
+                     GerenciadorEnergia &gerenciador_energia, GerenciadorTelemetria &gerenciador_telemetria)
+        : tempo(gerenciador_tempo), sensores(gerenciador_sensores), armazenamento(gerenciador_armazenamento),
+          wifi(gerenciador_wifi), upload(gerenciador_upload), rajada(gerenciador_rajada),
+          energia(gerenciador_energia), telemetria(gerenciador_telemetria), aquisicao_concluida(false),
+          gravacao_concluida(false)
+    {
+        gravacao_paralela = false;
+        registros_gravados = 0;
+        registros_descartados = 0;
+        faixas_envio = 0;
+        faixas_disparadas = 0;
+        via_gateway = false;
+        inicio_ciclo = 0;
+        inicio_radio = 0;
+        us_amostra = 0;
+        tempos = {0, 0, 0, 0, 0};
+        memset(memoria, 0, sizeof(memoria));
+    }
+
+    /*
+     * executa um ciclo completo: radio e gravacao em paralelo com a aquisicao
+     * se alguma tarefa nao puder ser criada, o estagio roda em sequencia
+     */
+    void executarCiclo()
+    {
+        inicio_ciclo = millis();
+        tempos = {0, 0, 0, 0, 0};
+        memset(memoria, 0, sizeof(memoria));
+        arenaCiclo().reiniciar(); // nada do ciclo anterior continua valido
+        registros_gravados = 0;
+        registros_descartados = 0;
+        faixas_disparadas = 0;
+        inicio_radio = 0;
+        aquisicao_concluida.store(false, std::memory_order_relaxed);
+        gravacao_concluida.store(false, std::memory_order_relaxed);
+
+        // ciclo de upload completo, ou alarme que nao chegou ao servidor antes
+        if (ciclos_sem_upload < CICLOS_ENTRE_UPLOADS)
+            ciclos_sem_upload++;
+        if (ciclos_sem_upload >= CICLOS_ENTRE_UPLOADS)
+            faixas_envio = TODAS_FAIXAS;
+        else if (armazenamento.existemDadosPendentes(1u << FAIXA_ALARME))
+            faixas_envio = 1u << FAIXA_ALARME;
+        else
+            faixas_envio = 0;
+
+        // o NTP so sincroniza com o wifi associado: ai o gateway nao economiza nada
+        via_gateway = upload.gatewayHabilitado() && !tempo.precisaSincronizar();
+
+        bool radio_paralelo = faixas_envio && tarefa_radio.iniciar("radio", executarTarefaRadio, this, NUCLEO_RADIO,
+                                                                   PILHA_TAREFA_RADIO);
+        gravacao_paralela = tarefa_gravacao.iniciar("gravacao", executarTarefaGravacao, this, NUCLEO_GRAVACAO,
+                                                    PILHA_TAREFA_GRAVACAO);
+
+        executarAquisicao();
+
+        if (gravacao_paralela)
+        {
+            tarefa_gravacao.aguardar();
+        }
+        else
+        {
+            executarGravacao();
+        }
+
+        // alarme num ciclo sem upload: acorda o radio so para a faixa de alarme
+        if (!faixas_envio && (faixas_disparadas & (1u << FAIXA_ALARME)))
+        {
+            Serial.println("[!] alarme - ligando o radio para enviar a faixa de alarme");
+            faixas_envio = 1u << FAIXA_ALARME;
+        }
+
+        if (radio_paralelo)
+        {
+            tarefa_radio.aguardar();
+        }
+        else if (faixas_envio)
+        {
+            executarRadio();
+        }
+        else
+        {
+            Serial.println("\nsem upload neste ciclo (" + String(ciclos_sem_upload) + " de " +
+                           String(CICLOS_ENTRE_UPLOADS) + ") - radio desligado");
+        }
+
+        tempos.total = millis() - inicio_ciclo;
+
+        // o wifi fica ligado de quando o radio parte ate o deep sleep
+        energia.registrarRadio(faixas_envio ? millis() - inicio_radio : 0);
+        imprimirTempos();
+    }
+
+    /*
+     * mostra a sobreposicao entre radio e aquisicao
+     */
+    void imprimirTempos()
+    {
+        uint32_t sequencial = tempos.conexao + tempos.gravacao + tempos.upload;
+
+        Serial.println("\ntempos do ciclo:");
+        Serial.println("  conexao wifi: " + String(tempos.conexao) + " ms");
+        Serial.println("  leitura: " + String(tempos.aquisicao) + " ms");
+        Serial.println("  leitura + gravacao: " + String(tempos.gravacao) + " ms");
+        Serial.println("  ntp + upload: " + String(tempos.upload) + " ms");
+        Serial.println("  acordado: " + String(tempos.total) + " ms (sequencial seria ~" + String(sequencial) + " ms)");
+        if (registros_descartados)
+            Serial.println("  [!] leituras descartadas com a fila cheia: " + String(registros_descartados));
+        if (tarefa_radio.pilhaLivreMinima() || tarefa_gravacao.pilhaLivreMinima())
+            Serial.println("  pilha livre minima: radio " + String(tarefa_radio.pilhaLivreMinima()) + " de " +
+                           String(PILHA_TAREFA_RADIO) + ", gravacao " + String(tarefa_gravacao.pilhaLivreMinima()) +
+                           " de " + String(PILHA_TAREFA_GRAVACAO) + " bytes");
+
+        static const char *const nomes[TOTAL_FASES_CICLO] = {"leitura", "gravacao", "upload"};
+        Serial.println("memoria ao fim de cada fase (arena pico / heap livre / heap minimo):");
+        for (uint8_t f = 0; f < TOTAL_FASES_CICLO; f++)
+        {
+            if (f == FASE_UPLOAD && !faixas_envio)
+                continue;
+            Serial.println("  " + String(nomes[f]) + ": " + String(memoria[f].arena_pico) + " / " +
+                           String(memoria[f].heap_livre) + " / " + String(memoria[f].heap_minimo) + " bytes");
+        }
+    }
+
+    const TemposCiclo &obterTempos() const
+    {
+        return tempos;
+    }
+
+    /*
+     * leituras do ultimo ciclo que nao couberam na fila (sem consumidor)
+     */
+    uint32_t registrosDescartados() const
+    {
+        return registros_descartados;
+    }
+
+    const MemoriaFase &obterMemoria(FaseCiclo fase) const
+    {
+        return memoria[fase];
+    }
+
+    /*
+     * epoch (us) em que a leitura do ultimo ciclo foi datada
+     */
+    int64_t instanteAmostraUs() const
+    {
+        return us_amostra;
+    }
+};
+
+#endif
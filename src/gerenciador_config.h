@@ -0,0 +1,341 @@
+#ifndef GERENCIADOR_CONFIG_H
+#define GERENCIADOR_CONFIG_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "buffer_texto.h"
+#include "gerenciador_sensores.h"
+#include <Preferences.h>
+
+/*
+ *  [i] configuracao remota recebida na resposta do upload
+ *
+ *  o dispositivo informa a versao que esta usando nos metadados do upload;
+ *  se houver versao mais nova, o servidor acrescenta uma linha de delta
+ *  na propria resposta, sem requisicao extra:
+ *
+ *      cfg;v=4;periodo_s=600;tentativas=5;espera_ms=3000;incerteza_ms=5000;url=http://...
+ *      cfg;v=5;limite0=32.5;limite3=150
+ *
+ *  limite<i> troca o limite da regra i de REGRAS_FAIXAS, dentro do minimo
+ *  e do maximo da propria regra; indice alem da tabela conta como chave
+ *  desconhecida. so as chaves presentes mudam. o delta e validado por inteiro (qualquer
+ *  valor fora dos limites do config.h rejeita tudo), gravado no NVS e passa
+ *  a valer no proximo despertar. chaves desconhecidas sao ignoradas, para
+ *  firmwares antigos aceitarem deltas de versoes novas.
+ */
+
+const uint32_t ASSINATURA_CONFIG = 0xC0F16002; // 2: limites das regras das faixas
+const char *const CHAVE_NVS_CONFIG = "config";
+
+struct ConfigRemota
+{
+    uint32_t assinatura;
+    uint16_t versao; // 0 = valores de fabrica do config.h
+    uint32_t periodo_amostragem_ms;
+    uint8_t max_tentativas;
+    uint32_t espera_tentativas_ms;
+    uint32_t limite_incerteza_ms;
+    char servidor_url[TAMANHO_URL_SERVIDOR];
+    float limites_regras[MAXIMO_REGRAS_FAIXA]; // na ordem de REGRAS_FAIXAS
+};
+
+class GerenciadorConfig
+{
+private:
+    ConfigRemota ativa;   // em uso neste despertar
+    ConfigRemota proxima; // gravada no NVS, vale no proximo despertar
+    bool tem_proxima;
+
+    static ConfigRemota configPadrao()
+    {
+        ConfigRemota padrao;
+        memset(&padrao, 0, sizeof(padrao));
+        padrao.assinatura = ASSINATURA_CONFIG;
+        padrao.versao = 0;
+        padrao.periodo_amostragem_ms = TEMPO_AMOSTRAGEM;
+        padrao.max_tentativas = MAX_TENTATIVAS_UPLOAD;
+        padrao.espera_tentativas_ms = ESPERA_ENTRE_TENTATIVAS_MS;
+        padrao.limite_incerteza_ms = LIMITE_INCERTEZA_MS;
+        strncpy(padrao.servidor_url, SERVIDOR_URL, TAMANHO_URL_SERVIDOR - 1);
+
+        uint8_t quantidade;
+        const RegraFaixa *regras = GerenciadorSensores::regras(quantidade);
+        for (uint8_t i = 0; i < quantidade; i++)
+        {
+            padrao.limites_regras[i] = regras[i].limite;
+        }
+        return padrao;
+    }
+
+    static bool lerInteiro(const char *texto, size_t tamanho, uint32_t minimo, uint32_t maximo, uint32_t &valor)
+    {
+        if (tamanho == 0 || tamanho > 10)
+            return false;
+
+        uint64_t numero = 0;
+        for (size_t i = 0; i < tamanho; i++)
+        {
+            if (texto[i] < '0' || texto[i] > '9')
+                return false;
+            numero = numero * 10 + (texto[i] - '0');
+        }
+
+        if (numero < minimo || numero > maximo)
+            return false;
+        valor = (uint32_t)numero;
+        return true;
+    }
+
+    /*
+     * decimal com sinal e ate 4 casas ("-12.5", "150")
+     */
+    static bool lerDecimal(const char *texto, size_t tamanho, float minimo, float maximo, float &valor)
+    {
+        bool negativo = tamanho > 0 && texto[0] == '-';
+        if (negativo)
+        {
+            texto++;
+            tamanho--;
+        }
+
+        const char *ponto = (const char *)memchr(texto, '.', tamanho);
+        size_t tamanho_inteiro = ponto ? (size_t)(ponto - texto) : tamanho;
+        size_t casas = ponto ? tamanho - tamanho_inteiro - 1 : 0;
+        uint32_t inteiro, fracao = 0;
+        if (!lerInteiro(texto, tamanho_inteiro, 0, 1000000, inteiro) || casas > 4 ||
+            (ponto && !lerInteiro(ponto + 1, casas, 0, 9999, fracao)))
+            return false;
+
+        float numero = inteiro;
+        float escala = 1.0f;
+        for (size_t i = 0; i < casas; i++)
+            escala *= 10.0f;
+        numero += fracao / escala;
+        if (negativo)
+            numero = -numero;
+
+        if (numero < minimo || numero > maximo)
+            return false;
+        valor = numero;
+        return true;
+    }
+
+    /*
+     * aplica os pares chave=valor de uma linha "cfg;..." sobre config
+     * retorna false se algum valor for invalido ou faltar a versao
+     */
+    static bool interpretarDelta(const char *linha, size_t tamanho_linha, ConfigRemota &config)
+    {
+        const char *p = linha + 4; // pula "cfg;"
+        const char *fim_linha = linha + tamanho_linha;
+        bool tem_versao = false;
+        uint8_t quantidade_regras;
+        const RegraFaixa *regras = GerenciadorSensores::regras(quantidade_regras);
+
+        while (p < fim_linha)
+        {
+            const char *fim = p;
+            while (fim < fim_linha && *fim != ';')
+                fim++;
+
+            const char *igual = (const char *)memchr(p, '=', fim - p);
+            if (igual)
+            {
+                size_t tamanho_chave = igual - p;
+                const char *valor = igual + 1;
+                size_t tamanho_valor = fim - valor;
+                uint32_t numero;
+
+#define CHAVE_DELTA(nome) (tamanho_chave == sizeof(nome) - 1 && memcmp(p, nome, tamanho_chave) == 0)
+                if (CHAVE_DELTA("v"))
+                {
+                    if (!lerInteiro(valor, tamanho_valor, 1, 0xFFFF, numero))
+                        return false;
+                    config.versao = numero;
+                    tem_versao = true;
+                }
+                else if (CHAVE_DELTA("periodo_s"))
+                {
+                    if (!lerInteiro(valor, tamanho_valor, PERIODO_AMOSTRAGEM_MINIMO_S, PERIODO_AMOSTRAGEM_MAXIMO_S, numero))
+                        return false;
+                    config.periodo_amostragem_ms = numero * 1000;
+                }
+                else if (CHAVE_DELTA("tentativas"))
+                {
+                    if (!lerInteiro(valor, tamanho_valor, 1, TENTATIVAS_UPLOAD_MAXIMAS, numero))
+                        return false;
+                    config.max_tentativas = numero;
+                }
+                else if (CHAVE_DELTA("espera_ms"))
+                {
+                    if (!lerInteiro(valor, tamanho_valor, 0, ESPERA_TENTATIVAS_MAXIMA_MS, numero))
+                        return false;
+                    config.espera_tentativas_ms = numero;
+                }
+                else if (CHAVE_DELTA("incerteza_ms"))
+                {
+                    if (!lerInteiro(valor, tamanho_valor, LIMITE_INCERTEZA_MINIMO_MS, LIMITE_INCERTEZA_MAXIMO_MS, numero))
+                        return false;
+                    config.limite_incerteza_ms = numero;
+                }
+                else if (CHAVE_DELTA("url"))
+                {
+                    if (tamanho_valor < 8 || tamanho_valor >= TAMANHO_URL_SERVIDOR ||
+                        (memcmp(valor, "http://", 7) != 0 && memcmp(valor, "https://", 8) != 0))
+                        return false;
+                    memcpy(config.servidor_url, valor, tamanho_valor);
+                    config.servidor_url[tamanho_valor] = '\0';
+                }
+                else if (tamanho_chave > 6 && memcmp(p, "limite", 6) == 0 &&
+                         lerInteiro(p + 6, tamanho_chave - 6, 0, quantidade_regras - 1, numero))
+                {
+                    const RegraFaixa &regra = regras[numero];
+                    if (!lerDecimal(valor, tamanho_valor, regra.minimo, regra.maximo, config.limites_regras[numero]))
+                        return false;
+                }
+                else
+                {
+                    Serial.println("[!] chave de config desconhecida ignorada: " + String(p).substring(0, tamanho_chave));
+                }
+#undef CHAVE_DELTA
+            }
+
+            p = fim + 1;
+        }
+
+        return tem_versao;
+    }
+
+public:
+    GerenciadorConfig()
+    {
+        ativa = configPadrao();
+        proxima = ativa;
+        tem_proxima = false;
+    }
+
+    /*
+     * carrega a configuracao gravada no NVS (chamar no setup)
+     */
+    void carregar()
+    {
+        Preferences nvs;
+        if (nvs.begin(ESPACO_NVS_CONFIG, true))
+        {
+            ConfigRemota gravada;
+            if (nvs.getBytesLength(CHAVE_NVS_CONFIG) == sizeof(ConfigRemota) &&
+                nvs.getBytes(CHAVE_NVS_CONFIG, &gravada, sizeof(ConfigRemota)) == sizeof(ConfigRemota) &&
+                gravada.assinatura == ASSINATURA_CONFIG)
+            {
+                gravada.servidor_url[TAMANHO_URL_SERVIDOR - 1] = '\0';
+                ativa = gravada;
+            }
+            nvs.end();
+        }
+
+        proxima = ativa;
+        tem_proxima = false;
+    }
+
+    /*
+     * procura um delta na resposta do servidor, valida e grava no NVS
+     * retorna true se uma nova versao foi aceita
+     */
+    bool aplicarDelta(const String &resposta)
+    {
+        const char *texto = resposta.c_str();
+        const char *linha = strstr(texto, "cfg;");
+        while (linha && linha != texto && linha[-1] != '\n')
+            linha = strstr(linha + 4, "cfg;");
+        if (!linha)
+            return false;
+
+        const char *fim = strchr(linha, '\n');
+        size_t tamanho = fim ? (size_t)(fim - linha) : strlen(linha);
+        if (tamanho > 0 && linha[tamanho - 1] == '\r')
+            tamanho--;
+
+        ConfigRemota nova = proxima;
+        if (!interpretarDelta(linha, tamanho, nova))
+        {
+            Serial.println("[!] delta de config invalido - mantida versao " + String(proxima.versao));
+            return false;
+        }
+
+        if (nova.versao <= proxima.versao)
+        {
+            return false;
+        }
+
+        Preferences nvs;
+        if (!nvs.begin(ESPACO_NVS_CONFIG, false) ||
+            nvs.putBytes(CHAVE_NVS_CONFIG, &nova, sizeof(ConfigRemota)) != sizeof(ConfigRemota))
+        {
+            Serial.println("[!] falha ao gravar config no NVS");
+            nvs.end();
+            return false;
+        }
+        nvs.end();
+
+        proxima = nova;
+        tem_proxima = true;
+        Serial.println("config v" + String(nova.versao) + " recebida - vale no proximo despertar");
+        return true;
+    }
+
+    /*
+     * ajuste local pelo console serial: "chave=valor;..." vira um delta com
+     * a versao seguinte (para sobrescrever, o servidor publica uma maior)
+     */
+    bool aplicarLocal(const String &pares)
+    {
+        return aplicarDelta("cfg;v=" + String(proxima.versao + 1) + ";" + pares);
+    }
+
+    /*
+     * sem deep sleep real (wokwi) o proximo despertar e o proximo ciclo
+     */
+    void promoverPendente()
+    {
+        if (tem_proxima)
+        {
+            ativa = proxima;
+            tem_proxima = false;
+            Serial.println("aplicando config v" + String(ativa.versao));
+        }
+    }
+
+    const ConfigRemota &atual() const
+    {
+        return ativa;
+    }
+
+    /*
+     * versao anunciada ao servidor nos metadados do upload
+     */
+    void metadadosJSON(BufferTexto &json) const
+    {
+        json.acrescentar("\"config_versao\": ").natural(proxima.versao);
+    }
+
+    void imprimirStatus()
+    {
+        Serial.println("configuracao (v" + String(ativa.versao) + (ativa.versao ? ", remota" : ", fabrica") + "):");
+        Serial.println("  periodo de amostragem: " + String(ativa.periodo_amostragem_ms / 1000) + " s");
+        Serial.println("  tentativas de upload: " + String(ativa.max_tentativas) + " (espera " +
+                       String(ativa.espera_tentativas_ms) + " ms)");
+        Serial.println("  limite de incerteza: " + String(ativa.limite_incerteza_ms) + " ms");
+        Serial.println("  servidor: " + String(ativa.servidor_url));
+
+        uint8_t quantidade;
+        const RegraFaixa *regras = GerenciadorSensores::regras(quantidade);
+        for (uint8_t i = 0; i < quantidade; i++)
+        {
+            Serial.println("  limite" + String(i) + " (" + GerenciadorSensores::canais()[regras[i].canal].nome +
+                           ", faixa " + faixas()[regras[i].faixa].nome + "): " + String(ativa.limites_regras[i], 2));
+        }
+    }
+};
+
+#endif
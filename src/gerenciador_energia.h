@@ -0,0 +1,189 @@
+#ifndef GERENCIADOR_ENERGIA_H
+#define GERENCIADOR_ENERGIA_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "buffer_texto.h"
+#include "modelo_energia.h"
+#include <sys/time.h>
+
+/*
+ *  [i] contabilidade de energia por ciclo
+ *
+ *  cada ciclo = sono anterior + tempo acordado. os tempos medidos de cada
+ *  estado passam pelo modelo (modelo_energia.h) com a tabela de correntes
+ *  do config.h; os totais ficam na memoria RTC e sobrevivem ao deep sleep.
+ */
+
+struct ContabilidadeEnergia
+{
+    uint32_t assinatura;                      // diferente de ASSINATURA_ENERGIA apos cold boot
+    uint32_t ciclos;                          // ciclos encerrados desde o cold boot
+    uint32_t amostras;                        // registros gravados nesses ciclos
+    uint64_t ms_total;                        // sono + acordado, para o periodo medio
+    float uah_estado[TOTAL_ESTADOS_ENERGIA];  // energia acumulada por estado
+    float uah_ultimo_ciclo;
+    int64_t us_inicio_sono;                   // relogio do sistema ao dormir (0 = sem sono pendente)
+};
+
+const uint32_t ASSINATURA_ENERGIA = 0x454E4731;
+
+RTC_DATA_ATTR ContabilidadeEnergia contabilidade_energia = {0, 0, 0, 0, {0, 0, 0, 0}, 0, 0};
+
+class GerenciadorEnergia
+{
+private:
+    TabelaCorrente tabela;
+    TemposEnergia ciclo;        // tempos do ciclo em andamento
+    unsigned long inicio_acordado;
+    uint32_t amostras_ciclo;
+    bool primeiro_despertar;
+
+    int64_t relogioSistemaUs()
+    {
+        struct timeval agora;
+        gettimeofday(&agora, NULL);
+        return (int64_t)agora.tv_sec * 1000000 + agora.tv_usec;
+    }
+
+    float uahTotal() const
+    {
+        float soma = 0.0f;
+        for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+            soma += contabilidade_energia.uah_estado[i];
+        return soma;
+    }
+
+public:
+    GerenciadorEnergia()
+    {
+        TabelaCorrente padrao = {CORRENTES_ENERGIA};
+        tabela = padrao;
+        memset(&ciclo, 0, sizeof(ciclo));
+        inicio_acordado = 0;
+        amostras_ciclo = 0;
+        primeiro_despertar = true;
+    }
+
+    /*
+     * valida os totais da RTC e conta o sono que acabou de terminar
+     */
+    void iniciar()
+    {
+        if (contabilidade_energia.assinatura != ASSINATURA_ENERGIA)
+        {
+            memset(&contabilidade_energia, 0, sizeof(contabilidade_energia));
+            contabilidade_energia.assinatura = ASSINATURA_ENERGIA;
+        }
+        registrarDespertar();
+    }
+
+    /*
+     * chamado ao acordar (boot no esp32, retorno do sono simulado no wokwi)
+     */
+    void registrarDespertar()
+    {
+        if (contabilidade_energia.us_inicio_sono != 0)
+        {
+            int64_t dormido_us = relogioSistemaUs() - contabilidade_energia.us_inicio_sono;
+            ciclo.ms[ENERGIA_SONO] = dormido_us > 0 ? dormido_us / 1000 : 0;
+            contabilidade_energia.us_inicio_sono = 0;
+        }
+
+        // no boot o tempo acordado conta desde o reset (millis = 0)
+        inicio_acordado = primeiro_despertar ? 0 : millis();
+        primeiro_despertar = false;
+    }
+
+    // tempos medidos pelas fases do ciclo
+    void registrarRadio(uint32_t ms) { ciclo.ms[ENERGIA_RADIO] += ms; }
+    void registrarFlash(uint32_t ms) { ciclo.ms[ENERGIA_FLASH] += ms; }
+    void registrarAmostras(uint32_t quantidade) { amostras_ciclo += quantidade; }
+
+    /*
+     * fecha o ciclo logo antes de dormir e acumula na RTC
+     */
+    void encerrarCiclo()
+    {
+        ciclo.ms[ENERGIA_CPU] = millis() - inicio_acordado;
+
+        float uah_ciclo = 0.0f;
+        for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+        {
+            float uah = energiaEstadoUAh(tabela.corrente_ma[i], ciclo.ms[i]);
+            contabilidade_energia.uah_estado[i] += uah;
+            uah_ciclo += uah;
+        }
+
+        contabilidade_energia.uah_ultimo_ciclo = uah_ciclo;
+        contabilidade_energia.ciclos++;
+        contabilidade_energia.amostras += amostras_ciclo;
+        contabilidade_energia.ms_total += ciclo.ms[ENERGIA_SONO] + ciclo.ms[ENERGIA_CPU];
+        contabilidade_energia.us_inicio_sono = relogioSistemaUs();
+
+        memset(&ciclo, 0, sizeof(ciclo));
+        amostras_ciclo = 0;
+    }
+
+    /*
+     * acordado ate agora no ciclo em andamento
+     */
+    uint32_t acordadoMs() const
+    {
+        return millis() - inicio_acordado;
+    }
+
+    float uahPorAmostra() const
+    {
+        if (contabilidade_energia.amostras == 0)
+            return 0.0f;
+        return uahTotal() / contabilidade_energia.amostras;
+    }
+
+    float consumoDiarioMAh() const
+    {
+        if (contabilidade_energia.ciclos == 0)
+            return 0.0f;
+        return ::consumoDiarioMAh(uahTotal() / contabilidade_energia.ciclos,
+                                  (float)contabilidade_energia.ms_total / contabilidade_energia.ciclos);
+    }
+
+    float autonomiaDias() const
+    {
+        return ::autonomiaDias(CAPACIDADE_BATERIA_MAH, consumoDiarioMAh());
+    }
+
+    /*
+     * fragmento json para o payload de upload (ciclos ja encerrados)
+     */
+    void formatarJSON(BufferTexto &json) const
+    {
+        json.acrescentar("\"energia\": {\"ciclos\": ").natural(contabilidade_energia.ciclos);
+        json.acrescentar(", \"uah_ciclo\": ").decimal(contabilidade_energia.uah_ultimo_ciclo, 1);
+        json.acrescentar(", \"uah_amostra\": ").decimal(uahPorAmostra(), 1);
+        json.acrescentar(", \"mah_dia\": ").decimal(consumoDiarioMAh(), 2);
+        json.acrescentar(", \"autonomia_dias\": ").decimal(autonomiaDias(), 0);
+        json.acrescentar(", \"uah\": [");
+        for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+        {
+            json.decimal(contabilidade_energia.uah_estado[i], 1);
+            json.acrescentar(i + 1 < TOTAL_ESTADOS_ENERGIA ? ", " : "]}");
+        }
+    }
+
+    void imprimirStatus() const
+    {
+        Serial.println("energia estimada:");
+        Serial.println("  ciclos: " + String(contabilidade_energia.ciclos));
+        Serial.println("  ultimo ciclo: " + String(contabilidade_energia.uah_ultimo_ciclo, 1) + " uAh");
+        Serial.println("  por amostra: " + String(uahPorAmostra(), 1) + " uAh");
+        Serial.println("  consumo: " + String(consumoDiarioMAh(), 2) + " mAh/dia");
+        Serial.println("  autonomia: " + String(autonomiaDias(), 0) + " dias (" + String(CAPACIDADE_BATERIA_MAH, 0) + " mAh)");
+        Serial.println("  sono/cpu/radio/flash: " + String(contabilidade_energia.uah_estado[ENERGIA_SONO], 0) + " / " +
+                       String(contabilidade_energia.uah_estado[ENERGIA_CPU], 0) + " / " +
+                       String(contabilidade_energia.uah_estado[ENERGIA_RADIO], 0) + " / " +
+                       String(contabilidade_energia.uah_estado[ENERGIA_FLASH], 0) + " uAh");
+    }
+};
+
+#endif
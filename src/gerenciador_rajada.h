@@ -0,0 +1,193 @@
+#ifndef GERENCIADOR_RAJADA_H
+#define GERENCIADOR_RAJADA_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "compressao_rajada.h"
+#include "gerenciador_armazenamento.h"
+
+/*
+ *  [i] captura em rajada para eventos transitorios
+ *
+ *  disparada pelo botao de wake-up ou por uma mudanca na saida digital do
+ *  LDR (comparador ligado ao GPIO25). amostra os dois canais do ADC em
+ *  FREQUENCIA_RAJADA_HZ por DURACAO_RAJADA_MS em buffers pre-alocados,
+ *  guarda as leituras cruas (12 bits) e grava a rajada compactada como um
+ *  unico bloco em ARQUIVO_RAJADAS, separado dos registros CSV.
+ */
+
+enum GatilhoRajada
+{
+    GATILHO_NENHUM = 0,
+    GATILHO_BOTAO = 1, // botao de wake-up
+    GATILHO_LDR = 2    // comparador do LDR mudou de nivel
+};
+
+const uint8_t CANAIS_RAJADA = 2; // 0 = termistor, 1 = LDR
+const uint8_t NIVEL_LDR_DESCONHECIDO = 0xFF;
+
+// nivel do comparador no fim do ultimo ciclo (sobrevive ao deep sleep)
+RTC_DATA_ATTR uint8_t nivel_ldr_anterior = NIVEL_LDR_DESCONHECIDO;
+
+class GerenciadorRajada
+{
+private:
+    uint16_t amostras[CANAIS_RAJADA][MAXIMO_AMOSTRAS_RAJADA];
+    uint8_t bloco[sizeof(CabecalhoRajada) + CANAIS_RAJADA * MAXIMO_AMOSTRAS_RAJADA * 3];
+
+    GatilhoRajada gatilho_armado;
+    CabecalhoRajada cabecalho;
+    uint32_t atrasos; // amostras que perderam o instante programado
+    bool pendente;    // capturada e ainda nao gravada
+
+public:
+    GerenciadorRajada()
+    {
+        gatilho_armado = GATILHO_NENHUM;
+        atrasos = 0;
+        pendente = false;
+        cabecalho = {ASSINATURA_RAJADA, VERSAO_RAJADA, GATILHO_NENHUM, 0, 0, 0, 0, 0};
+    }
+
+    /*
+     * pede uma rajada no proximo ciclo (ex: botao pressionado)
+     */
+    void armar(GatilhoRajada gatilho)
+    {
+        gatilho_armado = gatilho;
+    }
+
+    /*
+     * arma a rajada conforme o motivo do wake-up (GerenciadorSleep::aoAcordar)
+     */
+    void armarPorDespertar(esp_sleep_wakeup_cause_t causa)
+    {
+        switch (causa)
+        {
+        case ESP_SLEEP_WAKEUP_EXT0:
+            armar(GATILHO_BOTAO);
+            break;
+        case ESP_SLEEP_WAKEUP_EXT1:
+            armar(GATILHO_LDR);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /*
+     * consome o gatilho armado ou detecta mudanca no comparador do LDR
+     */
+    GatilhoRajada verificarGatilho()
+    {
+        GatilhoRajada gatilho = gatilho_armado;
+        gatilho_armado = GATILHO_NENHUM;
+
+        uint8_t nivel = digitalRead(PINO_LDR_DIGITAL);
+        if (gatilho == GATILHO_NENHUM && nivel_ldr_anterior != NIVEL_LDR_DESCONHECIDO &&
+            nivel != nivel_ldr_anterior)
+        {
+            gatilho = GATILHO_LDR;
+        }
+        nivel_ldr_anterior = nivel;
+
+        return gatilho;
+    }
+
+    /*
+     * amostra os dois canais em FREQUENCIA_RAJADA_HZ
+     * bloqueia por DURACAO_RAJADA_MS - chamar no nucleo da aquisicao
+     */
+    bool capturar(GatilhoRajada gatilho, uint32_t epoch)
+    {
+        uint32_t total = (uint32_t)FREQUENCIA_RAJADA_HZ * DURACAO_RAJADA_MS / 1000;
+        if (total > MAXIMO_AMOSTRAS_RAJADA)
+            total = MAXIMO_AMOSTRAS_RAJADA;
+
+        const uint32_t periodo_us = 1000000UL / FREQUENCIA_RAJADA_HZ;
+
+        Serial.print("\ncapturando rajada: ");
+        Serial.print(total);
+        Serial.print(" amostras a ");
+        Serial.print(FREQUENCIA_RAJADA_HZ);
+        Serial.println(" Hz");
+
+        atrasos = 0;
+        uint32_t inicio = micros();
+        uint32_t proxima = inicio;
+
+        for (uint32_t i = 0; i < total; i++)
+        {
+            while ((int32_t)(micros() - proxima) < 0)
+            {
+            }
+
+            amostras[0][i] = analogRead(PINO_TERMISTOR);
+            amostras[1][i] = analogRead(PINO_FOTORESISTOR);
+
+            proxima += periodo_us;
+            if ((int32_t)(micros() - proxima) > 0)
+                atrasos++;
+        }
+
+        uint32_t duracao_us = micros() - inicio;
+        if (duracao_us == 0)
+            duracao_us = 1;
+
+        cabecalho.gatilho = gatilho;
+        cabecalho.epoch = epoch;
+        cabecalho.amostras = total;
+        cabecalho.frequencia_hz = (uint64_t)total * 1000000 / duracao_us;
+        pendente = total > 0;
+
+        Serial.print("rajada capturada em ");
+        Serial.print(duracao_us / 1000);
+        Serial.print(" ms (");
+        Serial.print(cabecalho.frequencia_hz);
+        Serial.print(" Hz, ");
+        Serial.print(atrasos);
+        Serial.println(" atrasos)");
+        return pendente;
+    }
+
+    /*
+     * compacta a ultima rajada e grava como um bloco
+     */
+    bool salvar(GerenciadorArmazenamento &armazenamento)
+    {
+        if (!pendente)
+            return false;
+        pendente = false;
+
+        uint8_t *dados = bloco + sizeof(CabecalhoRajada);
+        size_t tamanho = 0;
+        for (uint8_t canal = 0; canal < CANAIS_RAJADA; canal++)
+        {
+            tamanho += codificarDeltaVarint(amostras[canal], cabecalho.amostras, dados + tamanho);
+        }
+
+        cabecalho.tamanho_dados = tamanho;
+        cabecalho.verificacao = fletcher16(dados, tamanho);
+        memcpy(bloco, &cabecalho, sizeof(CabecalhoRajada));
+
+        size_t tamanho_bloco = sizeof(CabecalhoRajada) + tamanho;
+        uint32_t bytes_crus = (uint32_t)cabecalho.amostras * CANAIS_RAJADA * sizeof(uint16_t);
+
+        Serial.print("gravando rajada: ");
+        Serial.print((uint32_t)tamanho_bloco);
+        Serial.print(" bytes (");
+        Serial.print(bytes_crus);
+        Serial.print(" crus, ");
+        Serial.print(100.0 * tamanho_bloco / bytes_crus, 1);
+        Serial.println("%)");
+
+        return armazenamento.salvarBloco(ARQUIVO_RAJADAS, bloco, tamanho_bloco);
+    }
+
+    bool temPendente() const
+    {
+        return pendente;
+    }
+};
+
+#endif
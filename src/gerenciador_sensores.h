@@ -3,19 +3,68 @@
 
 #include "config.h"
 #include "Arduino.h"
+#include "buffer_texto.h"
+#include "faixas_upload.h"
+#include "gerador_carga.h"
+#include "gerenciador_calibracao.h"
+#include "registro_canais.h"
+#include "saude_canal.h"
+
+/*
+ *  [i] canais de sensores
+ *
+ *  cada canal e uma linha da tabela em GerenciadorSensores::canais():
+ *  nome, unidade, casas decimais gravadas, periodo e metodo de leitura.
+ *  armazenamento, upload e exibicao percorrem a tabela, entao um
+ *  canal novo (umidade, bateria...) e um indice aqui, um metodo de leitura
+ *  e uma linha na tabela. indices so crescem: sao os bits do mapa gravado.
+ */
+enum IndiceCanal
+{
+    CANAL_TEMPERATURA,
+    CANAL_LUMINOSIDADE,
+    NUMERO_CANAIS
+};
+
+typedef RegistroCanais<NUMERO_CANAIS> CanaisLidos;
 
 /*
  *  [i] estrutura para armazenar dados dos sensores
  */
 struct DadosSensores
 {
-    float temperatura;          // temperatura em graus celsius
-    float luminosidade;         // luminosidade em lux
-    bool temperatura_valida;    // indica se leitura e confiavel
-    bool luminosidade_valida;   // indica se leitura e confiavel
+    CanaisLidos canais;         // mapa de presenca + valores em ponto fixo
     uint32_t timestamp_leitura; // quando a leitura foi feita (millis)
+    uint8_t faixas;             // bits de Faixa que as regras pediram (a bruta recebe sempre)
+};
+
+class GerenciadorSensores;
+typedef float (GerenciadorSensores::*LeituraCanal)(); // NAN = leitura invalida
+
+struct DescritorCanal
+{
+    const char *nome;     // coluna do cabecalho e chave no upload
+    const char *unidade;  // exibicao
+    uint8_t casas;        // escala: grava round(valor x 10^casas)
+    uint32_t periodo_s;   // 0 = todo ciclo
+    float desvio_atipico; // desvio minimo da mediana para marcar atipico
+    LeituraCanal ler;     // sensor real
+    ConfigCanalMock mock; // substituto quando o sensor falha (prob_falha 1 = nenhum)
+};
+
+/*
+ *  [i] estado de cada canal que sobrevive ao deep sleep
+ */
+struct EstadoCanal
+{
+    uint32_t ultima_leitura; // epoch, para canais com periodo proprio
+    SaudeSensor saude;
+    FiltroHampel filtro;
 };
 
+RTC_DATA_ATTR EstadoCanal estado_canais[NUMERO_CANAIS];
+RTC_DATA_ATTR EstadoRegra estado_regras[MAXIMO_REGRAS_FAIXA];
+
 /*
  *  [i] classe principal do gerenciador de sensores
  */
@@ -23,9 +72,10 @@ class GerenciadorSensores
 {
 private:
     bool sensores_inicializados;
-    bool mock_temperatura;       // true se usando dados simulados para temperatura
-    bool mock_luminosidade;      // true se usando dados simulados para luminosidade
-    unsigned long contador_mock; // contador para variacao dos dados simulados
+    unsigned long contador_mock;               // contador para variacao dos dados simulados
+    CanalMock gerador_canal[NUMERO_CANAIS];    // geradores simulados de cada canal
+    GerenciadorCalibracao calibracao_sensores; // tabelas de conversao por dispositivo
+    float limites_regras[MAXIMO_REGRAS_FAIXA]; // REGRAS_FAIXAS ou os da config remota
 
     /*
      * le o sensor de temperatura real (NTC)
@@ -44,12 +94,8 @@ private:
             return NAN;
         }
 
-        // converte leitura analogica para resistencia usando divisor de tensao
-        float resistencia = 10000.0 / (4095.0 / leitura_analogica - 1.0);
-
-        // converte resistencia para temperatura usando equacao do termistor NTC
-        float temperatura_kelvin = 1.0 / (log(resistencia / 10000.0) / BETA_TERMISTOR + 1.0 / 298.15);
-        float temperatura_celsius = temperatura_kelvin - 273.15;
+        // leitura -> temperatura pela tabela calibrada (Steinhart-Hart + ADC)
+        float temperatura_celsius = calibracao_sensores.temperatura(leitura_analogica);
 
         // verifica se o valor esta dentro de limites razoaveis para ambiente
         if (temperatura_celsius < -50.0 || temperatura_celsius > 100.0)
@@ -58,7 +104,10 @@ private:
             return NAN;
         }
 
-        Serial.println("temperatura: " + String(temperatura_celsius, 2) + " °C");
+        // dentro do trecho sem heap da leitura: texto na pilha, sem String
+        char texto[32];
+        BufferTexto linha(texto, sizeof(texto));
+        Serial.println(linha.acrescentar("temperatura: ").decimal(temperatura_celsius, 2).acrescentar(" °C").c_str());
         return temperatura_celsius;
     }
 
@@ -79,20 +128,8 @@ private:
             return NAN;
         }
 
-        // converte leitura analogica para tensao
-        float tensao = leitura_analogica / 4096.0 * 3.3;
-
-        // calcula resistencia do LDR usando divisor de tensao
-        float resistencia = 2000.0 * tensao / (1.0 - tensao / 3.3);
-
-        // evita divisao por zero ou valores negativos
-        if (resistencia <= 0)
-        {
-            return NAN;
-        }
-
-        // converte resistencia para luminosidade usando curva caracteristica do LDR
-        float luminosidade_lux = pow(RESISTENCIA_LDR * 1000.0 * pow(10.0, GAMA_LDR) / resistencia, (1.0 / GAMA_LDR));
+        // leitura -> luminosidade pela tabela calibrada (curva do LDR + ADC)
+        float luminosidade_lux = calibracao_sensores.luminosidade(leitura_analogica);
 
         // verifica se o valor esta dentro de limites razoaveis
         if (luminosidade_lux < 0.1 || luminosidade_lux > 100000.0)
@@ -101,47 +138,116 @@ private:
             return NAN;
         }
 
-        Serial.println("luminosidade: " + String(luminosidade_lux, 0) + " lux");
+        char texto[32];
+        BufferTexto linha(texto, sizeof(texto));
+        Serial.println(linha.acrescentar("luminosidade: ").decimal(luminosidade_lux, 0).acrescentar(" lux").c_str());
         return luminosidade_lux;
     }
 
     /*
-     * gera dados simulados quando os sensores reais nao estao disponiveis
-     * os valores variam suavemente para simular condicoes reais
+     * canal com periodo proprio so e lido quando vence
+     * meio periodo de amostragem de folga para o jitter do despertar
      */
-    void gerarDadosMock(DadosSensores &dados)
+    bool canalDevido(uint8_t canal, unsigned long epoch) const
     {
-        contador_mock++;
-
-        // temperatura oscila entre 20°C e 25°C de forma suave (funcao seno)
-        float variacao_temperatura = sin(contador_mock * 0.1) * 2.5;
-        dados.temperatura = 22.5 + variacao_temperatura;
+        uint32_t periodo_s = canais()[canal].periodo_s;
+        if (periodo_s == 0 || epoch == 0 || estado_canais[canal].ultima_leitura == 0)
+            return true;
+        return epoch + TEMPO_AMOSTRAGEM / 2000 - estado_canais[canal].ultima_leitura >= periodo_s;
+    }
 
-        // luminosidade varia entre 100 e 1000 lux (ambiente interno tipico)
-        float variacao_luz = sin(contador_mock * 0.05) * 450.0;
-        dados.luminosidade = 550.0 + variacao_luz;
+    /*
+     * regras das faixas sobre os canais lidos agora (canal ausente nao avalia)
+     * valores simulados tambem avaliam (o registro leva a marca s), para o
+     * wokwi e o host exercitarem os alarmes
+     * retorna os bits das faixas que devem receber o registro
+     */
+    uint8_t avaliarRegras(const DadosSensores &dados)
+    {
+        uint8_t faixas_registro = 0;
+        uint8_t quantidade;
+        const RegraFaixa *tabela = regras(quantidade);
 
-        // marca os dados como simulados
-        dados.temperatura_valida = mock_temperatura;
-        dados.luminosidade_valida = mock_luminosidade;
+        for (uint8_t i = 0; i < quantidade; i++)
+        {
+            const RegraFaixa &regra = tabela[i];
+            if (!dados.canais.tem(regra.canal))
+                continue;
 
-        Serial.println("usando dados simulados");
+            int32_t limite = escalarValor(limites_regras[i], canais()[regra.canal].casas);
+            if (avaliarRegra(regra.tipo, dados.canais.valor(regra.canal), limite, estado_regras[i]))
+            {
+                faixas_registro |= 1u << regra.faixa;
+                if (regra.faixa == FAIXA_ALARME)
+                {
+                    Serial.print("[!] alarme em ");
+                    Serial.print(canais()[regra.canal].nome);
+                    Serial.print(": ");
+                    Serial.println(estado_regras[i].ativa ? "limite cruzado" : "de volta ao normal");
+                }
+            }
+        }
+        return faixas_registro;
     }
 
 public:
+    /*
+     * tabela de canais (ordem = bit no mapa do registro)
+     */
+    static const DescritorCanal *canais()
+    {
+        static const DescritorCanal tabela[] = {
+            {"temperatura", "graus celsius", 2, 0, 1.0, &GerenciadorSensores::lerTemperatura, MOCK_TEMPERATURA},
+            {"luminosidade", "lux", 2, 0, 100.0, &GerenciadorSensores::lerLuminosidade, MOCK_LUMINOSIDADE},
+        };
+        static_assert(sizeof(tabela) / sizeof(tabela[0]) == NUMERO_CANAIS, "tabela de canais difere de IndiceCanal");
+        return tabela;
+    }
+
+    /*
+     * regras das faixas de upload (REGRAS_FAIXAS no config.h)
+     */
+    static const RegraFaixa *regras(uint8_t &quantidade)
+    {
+        static const RegraFaixa tabela[] = REGRAS_FAIXAS;
+        static_assert(sizeof(tabela) / sizeof(tabela[0]) <= MAXIMO_REGRAS_FAIXA, "regras demais para a memoria RTC");
+        quantidade = sizeof(tabela) / sizeof(tabela[0]);
+        return tabela;
+    }
+
     /*
      * construtor - inicializa o gerenciador
      */
     GerenciadorSensores()
     {
         sensores_inicializados = false;
-        mock_temperatura = false;
-        mock_luminosidade = false;
         contador_mock = 0;
+
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            gerador_canal[i].configurar(canais()[i].mock);
+        }
+
+        uint8_t quantidade;
+        const RegraFaixa *tabela = regras(quantidade);
+        for (uint8_t i = 0; i < quantidade; i++)
+        {
+            limites_regras[i] = tabela[i].limite;
+        }
+    }
+
+    /*
+     * limites das regras na ordem de REGRAS_FAIXAS (ConfigRemota::limites_regras)
+     */
+    void definirLimitesRegras(const float *limites)
+    {
+        uint8_t quantidade;
+        regras(quantidade);
+        memcpy(limites_regras, limites, quantidade * sizeof(float));
     }
 
     /*
-     * inicializa os sensores e detecta quais estao disponiveis
+     * inicializa os sensores e a calibracao e mostra a saude de cada canal
      * deve ser chamado uma vez no setup()
      */
     void iniciar()
@@ -152,32 +258,15 @@ public:
         pinMode(PINO_TERMISTOR, INPUT);
         pinMode(PINO_FOTORESISTOR, INPUT);
 
-        Serial.println("verificando sensores disponiveis...\n");
-
-        // testa sensor de temperatura para ver se esta funcionando
-        float teste_temperatura = lerTemperatura();
-        if (!isnan(teste_temperatura))
-        {
-            Serial.println("sensor de temperatura: detectado\n");
-            mock_temperatura = false;
-        }
-        else
-        {
-            Serial.println("[!] sensor de temperatura: usando dados simulados\n");
-            mock_temperatura = true;
-        }
+        // coeficientes do NVS compilados em tabelas antes da primeira leitura
+        calibracao_sensores.iniciar();
 
-        // testa sensor de luminosidade para ver se esta funcionando
-        float teste_luminosidade = lerLuminosidade();
-        if (!isnan(teste_luminosidade))
+        // sem leitura de teste: a saude de cada canal vem da memoria RTC e
+        // e atualizada pelas leituras do ciclo
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
         {
-            Serial.println("sensor de luminosidade: detectado\n");
-            mock_luminosidade = false;
-        }
-        else
-        {
-            Serial.println("[!] sensor de luminosidade: usando dados simulados\n");
-            mock_luminosidade = true;
+            const SaudeSensor &saude = estado_canais[i].saude;
+            Serial.println("sensor de " + String(canais()[i].nome) + ": " + nomeSaude(saude.estado));
         }
 
         sensores_inicializados = true;
@@ -185,12 +274,15 @@ public:
     }
 
     /*
-     * le todos os sensores disponiveis
-     * retorna estrutura com dados e flags de validade
+     * le os canais que vencem neste ciclo
+     * epoch alimenta os perfis diurnos dos canais simulados (0 = relogio sintetico)
+     * retorna mapa dos canais validos e seus valores
      */
-    DadosSensores lerSensores()
+    DadosSensores lerSensores(unsigned long epoch = 0)
     {
         DadosSensores dados;
+        dados.canais.limpar();
+        dados.faixas = 0;
 
         // se nao foi inicializado, inicializa automaticamente
         if (!sensores_inicializados)
@@ -201,42 +293,127 @@ public:
 
         dados.timestamp_leitura = millis();
 
-        // tenta ler sensor de temperatura real se disponivel
-        if (!mock_temperatura)
+        // sem epoch os simulados usam um relogio sintetico com o periodo de amostragem
+        contador_mock++;
+        uint32_t tempo_mock_s = epoch ? epoch : contador_mock * (TEMPO_AMOSTRAGEM / 1000);
+        bool usou_mock = false;
+
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
         {
-            dados.temperatura = lerTemperatura();
-            dados.temperatura_valida = !isnan(dados.temperatura);
+            if (!canalDevido(i, epoch))
+                continue;
+
+            const DescritorCanal &canal = canais()[i];
+            EstadoCanal &estado = estado_canais[i];
+            float valor = NAN;
 
-            // se a leitura real falhou e mocks estao habilitados, alterna para mock
-            if (!dados.temperatura_valida && SENSORES_MOCKS)
+            // sensor real, a menos que esteja em espera apos falhas seguidas
+            if (estado.saude.deveTentar())
             {
-                Serial.println("[!] leitura de temperatura falhou - usando dados simulados\n");
-                mock_temperatura = true;
+                uint8_t antes = estado.saude.estado;
+                valor = (this->*canal.ler)();
+
+                if (isnan(valor))
+                    estado.saude.registrarFalha();
+                else
+                    estado.saude.registrarSucesso();
+
+                if (estado.saude.estado != antes)
+                {
+                    Serial.print("[!] sensor de ");
+                    Serial.print(canal.nome);
+                    Serial.print(": ");
+                    Serial.print(nomeSaude(antes));
+                    Serial.print(" -> ");
+                    Serial.println(nomeSaude(estado.saude.estado));
+                }
             }
-        }
 
-        // tenta ler sensor de luminosidade real se disponivel
-        if (!mock_luminosidade)
-        {
-            dados.luminosidade = lerLuminosidade();
-            dados.luminosidade_valida = !isnan(dados.luminosidade);
+            // sem leitura real: valor simulado, marcado como tal no registro
+            bool simulado = false;
+            if (isnan(valor) && SENSORES_MOCKS)
+            {
+                usou_mock = true;
+                simulado = gerador_canal[i].gerar(tempo_mock_s, valor);
+                if (!simulado)
+                    valor = NAN;
+            }
 
-            if (!dados.luminosidade_valida && SENSORES_MOCKS)
+            if (!isnan(valor))
             {
-                Serial.println("[!] leitura de luminosidade falhou - usando dados simulados\n");
-                mock_luminosidade = true;
+                int32_t escalado = escalarValor(valor, canal.casas);
+                dados.canais.definir(i, escalado);
+
+                if (simulado)
+                {
+                    dados.canais.simulados |= 1u << i;
+                }
+                else if (estado.filtro.avaliar(escalado, escalarValor(canal.desvio_atipico, canal.casas)))
+                {
+                    dados.canais.atipicos |= 1u << i;
+                    char texto[24];
+                    BufferTexto atipico(texto, sizeof(texto));
+                    atipico.decimal(valor, canal.casas);
+                    Serial.print("[!] ");
+                    Serial.print(canal.nome);
+                    Serial.print(" atipico: ");
+                    Serial.println(atipico.c_str());
+                }
             }
+            estado.ultima_leitura = epoch;
         }
 
-        // se algum sensor precisa de dados simulados, gera eles
-        if (mock_temperatura || mock_luminosidade)
+        if (usou_mock)
         {
-            gerarDadosMock(dados);
+            Serial.println("usando dados simulados");
         }
 
+        dados.faixas = avaliarRegras(dados);
         return dados;
     }
 
+    /*
+     * valor real de um canal do registro (NAN se ausente)
+     */
+    static float valorCanal(const DadosSensores &dados, uint8_t canal)
+    {
+        if (!dados.canais.tem(canal))
+            return NAN;
+        return valorReal(dados.canais.valor(canal), canais()[canal].casas);
+    }
+
+    /*
+     * saude de cada canal no formato json para o upload
+     */
+    void saudeJSON(BufferTexto &json) const
+    {
+        json.acrescentar("\"saude\": {");
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            if (i > 0)
+                json.acrescentar(", ");
+            json.acrescentar('"').acrescentar(canais()[i].nome).acrescentar("\": \"");
+            json.acrescentar(nomeSaude(estado_canais[i].saude.estado)).acrescentar('"');
+        }
+        json.acrescentar('}');
+    }
+
+    /*
+     * acesso aos geradores simulados (troca de perfil, replay de trace)
+     */
+    CanalMock &canalMock(uint8_t canal)
+    {
+        return gerador_canal[canal];
+    }
+
+    /*
+     * coeficientes e tabelas de conversao (ajuste em campo)
+     */
+    GerenciadorCalibracao &calibracao()
+    {
+        return calibracao_sensores;
+    }
+
     /*
      * informa quais sensores estao usando dados reais ou simulados
      * util para debugging e status do sistema
@@ -244,10 +421,21 @@ public:
     void imprimirStatus()
     {
         Serial.println("status dos sensores:");
-        Serial.println("  temperatura: " + String(mock_temperatura ? "dados simulados" : "sensor real"));
-        Serial.println("  luminosidade: " + String(mock_luminosidade ? "dados simulados" : "sensor real"));
+        for (uint8_t i = 0; i < NUMERO_CANAIS; i++)
+        {
+            const DescritorCanal &canal = canais()[i];
+            const SaudeSensor &saude = estado_canais[i].saude;
+            String detalhe = saude.estado == SAUDE_FALHO ? " (nova tentativa em " + String(saude.ciclos_restantes) + " ciclos)" : "";
+            if (canal.periodo_s)
+                detalhe += " (a cada " + String(canal.periodo_s) + " s)";
+            Serial.println("  " + String(canal.nome) + ": " + nomeSaude(saude.estado) + detalhe);
+        }
+        calibracao_sensores.imprimirStatus();
         Serial.println();
     }
 };
 
-#endif
\ No newline at end of file
+// orcamento de memoria do gerenciador (config.h)
+static_assert(sizeof(GerenciadorSensores) <= ORCAMENTO_OBJETO_SENSORES, "GerenciadorSensores acima do orcamento de memoria");
+
+#endif
@@ -3,37 +3,41 @@
 
 #include "config.h"
 #include "Arduino.h"
+#include "plataforma.h"
+#include "grade_amostragem.h"
+#include <WiFi.h>
 
-class GerenciadorSleep
-{
-public:
-    /**
-     * configura e entra em deep sleep
-     */
-    void entrarDeepSleep()
-    {
-        Serial.println("\nentrando em deep sleep...");
+// grade de amostragem: alvo e latencia medida (sobrevive ao deep sleep)
+RTC_DATA_ATTR EstadoGrade estado_grade = {0, 0, 0, 0, 0, 0};
 
-#ifdef AMBIENTE_WOKWI
-        // wokwi: nao faz nada - o loop principal cuida da simulacao
-        // apenas informa que o controle volta para o loop
-        return;
+// BACKENDS DE SONO
 
-#else
-        // esp32 fisico: deep sleep real
+/**
+ * esp32 fisico: deep sleep real, acorda por timer, botao ou LDR
+ */
+struct SonoProfundo
+{
+    static void dormir(uint64_t duracao_us)
+    {
         Serial.println("configurando deep sleep real");
 
-        // 1. configura wake-up por timer (5 minutos em microssegundos)
-        esp_sleep_enable_timer_wakeup(TEMPO_AMOSTRAGEM_REAL * 1000);
+        // 1. configura wake-up por timer (duracao em microssegundos do RTC)
+        esp_sleep_enable_timer_wakeup(duracao_us);
 
         // 2. configura wake-up por botao
         esp_sleep_enable_ext0_wakeup((gpio_num_t)PINO_BOTAO, 0); // LOW acorda
 
+        // 3. configura wake-up pela saida digital do LDR (qualquer mudanca de nivel)
+        bool ldr_alto = digitalRead(PINO_LDR_DIGITAL) == HIGH;
+        esp_sleep_enable_ext1_wakeup(1ULL << PINO_LDR_DIGITAL,
+                                     ldr_alto ? ESP_EXT1_WAKEUP_ALL_LOW : ESP_EXT1_WAKEUP_ANY_HIGH);
+
         Serial.println("wake-up configurado:");
-        Serial.println("   timer: " + String(TEMPO_AMOSTRAGEM_REAL / 1000) + " minutos");
+        Serial.println("   timer: " + String((uint32_t)(duracao_us / 1000)) + " ms");
         Serial.println("   botao: pino " + String(PINO_BOTAO));
+        Serial.println("   ldr: pino " + String(PINO_LDR_DIGITAL) + (ldr_alto ? " (nivel baixo)" : " (nivel alto)"));
 
-        // 3. desliga wifi para economizar
+        // 4. desliga wifi para economizar
         WiFi.disconnect(true);
         WiFi.mode(WIFI_OFF);
 
@@ -41,23 +45,154 @@ public:
         Serial.println("indo dormir...");
         delay(100); // espera mensagens serem enviadas
 
-        // 4. entra em deep sleep real (PARA A EXECUCAO)
+        // 5. entra em deep sleep real (PARA A EXECUCAO)
         esp_deep_sleep_start();
+    }
 
-#endif
+    static esp_sleep_wakeup_cause_t causaDespertar()
+    {
+        return esp_sleep_get_wakeup_cause();
+    }
+};
+
+/**
+ * wokwi: espera no proprio loop pelas mesmas fontes de wake-up
+ * retorna ao acordar, como se o esp32 tivesse reiniciado o ciclo
+ * o timer vale so para este sono: o proximo sai de novo da grade
+ */
+struct SonoSimulado
+{
+    static esp_sleep_wakeup_cause_t &causa()
+    {
+        static esp_sleep_wakeup_cause_t ultima = ESP_SLEEP_WAKEUP_UNDEFINED;
+        return ultima;
+    }
+
+    static void dormir(uint64_t duracao_us)
+    {
+        uint32_t duracao_ms = (uint32_t)((duracao_us + 500) / 1000);
+
+        Serial.println("\n[data logger] entrando em modo sleep");
+        Serial.println("tempo de sleep: " + String(duracao_ms) + " ms");
+        Serial.println("aguardando timer ou acionamento do botao...");
+
+        unsigned long inicio = millis();
+        unsigned long ultimo_pisca = inicio;
+        int nivel_ldr = digitalRead(PINO_LDR_DIGITAL);
+
+        while (true)
+        {
+            // verifica se tempo de sleep acabou
+            unsigned long decorrido = millis() - inicio;
+            if (decorrido >= duracao_ms)
+            {
+                causa() = ESP_SLEEP_WAKEUP_TIMER;
+                Serial.println("\n[data logger] acordado por timer");
+                return;
+            }
+
+            // verifica se botao foi pressionado
+            if (digitalRead(PINO_BOTAO) == LOW)
+            {
+                causa() = ESP_SLEEP_WAKEUP_EXT0;
+                Serial.println("\n[data logger] acordado por botao");
+                delay(300);
+                while (digitalRead(PINO_BOTAO) == LOW)
+                    delay(50);
+                return;
+            }
+
+            // comparador do LDR mudou de nivel
+            if (digitalRead(PINO_LDR_DIGITAL) != nivel_ldr)
+            {
+                causa() = ESP_SLEEP_WAKEUP_EXT1;
+                Serial.println("\n[data logger] acordado por sensor de luz");
+                return;
+            }
+
+            // mostra sinal de atividade enquanto dorme
+            if (millis() - ultimo_pisca > 1000)
+            {
+                Serial.print(".");
+                ultimo_pisca = millis();
+            }
+
+            // no maximo 100 ms por volta, sem passar do timer
+            unsigned long restante = duracao_ms - decorrido;
+            delay(restante < 100 ? restante : 100);
+        }
     }
 
+    static esp_sleep_wakeup_cause_t causaDespertar()
+    {
+        return causa();
+    }
+};
+
+// CLASSE GERENCIADOR SLEEP
+
+/*
+ *  [i] o sono nao tem duracao fixa: termina na proxima fronteira da grade
+ *  (epoch multiplo do periodo, grade_amostragem.h), descontado o tempo
+ *  acordado, a latencia medida ate a amostra e a deriva do RTC. ciclos
+ *  longos e despertares pelo botao ou LDR nao deslocam as amostras
+ *  seguintes.
+ */
+template <typename Sono>
+class GerenciadorSleepBase
+{
+public:
     /**
-     * chamado ao acordar - verifica motivo do wake-up
+     * despertar por timer: compara o timestamp da amostra do ciclo com o alvo
+     * e corrige a latencia. botao, LDR e reset ficam fora da grade
      */
-    void aoAcordar()
+    void registrarAmostra(int64_t amostra_us)
     {
-#ifdef AMBIENTE_WOKWI
-        // wokwi: ja e tratado no loop principal
-        return;
-#else
-        // esp32 fisico: identifica motivo do wake-up
-        esp_sleep_wakeup_cause_t causa = esp_sleep_get_wakeup_cause();
+        iniciarGrade(estado_grade);
+        if (Sono::causaDespertar() != ESP_SLEEP_WAKEUP_TIMER)
+            return;
+
+        int64_t erro_us = registrarAmostraGrade(estado_grade, amostra_us);
+        Serial.print("grade: amostra a ");
+        Serial.print((int32_t)(erro_us / 1000));
+        Serial.print(" ms do alvo, latencia ");
+        Serial.print(estado_grade.latencia_us / 1000);
+        Serial.println(" ms");
+    }
+
+    /**
+     * configura e entra em deep sleep ate a proxima fronteira da grade
+     * periodo_ms vem da configuracao ativa; agora_us e o epoch corrigido
+     * (GerenciadorTempo::epochUs) e deriva_ppm a deriva medida do RTC
+     * no esp32 nao retorna; no wokwi retorna ao acordar
+     */
+    void entrarDeepSleep(uint32_t periodo_ms, int64_t agora_us, float deriva_ppm)
+    {
+        iniciarGrade(estado_grade);
+        uint32_t pulados = estado_grade.slots_pulados;
+        uint64_t duracao_us = planejarSonoGrade(estado_grade, agora_us, periodo_ms, deriva_ppm);
+
+        Serial.println("\nentrando em deep sleep...");
+        if (estado_grade.slots_pulados != pulados)
+        {
+            Serial.print("[!] ciclo passou da fronteira da grade - slots sem amostra: ");
+            Serial.println(estado_grade.slots_pulados - pulados);
+        }
+        Serial.print("proxima amostra: epoch ");
+        Serial.print((uint32_t)(estado_grade.us_alvo / 1000000));
+        Serial.print(" (deriva ");
+        Serial.print(deriva_ppm, 1);
+        Serial.println(" ppm)");
+
+        Sono::dormir(duracao_us);
+    }
+
+    /**
+     * chamado ao acordar - informa e retorna o motivo do wake-up
+     */
+    esp_sleep_wakeup_cause_t aoAcordar()
+    {
+        esp_sleep_wakeup_cause_t causa = Sono::causaDespertar();
 
         Serial.println("\nsistema acordou");
         Serial.print("motivo: ");
@@ -70,12 +205,21 @@ public:
         case ESP_SLEEP_WAKEUP_EXT0:
             Serial.println("botao");
             break;
+        case ESP_SLEEP_WAKEUP_EXT1:
+            Serial.println("sensor de luz");
+            break;
+        case ESP_SLEEP_WAKEUP_UNDEFINED:
+            Serial.println("energizacao ou reset");
+            break;
         default:
             Serial.println("desconhecido");
             break;
         }
-#endif
+
+        return causa;
     }
 };
 
-#endif
\ No newline at end of file
+typedef GerenciadorSleepBase<Plataforma::Sono> GerenciadorSleep;
+
+#endif
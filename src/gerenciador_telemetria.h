@@ -0,0 +1,208 @@
+#ifndef GERENCIADOR_TELEMETRIA_H
+#define GERENCIADOR_TELEMETRIA_H
+
+#include "config.h"
+#include "Arduino.h"
+#include "buffer_texto.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+
+/*
+ *  [i] telemetria de saude do dispositivo
+ *
+ *  a cada ciclo uma amostra de layout fixo (heap, maior bloco livre,
+ *  RSSI, tempo de conexao) e tirada com chamadas O(1) do heap_caps e do
+ *  wifi; contadores de boots, resets anormais, conexoes e uploads ficam
+ *  na memoria RTC. o registro vai junto de cada lote de upload, para a
+ *  frota mostrar tendencia de fragmentacao e problemas de RF antes da
+ *  falha.
+ */
+
+// AMOSTRA DO CICLO
+
+struct AmostraTelemetria
+{
+    uint32_t heap_livre;        // bytes livres agora
+    uint32_t heap_minimo;       // menor heap livre desde o boot (marca d'agua do idf)
+    uint32_t maior_bloco;       // maior alocacao possivel agora
+    uint16_t conexao_ms;        // tempo ate o wifi conectar (ou desistir)
+    int8_t rssi_dbm;            // 0 = sem conexao
+    uint8_t fragmentacao_pct;   // 100 - maior bloco / livre
+};
+
+static_assert(sizeof(AmostraTelemetria) == 16, "amostra de telemetria mudou de layout");
+
+// CONTADORES NA MEMORIA RTC
+
+struct EstadoTelemetria
+{
+    uint32_t assinatura;             // diferente de ASSINATURA_TELEMETRIA apos cold boot
+    uint32_t boots;                  // setups desde o cold boot (cada deep sleep e um boot)
+    uint16_t resets_anormais;        // panic, watchdog ou brownout
+    uint16_t falhas_conexao;         // ciclos sem wifi
+    uint32_t uploads_ok;
+    uint32_t falhas_upload;          // lotes que esgotaram as retentativas
+    uint16_t falhas_upload_seguidas;
+    uint8_t motivo_reset;            // esp_reset_reason_t do ultimo boot
+    int8_t rssi_minimo;              // pior sinal desde o cold boot (0 = nenhum)
+    uint32_t heap_minimo;            // menor heap livre entre boots
+    uint32_t maior_bloco_minimo;     // menor maior-bloco entre boots
+    AmostraTelemetria ultima;
+};
+
+const uint32_t ASSINATURA_TELEMETRIA = 0x544C4D31;
+
+RTC_DATA_ATTR EstadoTelemetria estado_telemetria = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {0, 0, 0, 0, 0, 0}};
+
+inline const char *nomeMotivoReset(uint8_t motivo)
+{
+    switch (motivo)
+    {
+    case ESP_RST_POWERON:
+        return "poweron";
+    case ESP_RST_EXT:
+        return "externo";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_DEEPSLEEP:
+        return "deepsleep";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    default:
+        return "desconhecido";
+    }
+}
+
+// CLASSE GERENCIADOR TELEMETRIA
+
+class GerenciadorTelemetria
+{
+private:
+    static bool resetAnormal(uint8_t motivo)
+    {
+        return motivo == ESP_RST_PANIC || motivo == ESP_RST_INT_WDT || motivo == ESP_RST_TASK_WDT ||
+               motivo == ESP_RST_WDT || motivo == ESP_RST_BROWNOUT;
+    }
+
+public:
+    /*
+     * valida os contadores da RTC e conta o boot
+     * deve ser chamado uma vez no setup()
+     */
+    void iniciar()
+    {
+        if (estado_telemetria.assinatura != ASSINATURA_TELEMETRIA)
+        {
+            memset(&estado_telemetria, 0, sizeof(estado_telemetria));
+            estado_telemetria.assinatura = ASSINATURA_TELEMETRIA;
+            estado_telemetria.heap_minimo = UINT32_MAX;
+            estado_telemetria.maior_bloco_minimo = UINT32_MAX;
+        }
+
+        estado_telemetria.boots++;
+        estado_telemetria.motivo_reset = esp_reset_reason();
+        if (resetAnormal(estado_telemetria.motivo_reset))
+        {
+            estado_telemetria.resets_anormais++;
+            Serial.println("[!] reset anormal: " + String(nomeMotivoReset(estado_telemetria.motivo_reset)));
+        }
+    }
+
+    /*
+     * amostra do ciclo, antes do upload (rssi 0 = sem conexao)
+     */
+    const AmostraTelemetria &amostrar(int rssi_dbm, uint32_t conexao_ms)
+    {
+        AmostraTelemetria &amostra = estado_telemetria.ultima;
+        amostra.heap_livre = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        amostra.heap_minimo = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+        amostra.maior_bloco = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        amostra.conexao_ms = conexao_ms > 0xFFFF ? 0xFFFF : conexao_ms;
+        amostra.rssi_dbm = rssi_dbm;
+        uint32_t contiguo_pct = amostra.heap_livre ? (uint64_t)amostra.maior_bloco * 100 / amostra.heap_livre : 100;
+        amostra.fragmentacao_pct = contiguo_pct >= 100 ? 0 : 100 - contiguo_pct;
+
+        if (amostra.heap_minimo < estado_telemetria.heap_minimo)
+            estado_telemetria.heap_minimo = amostra.heap_minimo;
+        if (amostra.maior_bloco < estado_telemetria.maior_bloco_minimo)
+            estado_telemetria.maior_bloco_minimo = amostra.maior_bloco;
+
+        if (rssi_dbm == 0)
+            estado_telemetria.falhas_conexao++;
+        else if (estado_telemetria.rssi_minimo == 0 || rssi_dbm < estado_telemetria.rssi_minimo)
+            estado_telemetria.rssi_minimo = rssi_dbm;
+
+        return amostra;
+    }
+
+    /*
+     * resultado do lote (apos todas as retentativas)
+     */
+    void registrarUpload(bool sucesso)
+    {
+        if (sucesso)
+        {
+            estado_telemetria.uploads_ok++;
+            estado_telemetria.falhas_upload_seguidas = 0;
+        }
+        else
+        {
+            estado_telemetria.falhas_upload++;
+            if (estado_telemetria.falhas_upload_seguidas < 0xFFFF)
+                estado_telemetria.falhas_upload_seguidas++;
+        }
+    }
+
+    const EstadoTelemetria &atual() const
+    {
+        return estado_telemetria;
+    }
+
+    /*
+     * fragmento json para o payload de upload
+     * o lote atual ainda nao conta em uploads/falhas
+     */
+    void formatarJSON(BufferTexto &json) const
+    {
+        const EstadoTelemetria &e = estado_telemetria;
+        const AmostraTelemetria &a = e.ultima;
+        json.acrescentar("\"telemetria\": {\"boots\": ").natural(e.boots);
+        json.acrescentar(", \"reset\": \"").acrescentar(nomeMotivoReset(e.motivo_reset)).acrescentar('"');
+        json.acrescentar(", \"resets_anormais\": ").natural(e.resets_anormais);
+        json.acrescentar(", \"heap\": ").natural(a.heap_livre);
+        json.acrescentar(", \"heap_min\": ").natural(e.heap_minimo);
+        json.acrescentar(", \"maior_bloco\": ").natural(a.maior_bloco);
+        json.acrescentar(", \"maior_bloco_min\": ").natural(e.maior_bloco_minimo);
+        json.acrescentar(", \"frag_pct\": ").natural(a.fragmentacao_pct);
+        json.acrescentar(", \"rssi\": ").inteiro(a.rssi_dbm);
+        json.acrescentar(", \"rssi_min\": ").inteiro(e.rssi_minimo);
+        json.acrescentar(", \"conexao_ms\": ").natural(a.conexao_ms);
+        json.acrescentar(", \"falhas_conexao\": ").natural(e.falhas_conexao);
+        json.acrescentar(", \"uploads\": ").natural(e.uploads_ok);
+        json.acrescentar(", \"falhas_upload\": ").natural(e.falhas_upload);
+        json.acrescentar(", \"falhas_upload_seguidas\": ").natural(e.falhas_upload_seguidas);
+        json.acrescentar('}');
+    }
+
+    void imprimirStatus() const
+    {
+        const EstadoTelemetria &e = estado_telemetria;
+        Serial.println("telemetria:");
+        Serial.println("  boots: " + String(e.boots) + " (ultimo reset: " + nomeMotivoReset(e.motivo_reset) +
+                       ", anormais: " + String(e.resets_anormais) + ")");
+        Serial.println("  heap: " + String(e.ultima.heap_livre) + " livres, maior bloco " +
+                       String(e.ultima.maior_bloco) + " (" + String(e.ultima.fragmentacao_pct) + "% fragmentado)");
+        Serial.println("  wifi: rssi " + String(e.ultima.rssi_dbm) + " dBm (pior " + String(e.rssi_minimo) +
+                       "), " + String(e.falhas_conexao) + " ciclos sem conexao");
+        Serial.println("  uploads: " + String(e.uploads_ok) + " ok, " + String(e.falhas_upload) + " falhas (" +
+                       String(e.falhas_upload_seguidas) + " seguidas)");
+    }
+};
+
+#endif
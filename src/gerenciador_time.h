@@ -4,6 +4,10 @@
 #include "config.h"
 #include "Arduino.h"
 #include <WiFi.h>
+#include <sys/time.h>
+#include "formato_tempo.h"
+#include "plataforma.h"
+#include "esp_sntp.h"
 
 // ESTRUTURA PARA DADOS DE TEMPO
 
@@ -11,56 +15,50 @@ struct DadosTempo
 {
     unsigned long epoch;               // timestamp unix
     unsigned long millis_sincronizado; // millis() quando foi sincronizado
-    bool sincronizado;                 // se tempo está sincronizado com NTP
-    char data_hora[20];                // string no formato "2024-01-15 14:30:25"
+    bool sincronizado;                 // se incerteza está dentro do limite
+    uint32_t incerteza_ms;             // limite estimado do erro do epoch
 };
 
-// CLASSE DO GERENCIADOR DE TEMPO
+// ESTADO DO RELÓGIO MANTIDO NA MEMÓRIA RTC
 
-class GerenciadorTempo
+/*
+ * o relógio do sistema continua contando durante o deep sleep (timer RTC),
+ * então basta guardar o instante do último sync e a deriva medida para
+ * estimar o epoch ao acordar, sem rede
+ */
+struct EstadoRelogio
 {
-private:
-    // configurações NTP
-    const char *ntp_server = "pool.ntp.org";
-    const long gmt_offset_sec = -3 * 3600; // GMT-3 (Brasília)
-    const int daylight_offset_sec = 0;
+    uint32_t assinatura;      // diferente de ASSINATURA_RELOGIO após cold boot
+    int64_t us_sincronizacao; // relógio do sistema (us) no último sync NTP
+    float deriva_ppm;         // deriva medida do RTC (positivo = adiantado)
+    bool deriva_medida;       // se deriva_ppm já foi medida entre dois syncs
+    uint32_t sincronizacoes;  // total de syncs NTP desde o cold boot
+};
 
-    bool tempo_inicializado;
-    unsigned long ultima_sincronizacao;
-    unsigned long epoch_fallback; // se NTP falhar
+const uint32_t ASSINATURA_RELOGIO = 0x52544331;
+const uint32_t INCERTEZA_DESCONHECIDA = 0xFFFFFFFF;
 
-    // MÉTODOS PRIVADOS
+RTC_DATA_ATTR EstadoRelogio estado_relogio = {0, 0, 0.0, false, 0};
 
-    // sincronizar com servidor NTP
-    bool sincronizarNTP()
-    {
-        Serial.println("tentando sincronizar com NTP...");
+// BACKENDS DE RELÓGIO
 
-#ifdef AMBIENTE_WOKWI
-        // no Wokwi, simula uma sincronização
-        Serial.println("wokwi: simulando sincronização NTP");
-        configTime(gmt_offset_sec, daylight_offset_sec, ntp_server);
-
-        // simula rede  (DEIXAR?)
-        delay(1000);
-
-        // no wokwi, sempre sincroniza
-        Serial.println("sincronização NTP simulada com sucesso");
-        return true;
-
-#else
-        // ESP32 físico - sincronização real
-        configTime(gmt_offset_sec, daylight_offset_sec, ntp_server);
+/*
+ *  [i] NTP real: configTime e espera o status do SNTP (máx 10 segundos)
+ */
+struct RelogioSNTP
+{
+    static bool sincronizar(long fuso_s, int horario_verao_s, const char *servidor)
+    {
+        configTime(fuso_s, horario_verao_s, servidor);
 
-        // aguarda a sincronização, máx 10 segundos
+        // getLocalTime não serve: o relógio já tem hora válida após o 1º sync
         Serial.print("aguardando sincronização NTP");
         for (int i = 0; i < 20; i++)
         {
             delay(500);
             Serial.print(".");
 
-            struct tm timeinfo;
-            if (getLocalTime(&timeinfo))
+            if (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED)
             {
                 Serial.println("\nsincronização NTP realizada com sucesso!");
                 return true;
@@ -69,69 +67,202 @@ private:
 
         Serial.println("\nfalha na sincronização NTP");
         return false;
-#endif
+    }
+};
+
+/*
+ *  [i] wokwi: sincronização sempre bem-sucedida após 1 s de "rede"
+ */
+struct RelogioSimulado
+{
+    static bool sincronizar(long fuso_s, int horario_verao_s, const char *servidor)
+    {
+        Serial.println("wokwi: simulando sincronização NTP");
+        configTime(fuso_s, horario_verao_s, servidor);
+        delay(1000);
+        Serial.println("sincronização NTP simulada com sucesso");
+        return true;
+    }
+};
+
+// CLASSE DO GERENCIADOR DE TEMPO
+
+template <typename Relogio>
+class GerenciadorTempoBase
+{
+private:
+    // configurações NTP
+    const char *ntp_server = "pool.ntp.org";
+    const long gmt_offset_sec = FUSO_HORARIO_S;
+    const int daylight_offset_sec = 0;
+
+    bool tempo_inicializado;
+    uint32_t limite_incerteza_ms; // LIMITE_INCERTEZA_MS ou o valor da config remota
+
+    // MÉTODOS PRIVADOS
+
+    // relógio do sistema em microssegundos (mantido pelo RTC no deep sleep)
+    int64_t relogioSistemaUs()
+    {
+        struct timeval agora;
+        gettimeofday(&agora, NULL);
+        return (int64_t)agora.tv_sec * 1000000 + agora.tv_usec;
+    }
+
+    bool estadoValido()
+    {
+        return estado_relogio.assinatura == ASSINATURA_RELOGIO && estado_relogio.sincronizacoes > 0;
+    }
+
+    // limite do erro acumulado desde o último sync
+    uint32_t calcularIncerteza(int64_t decorrido_us)
+    {
+        if (!estadoValido())
+            return INCERTEZA_DESCONHECIDA;
+
+        float ppm = estado_relogio.deriva_medida ? DERIVA_RESIDUAL_PPM : DERIVA_MAXIMA_PPM;
+        return INCERTEZA_NTP_MS + (uint32_t)(decorrido_us / 1000 * ppm / 1000000.0);
+    }
+
+    // epoch (us) do relógio livre, sem a deriva acumulada desde o último sync
+    int64_t corrigirDeriva(int64_t agora_us)
+    {
+        if (!estadoValido())
+            return agora_us;
+
+        int64_t decorrido_us = agora_us - estado_relogio.us_sincronizacao;
+        int64_t corrigido_us = decorrido_us - (int64_t)(decorrido_us * (estado_relogio.deriva_ppm / 1000000.0));
+        return estado_relogio.us_sincronizacao + corrigido_us;
+    }
+
+    // sincronizar com servidor NTP
+    bool sincronizarNTP()
+    {
+        Serial.println("tentando sincronizar com NTP...");
+        return Relogio::sincronizar(gmt_offset_sec, daylight_offset_sec, ntp_server);
     }
 
-    // converte epoch para string legível
-    void epochParaString(unsigned long epoch, char *buffer, size_t tamanho)
+    // atualiza a deriva comparando o relógio livre com o NTP
+    void medirDeriva(int64_t antes_us, unsigned long antes_ms, int64_t ntp_us)
     {
-        time_t rawtime = epoch;
-        struct tm *timeinfo = localtime(&rawtime);
+        if (!estadoValido())
+            return;
+
+        int64_t intervalo_us = antes_us - estado_relogio.us_sincronizacao;
+        if (intervalo_us < INTERVALO_MINIMO_DERIVA_MS * 1000LL)
+            return;
 
-        strftime(buffer, tamanho, "%Y-%m-%d %H:%M:%S", timeinfo);
+        // o que o relógio livre marcaria agora, se o NTP não tivesse ajustado
+        int64_t estimado_us = antes_us + (int64_t)(millis() - antes_ms) * 1000;
+        float nova_deriva = (float)(estimado_us - ntp_us) / intervalo_us * 1000000.0;
+
+        // média móvel para suavizar o jitter do NTP
+        if (estado_relogio.deriva_medida)
+            estado_relogio.deriva_ppm = 0.5 * estado_relogio.deriva_ppm + 0.5 * nova_deriva;
+        else
+            estado_relogio.deriva_ppm = nova_deriva;
+        estado_relogio.deriva_medida = true;
+
+        Serial.println("deriva do RTC: " + String(estado_relogio.deriva_ppm, 1) + " ppm");
     }
 
 public:
     // MÉTODOS PÚBLICOS
 
-    GerenciadorTempo()
+    GerenciadorTempoBase()
     {
         tempo_inicializado = false;
-        ultima_sincronizacao = 0;
-        epoch_fallback = 0;
+        limite_incerteza_ms = LIMITE_INCERTEZA_MS;
     }
 
     /**
-     * inicializa o sistema de tempo
-     * tenta NTP primeiro, depois usa fallback
+     * troca o erro máximo aceito antes de exigir NTP (config remota)
+     */
+    void definirLimiteIncerteza(uint32_t limite_ms)
+    {
+        limite_incerteza_ms = limite_ms;
+    }
+
+    /**
+     * inicializa o sistema de tempo a partir do estado na memória RTC
+     * não acessa a rede: o NTP só roda em sincronizarSeNecessario()
      */
 
     void iniciar()
     {
         Serial.println("\ninicializando gerenciador de tempo...");
 
-        // tenta sincronizar com NTP
-        bool ntp_sucesso = sincronizarNTP();
-
-        if (ntp_sucesso)
+        if (estadoValido())
         {
-            tempo_inicializado = true;
-            ultima_sincronizacao = millis();
-
-            // obtém o timestamp atual para usar como fallback
-            time_t agora;
-            time(&agora);
-            epoch_fallback = agora;
-
-            Serial.println("gerenciador de tempo inicializado (NTP)");
+            Serial.println("gerenciador de tempo inicializado (RTC)");
+            Serial.println("  syncs NTP: " + String(estado_relogio.sincronizacoes));
         }
         else
         {
-            // se NTP falhou, usa tempo fallback
-            tempo_inicializado = true;
-            epoch_fallback = 1609459200;
+            // cold boot: relógio parte do fallback uma única vez e segue
+            // monotônico pelo RTC até o primeiro sync
+            estado_relogio.assinatura = ASSINATURA_RELOGIO;
+            estado_relogio.sincronizacoes = 0;
+            estado_relogio.deriva_medida = false;
+
+            if (relogioSistemaUs() / 1000000 < EPOCH_FALLBACK)
+            {
+                struct timeval fallback = {(time_t)EPOCH_FALLBACK, 0};
+                settimeofday(&fallback, NULL);
+            }
 
             Serial.println("[!] gerenciador de tempo usando modo FALLBACK");
-            Serial.println("        (sem internet - usando RTC interno)");
+            Serial.println("        (sem sync anterior - aguardando NTP)");
         }
 
+        tempo_inicializado = true;
         imprimirTempoAtual();
     }
 
+    /**
+     * true quando a incerteza estimada passou do limite configurado
+     */
+    bool precisaSincronizar()
+    {
+        if (!estadoValido())
+            return true;
+
+        int64_t decorrido_us = relogioSistemaUs() - estado_relogio.us_sincronizacao;
+        return calcularIncerteza(decorrido_us) > limite_incerteza_ms;
+    }
+
+    /**
+     * sincroniza com NTP apenas se a incerteza exigir
+     * deve ser chamado com wifi conectado
+     */
+    bool sincronizarSeNecessario()
+    {
+        if (!precisaSincronizar())
+        {
+            Serial.println("NTP dispensado - incerteza dentro do limite");
+            return true;
+        }
+
+        int64_t antes_us = relogioSistemaUs();
+        unsigned long antes_ms = millis();
+
+        if (!sincronizarNTP())
+        {
+            return false;
+        }
+
+        int64_t ntp_us = relogioSistemaUs();
+        medirDeriva(antes_us, antes_ms, ntp_us);
+
+        estado_relogio.us_sincronizacao = ntp_us;
+        estado_relogio.sincronizacoes++;
+        return true;
+    }
+
     /**
      * Obtém o timestamp atual
-     * Se NTP disponível, retorna tempo real
-     * Se não, estima baseado no último sync + millis()
+     * estima o epoch a partir do último sync, corrigindo a deriva medida
+     * cada leitura leva o limite do erro em incerteza_ms
      */
 
     DadosTempo obterTempo()
@@ -144,64 +275,75 @@ public:
             iniciar();
         }
 
-        tempo.sincronizado = true; // por enquanto
-
-#ifdef AMBIENTE_WOKWI
-        // o wokwi, sempre tem tempo sincronizado
-        time_t agora;
-        time(&agora);
-        tempo.epoch = agora;
+        int64_t agora_us = relogioSistemaUs();
         tempo.millis_sincronizado = millis();
 
-#else
-        // no físico, tenta obter tempo real
-        struct tm timeinfo;
-        if (getLocalTime(&timeinfo))
+        if (estadoValido())
         {
-            // tempo NTP disponível
-            time_t agora;
-            time(&agora);
-            tempo.epoch = agora;
-            tempo.millis_sincronizado = millis();
-            tempo.sincronizado = true;
-
-            // atualiza fallback
-            epoch_fallback = agora;
-            ultima_sincronizacao = millis();
+            int64_t decorrido_us = agora_us - estado_relogio.us_sincronizacao;
+
+            tempo.epoch = corrigirDeriva(agora_us) / 1000000;
+            tempo.incerteza_ms = calcularIncerteza(decorrido_us);
+            tempo.sincronizado = tempo.incerteza_ms <= limite_incerteza_ms;
         }
         else
         {
-            // NTP não disponível - estima baseado no último sync
-            tempo.epoch = epoch_fallback + (millis() - ultima_sincronizacao) / 1000;
-            tempo.millis_sincronizado = millis();
+            // sem sync: relógio livre desde o fallback
+            tempo.epoch = agora_us / 1000000;
+            tempo.incerteza_ms = INCERTEZA_DESCONHECIDA;
             tempo.sincronizado = false;
         }
-#endif
-
-        // converte para string legível
-        epochParaString(tempo.epoch, tempo.data_hora, sizeof(tempo.data_hora));
 
         return tempo;
     }
 
+    /**
+     * epoch em microssegundos, com a mesma correção de deriva do obterTempo()
+     * usado pela grade de amostragem (gerenciador_sleep.h)
+     */
+    int64_t epochUs()
+    {
+        return corrigirDeriva(relogioSistemaUs());
+    }
+
+    /**
+     * deriva do RTC a compensar no timer do deep sleep (0 se ainda não medida)
+     */
+    float derivaPpm() const
+    {
+        return estado_relogio.deriva_medida ? estado_relogio.deriva_ppm : 0.0f;
+    }
+
     // imprime o tempo atual no Serial (para debug)
     void imprimirTempoAtual()
     {
         DadosTempo tempo = obterTempo();
+        char data_hora[TAMANHO_DATA_HORA];
+        formatarDataHora(tempo.epoch, FUSO_HORARIO_S, data_hora);
 
         Serial.println("\n[i] informações de tempo");
         Serial.print("  timestamp: ");
         Serial.println(tempo.epoch);
         Serial.print("  data/hora: ");
-        Serial.println(tempo.data_hora);
+        Serial.println(data_hora);
         Serial.print("  sincronizado: ");
         Serial.println(tempo.sincronizado ? "SIM (NTP)" : "NÃO (RTC fallback)");
 
-        if (!tempo.sincronizado)
+        if (tempo.incerteza_ms == INCERTEZA_DESCONHECIDA)
         {
-            Serial.println("usando estimativa baseada no RTC interno");
+            Serial.println("  incerteza: desconhecida");
+        }
+        else
+        {
+            Serial.println("  incerteza: " + String(tempo.incerteza_ms) + " ms");
+            Serial.println("  deriva: " + String(estado_relogio.deriva_ppm, 1) + " ppm");
         }
     }
 };
 
+typedef GerenciadorTempoBase<Plataforma::Relogio> GerenciadorTempo;
+
+// orcamento de memoria do gerenciador (config.h)
+static_assert(sizeof(GerenciadorTempo) <= ORCAMENTO_OBJETO_TEMPO, "GerenciadorTempo acima do orcamento de memoria");
+
 #endif
\ No newline at end of file
@@ -4,28 +4,443 @@
 
 #include "config.h"
 #include "Arduino.h"
+#include "arena_ciclo.h"
+#include "buffer_texto.h"
 #include <HTTPClient.h>
 #include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include "cliente_tls.h"
+#include "fila_spsc.h"
 #include "gerenciador_armazenamento.h" // 👈 ADICIONAR ESTE INCLUDE
+#include "gerenciador_config.h"
+#include "plataforma.h"
+#include "protocolo_gateway.h"
 
-class GerenciadorUpload
+// BACKENDS DE TRANSPORTE
+
+/*
+ *  [i] POST http real
+ *  retorna o codigo http (negativo em erro de conexao) e o corpo da resposta
+ *  urls https:// vao pelo ClienteTLS (servidor fixado, sessao retomada)
+ *  o corpo vem pronto (arena do ciclo): o transporte nao o copia
+ */
+struct TransporteHTTP
+{
+    /*
+     * HTTP/1.0 sobre o tls: resposta sem chunked, termina quando o servidor fecha
+     */
+    static int postarHTTPS(const char *url, const char *tipo_conteudo, const char *corpo, size_t tamanho,
+                           String &resposta)
+    {
+        String autoridade = url + 8;
+        String caminho = "/";
+        int barra = autoridade.indexOf('/');
+        if (barra >= 0)
+        {
+            caminho = autoridade.substring(barra);
+            autoridade = autoridade.substring(0, barra);
+        }
+        String host = autoridade;
+        String porta = "443";
+        int dois_pontos = autoridade.indexOf(':');
+        if (dois_pontos >= 0)
+        {
+            host = autoridade.substring(0, dois_pontos);
+            porta = autoridade.substring(dois_pontos + 1);
+        }
+
+        ClienteTLS tls;
+        if (!tls.conectar(host.c_str(), porta.c_str(), TIMEOUT_UPLOAD_MS))
+        {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+
+        String pedido = "POST " + caminho + " HTTP/1.0\r\nHost: " + host + "\r\nContent-Type: " + tipo_conteudo +
+                        "\r\nContent-Length: " + String((unsigned long)tamanho) + "\r\n\r\n";
+        if (!tls.escreverTudo((const uint8_t *)pedido.c_str(), pedido.length()) ||
+            !tls.escreverTudo((const uint8_t *)corpo, tamanho))
+        {
+            return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+        }
+
+        String bruto;
+        uint8_t buffer[512];
+        int n;
+        while ((n = tls.ler(buffer, sizeof(buffer) - 1)) > 0)
+        {
+            buffer[n] = '\0';
+            bruto += (const char *)buffer;
+        }
+
+        int http_code = 0;
+        if (sscanf(bruto.c_str(), "HTTP/1.%*d %d", &http_code) != 1)
+        {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+        int inicio_corpo = bruto.indexOf("\r\n\r\n");
+        if (http_code == HTTP_CODE_OK && inicio_corpo >= 0)
+        {
+            resposta = bruto.substring(inicio_corpo + 4);
+        }
+        return http_code;
+    }
+
+    static int postar(const char *url, const char *tipo_conteudo, const char *corpo, size_t tamanho, String &resposta)
+    {
+        if (strncmp(url, "https://", 8) == 0)
+        {
+            return postarHTTPS(url, tipo_conteudo, corpo, tamanho, resposta);
+        }
+
+        HTTPClient http;
+        http.begin(url);
+        http.addHeader("Content-Type", tipo_conteudo);
+
+        int http_code = http.POST((uint8_t *)corpo, tamanho);
+        if (http_code == HTTP_CODE_OK)
+        {
+            resposta = http.getString();
+        }
+        http.end();
+        return http_code;
+    }
+};
+
+/*
+ *  [i] wokwi: mostra o payload no serial e responde 200 sem config
+ */
+struct TransporteSimulado
+{
+    static int postar(const char *, const char *, const char *corpo, size_t tamanho, String &resposta)
+    {
+        Serial.println("enviando dados (simulacao wokwi)...");
+        Serial.println("dados que seriam enviados:");
+        Serial.write((const uint8_t *)corpo, tamanho);
+        Serial.println();
+        delay(500);
+        resposta = "ok";
+        return HTTP_CODE_OK;
+    }
+};
+
+// BACKENDS DE ENLACE DO GATEWAY
+
+/*
+ *  [i] esp-now: datagramas direto ao gateway, sem associacao, dhcp nem tcp
+ *  o radio liga em modo estacao no canal do gateway; as respostas chegam
+ *  no callback (tarefa do wifi) e passam ao upload por uma fila SPSC
+ */
+struct EnlaceEspNow
+{
+    struct Datagrama
+    {
+        uint8_t tamanho;
+        uint8_t dados[TAMANHO_MAXIMO_DATAGRAMA];
+    };
+
+    static FilaSPSC<Datagrama, 8> &recebidos()
+    {
+        static FilaSPSC<Datagrama, 8> fila;
+        return fila;
+    }
+
+    static void aoReceber(const uint8_t *, const uint8_t *dados, int tamanho)
+    {
+        if (tamanho <= 0 || tamanho > (int)TAMANHO_MAXIMO_DATAGRAMA)
+            return;
+        Datagrama datagrama;
+        datagrama.tamanho = tamanho;
+        memcpy(datagrama.dados, dados, tamanho);
+        recebidos().inserir(datagrama); // fila cheia: descarta, o ack seguinte cobre
+    }
+
+    static bool iniciar()
+    {
+        WiFi.mode(WIFI_STA);
+        esp_wifi_set_channel(CANAL_GATEWAY, WIFI_SECOND_CHAN_NONE);
+        if (esp_now_init() != ESP_OK)
+            return false;
+        esp_now_register_recv_cb(aoReceber);
+
+        esp_now_peer_info_t par;
+        memset(&par, 0, sizeof(par));
+        memcpy(par.peer_addr, GATEWAY_MAC, sizeof(par.peer_addr));
+        par.channel = CANAL_GATEWAY;
+        par.ifidx = WIFI_IF_STA;
+        par.encrypt = false;
+        if (!esp_now_is_peer_exist(GATEWAY_MAC) && esp_now_add_peer(&par) != ESP_OK)
+        {
+            esp_now_deinit();
+            return false;
+        }
+        Datagrama descartado;
+        while (recebidos().remover(descartado))
+        {
+        }
+        return true;
+    }
+
+    /*
+     * fila de transmissao cheia: espera o driver esvaziar
+     */
+    static bool enviar(const uint8_t *dados, size_t tamanho)
+    {
+        for (uint8_t tentativa = 0; tentativa < 20; tentativa++)
+        {
+            esp_err_t erro = esp_now_send(GATEWAY_MAC, dados, tamanho);
+            if (erro == ESP_OK)
+                return true;
+            if (erro != ESP_ERR_ESPNOW_NO_MEM)
+                return false;
+            delay(1);
+        }
+        return false;
+    }
+
+    /*
+     * proximo datagrama recebido, sem esperar; 0 se nao ha nenhum
+     */
+    static size_t receber(uint8_t *dados)
+    {
+        Datagrama datagrama;
+        if (!recebidos().remover(datagrama))
+            return 0;
+        memcpy(dados, datagrama.dados, datagrama.tamanho);
+        return datagrama.tamanho;
+    }
+
+    static void encerrar()
+    {
+        esp_now_deinit();
+    }
+};
+
+/*
+ *  [i] wokwi: sem esp-now simulado, o upload vai direto ao http
+ */
+struct EnlaceAusente
+{
+    static bool iniciar() { return false; }
+    static bool enviar(const uint8_t *, size_t) { return false; }
+    static size_t receber(uint8_t *) { return 0; }
+    static void encerrar() {}
+};
+
+// CLASSE GERENCIADOR UPLOAD
+
+template <typename Transporte, typename Enlace>
+class GerenciadorUploadBase
 {
 private:
     const char *servidor_url;
     bool upload_habilitado;
-    const int max_tentativas = 3;            // 👈 MOVER PARA AQUI
-    const int delay_entre_tentativas = 2000; // 👈 MOVER PARA AQUI
+    bool gateway_habilitado;
+    int max_tentativas;         // 👈 MOVER PARA AQUI
+    int delay_entre_tentativas; // 👈 MOVER PARA AQUI
+    GerenciadorConfig *config_remota; // recebe deltas nas respostas (opcional)
+    const char *metadados_extras;     // campos do ciclo (ex: energia), de quem chamou
+    uint32_t bytes_enviados;          // corpos dos POSTs + datagramas desde o boot
+
+    /*
+     * linha "ack;seq=N" da resposta: maior seq que o servidor ja gravou
+     * (procurada como a linha "cfg;" do GerenciadorConfig)
+     */
+    static bool lerConfirmacao(const String &resposta, uint32_t &confirmada)
+    {
+        const char *texto = resposta.c_str();
+        const char *linha = strstr(texto, "ack;seq=");
+        while (linha && linha != texto && linha[-1] != '\n')
+            linha = strstr(linha + 8, "ack;seq=");
+        if (!linha || !isdigit((unsigned char)linha[8]))
+            return false;
+
+        confirmada = strtoul(linha + 8, NULL, 10);
+        return true;
+    }
+
+    /*
+     * ACKs do gateway ja recebidos para o dispositivo e a faixa
+     * confirmada so cresce, ate o fim do lote; true se chegou algum
+     */
+    static bool lerAcksGateway(const uint8_t *mac, uint8_t faixa, uint32_t ultima, uint32_t &confirmada)
+    {
+        uint8_t datagrama[TAMANHO_MAXIMO_DATAGRAMA];
+        AckGateway ack;
+        bool recebeu = false;
+        size_t tamanho;
+        while ((tamanho = Enlace::receber(datagrama)) > 0)
+        {
+            if (!lerAckGateway(datagrama, tamanho, ack) || ack.faixa != faixa ||
+                memcmp(ack.dispositivo, mac, TAMANHO_MAC_GATEWAY) != 0)
+                continue;
+            recebeu = true;
+            if (ack.confirmada > confirmada)
+                confirmada = ack.confirmada < ultima ? ack.confirmada : ultima;
+        }
+        return recebeu;
+    }
+
+    /*
+     * uma rodada: codifica e envia os registros do lote acima de confirmada
+     * cada linha vai do log (flash mapeada ou bloco do LittleFS) direto ao
+     * verificador de crc e ao codificador, sem copia. o primeiro datagrama
+     * leva confirmada como base ja entregue (0: o seq antes do lote)
+     * false se uma linha nao passa pelo codec ou o radio recusa o envio
+     */
+    bool enviarRodadaGateway(GerenciadorArmazenamento &armazenamento, const FormatoLog &formato,
+                             const uint8_t *mac, uint8_t faixa, uint32_t &primeira, uint32_t &ultima,
+                             uint32_t &confirmada, uint32_t &datagramas)
+    {
+        TrechoSemHeap quente;
+        CodificadorLoteGateway codificador;
+        uint32_t inicio = confirmada;
+        bool aberto = false;
+        bool falhou = false;
+
+        armazenamento.lerLote(faixa, primeira, ultima, [&](const char *linha, size_t tamanho) {
+            if (falhou)
+                return;
+            LinhaDecodificada registro;
+            if (decodificarLinhaRegistro(linha, tamanho, formato, registro) != LINHA_INTEGRA)
+            {
+                Serial.println("[!] linha fora do formato - lote fica para o http");
+                falhou = true;
+                return;
+            }
+            if (registro.sequencia <= inicio || (aberto && codificador.acrescentar(registro)))
+                return;
+
+            // datagrama cheio: sai agora, o proximo continua do seu ultimo seq
+            uint32_t base = inicio > 0 ? inicio : registro.sequencia - 1;
+            if (aberto)
+            {
+                size_t tamanho_datagrama = codificador.fechar();
+                if (!Enlace::enviar(codificador.dados(), tamanho_datagrama))
+                {
+                    falhou = true;
+                    return;
+                }
+                bytes_enviados += tamanho_datagrama;
+                datagramas++;
+                lerAcksGateway(mac, faixa, codificador.ultima(), confirmada);
+                base = codificador.ultima();
+            }
+            codificador.iniciar(mac, faixa, base, !aberto, formato.canais, registro.epoch);
+            aberto = true;
+            falhou = !codificador.acrescentar(registro);
+        });
+        if (falhou)
+            return false;
+
+        if (aberto)
+        {
+            size_t tamanho_datagrama = codificador.fechar();
+            if (!Enlace::enviar(codificador.dados(), tamanho_datagrama))
+                return false;
+            bytes_enviados += tamanho_datagrama;
+            datagramas++;
+        }
+        return true;
+    }
+
+    /*
+     * {"dados": "<registros do lote separados por ';'>", <metadados>} direto
+     * no corpo, sem String: as linhas vem do log sem copia (ver lerLote)
+     * false se o lote esta vazio (ultima = 0) ou nao coube no corpo
+     */
+    bool montarCorpoLote(GerenciadorArmazenamento &armazenamento, uint8_t faixa, BufferTexto &corpo,
+                         uint32_t &primeira, uint32_t &ultima)
+    {
+        TrechoSemHeap quente;
+
+        corpo.acrescentar("{\"dados\": \"");
+        bool primeiro = true;
+        uint32_t bytes = armazenamento.lerLote(faixa, primeira, ultima, [&](const char *linha, size_t tamanho) {
+            if (!primeiro)
+                corpo.acrescentar(';'); // separador entre registros
+            corpo.acrescentar(linha, tamanho);
+            primeiro = false;
+        });
+        if (bytes == 0)
+        {
+            ultima = 0;
+            return false;
+        }
+
+        uint8_t mac[6];
+        char dispositivo[18];
+        WiFi.macAddress(mac);
+        snprintf(dispositivo, sizeof(dispositivo), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3],
+                 mac[4], mac[5]);
+        const char *nome_faixa = faixas()[faixa].nome;
+
+        corpo.acrescentar("\", \"dispositivo\": \"").acrescentar(dispositivo);
+        corpo.acrescentar("\", \"lote\": {\"faixa\": \"").acrescentar(nome_faixa);
+        corpo.acrescentar("\", \"primeira_seq\": ").natural(primeira);
+        corpo.acrescentar(", \"ultima_seq\": ").natural(ultima);
+        corpo.acrescentar(", \"chave\": \"").acrescentar(dispositivo).acrescentar(':').acrescentar(nome_faixa);
+        corpo.acrescentar(':').natural(primeira).acrescentar('-').natural(ultima).acrescentar("\"}, ");
+        armazenamento.canaisJSON(corpo);
+        corpo.acrescentar(", ");
+        armazenamento.estatisticasFlashJSON(corpo);
+        if (config_remota)
+        {
+            corpo.acrescentar(", ");
+            config_remota->metadadosJSON(corpo);
+        }
+        if (strncmp(servidor_url, "https://", 8) == 0)
+        {
+            corpo.acrescentar(", ");
+            estatisticasTLSJSON(corpo);
+        }
+        if (metadados_extras && metadados_extras[0])
+        {
+            corpo.acrescentar(", ").acrescentar(metadados_extras);
+        }
+        corpo.acrescentar('}');
+        return !corpo.estourou();
+    }
 
 public:
-    GerenciadorUpload() : servidor_url(SERVIDOR_URL)
+    GerenciadorUploadBase(const char *url = SERVIDOR_URL) : servidor_url(url)
     {
         upload_habilitado = true;
+        gateway_habilitado = USAR_GATEWAY;
+        max_tentativas = MAX_TENTATIVAS_UPLOAD;
+        delay_entre_tentativas = ESPERA_ENTRE_TENTATIVAS_MS;
+        config_remota = NULL;
+        metadados_extras = NULL;
+        bytes_enviados = 0;
+    }
+
+    /**
+     * aplica a configuracao ativa (url e politica de retentativa)
+     * e passa a entregar as respostas do servidor ao gerenciador de config
+     */
+    void configurar(GerenciadorConfig &config)
+    {
+        const ConfigRemota &atual = config.atual();
+        servidor_url = atual.servidor_url;
+        max_tentativas = atual.max_tentativas;
+        delay_entre_tentativas = atual.espera_tentativas_ms;
+        config_remota = &config;
+    }
+
+    /**
+     * campos json extras anexados ao proximo upload (ex: contabilidade de energia)
+     * o texto nao e copiado: vive ate o fim da sessao (ex: na arena do ciclo)
+     */
+    void definirMetadadosExtras(const char *metadados_json)
+    {
+        metadados_extras = metadados_json;
     }
 
     /**
-     * envia dados para o servidor via http post
+     * envia um corpo json ja montado via http post
+     * confirmada recebe o seq do "ack" da resposta, se o servidor mandar um
      */
-    bool enviarDados(const String &dados_csv)
+    bool enviarCorpo(const char *corpo, size_t tamanho, uint32_t *confirmada = NULL)
     {
         if (!upload_habilitado)
         {
@@ -33,92 +448,124 @@ public:
             return false;
         }
 
-#ifdef AMBIENTE_WOKWI
-        // wokwi: simulacao de upload
-        Serial.println("enviando dados (simulacao wokwi)...");
-        Serial.println("dados que seriam enviados:");
-        Serial.println(dados_csv);
-        delay(500);
-        Serial.println("upload simulado com sucesso");
-        return true;
-
-#else
-        // esp32 fisico: upload real
         if (WiFi.status() != WL_CONNECTED)
         {
             Serial.println("sem conexao wifi para upload");
             return false;
         }
 
-        Serial.println("preparando upload http...");
-
-        HTTPClient http;
-        http.begin(servidor_url);
-        http.addHeader("Content-Type", "application/json");
-
-        // prepara dados no formato json
-        String json_dados = "{\"dados\": \"" + dados_csv + "\"}";
-
-        Serial.println("enviando para: " + String(servidor_url));
-        int http_code = http.POST(json_dados);
+        Serial.print("enviando para: ");
+        Serial.println(servidor_url);
+        String resposta;
+        bytes_enviados += tamanho;
+        int http_code = Transporte::postar(servidor_url, "application/json", corpo, tamanho, resposta);
 
         if (http_code > 0)
         {
-            Serial.println("codigo http: " + String(http_code));
+            Serial.print("codigo http: ");
+            Serial.println(http_code);
             if (http_code == HTTP_CODE_OK)
             {
-                String resposta = http.getString();
-                Serial.println("resposta do servidor: " + resposta);
-                http.end();
+                Serial.print("resposta do servidor: ");
+                Serial.println(resposta);
+                if (config_remota)
+                {
+                    config_remota->aplicarDelta(resposta);
+                }
+                if (confirmada)
+                {
+                    lerConfirmacao(resposta, *confirmada);
+                }
                 Serial.println("upload realizado com sucesso");
                 return true;
             }
         }
         else
         {
-            Serial.println("erro no upload: " + String(http_code));
+            Serial.print("erro no upload: ");
+            Serial.println(http_code);
         }
 
-        http.end();
         return false;
-
-#endif
     }
 
     /**
-     * verifica se ha dados pendentes e envia em lote
+     * envia dados para o servidor via http post (ferramentas; o ciclo usa enviarLote)
+     * metadados_json sao campos extras do objeto json (ex: estatisticas da flash)
+     * confirmada recebe o seq do "ack" da resposta, se o servidor mandar um
      */
-    bool enviarDadosPendentes(GerenciadorArmazenamento &armazenamento)
-    { // 👈 MÉTODO QUE ESTAVA FALTANDO
-        Serial.println("verificando dados pendentes para upload...");
+    bool enviarDados(const String &dados_csv, const String &metadados_json = "", uint32_t *confirmada = NULL)
+    {
+        Serial.println("preparando upload http...");
 
-        // primeiro verifica se existem dados
-        if (!armazenamento.existemDadosPendentes())
+        // prepara dados no formato json
+        String json_dados = "{\"dados\": \"" + dados_csv + "\"";
+        if (metadados_json.length() > 0)
         {
-            Serial.println("nenhum dado pendente encontrado");
-            return true;
+            json_dados += ", " + metadados_json;
         }
+        json_dados += "}";
+        return enviarCorpo(json_dados.c_str(), json_dados.length(), confirmada);
+    }
 
-        Serial.println("dados pendentes encontrados, lendo do arquivo...");
-
-        // lê dados reais do arquivo
-        String dados_reais = armazenamento.lerDadosParaUpload();
+    /**
+     * envia o proximo lote de uma faixa
+     *
+     * o lote leva a faixa de seq e uma chave de idempotencia (dispositivo +
+     * faixa + seqs): reenviar depois de um ack perdido nao duplica nada no
+     * servidor. so os registros ate o seq confirmado saem da flash
+     */
+    bool enviarLote(GerenciadorArmazenamento &armazenamento, uint8_t faixa)
+    {
+        // corpo inteiro na arena do ciclo, devolvido ao fim do lote
+        MarcaArena marca(arenaCiclo());
+        BufferTexto corpo((char *)arenaCiclo().alocar(ARENA_UPLOAD, TAMANHO_CORPO_UPLOAD), TAMANHO_CORPO_UPLOAD);
+        if (!corpo.valido())
+        {
+            Serial.println("[!] arena do ciclo sem espaco para o corpo do upload");
+            return false;
+        }
 
-        if (dados_reais.length() == 0)
+        uint32_t primeira, ultima;
+        if (!montarCorpoLote(armazenamento, faixa, corpo, primeira, ultima))
         {
-            Serial.println("erro: nao foi possivel ler dados do arquivo");
+            if (ultima == 0)
+            {
+                // so linhas sem seq no restante: nada a enviar, o lote e pulado
+                Serial.println("[!] nenhum registro valido no restante da faixa");
+                return armazenamento.marcarComoEnviado(faixa, 0);
+            }
+            Serial.println("[!] corpo do upload passou de TAMANHO_CORPO_UPLOAD - lote mantido");
             return false;
         }
 
-        Serial.println("enviando " + String(dados_reais.length()) + " caracteres de dados");
+        Serial.print("enviando ");
+        Serial.print(corpo.tamanho());
+        Serial.print(" caracteres (seq ");
+        Serial.print(primeira);
+        Serial.print("-");
+        Serial.print(ultima);
+        Serial.println(")");
+
+        uint32_t confirmada = ultima; // servidor sem ack: o 200 confirma o lote inteiro
+        bool sucesso = enviarCorpo(corpo.c_str(), corpo.tamanho(), &confirmada);
 
-        // envia dados
-        bool sucesso = enviarDados(dados_reais);
+        // ack acima do lote (servidor com seqs de um dispositivo apagado) nao confirma o que nem foi gravado
+        if (confirmada > ultima)
+            confirmada = ultima;
 
         if (sucesso)
         {
-            Serial.println("upload bem-sucedido - marcando como enviado");
-            armazenamento.marcarComoEnviado(); // 👈 MARCA COMO ENVIADO
+            // campos do ciclo vao uma vez por sessao, nao em cada lote
+            metadados_extras = NULL;
+            Serial.print("upload bem-sucedido - confirmado ate seq ");
+            Serial.println(confirmada);
+            armazenamento.marcarComoEnviado(faixa, confirmada); // 👈 MARCA COMO ENVIADO
+            if (confirmada < ultima)
+            {
+                Serial.println("confirmacao parcial - restante fica para a retentativa");
+                sucesso = false;
+            }
         }
         else
         {
@@ -128,36 +575,197 @@ public:
         return sucesso;
     }
 
+    /**
+     * envia o proximo lote de uma faixa ao gateway, em datagramas
+     *
+     * rodadas go-back-N: cada uma reenvia a partir do maior seq que o
+     * gateway confirmou; desiste depois de RODADAS_GATEWAY rodadas seguidas
+     * sem progresso. o que foi confirmado sai da flash como no http
+     */
+    bool enviarLoteGateway(GerenciadorArmazenamento &armazenamento, uint8_t faixa, const uint8_t *mac)
+    {
+        const String &cabecalho = armazenamento.cabecalhoCSV();
+        FormatoLog formato = formatoDoCabecalho(cabecalho.c_str(), cabecalho.length());
+
+        // a primeira rodada le o lote; ate o primeiro ACK, o que ja saiu da
+        // flash e o confirmado: a base e o seq antes do lote
+        uint32_t primeira = 0, ultima = 0;
+        uint32_t confirmada = 0;
+        uint32_t datagramas = 0;
+        uint8_t sem_progresso = 0;
+        do
+        {
+            uint32_t antes = confirmada;
+            if (!enviarRodadaGateway(armazenamento, formato, mac, faixa, primeira, ultima, confirmada, datagramas))
+            {
+                break;
+            }
+            if (ultima == 0)
+            {
+                return armazenamento.marcarComoEnviado(faixa, 0);
+            }
+
+            // ACKs ate o lote inteiro ou TIMEOUT_ACK_GATEWAY_MS de silencio
+            unsigned long ultimo_ack = millis();
+            while (confirmada < ultima && millis() - ultimo_ack < TIMEOUT_ACK_GATEWAY_MS)
+            {
+                if (lerAcksGateway(mac, faixa, ultima, confirmada))
+                    ultimo_ack = millis();
+                else
+                    delay(1);
+            }
+            sem_progresso = confirmada > antes ? 0 : sem_progresso + 1;
+        } while (confirmada < ultima && sem_progresso < RODADAS_GATEWAY);
+
+        Serial.print(datagramas);
+        Serial.print(" datagrama(s) ao gateway, seq ");
+        Serial.print(primeira);
+        Serial.print("-");
+        Serial.print(ultima);
+        Serial.print(" - confirmado ate seq ");
+        Serial.println(confirmada);
+        if (confirmada >= primeira)
+        {
+            armazenamento.marcarComoEnviado(faixa, confirmada);
+        }
+        return confirmada >= ultima;
+    }
+
+    /**
+     * envia as faixas ao gateway local (Enlace), sem associar ao wifi
+     * true se tudo o que estava pendente foi confirmado; senao o restante
+     * fica para o http, que retoma do ultimo seq confirmado pelo gateway
+     */
+    bool enviarPorGateway(GerenciadorArmazenamento &armazenamento, uint8_t faixas_envio = TODAS_FAIXAS)
+    {
+        if (!upload_habilitado || !gateway_habilitado)
+        {
+            return false;
+        }
+        if (!armazenamento.existemDadosPendentes(faixas_envio))
+        {
+            Serial.println("nenhum dado pendente encontrado");
+            return true;
+        }
+        if (!Enlace::iniciar())
+        {
+            Serial.println("enlace do gateway indisponivel");
+            return false;
+        }
+
+        Serial.println("enviando ao gateway local...");
+        uint8_t mac[TAMANHO_MAC_GATEWAY];
+        WiFi.macAddress(mac);
+        bool sucesso = true;
+        for (uint8_t f = 0; f < NUMERO_FAIXAS && sucesso; f++)
+        {
+            while (sucesso && (faixas_envio & (1u << f)) && armazenamento.existemDadosPendentes(1u << f))
+            {
+                sucesso = enviarLoteGateway(armazenamento, f, mac);
+            }
+        }
+        Enlace::encerrar();
+        armazenamento.consolidarEnvio();
+
+        if (!sucesso)
+        {
+            Serial.println("gateway sem confirmacao - restante fica para o http");
+        }
+        return sucesso;
+    }
+
+    /**
+     * verifica se ha dados pendentes e envia em lotes limitados
+     * as faixas (bits de Faixa) sao esvaziadas em ordem: alarme, resumo, bruta
+     */
+    bool enviarDadosPendentes(GerenciadorArmazenamento &armazenamento, uint8_t faixas_envio = TODAS_FAIXAS)
+    { // 👈 MÉTODO QUE ESTAVA FALTANDO
+        Serial.println("verificando dados pendentes para upload...");
+
+        // primeiro verifica se existem dados
+        if (!armazenamento.existemDadosPendentes(faixas_envio))
+        {
+            Serial.println("nenhum dado pendente encontrado");
+            return true;
+        }
+
+        for (uint8_t f = 0; f < NUMERO_FAIXAS; f++)
+        {
+            while ((faixas_envio & (1u << f)) && armazenamento.existemDadosPendentes(1u << f))
+            {
+                Serial.print("dados pendentes na faixa ");
+                Serial.print(faixas()[f].nome);
+                Serial.println(", lendo do log...");
+                if (!enviarLote(armazenamento, f))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
     /**
      * envia dados com sistema de retentativas
+     * cada tentativa retoma do primeiro lote ainda nao confirmado
      */
-    bool enviarComRetentativas(GerenciadorArmazenamento &armazenamento)
+    bool enviarComRetentativas(GerenciadorArmazenamento &armazenamento, uint8_t faixas_envio = TODAS_FAIXAS)
     {
         Serial.println("iniciando envio com retentativas...");
 
-        for (int tentativa = 1; tentativa <= max_tentativas; tentativa++)
+        bool sucesso = false;
+        for (int tentativa = 1; tentativa <= max_tentativas && !sucesso; tentativa++)
         {
-            Serial.println("tentativa " + String(tentativa) + " de " + String(max_tentativas));
+            Serial.print("tentativa ");
+            Serial.print(tentativa);
+            Serial.print(" de ");
+            Serial.println(max_tentativas);
 
-            bool sucesso = enviarDadosPendentes(armazenamento);
+            sucesso = enviarDadosPendentes(armazenamento, faixas_envio);
 
             if (sucesso)
             {
-                Serial.println("upload bem-sucedido na tentativa " + String(tentativa));
-                return true;
+                Serial.print("upload bem-sucedido na tentativa ");
+                Serial.println(tentativa);
             }
-
             // se não foi a última tentativa, espera e tenta novamente
-            if (tentativa < max_tentativas)
+            else if (tentativa < max_tentativas)
             {
                 Serial.println("aguardando " + String(delay_entre_tentativas / 1000) + " segundos para retentativa...");
                 delay(delay_entre_tentativas);
             }
         }
 
-        Serial.println("todas as " + String(max_tentativas) + " tentativas falharam");
-        Serial.println("dados mantidos para proximo ciclo com wifi");
-        return false;
+        // lotes confirmados de faixas enviadas em parte saem da flash de uma vez
+        armazenamento.consolidarEnvio();
+
+        if (!sucesso)
+        {
+            Serial.println("todas as " + String(max_tentativas) + " tentativas falharam");
+            Serial.println("dados mantidos para proximo ciclo com wifi");
+        }
+        return sucesso;
+    }
+
+    /**
+     * habilita/desabilita o envio pelo gateway (o http continua disponivel)
+     */
+    void setGatewayHabilitado(bool habilitado)
+    {
+        gateway_habilitado = habilitado;
+    }
+
+    bool gatewayHabilitado() const
+    {
+        return gateway_habilitado;
+    }
+
+    /**
+     * bytes entregues ao radio desde o boot (sem cabecalhos http/tcp nem do quadro)
+     */
+    uint32_t bytesEnviados() const
+    {
+        return bytes_enviados;
     }
 
     /**
@@ -170,4 +778,9 @@ public:
     }
 };
 
+typedef GerenciadorUploadBase<Plataforma::Transporte, Plataforma::Enlace> GerenciadorUpload;
+
+// orcamento de memoria do gerenciador (config.h)
+static_assert(sizeof(GerenciadorUpload) <= ORCAMENTO_OBJETO_UPLOAD, "GerenciadorUpload acima do orcamento de memoria");
+
 #endif
\ No newline at end of file
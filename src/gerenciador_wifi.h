@@ -3,9 +3,39 @@
 
 #include "config.h"
 #include "Arduino.h"
+#include "plataforma.h"
 #include <WiFi.h>
 
-class GerenciadorWiFi
+// BACKENDS DE REDE
+
+/*
+ *  [i] rede wifi com as credenciais do config_privado.h
+ */
+struct RedeEstacao
+{
+    static const char *nome() { return WIFI_SSID; }
+    static const char *senha() { return WIFI_SENHA; }
+    static const int32_t canal = 0;             // 0 = varredura automatica
+    static const uint8_t tentativas = 20;       // mais tentativas no fisico
+    static const uint16_t intervalo_ms = 1000;
+};
+
+/*
+ *  [i] rede simulada do wokwi (aberta, canal fixo para conexao rapida)
+ */
+struct RedeWokwi
+{
+    static const char *nome() { return "Wokwi-GUEST"; }
+    static const char *senha() { return ""; }
+    static const int32_t canal = 6;
+    static const uint8_t tentativas = 15;
+    static const uint16_t intervalo_ms = 500;
+};
+
+// CLASSE GERENCIADOR WIFI
+
+template <typename Rede>
+class GerenciadorWiFiBase
 {
 private:
     bool wifi_conectado;
@@ -15,54 +45,25 @@ public:
     /*
      * construtor - inicializa o gerenciador wifi
      */
-    GerenciadorWiFi()
+    GerenciadorWiFiBase()
     {
         wifi_conectado = false;
         ultima_tentativa = 0;
     }
 
     /*
-     * tenta conectar ao wifi nos dois ambientes
-     * no wokwi: usa rede real "Wokwi-GUEST"
-     * no fisico: usa credenciais do config.h
+     * tenta conectar na rede do backend (Wokwi-GUEST ou credenciais do config.h)
      */
     bool conectar()
     {
         Serial.println("\nconectando ao wifi...");
-
-#ifdef AMBIENTE_WOKWI
-        // wokwi: conexao real com rede simulada do wokwi
-        Serial.println("wokwi: usando rede Wokwi-GUEST");
-        WiFi.begin("Wokwi-GUEST", "", 6); // canal 6 para conexao rapida
-
-        Serial.print("conectando");
-        for (int i = 0; i < 15; i++)
-        {
-            if (WiFi.status() == WL_CONNECTED)
-            {
-                wifi_conectado = true;
-                Serial.println("\nwokwi: wifi conectado!");
-                Serial.print("endereco ip: ");
-                Serial.println(WiFi.localIP());
-                return true;
-            }
-            delay(500);
-            Serial.print(".");
-        }
-
-        Serial.println("\n[!] wokwi: falha ao conectar wifi");
-        wifi_conectado = false;
-        return false;
-
-#else
-        // esp32 fisico: conexao real com credenciais do config.h
         Serial.print("conectando a rede: ");
-        Serial.print(WIFI_SSID);
+        Serial.print(Rede::nome());
         Serial.print(" ...");
 
-        WiFi.begin(WIFI_SSID, WIFI_SENHA);
+        WiFi.begin(Rede::nome(), Rede::senha(), Rede::canal);
 
-        for (int i = 0; i < 20; i++) // mais tentativas no fisico
+        for (uint8_t i = 0; i < Rede::tentativas; i++)
         {
             if (WiFi.status() == WL_CONNECTED)
             {
@@ -72,29 +73,21 @@ public:
                 Serial.println(WiFi.localIP());
                 return true;
             }
-            delay(1000);
+            delay(Rede::intervalo_ms);
             Serial.print(".");
         }
 
         Serial.println("\n[!] falha ao conectar wifi");
         wifi_conectado = false;
         return false;
-#endif
     }
 
     /*
-     * verifica se esta conectado ao wifi
-     * em ambos ambientes verifica o status real da conexao
+     * verifica se esta conectado ao wifi (status real da conexao)
      */
     bool estaConectado()
     {
-#ifdef AMBIENTE_WOKWI
-        // wokwi: verifica status real da conexao
         return WiFi.status() == WL_CONNECTED;
-#else
-        // fisico: verifica status real da conexao
-        return WiFi.status() == WL_CONNECTED;
-#endif
     }
 
     /*
@@ -110,18 +103,9 @@ public:
         }
 
         Serial.println("\nverificando conexao para upload...");
-
-#ifdef AMBIENTE_WIFI
-        // wokwi: simula verificacao de conexao
-        Serial.println("wokwi: conexao wifi verificada - pronto para upload");
-        Serial.println("servidor: " + String(SERVIDOR_URL));
-        return true;
-#else
-        // fisico: verifica conexao real
         Serial.println("conexao wifi verificada - pronto para upload");
         Serial.println("servidor: " + String(SERVIDOR_URL));
         return true;
-#endif
     }
 
     /*
@@ -149,4 +133,6 @@ public:
     }
 };
 
+typedef GerenciadorWiFiBase<Plataforma::Rede> GerenciadorWiFi;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef GRADE_AMOSTRAGEM_H
+#define GRADE_AMOSTRAGEM_H
+
+#include "config.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  [i] grade de amostragem: amostras em epoch multiplo do periodo
+ *
+ *  um sono de duracao fixa conta a partir do fim de um ciclo de duracao
+ *  variavel, entao cada ciclo empurra a fase da serie, e um despertar
+ *  fora do timer (botao, LDR) recomeca a contagem. aqui cada sono sai
+ *  da proxima fronteira absoluta da grade:
+ *
+ *    sono = fronteira + ATRASO_GRADE_MS - latencia - agora
+ *
+ *  agora e o epoch corrigido no fim do ciclo, entao ja desconta todo o
+ *  tempo acordado. latencia vai do disparo do timer ate o timestamp da
+ *  amostra (boot, setup, prints antes de dormir): tudo o que se repete
+ *  entre um calculo e a amostra seguinte. ela e medida a cada despertar
+ *  por timer, pelo erro da amostra em relacao ao alvo.
+ *
+ *  o timer corre no RTC: a duracao pedida leva a deriva estimada pelo
+ *  GerenciadorTempo (RTC adiantado conta mais rapido, entao pede mais).
+ *
+ *  funcoes puras sobre o EstadoGrade, para o simulador do host
+ *  (ferramentas/jitter_grade.cpp) rodar exatamente as mesmas contas.
+ */
+
+struct EstadoGrade
+{
+    uint32_t assinatura;    // diferente de ASSINATURA_GRADE apos cold boot
+    int64_t us_alvo;        // epoch (us) planejado para a proxima amostra (0 = sem plano)
+    int32_t latencia_us;    // disparo do timer -> timestamp da amostra
+    int32_t ultimo_erro_us; // amostra - alvo no ultimo despertar por timer
+    uint32_t amostras;      // despertares por timer comparados com o alvo
+    uint32_t slots_pulados; // fronteiras perdidas por ciclo longo demais
+};
+
+const uint32_t ASSINATURA_GRADE = 0x47524431;
+
+/*
+ * cold boot: sem alvo, latencia de fabrica
+ */
+inline void iniciarGrade(EstadoGrade &estado)
+{
+    if (estado.assinatura == ASSINATURA_GRADE)
+        return;
+
+    memset(&estado, 0, sizeof(estado));
+    estado.assinatura = ASSINATURA_GRADE;
+    estado.latencia_us = (int32_t)LATENCIA_DESPERTAR_MS * 1000;
+}
+
+/*
+ * compara a amostra de um despertar por timer com o alvo e corrige a latencia
+ * erro acima de ERRO_MAXIMO_GRADE_MS (ntp corrigiu o relogio, periodo mudou)
+ * nao entra na estimativa; retorna o erro (us)
+ */
+inline int64_t registrarAmostraGrade(EstadoGrade &estado, int64_t amostra_us)
+{
+    if (estado.us_alvo == 0)
+        return 0;
+
+    int64_t erro_us = amostra_us - estado.us_alvo;
+    estado.ultimo_erro_us = erro_us > INT32_MAX ? INT32_MAX : erro_us < INT32_MIN ? INT32_MIN : (int32_t)erro_us;
+    if (erro_us > (int64_t)ERRO_MAXIMO_GRADE_MS * 1000 || erro_us < -(int64_t)ERRO_MAXIMO_GRADE_MS * 1000)
+        return erro_us;
+
+    // acordou tarde: a latencia real e maior que a estimada
+    // a primeira medida substitui a de fabrica; as seguintes so filtram o jitter do boot
+    estado.latencia_us += (int32_t)(estado.amostras == 0 ? erro_us : erro_us * GANHO_LATENCIA_GRADE);
+    if (estado.latencia_us < 0)
+        estado.latencia_us = 0;
+    estado.amostras++;
+    return erro_us;
+}
+
+/*
+ * alvo da proxima amostra: fronteira da grade com ao menos SONO_MINIMO_MS de sono
+ */
+inline int64_t proximoAlvoUs(int64_t agora_us, uint32_t periodo_ms, int32_t latencia_us)
+{
+    int64_t periodo_us = (int64_t)periodo_ms * 1000;
+    int64_t minimo_us = agora_us + latencia_us + (int64_t)SONO_MINIMO_MS * 1000 - (int64_t)ATRASO_GRADE_MS * 1000;
+    int64_t fronteira_us = (minimo_us + periodo_us - 1) / periodo_us * periodo_us;
+    return fronteira_us + (int64_t)ATRASO_GRADE_MS * 1000;
+}
+
+/*
+ * duracao real -> duracao pedida ao timer do RTC
+ */
+inline uint64_t duracaoNoRtcUs(int64_t real_us, float deriva_ppm)
+{
+    return (uint64_t)(real_us + (int64_t)(real_us * (deriva_ppm / 1000000.0)));
+}
+
+/*
+ * planeja o sono ate o proximo alvo da grade: guarda o alvo e
+ * retorna a duracao a pedir ao timer (us)
+ */
+inline uint64_t planejarSonoGrade(EstadoGrade &estado, int64_t agora_us, uint32_t periodo_ms, float deriva_ppm)
+{
+    int64_t alvo_us = proximoAlvoUs(agora_us, periodo_ms, estado.latencia_us);
+
+    // o alvo anterior ainda estava a frente (despertar externo) ou foi o desta amostra:
+    // qualquer fronteira entre ele e o novo alvo ficou sem amostra
+    int64_t periodo_us = (int64_t)periodo_ms * 1000;
+    if (estado.us_alvo != 0 && alvo_us - estado.us_alvo > periodo_us)
+        estado.slots_pulados += (alvo_us - estado.us_alvo) / periodo_us - 1;
+
+    estado.us_alvo = alvo_us;
+    return duracaoNoRtcUs(alvo_us - estado.latencia_us - agora_us, deriva_ppm);
+}
+
+#endif
@@ -5,6 +5,13 @@
 #include "gerenciador_time.h"
 #include "gerenciador_upload.h"
 #include "gerenciador_wifi.h"
+#include "gerenciador_ciclo.h"
+#include "gerenciador_rajada.h"
+#include "gerenciador_config.h"
+#include "gerenciador_energia.h"
+#include "gerenciador_telemetria.h"
+#include "desempenho_ciclo.h"
+#include "console_serial.h"
 #include "Arduino.h"
 
 // gerenciadores do sistema
@@ -14,16 +21,42 @@ GerenciadorSleep gerenciadorSleep;
 GerenciadorTempo gerenciadorTempo;
 GerenciadorWiFi gerenciadorWiFi;
 GerenciadorUpload gerenciadorUpload;
-
-// controle de sleep simulado
-bool esta_dormindo = false;
-unsigned long tempo_inicio_sono = 0;
+GerenciadorRajada gerenciadorRajada;
+GerenciadorConfig gerenciadorConfig;
+GerenciadorEnergia gerenciadorEnergia;
+GerenciadorTelemetria gerenciadorTelemetria;
+MonitorDesempenho monitorDesempenho;
+GerenciadorCiclo gerenciadorCiclo(gerenciadorTempo, gerenciadorSensores, gerenciadorArmazenamento,
+                                  gerenciadorWiFi, gerenciadorUpload, gerenciadorRajada, gerenciadorEnergia,
+                                  gerenciadorTelemetria);
+GerenciadorConsole gerenciadorConsole(gerenciadorArmazenamento, gerenciadorConfig, gerenciadorSensores,
+                                      gerenciadorEnergia, gerenciadorTelemetria, gerenciadorTempo);
+
+/*
+ * repassa a configuracao ativa (fabrica ou remota) aos gerenciadores
+ */
+void aplicarConfiguracao()
+{
+  const ConfigRemota &config = gerenciadorConfig.atual();
+  gerenciadorUpload.configurar(gerenciadorConfig);
+  gerenciadorTempo.definirLimiteIncerteza(config.limite_incerteza_ms);
+  gerenciadorSensores.definirLimitesRegras(config.limites_regras);
+}
 
 void setup()
 {
-  Serial.begin(115200);
+  Serial.begin(VELOCIDADE_CONSOLE);
   delay(1000);
 
+  // contabiliza o sono que terminou antes de qualquer trabalho
+  gerenciadorEnergia.iniciar();
+
+  // conta o boot e guarda o motivo do reset
+  gerenciadorTelemetria.iniciar();
+
+  // orcamento do ciclo conta a flash a partir daqui
+  monitorDesempenho.iniciar();
+
   Serial.println("\n[data logger] inicializando sistema");
   Serial.println("==========================================");
 
@@ -31,6 +64,15 @@ void setup()
   pinMode(PINO_BOTAO, INPUT_PULLUP);
   Serial.println("configurado botao no pino: " + String(PINO_BOTAO));
 
+  // saida digital do LDR dispara rajadas ao mudar de nivel
+  pinMode(PINO_LDR_DIGITAL, INPUT);
+
+  // acordou pelo botao ou pelo LDR: captura rajada neste ciclo
+  // energizou ou botao: console escuta comandos ao fim do ciclo
+  esp_sleep_wakeup_cause_t causa = gerenciadorSleep.aoAcordar();
+  gerenciadorRajada.armarPorDespertar(causa);
+  gerenciadorConsole.armarPorDespertar(causa);
+
   // inicializa todos os sistemas
   Serial.println("\ninicializando modulos:");
 
@@ -38,6 +80,11 @@ void setup()
   gerenciadorSensores.iniciar();
   Serial.println("pronto");
 
+  Serial.print("- configuracao: ");
+  gerenciadorConfig.carregar();
+  aplicarConfiguracao();
+  Serial.println("v" + String(gerenciadorConfig.atual().versao));
+
   Serial.print("- tempo: ");
   gerenciadorTempo.iniciar();
   Serial.println("pronto");
@@ -52,15 +99,18 @@ void setup()
     Serial.println("falha");
   }
 
-  Serial.print("- wifi: ");
-  gerenciadorWiFi.conectar();
-  Serial.println(gerenciadorWiFi.estaConectado() ? "conectado" : "desconectado");
+  // wifi conecta no nucleo 0 durante o ciclo, em paralelo com a leitura
+  Serial.println("- wifi: conecta em paralelo no ciclo");
 
   // status do sistema
   Serial.println("\nstatus do sistema:");
   gerenciadorSensores.imprimirStatus();
+  gerenciadorConfig.imprimirStatus();
+  gerenciadorEnergia.imprimirStatus();
+  gerenciadorTelemetria.imprimirStatus();
   gerenciadorTempo.imprimirTempoAtual();
   gerenciadorArmazenamento.listarArquivos();
+  gerenciadorArmazenamento.imprimirEstatisticasFlash();
 
   Serial.println("==========================================");
   Serial.println("[data logger] sistema pronto para operacao");
@@ -69,107 +119,33 @@ void setup()
 
 void loop()
 {
-  // estado: acordado - fazer leituras
-  if (!esta_dormindo)
-  {
-    Serial.println("\n[data logger] iniciando ciclo de leitura");
-
-    // obtem timestamp atual
-    Serial.println("obtendo timestamp...");
-    DadosTempo dados_tempo = gerenciadorTempo.obterTempo();
-
-    // le dados dos sensores
-    Serial.println("lendo sensores...");
-    DadosSensores dados_sensores = gerenciadorSensores.lerSensores();
-
-    // exibe dados coletados
-    Serial.println("\ndados coletados:");
-    Serial.println("  timestamp: " + String(dados_tempo.epoch) + " (" + String(dados_tempo.data_hora) + ")");
-
-    if (dados_sensores.temperatura_valida)
-    {
-      Serial.println("  temperatura: " + String(dados_sensores.temperatura, 2) + " graus celsius");
-    }
-    else
-    {
-      Serial.println("  temperatura: sensor indisponivel");
-    }
-
-    if (dados_sensores.luminosidade_valida)
-    {
-      Serial.println("  luminosidade: " + String(dados_sensores.luminosidade, 2) + " lux");
-    }
-    else
-    {
-      Serial.println("  luminosidade: sensor indisponivel");
-    }
-
-    // salva dados no armazenamento
-    Serial.println("\nsalvando dados...");
-    if (gerenciadorArmazenamento.salvarRegistro(dados_tempo, dados_sensores))
-    {
-      Serial.println("dados salvos com sucesso");
-    }
-    else
-    {
-      Serial.println("falha ao salvar dados");
-    }
-
-    // verifica e envia dados pendentes
-    Serial.println("\nverificando conexao para upload...");
-    if (gerenciadorWiFi.estaConectado())
-    {
-      Serial.println("wifi disponivel - iniciando upload de dados");
-      gerenciadorUpload.enviarComRetentativas(gerenciadorArmazenamento);
-    }
-    else
-    {
-      Serial.println("wifi indisponivel - dados mantidos localmente");
-    }
-
-// controle de sleep
-#ifdef AMBIENTE_WOKWI
-    Serial.println("\n[data logger] entrando em modo sleep");
-    Serial.println("tempo de sleep: " + String(TEMPO_DEEP_SLEEP_DEMO / 1000) + " segundos");
-    Serial.println("aguardando timer ou acionamento do botao...");
-    esta_dormindo = true;
-    tempo_inicio_sono = millis();
-#else
-    gerenciadorSleep.entrarDeepSleep();
-#endif
-  }
+  Serial.println("\n[data logger] iniciando ciclo de leitura");
 
-// estado: dormindo - apenas no wokwi
-#ifdef AMBIENTE_WOKWI
-  if (esta_dormindo)
-  {
-    // verifica se tempo de sleep acabou
-    if (millis() - tempo_inicio_sono >= TEMPO_DEEP_SLEEP_DEMO)
-    {
-      esta_dormindo = false;
-      Serial.println("\n[data logger] acordado por timer");
-    }
-
-    // verifica se botao foi pressionado
-    if (digitalRead(PINO_BOTAO) == LOW)
-    {
-      esta_dormindo = false;
-      Serial.println("\n[data logger] acordado por botao");
-      delay(300);
-      while (digitalRead(PINO_BOTAO) == LOW)
-        delay(50);
-      tempo_inicio_sono = millis();
-    }
-
-    // mostra sinal de atividade enquanto dorme
-    static unsigned long ultimo_pisca = 0;
-    if (millis() - ultimo_pisca > 1000)
-    {
-      Serial.print(".");
-      ultimo_pisca = millis();
-    }
-  }
-#endif
+  // config recebida no ciclo anterior (sem deep sleep real no wokwi)
+  gerenciadorConfig.promoverPendente();
+  aplicarConfiguracao();
+
+  // leitura no nucleo 1; radio e gravacao (pela fila) no nucleo 0
+  gerenciadorCiclo.executarCiclo();
+
+  // despertar por timer: quanto a amostra ficou do alvo da grade
+  gerenciadorSleep.registrarAmostra(gerenciadorCiclo.instanteAmostraUs());
 
-  delay(100);
-}
\ No newline at end of file
+  // orcamento do ciclo, sem a janela do console (que espera o operador)
+  monitorDesempenho.encerrarCiclo(gerenciadorEnergia.acordadoMs(), gerenciadorUpload.bytesEnviados());
+
+  // comandos pela UART (recuperacao de dados sem wifi)
+  gerenciadorConsole.atender();
+
+  // fecha a contabilidade do ciclo antes de dormir
+  gerenciadorEnergia.encerrarCiclo();
+
+  // controle de sleep: dorme ate a proxima fronteira da grade de amostragem
+  // no esp32 nao retorna; no wokwi volta ao acordar
+  gerenciadorSleep.entrarDeepSleep(gerenciadorConfig.atual().periodo_amostragem_ms, gerenciadorTempo.epochUs(),
+                                   gerenciadorTempo.derivaPpm());
+  gerenciadorEnergia.registrarDespertar();
+  esp_sleep_wakeup_cause_t causa = gerenciadorSleep.aoAcordar();
+  gerenciadorRajada.armarPorDespertar(causa);
+  gerenciadorConsole.armarPorDespertar(causa);
+}
@@ -0,0 +1,77 @@
+#ifndef MODELO_ENERGIA_H
+#define MODELO_ENERGIA_H
+
+#include <stdint.h>
+
+/*
+ *  [i] modelo de energia por estados
+ *
+ *  o consumo de um ciclo e a soma, por estado, de corrente x tempo. as
+ *  correntes sao aditivas: a CPU conta durante todo o tempo acordado e o
+ *  radio e a flash somam o seu incremento enquanto estao ativos.
+ *
+ *  sem Arduino, para a calculadora do host rodar exatamente o mesmo modelo.
+ */
+
+enum EstadoEnergia
+{
+    ENERGIA_SONO,  // deep sleep (RTC + ULP desligado)
+    ENERGIA_CPU,   // acordado, CPU ativa
+    ENERGIA_RADIO, // incremento do wifi associado/transmitindo
+    ENERGIA_FLASH, // incremento durante escrita/apagamento na flash
+    TOTAL_ESTADOS_ENERGIA
+};
+
+/*
+ *  [i] corrente media de cada estado em mA (ver config.h)
+ */
+struct TabelaCorrente
+{
+    float corrente_ma[TOTAL_ESTADOS_ENERGIA];
+};
+
+/*
+ *  [i] tempos de um ciclo em cada estado (ms)
+ */
+struct TemposEnergia
+{
+    uint32_t ms[TOTAL_ESTADOS_ENERGIA];
+};
+
+// mA x ms -> uAh (1 uAh = 1 mA x 3.6 s)
+inline float energiaEstadoUAh(float corrente_ma, uint32_t ms)
+{
+    return corrente_ma * ms / 3600.0f;
+}
+
+inline float energiaUAh(const TemposEnergia &tempos, const TabelaCorrente &tabela)
+{
+    float soma = 0.0f;
+    for (uint8_t i = 0; i < TOTAL_ESTADOS_ENERGIA; i++)
+    {
+        soma += energiaEstadoUAh(tabela.corrente_ma[i], tempos.ms[i]);
+    }
+    return soma;
+}
+
+/*
+ * consumo diario em mAh para um consumo medio por ciclo e periodo medio
+ */
+inline float consumoDiarioMAh(float uah_por_ciclo, float periodo_ms)
+{
+    if (periodo_ms <= 0.0f)
+        return 0.0f;
+    return uah_por_ciclo / 1000.0f * (86400000.0f / periodo_ms);
+}
+
+/*
+ * dias de bateria para um consumo diario (sem autodescarga)
+ */
+inline float autonomiaDias(float capacidade_mah, float consumo_diario_mah)
+{
+    if (consumo_diario_mah <= 0.0f)
+        return 0.0f;
+    return capacidade_mah / consumo_diario_mah;
+}
+
+#endif
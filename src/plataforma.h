@@ -0,0 +1,66 @@
+#ifndef PLATAFORMA_H
+#define PLATAFORMA_H
+
+#include "config.h"
+
+/*
+ *  [i] especializacao por plataforma em tempo de compilacao
+ *
+ *  os gerenciadores sao templates sobre backends de E/S (arquivos, rede,
+ *  relogio, transporte, enlace do gateway, sono e ADC). wokwi, esp32
+ *  fisico e host nativo executam o mesmo codigo de caminho quente; so as
+ *  folhas mudam, escolhidas aqui por typedef - sem chamadas virtuais e
+ *  sem #ifdef nos gerenciadores.
+ *
+ *  cada backend e uma struct de funcoes estaticas definida no header do
+ *  gerenciador que a usa. o host nativo usa os backends do esp32 fisico:
+ *  os stand-ins de ferramentas/nativo substituem as bibliotecas.
+ */
+
+// BACKENDS DISPONIVEIS
+
+struct ArquivosLittleFS;   // LittleFS (flash real, flash emulada do wokwi ou diretorio do host)
+struct RedeEstacao;        // wifi com as credenciais do config_privado.h
+struct RedeWokwi;          // rede Wokwi-GUEST
+struct RelogioSNTP;        // NTP real, aguarda o status do SNTP
+struct RelogioSimulado;    // NTP sempre bem-sucedido
+struct TransporteHTTP;     // POST via HTTPClient
+struct TransporteSimulado; // eco no serial, resposta 200
+struct EnlaceEspNow;       // datagramas esp-now ao gateway local (udp no host)
+struct EnlaceAusente;      // sem gateway: tudo vai pelo transporte http
+struct SonoProfundo;       // deep sleep do esp32
+struct SonoSimulado;       // espera ativa no loop (wokwi)
+struct AdcEfuse;           // ADC caracterizado pelo eFuse
+struct AdcIdeal;           // ADC linear ideal (wokwi)
+
+// CONJUNTOS POR PLATAFORMA
+
+struct PlataformaESP32
+{
+    typedef ArquivosLittleFS Arquivos;
+    typedef RedeEstacao Rede;
+    typedef RelogioSNTP Relogio;
+    typedef TransporteHTTP Transporte;
+    typedef EnlaceEspNow Enlace;
+    typedef SonoProfundo Sono;
+    typedef AdcEfuse Adc;
+};
+
+struct PlataformaWokwi
+{
+    typedef ArquivosLittleFS Arquivos;
+    typedef RedeWokwi Rede;
+    typedef RelogioSimulado Relogio;
+    typedef TransporteSimulado Transporte;
+    typedef EnlaceAusente Enlace;
+    typedef SonoSimulado Sono;
+    typedef AdcIdeal Adc;
+};
+
+#ifdef AMBIENTE_WOKWI
+typedef PlataformaWokwi Plataforma;
+#else
+typedef PlataformaESP32 Plataforma;
+#endif
+
+#endif
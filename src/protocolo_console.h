@@ -0,0 +1,148 @@
+#ifndef PROTOCOLO_CONSOLE_H
+#define PROTOCOLO_CONSOLE_H
+
+#include "codec_registro.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  [i] quadros binarios da exportacao pelo console serial
+ *
+ *  quadro: A5 5A | tipo | sequencia (u32) | tamanho (u16) | carga | crc32 (u32)
+ *  inteiros little-endian; o crc32 cobre de tipo ate o fim da carga.
+ *
+ *  o dispositivo numera os quadros de uma exportacao: INICIO e o 0, os
+ *  blocos do arquivo sao 1..n e FIM e o n+1. o host responde ACK com o
+ *  proximo quadro esperado (cumulativo) e NAK com o primeiro que faltou;
+ *  o dispositivo mantem ate `janela` quadros sem ACK e volta ao primeiro
+ *  pendente no NAK ou no timeout (go-back-N). bytes fora de quadro ou com
+ *  crc errado sao descartados ate o proximo sincronismo.
+ *
+ *  firmware e cliente do host usam este mesmo codigo (sem Arduino).
+ */
+
+const uint8_t SINCRONISMO_QUADRO[2] = {0xA5, 0x5A};
+const size_t TAMANHO_CABECALHO_QUADRO = 9; // sincronismo + tipo + sequencia + tamanho
+const size_t TAMANHO_CRC_QUADRO = 4;
+const uint16_t CARGA_MAXIMA_QUADRO = 1024;
+
+enum TipoQuadro
+{
+    QUADRO_INICIO = 'I',  // carga: tamanho do arquivo (u32), carga por bloco (u16), janela (u8), nome
+    QUADRO_DADOS = 'D',   // carga: bloco do arquivo
+    QUADRO_FIM = 'F',     // carga: crc32 do arquivo inteiro (u32)
+    QUADRO_ACK = 'A',     // host: sequencia = proximo quadro esperado
+    QUADRO_NAK = 'N',     // host: sequencia = primeiro quadro que faltou
+    QUADRO_CANCELA = 'C'  // qualquer lado encerra a exportacao
+};
+
+inline void escreverU16(uint8_t *destino, uint16_t valor)
+{
+    destino[0] = valor;
+    destino[1] = valor >> 8;
+}
+
+inline void escreverU32(uint8_t *destino, uint32_t valor)
+{
+    for (uint8_t i = 0; i < 4; i++)
+        destino[i] = valor >> (8 * i);
+}
+
+inline uint16_t lerU16(const uint8_t *origem)
+{
+    return origem[0] | (uint16_t)origem[1] << 8;
+}
+
+inline uint32_t lerU32(const uint8_t *origem)
+{
+    return origem[0] | (uint32_t)origem[1] << 8 | (uint32_t)origem[2] << 16 | (uint32_t)origem[3] << 24;
+}
+
+constexpr size_t tamanhoQuadro(uint16_t carga)
+{
+    return TAMANHO_CABECALHO_QUADRO + carga + TAMANHO_CRC_QUADRO;
+}
+
+/*
+ * monta o quadro em saida (tamanhoQuadro(tamanho) bytes); a carga pode ja
+ * estar no lugar (saida + TAMANHO_CABECALHO_QUADRO), entao e copiada com memmove
+ */
+inline size_t montarQuadro(uint8_t tipo, uint32_t sequencia, const uint8_t *carga, uint16_t tamanho, uint8_t *saida)
+{
+    saida[0] = SINCRONISMO_QUADRO[0];
+    saida[1] = SINCRONISMO_QUADRO[1];
+    saida[2] = tipo;
+    escreverU32(saida + 3, sequencia);
+    escreverU16(saida + 7, tamanho);
+    if (tamanho > 0 && carga != saida + TAMANHO_CABECALHO_QUADRO)
+        memmove(saida + TAMANHO_CABECALHO_QUADRO, carga, tamanho);
+
+    size_t fim = TAMANHO_CABECALHO_QUADRO + tamanho;
+    escreverU32(saida + fim, crc32(saida + 2, fim - 2));
+    return fim + TAMANHO_CRC_QUADRO;
+}
+
+/*
+ * remonta quadros byte a byte (Capacidade = maior carga aceita)
+ */
+template <uint16_t Capacidade>
+struct DecodificadorQuadros
+{
+    uint8_t bruto[tamanhoQuadro(Capacidade)];
+    size_t recebidos = 0;
+    uint32_t descartados = 0; // bytes fora de quadro ou em quadros com crc errado
+
+    uint8_t tipo() const { return bruto[2]; }
+    uint32_t sequencia() const { return lerU32(bruto + 3); }
+    uint16_t tamanho() const { return lerU16(bruto + 7); }
+    const uint8_t *carga() const { return bruto + TAMANHO_CABECALHO_QUADRO; }
+
+    /*
+     * retorna true quando um quadro integro acabou de chegar
+     */
+    bool alimentar(uint8_t byte)
+    {
+        if (recebidos < 2)
+        {
+            if (byte == SINCRONISMO_QUADRO[recebidos])
+            {
+                bruto[recebidos++] = byte;
+                return false;
+            }
+            descartados += recebidos + 1;
+            recebidos = 0;
+            if (byte == SINCRONISMO_QUADRO[0])
+            {
+                bruto[recebidos++] = byte;
+                descartados--;
+            }
+            return false;
+        }
+
+        bruto[recebidos++] = byte;
+        if (recebidos < TAMANHO_CABECALHO_QUADRO)
+            return false;
+
+        uint16_t carga = tamanho();
+        if (carga > Capacidade)
+        {
+            descartados += recebidos;
+            recebidos = 0;
+            return false;
+        }
+        if (recebidos < tamanhoQuadro(carga))
+            return false;
+
+        size_t fim = TAMANHO_CABECALHO_QUADRO + carga;
+        recebidos = 0;
+        if (crc32(bruto + 2, fim - 2) != lerU32(bruto + fim))
+        {
+            descartados += tamanhoQuadro(carga);
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
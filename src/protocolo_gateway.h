@@ -0,0 +1,495 @@
+#ifndef PROTOCOLO_GATEWAY_H
+#define PROTOCOLO_GATEWAY_H
+
+#include "codec_registro.h"
+#include "protocolo_console.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  [i] lotes binarios para o gateway local (esp-now no dispositivo, udp no host)
+ *
+ *  datagrama: 'G' | tipo | dispositivo (mac, 6) | faixa | carga | crc32 (u32)
+ *  inteiros little-endian; o crc32 cobre da marca ate o fim da carga.
+ *  cada datagrama cabe num quadro esp-now (250 bytes) e decodifica sozinho:
+ *  perder um nao impede ler os outros.
+ *
+ *  LOTE: base (u32) | flags | canais | epoch (u32) | casas (4 bits por canal)
+ *        | registros
+ *  os registros sao as linhas do log em binario, sem perdas: o gateway
+ *  refaz o texto (e o crc32) identico ao da flash. cada registro:
+ *    controle | [salto de seq] | delta do epoch | [incerteza] | [mapa]
+ *    | [simulados, atipicos] | delta de cada valor presente
+ *  tudo em varint; deltas com sinal em zigzag. o controle diz quais
+ *  campos opcionais mudaram desde o registro anterior do datagrama.
+ *  ~6 bytes por registro, contra ~45 da linha CSV.
+ *
+ *  base e o seq anterior ao primeiro registro na sequencia do dispositivo:
+ *  seqs em (base, primeira) nao existem. com FLAG_BASE_CONFIRMADA o
+ *  dispositivo afirma que tudo ate base ja foi entregue (pelo gateway ou
+ *  pelo http) - e o primeiro datagrama de cada rodada.
+ *
+ *  ACK: primeira (u32) | ultima (u32) | confirmada (u32)
+ *  a faixa de seq do LOTE que chegou e o maior seq que o gateway tem sem
+ *  buracos para o dispositivo e a faixa. o gateway so aceita um LOTE
+ *  cujo base ja esta confirmado (go-back-N, como a exportacao do console):
+ *  o dispositivo reenvia a partir do confirmado.
+ *
+ *  firmware e gateway do host usam este mesmo codigo (sem Arduino).
+ */
+
+const uint8_t MARCA_GATEWAY = 'G';
+const size_t TAMANHO_MAXIMO_DATAGRAMA = 250; // carga maxima de um quadro esp-now
+const size_t TAMANHO_MAC_GATEWAY = 6;
+const size_t TAMANHO_CABECALHO_DATAGRAMA = 2 + TAMANHO_MAC_GATEWAY + 1; // marca + tipo + mac + faixa
+const size_t TAMANHO_CRC_DATAGRAMA = 4;
+const size_t TAMANHO_ACK_GATEWAY = TAMANHO_CABECALHO_DATAGRAMA + 12 + TAMANHO_CRC_DATAGRAMA;
+
+enum TipoDatagrama
+{
+    DATAGRAMA_LOTE = 'L', // dispositivo -> gateway
+    DATAGRAMA_ACK = 'A'   // gateway -> dispositivo
+};
+
+const uint8_t FLAG_BASE_CONFIRMADA = 0x01;
+
+// bits do byte de controle de cada registro
+const uint8_t CONTROLE_SALTO = 0x01;     // seq nao e o anterior + 1
+const uint8_t CONTROLE_INCERTEZA = 0x02; // incerteza mudou
+const uint8_t CONTROLE_MAPA = 0x04;      // mapa de canais mudou
+const uint8_t CONTROLE_MARCAS = 0x08;    // simulados/atipicos mudaram
+
+// VARINT
+
+inline size_t escreverVarint(uint8_t *destino, uint32_t valor)
+{
+    size_t n = 0;
+    while (valor >= 0x80)
+    {
+        destino[n++] = (uint8_t)(valor | 0x80);
+        valor >>= 7;
+    }
+    destino[n++] = (uint8_t)valor;
+    return n;
+}
+
+inline bool lerVarint(const uint8_t *&p, const uint8_t *fim, uint32_t &valor)
+{
+    valor = 0;
+    for (uint8_t deslocamento = 0; p < fim && deslocamento < 35; deslocamento += 7)
+    {
+        uint8_t byte = *p++;
+        valor |= (uint32_t)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint32_t zigzag(int32_t valor)
+{
+    return ((uint32_t)valor << 1) ^ (uint32_t)(valor >> 31);
+}
+
+inline int32_t desfazerZigzag(uint32_t valor)
+{
+    return (int32_t)(valor >> 1) ^ -(int32_t)(valor & 1);
+}
+
+// DATAGRAMA
+
+inline void escreverCabecalhoDatagrama(uint8_t tipo, const uint8_t *dispositivo, uint8_t faixa, uint8_t *saida)
+{
+    saida[0] = MARCA_GATEWAY;
+    saida[1] = tipo;
+    memcpy(saida + 2, dispositivo, TAMANHO_MAC_GATEWAY);
+    saida[2 + TAMANHO_MAC_GATEWAY] = faixa;
+}
+
+/*
+ * fecha o datagrama com o crc; retorna o tamanho total
+ */
+inline size_t fecharDatagrama(uint8_t *datagrama, size_t tamanho)
+{
+    escreverU32(datagrama + tamanho, crc32(datagrama, tamanho));
+    return tamanho + TAMANHO_CRC_DATAGRAMA;
+}
+
+/*
+ * marca, tamanho minimo e crc; tipo 0 aceita qualquer tipo
+ */
+inline bool verificarDatagrama(const uint8_t *dados, size_t tamanho, uint8_t tipo = 0)
+{
+    if (tamanho < TAMANHO_CABECALHO_DATAGRAMA + TAMANHO_CRC_DATAGRAMA || tamanho > TAMANHO_MAXIMO_DATAGRAMA ||
+        dados[0] != MARCA_GATEWAY || (tipo && dados[1] != tipo))
+        return false;
+    size_t corpo = tamanho - TAMANHO_CRC_DATAGRAMA;
+    return crc32(dados, corpo) == lerU32(dados + corpo);
+}
+
+inline size_t montarAckGateway(const uint8_t *dispositivo, uint8_t faixa, uint32_t primeira, uint32_t ultima,
+                               uint32_t confirmada, uint8_t *saida)
+{
+    escreverCabecalhoDatagrama(DATAGRAMA_ACK, dispositivo, faixa, saida);
+    escreverU32(saida + TAMANHO_CABECALHO_DATAGRAMA, primeira);
+    escreverU32(saida + TAMANHO_CABECALHO_DATAGRAMA + 4, ultima);
+    escreverU32(saida + TAMANHO_CABECALHO_DATAGRAMA + 8, confirmada);
+    return fecharDatagrama(saida, TAMANHO_CABECALHO_DATAGRAMA + 12);
+}
+
+struct AckGateway
+{
+    uint8_t dispositivo[TAMANHO_MAC_GATEWAY];
+    uint8_t faixa;
+    uint32_t primeira;
+    uint32_t ultima;
+    uint32_t confirmada;
+};
+
+inline bool lerAckGateway(const uint8_t *dados, size_t tamanho, AckGateway &ack)
+{
+    if (tamanho != TAMANHO_ACK_GATEWAY || !verificarDatagrama(dados, tamanho, DATAGRAMA_ACK))
+        return false;
+    memcpy(ack.dispositivo, dados + 2, TAMANHO_MAC_GATEWAY);
+    ack.faixa = dados[2 + TAMANHO_MAC_GATEWAY];
+    ack.primeira = lerU32(dados + TAMANHO_CABECALHO_DATAGRAMA);
+    ack.ultima = lerU32(dados + TAMANHO_CABECALHO_DATAGRAMA + 4);
+    ack.confirmada = lerU32(dados + TAMANHO_CABECALHO_DATAGRAMA + 8);
+    return true;
+}
+
+// CODIFICACAO DO LOTE
+
+/*
+ * estado de delta entre registros do mesmo datagrama
+ */
+struct ContextoLoteGateway
+{
+    uint32_t sequencia;
+    uint32_t epoch;
+    uint32_t incerteza_ms;
+    uint32_t mapa;
+    uint32_t simulados;
+    uint32_t atipicos;
+    int32_t valores[MAXIMO_CANAIS]; // ultimo valor de cada canal
+
+    void iniciar(uint32_t base)
+    {
+        memset(this, 0, sizeof(*this));
+        sequencia = base;
+    }
+};
+
+/*
+ *  [i] monta um LOTE registro a registro, sem alocacao
+ *
+ *  acrescentar() recusa o registro que nao cabe (ou que muda as casas
+ *  de um canal ja descrito): o chamador fecha este datagrama e abre outro
+ *  com base = ultima().
+ */
+class CodificadorLoteGateway
+{
+private:
+    uint8_t datagrama[TAMANHO_MAXIMO_DATAGRAMA];
+    size_t tamanho;
+    size_t inicio_casas;
+    uint8_t canais;
+    uint32_t casas_definidas; // canais com casas ja escritas no cabecalho
+    uint32_t primeira_seq;
+    uint16_t registros;
+    ContextoLoteGateway contexto;
+
+    /*
+     * registro em destino (ate 1 + 5 * (6 + MAXIMO_CANAIS) bytes); atualiza o contexto
+     */
+    static size_t codificarRegistro(const LinhaDecodificada &linha, ContextoLoteGateway &contexto, uint8_t *destino)
+    {
+        uint8_t controle = 0;
+        size_t n = 1;
+        if (linha.sequencia != contexto.sequencia + 1)
+        {
+            controle |= CONTROLE_SALTO;
+            n += escreverVarint(destino + n, linha.sequencia - contexto.sequencia - 1);
+        }
+        n += escreverVarint(destino + n, zigzag((int32_t)(linha.epoch - contexto.epoch)));
+        if (linha.incerteza_ms != contexto.incerteza_ms)
+        {
+            controle |= CONTROLE_INCERTEZA;
+            n += escreverVarint(destino + n, linha.incerteza_ms);
+        }
+        if (linha.mapa != contexto.mapa)
+        {
+            controle |= CONTROLE_MAPA;
+            n += escreverVarint(destino + n, linha.mapa);
+        }
+        if (linha.simulados != contexto.simulados || linha.atipicos != contexto.atipicos)
+        {
+            controle |= CONTROLE_MARCAS;
+            n += escreverVarint(destino + n, linha.simulados);
+            n += escreverVarint(destino + n, linha.atipicos);
+        }
+
+        uint32_t restantes = linha.mapa;
+        uint8_t posicao = 0;
+        while (restantes)
+        {
+            uint8_t canal = __builtin_ctz(restantes);
+            restantes &= restantes - 1;
+            int32_t valor = linha.valores[posicao++];
+            n += escreverVarint(destino + n, zigzag((int32_t)((uint32_t)valor - (uint32_t)contexto.valores[canal])));
+            contexto.valores[canal] = valor;
+        }
+        destino[0] = controle;
+
+        contexto.sequencia = linha.sequencia;
+        contexto.epoch = linha.epoch;
+        contexto.incerteza_ms = linha.incerteza_ms;
+        contexto.mapa = linha.mapa;
+        contexto.simulados = linha.simulados;
+        contexto.atipicos = linha.atipicos;
+        return n;
+    }
+
+public:
+    /*
+     * novo datagrama; epoch_base e o epoch de referencia do primeiro delta
+     */
+    void iniciar(const uint8_t *dispositivo, uint8_t faixa, uint32_t base, bool base_confirmada, uint8_t numero_canais,
+                 uint32_t epoch_base)
+    {
+        canais = numero_canais > MAXIMO_CANAIS ? MAXIMO_CANAIS : numero_canais;
+        escreverCabecalhoDatagrama(DATAGRAMA_LOTE, dispositivo, faixa, datagrama);
+        tamanho = TAMANHO_CABECALHO_DATAGRAMA;
+        escreverU32(datagrama + tamanho, base);
+        tamanho += 4;
+        datagrama[tamanho++] = base_confirmada ? FLAG_BASE_CONFIRMADA : 0;
+        datagrama[tamanho++] = canais;
+        escreverU32(datagrama + tamanho, epoch_base);
+        tamanho += 4;
+        inicio_casas = tamanho;
+        memset(datagrama + tamanho, 0, (canais + 1) / 2);
+        tamanho += (canais + 1) / 2;
+
+        casas_definidas = 0;
+        primeira_seq = 0;
+        registros = 0;
+        contexto.iniciar(base);
+        contexto.epoch = epoch_base;
+    }
+
+    /*
+     * false se o registro nao cabe neste datagrama
+     */
+    bool acrescentar(const LinhaDecodificada &linha)
+    {
+        if (linha.sequencia <= contexto.sequencia || (canais < MAXIMO_CANAIS && (linha.mapa >> canais) != 0))
+            return false;
+
+        // casas de cada canal presente: fixas dentro do datagrama
+        uint8_t casas[MAXIMO_CANAIS];
+        uint32_t novas = 0;
+        uint32_t restantes = linha.mapa;
+        uint8_t posicao = 0;
+        while (restantes)
+        {
+            uint8_t canal = __builtin_ctz(restantes);
+            restantes &= restantes - 1;
+            uint8_t casas_valor = linha.casas[posicao++];
+            if (casas_valor > 15)
+                return false;
+            if (casas_definidas & (1u << canal))
+            {
+                uint8_t byte = datagrama[inicio_casas + canal / 2];
+                if (((canal & 1) ? byte >> 4 : byte & 0xF) != casas_valor)
+                    return false;
+            }
+            else
+            {
+                novas |= 1u << canal;
+            }
+            casas[canal] = casas_valor;
+        }
+
+        uint8_t registro[1 + 5 * (6 + MAXIMO_CANAIS)];
+        ContextoLoteGateway proximo = contexto;
+        size_t n = codificarRegistro(linha, proximo, registro);
+        if (tamanho + n + TAMANHO_CRC_DATAGRAMA > TAMANHO_MAXIMO_DATAGRAMA)
+            return false;
+
+        while (novas)
+        {
+            uint8_t canal = __builtin_ctz(novas);
+            novas &= novas - 1;
+            datagrama[inicio_casas + canal / 2] |= (canal & 1) ? casas[canal] << 4 : casas[canal];
+            casas_definidas |= 1u << canal;
+        }
+        memcpy(datagrama + tamanho, registro, n);
+        tamanho += n;
+        contexto = proximo;
+        if (registros++ == 0)
+            primeira_seq = linha.sequencia;
+        return true;
+    }
+
+    /*
+     * fecha com o crc; o datagrama fica em dados() ate o proximo iniciar()
+     */
+    size_t fechar()
+    {
+        return fecharDatagrama(datagrama, tamanho);
+    }
+
+    const uint8_t *dados() const
+    {
+        return datagrama;
+    }
+
+    uint16_t quantidade() const
+    {
+        return registros;
+    }
+
+    uint32_t primeira() const
+    {
+        return primeira_seq;
+    }
+
+    uint32_t ultima() const
+    {
+        return contexto.sequencia;
+    }
+};
+
+// DECODIFICACAO DO LOTE
+
+struct CabecalhoLoteGateway
+{
+    uint8_t dispositivo[TAMANHO_MAC_GATEWAY];
+    uint8_t faixa;
+    uint32_t base;
+    bool base_confirmada;
+    uint8_t canais;
+    uint8_t casas[MAXIMO_CANAIS];
+};
+
+/*
+ * le o cabecalho de um LOTE ja verificado; p aponta para o primeiro registro
+ */
+inline bool lerCabecalhoLoteGateway(const uint8_t *dados, size_t tamanho, CabecalhoLoteGateway &cabecalho,
+                                    ContextoLoteGateway &contexto, const uint8_t *&p)
+{
+    const uint8_t *fim = dados + tamanho - TAMANHO_CRC_DATAGRAMA;
+    p = dados + TAMANHO_CABECALHO_DATAGRAMA;
+    if (fim - p < 10)
+        return false;
+
+    memcpy(cabecalho.dispositivo, dados + 2, TAMANHO_MAC_GATEWAY);
+    cabecalho.faixa = dados[2 + TAMANHO_MAC_GATEWAY];
+    cabecalho.base = lerU32(p);
+    cabecalho.base_confirmada = p[4] & FLAG_BASE_CONFIRMADA;
+    cabecalho.canais = p[5];
+    uint32_t epoch_base = lerU32(p + 6);
+    p += 10;
+    if (cabecalho.canais > MAXIMO_CANAIS || fim - p < (cabecalho.canais + 1) / 2)
+        return false;
+    for (uint8_t c = 0; c < cabecalho.canais; c++)
+        cabecalho.casas[c] = (c & 1) ? p[c / 2] >> 4 : p[c / 2] & 0xF;
+    p += (cabecalho.canais + 1) / 2;
+
+    contexto.iniciar(cabecalho.base);
+    contexto.epoch = epoch_base;
+    return true;
+}
+
+/*
+ * campos de um registro sobre uma copia do contexto
+ */
+inline bool decodificarRegistroGateway(const uint8_t *&p, const uint8_t *fim, const CabecalhoLoteGateway &cabecalho,
+                                       ContextoLoteGateway &contexto, LinhaDecodificada &linha)
+{
+    uint8_t controle = *p++;
+    uint32_t salto = 0, delta_epoch;
+    if ((controle & CONTROLE_SALTO) && !lerVarint(p, fim, salto))
+        return false;
+    if (!lerVarint(p, fim, delta_epoch))
+        return false;
+    if ((controle & CONTROLE_INCERTEZA) && !lerVarint(p, fim, contexto.incerteza_ms))
+        return false;
+    if ((controle & CONTROLE_MAPA) && !lerVarint(p, fim, contexto.mapa))
+        return false;
+    if ((controle & CONTROLE_MARCAS) && (!lerVarint(p, fim, contexto.simulados) || !lerVarint(p, fim, contexto.atipicos)))
+        return false;
+    if (cabecalho.canais < MAXIMO_CANAIS && (contexto.mapa >> cabecalho.canais) != 0)
+        return false;
+
+    contexto.sequencia += salto + 1;
+    contexto.epoch += desfazerZigzag(delta_epoch);
+    linha.sequencia = contexto.sequencia;
+    linha.epoch = contexto.epoch;
+    linha.incerteza_ms = contexto.incerteza_ms;
+    linha.mapa = contexto.mapa;
+    linha.simulados = contexto.simulados;
+    linha.atipicos = contexto.atipicos;
+
+    uint32_t restantes = contexto.mapa;
+    uint8_t posicao = 0;
+    while (restantes)
+    {
+        uint8_t canal = __builtin_ctz(restantes);
+        restantes &= restantes - 1;
+        uint32_t delta;
+        if (!lerVarint(p, fim, delta))
+            return false;
+        contexto.valores[canal] = (int32_t)((uint32_t)contexto.valores[canal] + (uint32_t)desfazerZigzag(delta));
+        linha.valores[posicao] = contexto.valores[canal];
+        linha.casas[posicao++] = cabecalho.casas[canal];
+    }
+    return true;
+}
+
+/*
+ * proximo registro do LOTE; false no fim (p == fim) ou se malformado (p != fim)
+ */
+inline bool lerRegistroLoteGateway(const uint8_t *&p, const uint8_t *fim, const CabecalhoLoteGateway &cabecalho,
+                                   ContextoLoteGateway &contexto, LinhaDecodificada &linha)
+{
+    if (p >= fim)
+        return false;
+
+    const uint8_t *inicio = p;
+    ContextoLoteGateway proximo = contexto;
+    if (!decodificarRegistroGateway(p, fim, cabecalho, proximo, linha))
+    {
+        p = inicio; // fica antes do registro ruim: o chamador ve p != fim
+        return false;
+    }
+    contexto = proximo;
+    return true;
+}
+
+/*
+ * linha do log refeita a partir do registro (texto e crc32 iguais aos da flash)
+ * saida precisa de tamanhoMaximoLinhaRegistro(MAXIMO_CANAIS) + 1 bytes
+ */
+inline size_t formatarLinhaGateway(const LinhaDecodificada &linha, const CabecalhoLoteGateway &cabecalho, char *saida)
+{
+    struct DescritorCasas
+    {
+        uint8_t casas;
+    };
+    DescritorCasas descritores[MAXIMO_CANAIS];
+    for (uint8_t c = 0; c < MAXIMO_CANAIS; c++)
+        descritores[c].casas = c < cabecalho.canais ? cabecalho.casas[c] : 0;
+
+    RegistroCanais<MAXIMO_CANAIS> canais;
+    canais.mapa = linha.mapa;
+    canais.simulados = linha.simulados;
+    canais.atipicos = linha.atipicos;
+    memcpy(canais.valores, linha.valores, __builtin_popcount(linha.mapa) * sizeof(int32_t));
+
+    uint32_t crc;
+    return formatarLinhaRegistro(linha.sequencia, linha.epoch, linha.incerteza_ms, canais, descritores, saida, crc);
+}
+
+#endif
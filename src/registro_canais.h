@@ -0,0 +1,202 @@
+#ifndef REGISTRO_CANAIS_H
+#define REGISTRO_CANAIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ *  [i] registro compacto de canais de sensores
+ *
+ *  cada registro guarda um mapa de presenca (bit i = canal i lido e valido)
+ *  e, em seguida, so os valores presentes, em ordem de canal, como inteiros
+ *  em ponto fixo (valor x 10^casas). canal ausente ou fora do seu periodo
+ *  nao ocupa espaco no CSV nem no upload.
+ *
+ *  marcas por canal (valor simulado, valor atipico) sao outros dois mapas;
+ *  no CSV viram um campo "s<hex>o<hex>" que fica vazio sem marcas.
+ *
+ *  no CSV a linha fica "mapa_hex,marcas,v0,v1,..." e o cabecalho lista os nomes
+ *  da tabela de canais: o bit i corresponde ao i-esimo nome. canais novos
+ *  entram no fim da tabela, entao logs antigos continuam legiveis.
+ *
+ *  as funcoes sao genericas sobre o tipo do descritor (campos nome e
+ *  casas), sem Arduino, para rodarem no host com tabelas de qualquer
+ *  tamanho.
+ */
+
+const uint8_t MAXIMO_CANAIS = 32; // mapa de presenca em 32 bits
+const uint8_t MAXIMO_CASAS_DECIMAIS = 6;
+
+// texto de um valor: sinal + 10 digitos + ponto + virgula
+const size_t TAMANHO_TEXTO_VALOR = 13;
+
+inline int32_t potenciaDez(uint8_t casas)
+{
+    static const int32_t potencias[MAXIMO_CASAS_DECIMAIS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    return potencias[casas > MAXIMO_CASAS_DECIMAIS ? MAXIMO_CASAS_DECIMAIS : casas];
+}
+
+/*
+ * valor real -> ponto fixo com arredondamento (satura em int32)
+ */
+inline int32_t escalarValor(float valor, uint8_t casas)
+{
+    double escalado = (double)valor * potenciaDez(casas);
+    if (escalado >= 2147483647.0)
+        return INT32_MAX;
+    if (escalado <= -2147483648.0)
+        return INT32_MIN;
+    return (int32_t)(escalado < 0 ? escalado - 0.5 : escalado + 0.5);
+}
+
+inline float valorReal(int32_t escalado, uint8_t casas)
+{
+    return (float)escalado / potenciaDez(casas);
+}
+
+/*
+ * ponto fixo -> texto ("-12.05"), sem printf nem float; retorna o tamanho
+ */
+inline size_t formatarPontoFixo(int32_t valor, uint8_t casas, char *saida)
+{
+    char digitos[12];
+    size_t n = 0;
+    uint32_t magnitude = valor < 0 ? 0u - (uint32_t)valor : (uint32_t)valor;
+
+    do
+    {
+        digitos[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0 || n <= casas);
+
+    size_t tamanho = 0;
+    if (valor < 0)
+        saida[tamanho++] = '-';
+    while (n > 0)
+    {
+        if (n == casas)
+            saida[tamanho++] = '.';
+        saida[tamanho++] = digitos[--n];
+    }
+    return tamanho;
+}
+
+// REGISTRO
+
+template <uint8_t Capacidade>
+struct RegistroCanais
+{
+    static_assert(Capacidade > 0 && Capacidade <= MAXIMO_CANAIS, "capacidade de canais fora do mapa de 32 bits");
+
+    uint32_t mapa;
+    uint32_t simulados; // canais com valor do gerador simulado
+    uint32_t atipicos;  // canais marcados pelo filtro de atipicos
+    int32_t valores[Capacidade]; // so os primeiros quantidade() sao validos
+
+    void limpar()
+    {
+        mapa = 0;
+        simulados = 0;
+        atipicos = 0;
+    }
+
+    uint8_t quantidade() const
+    {
+        return __builtin_popcount(mapa);
+    }
+
+    bool tem(uint8_t canal) const
+    {
+        return (mapa >> canal) & 1u;
+    }
+
+    /*
+     * define o valor escalado de um canal (em ordem crescente e o caso
+     * barato: so acrescenta no fim)
+     */
+    void definir(uint8_t canal, int32_t valor)
+    {
+        uint8_t posicao = posicaoDe(canal);
+        if (!tem(canal))
+        {
+            memmove(&valores[posicao + 1], &valores[posicao], (quantidade() - posicao) * sizeof(int32_t));
+            mapa |= 1u << canal;
+        }
+        valores[posicao] = valor;
+    }
+
+    int32_t valor(uint8_t canal) const
+    {
+        return valores[posicaoDe(canal)];
+    }
+
+private:
+    uint8_t posicaoDe(uint8_t canal) const
+    {
+        return __builtin_popcount(mapa & ((1u << canal) - 1u));
+    }
+};
+
+// OPERACOES GENERICAS SOBRE A TABELA
+
+/*
+ * tamanho maximo do trecho "mapa,marcas,v0,...,vN" (sem terminador)
+ */
+constexpr size_t tamanhoMaximoCanaisCSV(uint8_t canais)
+{
+    return 8 + 1 + 18 + canais * TAMANHO_TEXTO_VALOR;
+}
+
+/*
+ * mapa em hexa sem zeros a esquerda; retorna o tamanho
+ */
+inline size_t formatarMapa(uint32_t mapa, char *saida)
+{
+    static const char hexa[] = "0123456789abcdef";
+    size_t tamanho = 0;
+    int8_t deslocamento = 28;
+    while (deslocamento > 0 && ((mapa >> deslocamento) & 0xF) == 0)
+        deslocamento -= 4;
+    for (; deslocamento >= 0; deslocamento -= 4)
+        saida[tamanho++] = hexa[(mapa >> deslocamento) & 0xF];
+    return tamanho;
+}
+
+/*
+ * escreve "mapa_hex,marcas,v0,v1,..." em saida (terminado em zero)
+ * so percorre os bits presentes; retorna o tamanho
+ */
+template <typename Descritor, uint8_t Capacidade>
+inline size_t formatarCanaisCSV(const RegistroCanais<Capacidade> &registro, const Descritor *canais, char *saida)
+{
+    size_t tamanho = formatarMapa(registro.mapa, saida);
+
+    saida[tamanho++] = ',';
+    if (registro.simulados)
+    {
+        saida[tamanho++] = 's';
+        tamanho += formatarMapa(registro.simulados, saida + tamanho);
+    }
+    if (registro.atipicos)
+    {
+        saida[tamanho++] = 'o';
+        tamanho += formatarMapa(registro.atipicos, saida + tamanho);
+    }
+
+    uint32_t restantes = registro.mapa;
+    uint8_t posicao = 0;
+    while (restantes)
+    {
+        uint8_t canal = __builtin_ctz(restantes);
+        restantes &= restantes - 1;
+
+        saida[tamanho++] = ',';
+        tamanho += formatarPontoFixo(registro.valores[posicao++], canais[canal].casas, saida + tamanho);
+    }
+
+    saida[tamanho] = '\0';
+    return tamanho;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef SAUDE_CANAL_H
+#define SAUDE_CANAL_H
+
+#include "config.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ *  [i] saude de cada canal e filtro de valores atipicos
+ *
+ *  maquina de estados por canal:
+ *
+ *      OK --falha--> DEGRADADO --FALHAS_PARA_FALHO seguidas--> FALHO
+ *      FALHO: o sensor real fica em espera por 1, 2, 4... ciclos (ate
+ *      ESPERA_MAXIMA_CICLOS) e volta a ser tentado; um sucesso leva a
+ *      DEGRADADO e LEITURAS_PARA_RECUPERAR sucessos seguidos voltam a OK.
+ *
+ *  filtro de Hampel causal: mediana e MAD das ultimas TAMANHO_JANELA_HAMPEL
+ *  leituras; valor a mais de LIMIAR_HAMPEL desvios (1.4826 x MAD) da
+ *  mediana e marcado como atipico, sem leituras extras do ADC. o valor
+ *  entra na janela mesmo marcado, para um degrau real deixar de ser
+ *  atipico depois de meia janela.
+ *
+ *  as estruturas ficam na memoria RTC (sobrevivem ao deep sleep) e so usam
+ *  constantes do config.h, para os traces de falha rodarem no host.
+ */
+
+const uint8_t MINIMO_JANELA_HAMPEL = TAMANHO_JANELA_HAMPEL / 2 + 1; // antes disso nao julga
+
+enum SaudeCanal
+{
+    SAUDE_OK,
+    SAUDE_DEGRADADO, // falhou recentemente ou ainda em recuperacao
+    SAUDE_FALHO      // sensor real em espera, com retentativa espacada
+};
+
+// FILTRO DE HAMPEL
+
+struct FiltroHampel
+{
+    int32_t janela[TAMANHO_JANELA_HAMPEL]; // valores em ponto fixo do canal
+    uint8_t quantidade;
+    uint8_t proxima;
+
+    static void ordenar(int32_t *valores, uint8_t n)
+    {
+        for (uint8_t i = 1; i < n; i++)
+        {
+            int32_t atual = valores[i];
+            int8_t j = i - 1;
+            while (j >= 0 && valores[j] > atual)
+            {
+                valores[j + 1] = valores[j];
+                j--;
+            }
+            valores[j + 1] = atual;
+        }
+    }
+
+    /*
+     * julga o valor contra a janela e o acrescenta
+     * desvio_minimo evita marcar ruido quando o sinal esta parado (MAD = 0)
+     */
+    bool avaliar(int32_t valor, int32_t desvio_minimo)
+    {
+        bool atipico = false;
+
+        if (quantidade >= MINIMO_JANELA_HAMPEL)
+        {
+            int32_t ordenados[TAMANHO_JANELA_HAMPEL];
+            for (uint8_t i = 0; i < quantidade; i++)
+                ordenados[i] = janela[i];
+            ordenar(ordenados, quantidade);
+            int32_t mediana = ordenados[quantidade / 2];
+
+            for (uint8_t i = 0; i < quantidade; i++)
+                ordenados[i] = abs(janela[i] - mediana);
+            ordenar(ordenados, quantidade);
+            int32_t mad = ordenados[quantidade / 2];
+
+            float limite = LIMIAR_HAMPEL * 1.4826f * mad;
+            if (limite < desvio_minimo)
+                limite = desvio_minimo;
+            atipico = abs(valor - mediana) > limite;
+        }
+
+        janela[proxima] = valor;
+        proxima = (proxima + 1) % TAMANHO_JANELA_HAMPEL;
+        if (quantidade < TAMANHO_JANELA_HAMPEL)
+            quantidade++;
+
+        return atipico;
+    }
+};
+
+// MAQUINA DE SAUDE
+
+struct SaudeSensor
+{
+    uint8_t estado;           // SaudeCanal
+    uint8_t falhas_seguidas;
+    uint8_t acertos_seguidos;
+    uint16_t espera;          // ciclos de espera configurados na ultima falha
+    uint16_t ciclos_restantes; // ate a proxima tentativa do sensor real
+
+    /*
+     * consome um ciclo de espera; false = nao ler o sensor real agora
+     */
+    bool deveTentar()
+    {
+        if (estado != SAUDE_FALHO || ciclos_restantes == 0)
+            return true;
+        ciclos_restantes--;
+        return false;
+    }
+
+    void registrarSucesso()
+    {
+        falhas_seguidas = 0;
+        if (estado == SAUDE_OK)
+            return;
+
+        if (estado == SAUDE_FALHO)
+        {
+            estado = SAUDE_DEGRADADO;
+            acertos_seguidos = 0;
+        }
+
+        if (++acertos_seguidos >= LEITURAS_PARA_RECUPERAR)
+        {
+            estado = SAUDE_OK;
+            espera = 0;
+        }
+    }
+
+    void registrarFalha()
+    {
+        acertos_seguidos = 0;
+        if (falhas_seguidas < 0xFF)
+            falhas_seguidas++;
+
+        if (estado != SAUDE_FALHO && falhas_seguidas < FALHAS_PARA_FALHO)
+        {
+            estado = SAUDE_DEGRADADO;
+            return;
+        }
+
+        // falho (ou retentativa falhou): dobra a espera
+        estado = SAUDE_FALHO;
+        espera = espera == 0 ? 1 : espera * 2;
+        if (espera > ESPERA_MAXIMA_CICLOS)
+            espera = ESPERA_MAXIMA_CICLOS;
+        ciclos_restantes = espera;
+    }
+};
+
+inline const char *nomeSaude(uint8_t estado)
+{
+    switch (estado)
+    {
+    case SAUDE_OK:
+        return "ok";
+    case SAUDE_DEGRADADO:
+        return "degradado";
+    default:
+        return "falho";
+    }
+}
+
+#endif
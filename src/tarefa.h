@@ -0,0 +1,111 @@
+#ifndef TAREFA_H
+#define TAREFA_H
+
+#include "config.h"
+#include "Arduino.h"
+
+/*
+ *  [i] tarefa fixada em um nucleo
+ *
+ *  no esp32 usa FreeRTOS (xTaskCreatePinnedToCore); no build nativo usa
+ *  std::thread e ignora o nucleo. aguardar() bloqueia ate a funcao
+ *  terminar, como um join. no esp32 a tarefa guarda, ao terminar, o
+ *  minimo de pilha que ficou livre (high-water mark) para dimensionar a
+ *  pilha pelo que foi medido.
+ */
+
+#ifdef AMBIENTE_NATIVO
+#include <thread>
+#endif
+
+typedef void (*FuncaoTarefa)(void *argumento);
+
+class Tarefa
+{
+private:
+    FuncaoTarefa funcao;
+    void *argumento;
+    bool ativa;
+    uint32_t pilha_livre_minima; // bytes; 0 = nao medido (host)
+
+#ifdef AMBIENTE_NATIVO
+    std::thread thread;
+#else
+    SemaphoreHandle_t concluida;
+
+    // tarefas do FreeRTOS nao podem retornar: sinaliza e se apaga
+    static void trampolim(void *contexto)
+    {
+        Tarefa *tarefa = (Tarefa *)contexto;
+        tarefa->funcao(tarefa->argumento);
+        tarefa->pilha_livre_minima = uxTaskGetStackHighWaterMark(NULL);
+        xSemaphoreGive(tarefa->concluida);
+        vTaskDelete(NULL);
+    }
+#endif
+
+public:
+    Tarefa()
+    {
+        funcao = NULL;
+        argumento = NULL;
+        ativa = false;
+        pilha_livre_minima = 0;
+#ifndef AMBIENTE_NATIVO
+        concluida = xSemaphoreCreateBinary();
+#endif
+    }
+
+    /*
+     * cria a tarefa e retorna imediatamente
+     */
+    bool iniciar(const char *nome, FuncaoTarefa nova_funcao, void *novo_argumento,
+                 uint8_t nucleo, uint32_t pilha = 8192, uint8_t prioridade = 1)
+    {
+        if (ativa)
+            return false;
+
+        funcao = nova_funcao;
+        argumento = novo_argumento;
+
+#ifdef AMBIENTE_NATIVO
+        (void)nome; // o escalonador do host decide nucleo e prioridade
+        (void)nucleo;
+        (void)pilha;
+        (void)prioridade;
+        thread = std::thread(funcao, argumento);
+        ativa = true;
+#else
+        ativa = xTaskCreatePinnedToCore(trampolim, nome, pilha, this, prioridade, NULL, nucleo) == pdPASS;
+        if (!ativa)
+            Serial.println("[!] falha ao criar tarefa " + String(nome));
+#endif
+        return ativa;
+    }
+
+    /*
+     * espera a tarefa terminar
+     */
+    void aguardar()
+    {
+        if (!ativa)
+            return;
+
+#ifdef AMBIENTE_NATIVO
+        thread.join();
+#else
+        xSemaphoreTake(concluida, portMAX_DELAY);
+#endif
+        ativa = false;
+    }
+
+    /*
+     * menor folga de pilha da ultima execucao (bytes; 0 no host)
+     */
+    uint32_t pilhaLivreMinima() const
+    {
+        return pilha_livre_minima;
+    }
+};
+
+#endif